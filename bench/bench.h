@@ -0,0 +1,217 @@
+/*
+ * Helpers shared by the benchmark programs.
+ */
+
+#pragma once
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Keep the compiler from optimizing away a value that is computed
+ * only for the benchmark.
+ */
+#define BENCH_USE(x) __asm__ volatile("" : : "r"(x) : "memory")
+
+/* Keep a protothread function out of line, like a real one. */
+#define BENCH_NOINLINE __attribute__((noinline))
+
+static inline uint64_t
+bench_now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* A small xorshift generator, so that runs are reproducible. */
+static inline uint32_t
+bench_rand(uint32_t *state)
+{
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return *state = x;
+}
+
+/*---------------------------------------------------------------------------*/
+/*
+ * Hardware performance counters. Cycles and instructions are counted
+ * in user space for the calling thread with perf_event_open(). When
+ * the counters are not available (not Linux, no PMU in a virtual
+ * machine, or perf_event_paranoid too high) only the time is
+ * measured.
+ */
+struct bench_counters {
+  int fd;
+  uint64_t cycles;
+  uint64_t instructions;
+};
+
+#ifdef __linux__
+static inline int
+bench_perf_open(uint64_t config, int group)
+{
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.disabled = group == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+static inline void
+bench_counters_open(struct bench_counters *c)
+{
+  c->fd = -1;
+  c->cycles = 0;
+  c->instructions = 0;
+#ifdef __linux__
+  c->fd = bench_perf_open(PERF_COUNT_HW_CPU_CYCLES, -1);
+  if(c->fd >= 0 &&
+     bench_perf_open(PERF_COUNT_HW_INSTRUCTIONS, c->fd) < 0) {
+    close(c->fd);
+    c->fd = -1;
+  }
+#endif
+}
+
+#define bench_counters_available(c) ((c)->fd >= 0)
+
+static inline void
+bench_counters_start(struct bench_counters *c)
+{
+#ifdef __linux__
+  if(c->fd >= 0) {
+    ioctl(c->fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(c->fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+#else
+  (void)c;
+#endif
+}
+
+static inline void
+bench_counters_stop(struct bench_counters *c)
+{
+#ifdef __linux__
+  struct { uint64_t nr; uint64_t values[2]; } data;
+
+  if(c->fd >= 0) {
+    ioctl(c->fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    if(read(c->fd, &data, sizeof(data)) == (ssize_t)sizeof(data)) {
+      c->cycles = data.values[0];
+      c->instructions = data.values[1];
+    }
+  }
+#else
+  (void)c;
+#endif
+}
+
+/*---------------------------------------------------------------------------*/
+/*
+ * A benchmark is a function that performs a number of operations.
+ * bench_run() measures it and stores the cost per operation.
+ */
+struct bench_result {
+  const char *name;
+  const char *backend;
+  uint64_t ops;
+  double ns_per_op;
+  double cycles_per_op;
+  double instructions_per_op;
+  int have_counters;
+};
+
+static inline void
+bench_run(struct bench_result *r, const char *name, const char *backend,
+          void (*fn)(uint64_t ops), uint64_t ops)
+{
+  static struct bench_counters counters;
+  static int counters_opened;
+  uint64_t start, ns;
+
+  if(!counters_opened) {
+    bench_counters_open(&counters);
+    counters_opened = 1;
+  }
+
+  /* Warm up caches and branch predictors. */
+  fn(ops / 10 + 1);
+
+  start = bench_now_ns();
+  bench_counters_start(&counters);
+  fn(ops);
+  bench_counters_stop(&counters);
+  ns = bench_now_ns() - start;
+
+  r->name = name;
+  r->backend = backend;
+  r->ops = ops;
+  r->ns_per_op = (double)ns / ops;
+  r->have_counters = bench_counters_available(&counters);
+  r->cycles_per_op = (double)counters.cycles / ops;
+  r->instructions_per_op = (double)counters.instructions / ops;
+}
+
+static inline void
+bench_print_header(FILE *f)
+{
+  fprintf(f, "%-24s %-16s %10s %10s %10s\n",
+          "benchmark", "backend", "ns/op", "cycles/op", "instr/op");
+}
+
+static inline void
+bench_print(FILE *f, const struct bench_result *r)
+{
+  if(r->have_counters) {
+    fprintf(f, "%-24s %-16s %10.2f %10.2f %10.2f\n", r->name, r->backend,
+            r->ns_per_op, r->cycles_per_op, r->instructions_per_op);
+  } else {
+    fprintf(f, "%-24s %-16s %10.2f %10s %10s\n", r->name, r->backend,
+            r->ns_per_op, "-", "-");
+  }
+}
+
+static inline void
+bench_print_json(FILE *f, const struct bench_result *r, int n)
+{
+  int i;
+
+  fprintf(f, "{\n  \"benchmarks\": [\n");
+  for(i = 0; i < n; ++i) {
+    fprintf(f, "    {\"name\": \"%s\", \"backend\": \"%s\", \"ops\": %llu, "
+            "\"ns_per_op\": %.3f, ",
+            r[i].name, r[i].backend, (unsigned long long)r[i].ops,
+            r[i].ns_per_op);
+    if(r[i].have_counters) {
+      fprintf(f, "\"cycles_per_op\": %.3f, \"instructions_per_op\": %.3f}",
+              r[i].cycles_per_op, r[i].instructions_per_op);
+    } else {
+      fprintf(f, "\"cycles_per_op\": null, \"instructions_per_op\": null}");
+    }
+    fprintf(f, "%s\n", i + 1 < n ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+}
@@ -0,0 +1,252 @@
+/*
+ * Measures items per second through a bounded buffer.
+ *
+ * The producer and the consumer protothread exchange 32-bit items
+ * through buffers of 8 and 4096 slots:
+ *
+ * - sem: a ring buffer guarded by a pair of counting semaphores, like
+ *   example-buffer.c.
+ * - chan: PT_CHAN_SEND() and PT_CHAN_RECV(), one item at a time.
+ * - chan batch: PT_CHAN_SEND_BATCH() and PT_CHAN_RECV_BATCH() with up
+ *   to 64 items at a time.
+ *
+ * Both protothreads are first run alternately by the same thread, and
+ * then each on its own thread. The semaphores are not safe across
+ * threads, so only the channels are measured in the second case.
+ *
+ * Usage: bench_chan [items]
+ */
+
+#include "bench.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pt-chan.h"
+#include "pt-sem.h"
+
+#define BATCH 64
+
+static uint32_t items;
+static uint64_t checksum;
+
+/*---------------------------------------------------------------------------*/
+static uint32_t sem_buf[4096];
+static uint32_t sem_size, sem_in, sem_out;
+static struct pt_sem full, empty;
+
+static
+PT_THREAD(sem_producer(struct pt *pt, uint32_t *i))
+{
+  PT_BEGIN(pt);
+  for(*i = 0; *i < items; ++*i) {
+    PT_SEM_WAIT(pt, &full);
+    sem_buf[sem_in] = *i;
+    sem_in = (sem_in + 1) % sem_size;
+    PT_SEM_SIGNAL(pt, &empty);
+  }
+  PT_END(pt);
+}
+
+static
+PT_THREAD(sem_consumer(struct pt *pt, uint32_t *i))
+{
+  PT_BEGIN(pt);
+  for(*i = 0; *i < items; ++*i) {
+    PT_SEM_WAIT(pt, &empty);
+    checksum += sem_buf[sem_out];
+    sem_out = (sem_out + 1) % sem_size;
+    PT_SEM_SIGNAL(pt, &full);
+  }
+  PT_END(pt);
+}
+
+/*---------------------------------------------------------------------------*/
+/* Producer and consumer protothreads for one channel size. */
+#define CHAN_THREADS(name, size)					\
+  static PT_CHAN(uint32_t, size) name;					\
+									\
+  static								\
+  PT_THREAD(name##_send(struct pt *pt, uint32_t *i))			\
+  {									\
+    PT_BEGIN(pt);							\
+    for(*i = 0; *i < items; ++*i) {					\
+      PT_CHAN_SEND(pt, &name, *i);					\
+    }									\
+    PT_END(pt);								\
+  }									\
+									\
+  static								\
+  PT_THREAD(name##_recv(struct pt *pt, uint32_t *i))			\
+  {									\
+    static uint32_t item;						\
+									\
+    PT_BEGIN(pt);							\
+    for(*i = 0; *i < items; ++*i) {					\
+      PT_CHAN_RECV(pt, &name, &item);					\
+      checksum += item;							\
+    }									\
+    PT_END(pt);								\
+  }									\
+									\
+  static								\
+  PT_THREAD(name##_send_batch(struct pt *pt, uint32_t *i))		\
+  {									\
+    static uint32_t batch[BATCH];					\
+    static uint32_t n, k, sent;						\
+									\
+    PT_BEGIN(pt);							\
+    for(*i = 0; *i < items; *i += n) {					\
+      n = items - *i < BATCH ? items - *i : BATCH;			\
+      for(k = 0; k < n; ++k) {						\
+        batch[k] = *i + k;						\
+      }									\
+      for(k = 0; k < n; k += sent) {					\
+        PT_CHAN_SEND_BATCH(pt, &name, batch + k, n - k, sent);		\
+      }									\
+    }									\
+    PT_END(pt);								\
+  }									\
+									\
+  static								\
+  PT_THREAD(name##_recv_batch(struct pt *pt, uint32_t *i))		\
+  {									\
+    static uint32_t batch[BATCH];					\
+    static uint32_t n, k;						\
+									\
+    PT_BEGIN(pt);							\
+    for(*i = 0; *i < items; *i += n) {					\
+      PT_CHAN_RECV_BATCH(pt, &name, batch, BATCH, n);			\
+      for(k = 0; k < n; ++k) {						\
+        checksum += batch[k];						\
+      }									\
+    }									\
+    PT_END(pt);								\
+  }
+
+CHAN_THREADS(chan8, 8)
+CHAN_THREADS(chan4096, 4096)
+
+/*---------------------------------------------------------------------------*/
+typedef char (*thread_fn)(struct pt *pt, uint32_t *i);
+
+struct side {
+  thread_fn fn;
+  struct pt pt;
+  uint32_t i;
+};
+
+static void
+check(const char *name)
+{
+  if(checksum != (uint64_t)items * (items - 1) / 2) {
+    fprintf(stderr, "%s: wrong checksum\n", name);
+    exit(1);
+  }
+}
+
+static void
+run_same_thread(const char *name, uint32_t size, thread_fn send,
+                thread_fn recv)
+{
+  struct pt pt_send, pt_recv;
+  uint32_t i, j;
+  int sending = 1, receiving = 1;
+  uint64_t start, ns;
+
+  PT_INIT(&pt_send);
+  PT_INIT(&pt_recv);
+  checksum = 0;
+
+  start = bench_now_ns();
+  while(sending || receiving) {
+    sending = sending && PT_SCHEDULE(send(&pt_send, &i));
+    receiving = receiving && PT_SCHEDULE(recv(&pt_recv, &j));
+  }
+  ns = bench_now_ns() - start;
+
+  check(name);
+  printf("%-12s %-12s %6u %14.0f\n", "same thread", name, size,
+         (double)items * 1e9 / ns);
+}
+
+/*
+ * Runs a protothread until it ends. A waiting protothread yields the
+ * CPU, so that the other side makes progress even on a single core.
+ */
+static void *
+side_main(void *arg)
+{
+  struct side *s = arg;
+
+  PT_INIT(&s->pt);
+  while(PT_SCHEDULE(s->fn(&s->pt, &s->i))) {
+    sched_yield();
+  }
+  return NULL;
+}
+
+static void
+run_threads(const char *name, uint32_t size, thread_fn send, thread_fn recv)
+{
+  struct side s = { .fn = send }, r = { .fn = recv };
+  pthread_t thread;
+  uint64_t start, ns;
+
+  checksum = 0;
+
+  start = bench_now_ns();
+  pthread_create(&thread, NULL, side_main, &s);
+  side_main(&r);
+  pthread_join(thread, NULL);
+  ns = bench_now_ns() - start;
+
+  check(name);
+  printf("%-12s %-12s %6u %14.0f\n", "two threads", name, size,
+         (double)items * 1e9 / ns);
+}
+
+static void
+run_sem(uint32_t size)
+{
+  sem_size = size;
+  sem_in = sem_out = 0;
+  PT_SEM_INIT(&full, size);
+  PT_SEM_INIT(&empty, 0);
+  run_same_thread("sem", size, sem_producer, sem_consumer);
+}
+
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  items = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 10000000;
+
+  printf("%u items of %zu bytes\n\n", items, sizeof(uint32_t));
+  printf("%-12s %-12s %6s %14s\n", "threads", "buffer", "slots", "items/s");
+
+  run_sem(8);
+  PT_CHAN_INIT(&chan8);
+  run_same_thread("chan", 8, chan8_send, chan8_recv);
+  PT_CHAN_INIT(&chan8);
+  run_same_thread("chan batch", 8, chan8_send_batch, chan8_recv_batch);
+
+  run_sem(4096);
+  PT_CHAN_INIT(&chan4096);
+  run_same_thread("chan", 4096, chan4096_send, chan4096_recv);
+  PT_CHAN_INIT(&chan4096);
+  run_same_thread("chan batch", 4096, chan4096_send_batch,
+                  chan4096_recv_batch);
+
+  PT_CHAN_INIT(&chan8);
+  run_threads("chan", 8, chan8_send, chan8_recv);
+  PT_CHAN_INIT(&chan8);
+  run_threads("chan batch", 8, chan8_send_batch, chan8_recv_batch);
+  PT_CHAN_INIT(&chan4096);
+  run_threads("chan", 4096, chan4096_send, chan4096_recv);
+  PT_CHAN_INIT(&chan4096);
+  run_threads("chan batch", 4096, chan4096_send_batch, chan4096_recv_batch);
+  return 0;
+}
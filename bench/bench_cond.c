@@ -0,0 +1,155 @@
+/*
+ * Compares waiting for shared state to change with PT_WAIT_UNTIL()
+ * and with the condition variables in pt-cond.h.
+ *
+ * N protothreads wait for a version number to change, and it changes
+ * once every few ticks.
+ *
+ * - poll: each tick calls every protothread, which evaluates its
+ *   PT_WAIT_UNTIL() condition.
+ * - broadcast: the protothreads wait with PT_COND_WAIT_UNTIL() under
+ *   pt-sched.h, and each change is followed by pt_cond_broadcast(),
+ *   which appends the whole wait queue to the run queue at once.
+ * - broadcast, 2 prio: the same with the protothreads at two
+ *   priorities, so that the broadcast puts each waiter in the run
+ *   queue of its priority one by one.
+ *
+ * Usage: bench_cond [threads] [ticks-per-change] [ticks]
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pt-cond.h"
+
+struct waiter {
+  struct pt_task task;
+  uint32_t seen;
+};
+
+static struct pt_cond changed;
+static uint32_t version;
+static uint64_t checks;
+static uint64_t wakeups;
+
+static
+PT_THREAD(poll_thread(struct pt_task *t))
+{
+  struct waiter *w = (struct waiter *)t;
+
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    w->seen = version;
+    PT_WAIT_UNTIL(&t->pt, (++checks, version != w->seen));
+    ++wakeups;
+  }
+
+  PT_END(&t->pt);
+}
+
+static
+PT_THREAD(cond_thread(struct pt_task *t))
+{
+  struct waiter *w = (struct waiter *)t;
+
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    w->seen = version;
+    PT_COND_WAIT_UNTIL(t, &changed, (++checks, version != w->seen));
+    ++wakeups;
+  }
+
+  PT_END(&t->pt);
+}
+
+static void
+report(const char *name, uint64_t ns, uint64_t broadcast_ns,
+       uint32_t ticks, uint32_t changes)
+{
+  printf("%-18s %10.3f %14.0f %12.0f %14.1f\n", name, ns / 1e6 / ticks,
+         (double)checks / ticks, (double)wakeups / changes,
+         changes > 0 ? (double)broadcast_ns / changes : 0.0);
+}
+
+static void
+run_cond(struct waiter *w, uint32_t n, uint32_t every, uint32_t ticks,
+         int mixed)
+{
+  struct pt_sched sched;
+  uint64_t start, broadcast_ns = 0;
+  uint32_t i, tick;
+
+  PT_COND_INIT(&changed);
+  pt_sched_init(&sched);
+  version = 0;
+  for(i = 0; i < n; ++i) {
+    pt_sched_spawn_prio(&sched, &w[i].task, cond_thread,
+                        mixed && (i & 1) ? PT_SCHED_DEFAULT_PRIO - 1
+                                         : PT_SCHED_DEFAULT_PRIO);
+  }
+  pt_sched_run(&sched);
+  checks = wakeups = 0;
+  start = bench_now_ns();
+  for(tick = 1; tick <= ticks; ++tick) {
+    if(tick % every == 0) {
+      uint64_t t0 = bench_now_ns();
+
+      ++version;
+      pt_cond_broadcast(&changed);
+      broadcast_ns += bench_now_ns() - t0;
+    }
+    pt_sched_run(&sched);
+  }
+  report(mixed ? "broadcast, 2 prio" : "broadcast",
+         bench_now_ns() - start, broadcast_ns, ticks, ticks / every);
+}
+
+int
+main(int argc, char *argv[])
+{
+  uint32_t n = argc > 1 ? (uint32_t)atoi(argv[1]) : 100000;
+  uint32_t every = argc > 2 ? (uint32_t)atoi(argv[2]) : 10;
+  uint32_t ticks = argc > 3 ? (uint32_t)atoi(argv[3]) : 100;
+  struct waiter *w = calloc(n, sizeof(*w));
+  uint64_t start;
+  uint32_t i, tick;
+
+  if(w == NULL) {
+    perror("calloc");
+    return 1;
+  }
+
+  printf("%u threads, a change every %u ticks, %u ticks\n\n",
+         n, every, ticks);
+  printf("%-18s %10s %14s %12s %14s\n", "method", "ms/tick",
+         "checks/tick", "wakeups/chg", "broadcast ns");
+
+  /* Poll every protothread */
+  version = 0;
+  for(i = 0; i < n; ++i) {
+    PT_INIT(&w[i].task.pt);
+    poll_thread(&w[i].task);
+  }
+  checks = wakeups = 0;
+  start = bench_now_ns();
+  for(tick = 1; tick <= ticks; ++tick) {
+    if(tick % every == 0) {
+      ++version;
+    }
+    for(i = 0; i < n; ++i) {
+      poll_thread(&w[i].task);
+    }
+  }
+  report("poll PT_WAIT_UNTIL", bench_now_ns() - start, 0, ticks,
+         ticks / every);
+
+  run_cond(w, n, every, ticks, 0);
+  run_cond(w, n, every, ticks, 1);
+
+  free(w);
+  return 0;
+}
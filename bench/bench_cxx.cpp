@@ -0,0 +1,190 @@
+/*
+ * Measures what protothreads.hpp saves over calling protothreads
+ * through function pointers and virtual functions.
+ *
+ * Every protothread adds one to a counter and yields, in an endless
+ * loop. Many instances are called round-robin:
+ *
+ * - function pointer: a C protothread function called through a
+ *   pointer stored with each struct pt, as pt-sched.h does.
+ * - virtual: a C++ class whose body() is a virtual function.
+ * - CRTP: a protothreads::thread, called directly with run().
+ * - pt_sched: the C protothreads run by pt_sched_run().
+ * - scheduler: the protothreads::thread run by
+ *   protothreads::scheduler::run().
+ *
+ * Usage: bench_cxx [threads] [rounds]
+ */
+
+#include "bench.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "protothreads.hpp"
+#include "pt-sched.h"
+
+static uint64_t steps;
+
+/* A C protothread, called through a pointer */
+struct c_thread {
+  struct pt pt;
+  char (*fn)(struct c_thread *);
+};
+
+static
+PT_THREAD(c_body(struct c_thread *t))
+{
+  PT_BEGIN(&t->pt);
+  while(1) {
+    ++steps;
+    PT_YIELD(&t->pt);
+  }
+  PT_END(&t->pt);
+}
+
+/* The same protothread as a pt_sched task */
+static
+PT_THREAD(task_body(struct pt_task *t))
+{
+  PT_BEGIN(&t->pt);
+  while(1) {
+    ++steps;
+    PT_YIELD(&t->pt);
+  }
+  PT_END(&t->pt);
+}
+
+/* A C++ protothread with a virtual body() */
+struct virtual_thread {
+  struct pt pt;
+
+  virtual_thread() { PT_INIT(&pt); }
+  virtual ~virtual_thread() = default;
+  virtual char body() = 0;
+};
+
+struct virtual_counter final : virtual_thread {
+  char body() override;
+};
+
+char
+virtual_counter::body()
+{
+  PT_BEGIN(&pt);
+  while(1) {
+    ++steps;
+    PT_YIELD(&pt);
+  }
+  PT_END(&pt);
+}
+
+/* A C++ protothread with CRTP */
+struct crtp_counter : protothreads::thread<crtp_counter> {
+  char
+  body()
+  {
+    PT_BEGIN(pt());
+    while(1) {
+      ++steps;
+      PT_YIELD(pt());
+    }
+    PT_END(pt());
+  }
+};
+
+static void
+report(const char *name, uint64_t ns, uint64_t calls)
+{
+  std::printf("%-18s %10.2f %10.3f\n", name, ns / 1e6, (double)ns / calls);
+}
+
+int
+main(int argc, char *argv[])
+{
+  uint32_t n = argc > 1 ? (uint32_t)std::atoi(argv[1]) : 1024;
+  uint32_t rounds = argc > 2 ? (uint32_t)std::atoi(argv[2]) : 100000;
+  uint64_t calls = (uint64_t)n * rounds;
+  uint64_t start;
+  uint32_t i, r;
+
+  std::vector<c_thread> cs(n);
+  std::vector<virtual_thread *> vs(n);
+  std::vector<crtp_counter> ts(n);
+  std::vector<pt_task> tasks(n);
+  struct pt_sched sched;
+  protothreads::scheduler<crtp_counter> s;
+
+  std::printf("%u threads, %u rounds\n\n", n, rounds);
+  std::printf("%-18s %10s %10s\n", "dispatch", "ms", "ns/call");
+
+  /* Function pointers */
+  for(i = 0; i < n; ++i) {
+    PT_INIT(&cs[i].pt);
+    cs[i].fn = c_body;
+  }
+  steps = 0;
+  start = bench_now_ns();
+  for(r = 0; r < rounds; ++r) {
+    for(c_thread &t : cs) {
+      t.fn(&t);
+    }
+  }
+  report("function pointer", bench_now_ns() - start, calls);
+  BENCH_USE(steps);
+
+  /* Virtual functions */
+  for(i = 0; i < n; ++i) {
+    vs[i] = new virtual_counter;
+  }
+  steps = 0;
+  start = bench_now_ns();
+  for(r = 0; r < rounds; ++r) {
+    for(virtual_thread *t : vs) {
+      t->body();
+    }
+  }
+  report("virtual", bench_now_ns() - start, calls);
+  BENCH_USE(steps);
+  for(virtual_thread *t : vs) {
+    delete t;
+  }
+
+  /* CRTP */
+  steps = 0;
+  start = bench_now_ns();
+  for(r = 0; r < rounds; ++r) {
+    for(crtp_counter &t : ts) {
+      t.run();
+    }
+  }
+  report("CRTP", bench_now_ns() - start, calls);
+  BENCH_USE(steps);
+
+  /* pt_sched */
+  pt_sched_init(&sched);
+  for(pt_task &t : tasks) {
+    pt_sched_spawn(&sched, &t, task_body);
+  }
+  steps = 0;
+  start = bench_now_ns();
+  for(r = 0; r < rounds; ++r) {
+    pt_sched_run(&sched);
+  }
+  report("pt_sched", bench_now_ns() - start, calls);
+  BENCH_USE(steps);
+
+  /* protothreads::scheduler */
+  for(crtp_counter &t : ts) {
+    s.spawn(t);
+  }
+  steps = 0;
+  start = bench_now_ns();
+  for(r = 0; r < rounds; ++r) {
+    s.run();
+  }
+  report("scheduler", bench_now_ns() - start, calls);
+  BENCH_USE(steps);
+  return 0;
+}
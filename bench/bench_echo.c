@@ -0,0 +1,230 @@
+/*
+ * TCP echo server over loopback with one protothread per connection.
+ *
+ * N client connections are opened to a server in the same process.
+ * Every connection is served by a protothread that reads a 64-byte
+ * message and writes it back, and every client is a protothread that
+ * sends a message and waits for the echo. Both sides block with
+ * PT_READ() and PT_WRITE() from pt-io.h.
+ *
+ * For comparison, the servers are also run as protothreads that poll
+ * their socket with read() and yield while it has no data. Two loads
+ * are measured: all clients busy, and only 1% of the clients busy
+ * while the other connections stay idle.
+ *
+ * Usage: bench_echo [connections] [round-trips-per-client]
+ */
+
+#include "bench.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "pt-io.h"
+
+#define MSG_SIZE 64
+
+struct conn {
+  struct pt_task task;
+  struct pt_io_handle h;
+  char buf[MSG_SIZE];
+  ssize_t n;
+  uint32_t i;
+};
+
+static struct pt_sched sched;
+static struct pt_io io;
+static uint32_t rounds;
+static uint32_t clients_done;
+static uint64_t syscalls;
+
+static
+PT_THREAD(server_thread(struct pt_task *t))
+{
+  struct conn *c = (struct conn *)t;
+
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    PT_READ(t, &c->h, c->buf, MSG_SIZE, c->n);
+    if(c->n != MSG_SIZE) {
+      break;
+    }
+    PT_WRITE(t, &c->h, c->buf, MSG_SIZE, c->n);
+  }
+
+  PT_END(&t->pt);
+}
+
+static
+PT_THREAD(polling_server_thread(struct pt_task *t))
+{
+  struct conn *c = (struct conn *)t;
+  ssize_t n;
+
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    c->n = 0;
+    while(c->n < MSG_SIZE) {
+      ++syscalls;
+      n = read(c->h.fd, c->buf + c->n, MSG_SIZE - c->n);
+      if(n > 0) {
+        c->n += n;
+      } else if(n < 0 && errno == EAGAIN) {
+        PT_YIELD(&t->pt);
+      } else {
+        PT_EXIT(&t->pt);
+      }
+    }
+    ++syscalls;
+    if(write(c->h.fd, c->buf, MSG_SIZE) != MSG_SIZE) {
+      PT_EXIT(&t->pt);
+    }
+  }
+
+  PT_END(&t->pt);
+}
+
+static
+PT_THREAD(client_thread(struct pt_task *t))
+{
+  struct conn *c = (struct conn *)t;
+
+  PT_BEGIN(&t->pt);
+
+  memset(c->buf, 'x', MSG_SIZE);
+  for(c->i = 0; c->i < rounds; ++c->i) {
+    PT_WRITE(t, &c->h, c->buf, MSG_SIZE, c->n);
+    PT_READ(t, &c->h, c->buf, MSG_SIZE, c->n);
+    if(c->n != MSG_SIZE) {
+      break;
+    }
+  }
+  ++clients_done;
+
+  PT_END(&t->pt);
+}
+
+static uint32_t
+open_connections(int *client_fd, int *server_fd, uint32_t n)
+{
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  int one = 1;
+  int lfd;
+  uint32_t i;
+
+  lfd = socket(AF_INET, SOCK_STREAM, 0);
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if(bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+     listen(lfd, 64) < 0 ||
+     getsockname(lfd, (struct sockaddr *)&addr, &len) < 0) {
+    perror("listen");
+    exit(1);
+  }
+  for(i = 0; i < n; ++i) {
+    client_fd[i] = socket(AF_INET, SOCK_STREAM, 0);
+    if(client_fd[i] < 0 ||
+       connect(client_fd[i], (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+       (server_fd[i] = accept(lfd, NULL, NULL)) < 0) {
+      perror("connect");
+      break;
+    }
+    setsockopt(client_fd[i], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(server_fd[i], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    pt_io_nonblock(client_fd[i]);
+    pt_io_nonblock(server_fd[i]);
+  }
+  close(lfd);
+  return i;
+}
+
+static void
+run(const char *name, struct conn *server, struct conn *client,
+    const int *server_fd, const int *client_fd, uint32_t n,
+    uint32_t active, int polling)
+{
+  uint64_t start, ns;
+  uint32_t i;
+
+  pt_sched_init(&sched);
+  pt_io_init(&io, &sched);
+  for(i = 0; i < n; ++i) {
+    pt_io_add(&io, &server[i].h, server_fd[i]);
+    pt_sched_spawn(&sched, &server[i].task,
+                   polling ? polling_server_thread : server_thread);
+  }
+  for(i = 0; i < active; ++i) {
+    pt_io_add(&io, &client[i].h, client_fd[i * (n / active)]);
+    pt_sched_spawn(&sched, &client[i].task, client_thread);
+  }
+  clients_done = 0;
+  syscalls = 0;
+
+  start = bench_now_ns();
+  while(1) {
+    pt_sched_run(&sched);
+    if(clients_done == active) {
+      break;
+    }
+    pt_io_poll(&io, pt_sched_idle(&sched) ? -1 : 0);
+  }
+  ns = bench_now_ns() - start;
+
+  printf("%-28s %8u %8u %12.0f %10.2f",
+         name, n, active, (double)active * rounds * 1e9 / ns,
+         (double)ns / 1e6);
+  if(polling) {
+    printf(" %14.1f\n", (double)syscalls / ((double)active * rounds));
+  } else {
+    printf(" %14s\n", "-");
+  }
+  pt_io_close(&io);
+}
+
+int
+main(int argc, char **argv)
+{
+  uint32_t n = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 10000;
+  struct rlimit rl;
+  struct conn *server, *client;
+  int *server_fd, *client_fd;
+
+  rounds = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 0) : 20;
+
+  /* Two file descriptors per connection */
+  getrlimit(RLIMIT_NOFILE, &rl);
+  rl.rlim_cur = rl.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &rl);
+  if((rlim_t)n * 2 + 16 > rl.rlim_cur) {
+    n = (uint32_t)((rl.rlim_cur - 16) / 2);
+    printf("RLIMIT_NOFILE is %llu, using %u connections\n",
+           (unsigned long long)rl.rlim_cur, n);
+  }
+
+  server = calloc(n, sizeof(*server));
+  client = calloc(n, sizeof(*client));
+  server_fd = calloc(n, sizeof(*server_fd));
+  client_fd = calloc(n, sizeof(*client_fd));
+  n = open_connections(client_fd, server_fd, n);
+
+  printf("%u round trips of %d bytes per busy client\n\n", rounds, MSG_SIZE);
+  printf("%-28s %8s %8s %12s %10s %14s\n", "servers", "conns", "busy",
+         "round trips/s", "ms", "syscalls/trip");
+  run("PT_READ/PT_WRITE (epoll)", server, client, server_fd, client_fd,
+      n, n, 0);
+  run("read() polling", server, client, server_fd, client_fd,
+      n, n, 1);
+  run("PT_READ/PT_WRITE (epoll)", server, client, server_fd, client_fd,
+      n, n / 100 ? n / 100 : 1, 0);
+  run("read() polling", server, client, server_fd, client_fd,
+      n, n / 100 ? n / 100 : 1, 1);
+  return 0;
+}
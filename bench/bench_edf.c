@@ -0,0 +1,248 @@
+/*
+ * Compares earliest-deadline-first scheduling in pt-sched.h with
+ * fixed priorities.
+ *
+ * The first part simulates random sets of periodic protothreads whose
+ * deadline is the end of their period, at increasing total
+ * utilization. Time is the scheduler's tick counter; a job advances
+ * it one tick at a time and yields after every tick, as a cooperative
+ * protothread would, so the simulation is exact and repeatable. With
+ * fixed priorities the tasks are ranked by period (rate monotonic);
+ * with EDF they wait with PT_WAIT_PERIOD(). Fixed priorities start to
+ * miss deadlines well below full utilization, EDF only close to it.
+ * At 100%, rounding the costs to whole ticks overloads some sets, and
+ * an overloaded EDF schedule misses many deadlines in a row.
+ *
+ * The second part measures the cost of a scheduling decision with N
+ * runnable protothreads that yield with random deadlines, against
+ * the same protothreads yielding at one priority. Time advances by
+ * one tick per run in both cases.
+ *
+ * Usage: bench_edf [task-sets] [ticks]
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pt-sched.h"
+
+#define TASKS 8
+
+struct periodic {
+  struct pt_task task;
+  uint32_t period;
+  uint32_t cost;
+  uint32_t deadline;
+  uint32_t left;
+  uint32_t jobs;
+  uint32_t misses;
+};
+
+static
+PT_THREAD(edf_thread(struct pt_task *t))
+{
+  struct periodic *p = (struct periodic *)t;
+
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    for(p->left = p->cost; --p->left > 0;) {
+      pt_sched_advance(t->sched, 1);
+      PT_YIELD(&t->pt);
+    }
+    pt_sched_advance(t->sched, 1);
+    ++p->jobs;
+    PT_WAIT_PERIOD(t, p->period);
+  }
+
+  PT_END(&t->pt);
+}
+
+static
+PT_THREAD(rm_thread(struct pt_task *t))
+{
+  struct periodic *p = (struct periodic *)t;
+  uint32_t release;
+
+  PT_BEGIN(&t->pt);
+
+  p->deadline = t->sched->wheel.now + p->period;
+  while(1) {
+    for(p->left = p->cost; --p->left > 0;) {
+      pt_sched_advance(t->sched, 1);
+      PT_YIELD(&t->pt);
+    }
+    pt_sched_advance(t->sched, 1);
+    ++p->jobs;
+    if((int32_t)(t->sched->wheel.now - p->deadline) > 0) {
+      ++p->misses;
+    }
+    release = p->deadline;
+    p->deadline += p->period;
+    if((int32_t)(release - t->sched->wheel.now) > 0) {
+      PT_SLEEP(t, release - t->sched->wheel.now);
+    } else {
+      PT_YIELD(&t->pt);
+    }
+  }
+
+  PT_END(&t->pt);
+}
+
+/* Draws periods and costs with a total utilization of about u. */
+static void
+make_set(struct periodic *p, double u, uint32_t *seed)
+{
+  uint32_t weight[TASKS], sum = 0;
+  unsigned i;
+
+  for(i = 0; i < TASKS; ++i) {
+    weight[i] = 1 + bench_rand(seed) % 100;
+    sum += weight[i];
+  }
+  for(i = 0; i < TASKS; ++i) {
+    p[i].period = 10 + bench_rand(seed) % 991;
+    p[i].cost = (uint32_t)(u * weight[i] / sum * p[i].period + 0.5);
+    if(p[i].cost == 0) {
+      p[i].cost = 1;
+    }
+  }
+}
+
+/* Runs a task set and returns the fraction of jobs that were late. */
+static double
+run_set(struct periodic *p, int edf, uint32_t ticks)
+{
+  struct pt_sched sched;
+  uint32_t jobs = 0, misses = 0;
+  unsigned i, j, rank;
+
+  pt_sched_init(&sched);
+  for(i = 0; i < TASKS; ++i) {
+    p[i].jobs = 0;
+    p[i].misses = 0;
+    if(edf) {
+      pt_sched_spawn(&sched, &p[i].task, edf_thread);
+    } else {
+      for(rank = 0, j = 0; j < TASKS; ++j) {
+        rank += p[j].period < p[i].period ||
+          (p[j].period == p[i].period && j < i);
+      }
+      pt_sched_spawn_prio(&sched, &p[i].task, rm_thread, rank);
+    }
+  }
+
+  while((int32_t)(sched.wheel.now - ticks) < 0) {
+    if(pt_sched_idle(&sched)) {
+      pt_sched_advance(&sched, 1);
+    } else {
+      pt_sched_run_one(&sched);
+    }
+  }
+
+  for(i = 0; i < TASKS; ++i) {
+    jobs += p[i].jobs;
+    misses += p[i].misses;
+  }
+  if(edf) {
+    misses = pt_sched_misses(&sched);
+  }
+  return jobs > 0 ? (double)misses / jobs : 0;
+}
+
+struct yielder {
+  struct pt_task task;
+  uint32_t seed;
+};
+
+static
+PT_THREAD(deadline_yielder(struct pt_task *t))
+{
+  struct yielder *y = (struct yielder *)t;
+
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    PT_YIELD_DEADLINE(t, 1 + bench_rand(&y->seed) % 1000);
+  }
+
+  PT_END(&t->pt);
+}
+
+static
+PT_THREAD(fifo_yielder(struct pt_task *t))
+{
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    PT_YIELD(&t->pt);
+  }
+
+  PT_END(&t->pt);
+}
+
+static double
+run_yielders(struct yielder *y, uint32_t n, pt_task_fn fn, uint32_t runs)
+{
+  struct pt_sched sched;
+  uint64_t start;
+  uint32_t i;
+
+  pt_sched_init(&sched);
+  for(i = 0; i < n; ++i) {
+    y[i].seed = i + 1;
+    pt_sched_spawn(&sched, &y[i].task, fn);
+  }
+  pt_sched_run(&sched);
+
+  start = bench_now_ns();
+  for(i = 0; i < runs; ++i) {
+    pt_sched_run_one(&sched);
+    pt_sched_advance(&sched, 1);
+  }
+  return (double)(bench_now_ns() - start) / runs;
+}
+
+int
+main(int argc, char *argv[])
+{
+  static const double utilization[] = { 0.5, 0.7, 0.8, 0.9, 0.95, 0.98, 1.0 };
+  static const uint32_t sizes[] = { 10, 1000, 100000 };
+  uint32_t sets = argc > 1 ? (uint32_t)atoi(argv[1]) : 50;
+  uint32_t ticks = argc > 2 ? (uint32_t)atoi(argv[2]) : 100000;
+  struct periodic p[TASKS];
+  unsigned i, k;
+
+  printf("%u periodic threads, %u task sets of %u ticks, late jobs\n\n",
+         TASKS, sets, ticks);
+  printf("%12s %14s %14s\n", "utilization", "fixed prio", "EDF");
+  for(i = 0; i < sizeof(utilization) / sizeof(utilization[0]); ++i) {
+    uint32_t seed = 1;
+    double rm = 0, edf = 0;
+
+    for(k = 0; k < sets; ++k) {
+      make_set(p, utilization[i], &seed);
+      rm += run_set(p, 0, ticks);
+      edf += run_set(p, 1, ticks);
+    }
+    printf("%11.0f%% %13.3f%% %13.3f%%\n", utilization[i] * 100,
+           rm / sets * 100, edf / sets * 100);
+  }
+
+  printf("\n%12s %14s %14s\n", "threads", "FIFO ns/run", "EDF ns/run");
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    struct yielder *y = calloc(sizes[i], sizeof(*y));
+
+    if(y == NULL) {
+      perror("calloc");
+      return 1;
+    }
+    printf("%12u %14.1f %14.1f\n", sizes[i],
+           run_yielders(y, sizes[i], fifo_yielder, 2000000),
+           run_yielders(y, sizes[i], deadline_yielder, 2000000));
+    free(y);
+  }
+  return 0;
+}
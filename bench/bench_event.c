@@ -0,0 +1,171 @@
+/*
+ * Compares waiting for any of several events by polling a condition
+ * with waiting on a pt-event.h event flag group.
+ *
+ * N protothreads each wait for any flag of a mask of three flags out
+ * of 32, picked from a given number of distinct masks, handle the
+ * event and yield. Every tick, the protothreads run once; one random
+ * flag is set before they run on every tick, every 10th tick or
+ * every 100th tick, and is cleared after.
+ *
+ * - PT_WAIT_UNTIL: every protothread is called on every tick and
+ *   tests PT_WAIT_UNTIL(pt, flags & mask), as it would test
+ *   a() || b() || c().
+ * - PT_EVENT_WAIT_ANY: the protothreads run under pt-sched.h and wait
+ *   with PT_EVENT_WAIT_ANY(). Setting a flag makes the waiters of the
+ *   masks that contain it runnable; the others are not run.
+ *
+ * With more distinct masks than PT_EVENT_BUCKETS, the waiters of the
+ * remaining masks share a queue, and are all run when any of their
+ * flags is set.
+ *
+ * Polling costs the same on every tick, while waiting on the group
+ * costs in proportion to the waiters that are woken.
+ *
+ * Usage: bench_event [threads] [masks] [ticks]
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pt-event.h"
+
+struct waiter {
+  struct pt_task task;
+  pt_event_flags_t mask;
+};
+
+static struct pt_event events;
+static pt_event_flags_t flags;
+static uint64_t handled;
+static uint64_t runs;
+
+static
+PT_THREAD(poll_thread(struct waiter *w))
+{
+  ++runs;
+  PT_BEGIN(&w->task.pt);
+
+  while(1) {
+    PT_WAIT_UNTIL(&w->task.pt, (flags & w->mask) != 0);
+    ++handled;
+    PT_YIELD(&w->task.pt);
+  }
+
+  PT_END(&w->task.pt);
+}
+
+static
+PT_THREAD(event_thread(struct pt_task *t))
+{
+  struct waiter *w = (struct waiter *)t;
+
+  ++runs;
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    PT_EVENT_WAIT_ANY(t, &events, w->mask);
+    ++handled;
+    PT_YIELD(&t->pt);
+  }
+
+  PT_END(&t->pt);
+}
+
+static void
+report(const char *name, uint64_t ns, uint32_t ticks)
+{
+  printf("  %-18s %12.1f %12.1f %12.1f\n", name, (double)ns / ticks,
+         (double)runs / ticks, (double)handled / ticks);
+}
+
+int
+main(int argc, char *argv[])
+{
+  static const uint32_t periods[] = { 1, 10, 100 };
+  uint32_t n = argc > 1 ? (uint32_t)atoi(argv[1]) : 10000;
+  uint32_t nmasks = argc > 2 ? (uint32_t)atoi(argv[2]) : 8;
+  uint32_t ticks = argc > 3 ? (uint32_t)atoi(argv[3]) : 10000;
+  struct waiter *w = calloc(n, sizeof(*w));
+  pt_event_flags_t *masks = calloc(nmasks, sizeof(*masks));
+  uint8_t *bits = malloc(ticks);
+  struct pt_sched sched;
+  uint32_t seed = 1;
+  uint64_t start;
+  uint32_t i, j, k, period;
+  unsigned p;
+
+  if(w == NULL || masks == NULL || bits == NULL) {
+    perror("calloc");
+    return 1;
+  }
+  for(k = 0; k < nmasks; ++k) {
+    for(j = 0; j < 3; ++j) {
+      pt_event_flags_t bit;
+
+      do {
+        bit = (pt_event_flags_t)1 << bench_rand(&seed) % 32;
+      } while(masks[k] & bit);
+      masks[k] |= bit;
+    }
+  }
+  for(i = 0; i < n; ++i) {
+    w[i].mask = masks[bench_rand(&seed) % nmasks];
+  }
+  for(k = 0; k < ticks; ++k) {
+    bits[k] = (uint8_t)(bench_rand(&seed) % 32);
+  }
+
+  printf("%u threads, %u masks of 3 flags, %u ticks\n", n, nmasks, ticks);
+  for(p = 0; p < sizeof(periods) / sizeof(periods[0]); ++p) {
+    period = periods[p];
+    printf("\none flag every %u tick%s\n", period, period > 1 ? "s" : "");
+    printf("  %-18s %12s %12s %12s\n", "wait", "ns/tick", "runs/tick",
+           "events/tick");
+
+    /* Every protothread tests its condition on every tick */
+    for(i = 0; i < n; ++i) {
+      PT_INIT(&w[i].task.pt);
+      poll_thread(&w[i]);
+    }
+    handled = runs = 0;
+    start = bench_now_ns();
+    for(k = 0; k < ticks; ++k) {
+      if(k % period == 0) {
+        flags |= (pt_event_flags_t)1 << bits[k];
+      }
+      for(i = 0; i < n; ++i) {
+        poll_thread(&w[i]);
+      }
+      flags = 0;
+    }
+    report("PT_WAIT_UNTIL", bench_now_ns() - start, ticks);
+    BENCH_USE(handled);
+
+    /* Only the waiters whose mask contains the flag run */
+    pt_sched_init(&sched);
+    pt_event_init(&events, 0);
+    for(i = 0; i < n; ++i) {
+      pt_sched_spawn(&sched, &w[i].task, event_thread);
+    }
+    pt_sched_run(&sched);
+    handled = runs = 0;
+    start = bench_now_ns();
+    for(k = 0; k < ticks; ++k) {
+      if(k % period == 0) {
+        pt_event_set(&events, (pt_event_flags_t)1 << bits[k]);
+      }
+      pt_sched_run(&sched);
+      pt_event_clear(&events, ~(pt_event_flags_t)0);
+    }
+    report("PT_EVENT_WAIT_ANY", bench_now_ns() - start, ticks);
+    BENCH_USE(handled);
+  }
+
+  free(bits);
+  free(masks);
+  free(w);
+  return 0;
+}
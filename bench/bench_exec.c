@@ -0,0 +1,96 @@
+/*
+ * Measures how the multi-core executor in pt-exec.h scales with the
+ * number of workers on a CPU-bound workload.
+ *
+ * Every protothread computes a chain of xorshift steps and yields
+ * after each chunk of work, so that the workers keep moving tasks
+ * between passes. The same tasks are run with 1, 2, 4, ... workers up
+ * to the given maximum, and the speedup is relative to one worker.
+ *
+ * Usage: bench_exec [max-workers] [tasks] [chunks] [work]
+ */
+
+#include "bench.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "pt-exec.h"
+
+struct job {
+  struct pt_exec_task task;
+  uint32_t chunk;
+  uint32_t state;
+};
+
+static uint32_t chunks, work;
+
+static
+PT_THREAD(job_thread(struct pt_exec_task *t))
+{
+  struct job *j = (struct job *)t;
+  uint32_t i;
+
+  PT_BEGIN(&t->pt);
+  for(j->chunk = 0; j->chunk < chunks; ++j->chunk) {
+    for(i = 0; i < work; ++i) {
+      bench_rand(&j->state);
+    }
+    PT_YIELD(&t->pt);
+  }
+  PT_END(&t->pt);
+}
+
+int
+main(int argc, char **argv)
+{
+  uint32_t max_workers = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 64;
+  uint32_t tasks = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 0) : 4096;
+  struct job *jobs;
+  double base_ns = 0;
+  uint32_t n, i;
+
+  chunks = argc > 3 ? (uint32_t)strtoul(argv[3], NULL, 0) : 100;
+  work = argc > 4 ? (uint32_t)strtoul(argv[4], NULL, 0) : 2000;
+  jobs = calloc(tasks, sizeof(*jobs));
+
+  printf("%u tasks of %u chunks of %u steps, %ld CPUs online\n\n", tasks,
+         chunks, work, sysconf(_SC_NPROCESSORS_ONLN));
+  printf("%8s %12s %10s %12s %12s\n", "workers", "ms", "speedup",
+         "chunks/s", "steals");
+
+  for(n = 1; n <= max_workers; n *= 2) {
+    struct pt_exec exec;
+    uint64_t start, ns, steals = 0;
+
+    if(pt_exec_init(&exec, n, tasks) < 0) {
+      perror("pt_exec_init");
+      return 1;
+    }
+    for(i = 0; i < tasks; ++i) {
+      jobs[i].state = i + 1;
+      pt_exec_spawn(&exec, &jobs[i].task, job_thread);
+    }
+
+    start = bench_now_ns();
+    pt_exec_run(&exec);
+    ns = bench_now_ns() - start;
+
+    for(i = 0; i < n; ++i) {
+      steals += exec.workers[i].steals;
+    }
+    if(n == 1) {
+      base_ns = ns;
+    }
+    printf("%8u %12.1f %10.2f %12.0f %12" PRIu64 "\n", n, ns / 1e6,
+           base_ns / ns, (double)tasks * chunks * 1e9 / ns, steals);
+    pt_exec_close(&exec);
+  }
+  for(i = 0; i < tasks; ++i) {
+    BENCH_USE(jobs[i].state);
+  }
+  free(jobs);
+  return 0;
+}
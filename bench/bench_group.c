@@ -0,0 +1,147 @@
+/*
+ * Sweeps 10M mostly idle protothreads with the structure-of-arrays
+ * layout of pt-group.h and with an array of structures.
+ *
+ * Every protothread sleeps for a random number of ticks between 1
+ * and a maximum, so about N / (max / 2) of them are due on each tick.
+ *
+ * - array of structs: every protothread is a 64-byte structure that
+ *   holds its struct pt, its wake-up tick and its other state, and
+ *   each tick calls every protothread, which checks its deadline in
+ *   PT_WAIT_UNTIL().
+ * - group: the protothreads are a struct pt_group. Each tick,
+ *   pt_group_advance() finds the due protothreads in the timestamp
+ *   array and pt_group_sweep() runs them through the ready bitmap.
+ *
+ * Usage: bench_group [threads] [max-ticks] [ticks]
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pt-group.h"
+
+static uint32_t max_ticks;
+static uint32_t now;
+static uint64_t wakeups;
+
+struct aos_thread {
+  struct pt pt;
+  uint32_t wake;
+  uint32_t seed;
+  uint32_t count;
+  char state[64 - sizeof(struct pt) - 3 * sizeof(uint32_t)];
+};
+
+static
+PT_THREAD(aos_sleeper(struct aos_thread *t))
+{
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    t->wake = now + 1 + bench_rand(&t->seed) % max_ticks;
+    PT_WAIT_UNTIL(&t->pt, (int32_t)(now - t->wake) >= 0);
+    ++t->count;
+    ++wakeups;
+  }
+
+  PT_END(&t->pt);
+}
+
+static uint32_t *seeds;
+static uint32_t *counts;
+
+static
+PT_THREAD(group_sleeper(struct pt_group *g, uint32_t i))
+{
+  PT_BEGIN(pt_group_pt(g, i));
+
+  while(1) {
+    PT_GROUP_SLEEP(g, i, 1 + bench_rand(&seeds[i]) % max_ticks);
+    ++counts[i];
+    ++wakeups;
+  }
+
+  PT_END(pt_group_pt(g, i));
+}
+
+int
+main(int argc, char *argv[])
+{
+  uint32_t n = argc > 1 ? (uint32_t)atoi(argv[1]) : 10000000;
+  uint32_t ticks = argc > 3 ? (uint32_t)atoi(argv[3]) : 20;
+  struct aos_thread *aos;
+  struct pt_group g;
+  uint64_t start, aos_ns, group_ns, sweep_ns = 0;
+  uint64_t aos_wakeups, group_wakeups;
+  uint32_t i, tick;
+
+  max_ticks = argc > 2 ? (uint32_t)atoi(argv[2]) : 1000;
+
+  aos = malloc((size_t)n * sizeof(*aos));
+  if(aos == NULL) {
+    perror("malloc");
+    return 1;
+  }
+  for(i = 0; i < n; ++i) {
+    PT_INIT(&aos[i].pt);
+    aos[i].seed = i + 1;
+    aos_sleeper(&aos[i]);
+  }
+  wakeups = 0;
+  start = bench_now_ns();
+  for(tick = 0; tick < ticks; ++tick) {
+    ++now;
+    for(i = 0; i < n; ++i) {
+      aos_sleeper(&aos[i]);
+    }
+  }
+  aos_ns = bench_now_ns() - start;
+  aos_wakeups = wakeups;
+  free(aos);
+
+  seeds = malloc((size_t)n * sizeof(*seeds));
+  counts = calloc(n, sizeof(*counts));
+  if(seeds == NULL || counts == NULL ||
+     pt_group_init(&g, n, group_sleeper, NULL) != 0) {
+    perror("malloc");
+    return 1;
+  }
+  for(i = 0; i < n; ++i) {
+    seeds[i] = i + 1;
+    pt_group_spawn(&g, i);
+  }
+  pt_group_sweep(&g);
+  wakeups = 0;
+  start = bench_now_ns();
+  for(tick = 0; tick < ticks; ++tick) {
+    uint64_t t0;
+
+    pt_group_advance(&g, 1);
+    t0 = bench_now_ns();
+    pt_group_sweep(&g);
+    sweep_ns += bench_now_ns() - t0;
+  }
+  group_ns = bench_now_ns() - start;
+  group_wakeups = wakeups;
+
+  printf("%u threads sleeping 1..%u ticks, %u ticks, %.0f wakeups/tick\n\n",
+         n, max_ticks, ticks, (double)group_wakeups / ticks);
+  printf("%-18s %14s %14s %10s\n", "layout", "ms/tick", "ns/thread", "wakeups");
+  printf("%-18s %14.2f %14.2f %10llu\n", "array of structs",
+         aos_ns / 1e6 / ticks, (double)aos_ns / ticks / n,
+         (unsigned long long)aos_wakeups);
+  printf("%-18s %14.2f %14.2f %10llu\n", "group",
+         group_ns / 1e6 / ticks, (double)group_ns / ticks / n,
+         (unsigned long long)group_wakeups);
+  printf("%-18s %14.2f %14.2f\n", "  of which sweep",
+         sweep_ns / 1e6 / ticks, (double)sweep_ns / ticks / n);
+  printf("\nspeedup %.1fx\n", (double)aos_ns / group_ns);
+
+  pt_group_close(&g);
+  free(seeds);
+  free(counts);
+  return 0;
+}
@@ -0,0 +1,175 @@
+/*
+ * Compares two ways for a protothread to start N children and wait
+ * until all of them have finished.
+ *
+ * Every child waits a random number of ticks, between 1 and a
+ * maximum, and ends. A round ends when the parent has seen all
+ * children finish.
+ *
+ * - PT_WAIT_THREAD: the parent waits with PT_WAIT_UNTIL() for a
+ *   function that runs every child that has not finished, as
+ *   PT_WAIT_THREAD(pt, a(&pa) & b(&pb) & ...) does for a few
+ *   children. The driver calls the parent once per tick, and the
+ *   children poll the time.
+ * - PT_SPAWN_ALL: the parent starts the children under pt-sched.h
+ *   with PT_SPAWN_ALL() and is woken once, by the last child; the
+ *   children sleep with PT_SLEEP().
+ *
+ * Usage: bench_latch [children] [max-ticks] [rounds]
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pt-sched.h"
+
+struct child {
+  struct pt_task task;
+  uint32_t ticks;
+  uint32_t deadline;
+  uint8_t done;
+};
+
+static struct child *children;
+static uint32_t nchildren;
+static uint32_t now;
+static uint64_t parent_runs;
+static uint64_t child_runs;
+static struct pt_latch latch;
+
+static
+PT_THREAD(poll_child(struct child *c))
+{
+  ++child_runs;
+  PT_BEGIN(&c->task.pt);
+  c->deadline = now + c->ticks;
+  PT_WAIT_UNTIL(&c->task.pt, (int32_t)(now - c->deadline) >= 0);
+  PT_END(&c->task.pt);
+}
+
+/* Runs every child that has not finished; true when all have. */
+static int
+poll_all(void)
+{
+  uint32_t i, live = 0;
+
+  for(i = 0; i < nchildren; ++i) {
+    if(!children[i].done) {
+      if(PT_SCHEDULE(poll_child(&children[i]))) {
+        ++live;
+      } else {
+        children[i].done = 1;
+      }
+    }
+  }
+  return live == 0;
+}
+
+static
+PT_THREAD(poll_parent(struct pt *pt))
+{
+  uint32_t i;
+
+  ++parent_runs;
+  PT_BEGIN(pt);
+  for(i = 0; i < nchildren; ++i) {
+    PT_INIT(&children[i].task.pt);
+    children[i].done = 0;
+  }
+  PT_WAIT_UNTIL(pt, poll_all());
+  PT_END(pt);
+}
+
+static
+PT_THREAD(sleep_child(struct pt_task *t))
+{
+  struct child *c = (struct child *)t;
+
+  ++child_runs;
+  PT_BEGIN(&t->pt);
+  PT_SLEEP(t, c->ticks);
+  PT_END(&t->pt);
+}
+
+static
+PT_THREAD(spawn_parent(struct pt_task *t))
+{
+  ++parent_runs;
+  PT_BEGIN(&t->pt);
+  PT_SPAWN_ALL(t, &latch, children, nchildren, sleep_child);
+  PT_END(&t->pt);
+}
+
+static void
+report(const char *name, uint64_t ns, uint32_t rounds, uint64_t ticks)
+{
+  printf("%-14s %12.3f %12.1f %14.1f %12.0f\n", name, ns / 1e6 / rounds,
+         (double)parent_runs / rounds, (double)child_runs / rounds,
+         (double)ticks / rounds);
+}
+
+int
+main(int argc, char *argv[])
+{
+  uint32_t max_ticks, rounds, r, i;
+  uint32_t seed = 1;
+  uint64_t start, ticks;
+
+  nchildren = argc > 1 ? (uint32_t)atoi(argv[1]) : 10000;
+  max_ticks = argc > 2 ? (uint32_t)atoi(argv[2]) : 100;
+  rounds = argc > 3 ? (uint32_t)atoi(argv[3]) : 10;
+
+  children = calloc(nchildren, sizeof(*children));
+  if(children == NULL) {
+    perror("calloc");
+    return 1;
+  }
+  for(i = 0; i < nchildren; ++i) {
+    children[i].ticks = 1 + bench_rand(&seed) % max_ticks;
+  }
+
+  printf("%u children waiting 1..%u ticks, %u rounds\n\n",
+         nchildren, max_ticks, rounds);
+  printf("%-14s %12s %12s %14s %12s\n", "fan-in", "ms/round",
+         "parent runs", "child runs", "ticks");
+
+  /* The parent polls the children */
+  parent_runs = child_runs = ticks = 0;
+  start = bench_now_ns();
+  for(r = 0; r < rounds; ++r) {
+    struct pt parent;
+
+    PT_INIT(&parent);
+    while(PT_SCHEDULE(poll_parent(&parent))) {
+      ++now;
+      ++ticks;
+    }
+  }
+  report("PT_WAIT_THREAD", bench_now_ns() - start, rounds, ticks);
+
+  /* The children count down a latch */
+  parent_runs = child_runs = ticks = 0;
+  start = bench_now_ns();
+  for(r = 0; r < rounds; ++r) {
+    struct pt_sched sched;
+    struct pt_task parent;
+
+    pt_sched_init(&sched);
+    pt_sched_spawn(&sched, &parent, spawn_parent);
+    while(parent.state != PT_TASK_IDLE) {
+      while(!pt_sched_idle(&sched)) {
+        pt_sched_run(&sched);
+      }
+      if(parent.state != PT_TASK_IDLE) {
+        pt_sched_advance(&sched, 1);
+        ++ticks;
+      }
+    }
+  }
+  report("PT_SPAWN_ALL", bench_now_ns() - start, rounds, ticks);
+
+  free(children);
+  return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * Measures the cost of resuming a protothread with the local
+ * continuation implementation selected by LC_INCLUDE.
+ *
+ * The protothreads yield in an endless loop over 4, 32 or 256 resume
+ * points. Many instances are started at random resume points and are
+ * called round-robin, so that consecutive resumes jump to different
+ * places, as they do in a real driver loop. The protothread functions
+ * are generated by CMake, because lc-switch.h and lc-addrlabels.h need
+ * every resume point on its own line.
+ *
+ * bench_lc_coro is this program compiled as C++20 with lc-coro.h. It
+ * also reports the bytes that each protothread allocates for its
+ * coroutine frame and captures, counted through LC_CORO_ALLOC; the C
+ * backends allocate nothing beyond lc_t.
+ *
+ * Usage: bench_lc_<backend> [calls]
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+#include <cstddef>
+
+static std::size_t bench_lc_frame_bytes;
+
+static void *
+bench_lc_alloc(std::size_t size)
+{
+  bench_lc_frame_bytes += size;
+  return ::operator new(size);
+}
+
+#define LC_CORO_ALLOC(size) bench_lc_alloc(size)
+#define LC_CORO_FREE(p, size) ::operator delete(p)
+#endif
+
+#include "pt.h"
+
+#include "bench_lc_threads.h"
+
+#ifndef BENCH_LC_NAME
+#define BENCH_LC_NAME LC_INCLUDE
+#endif
+
+#define INSTANCES 4096
+
+static struct pt pts[INSTANCES];
+
+static double
+run(char (*thread)(struct pt *), unsigned points, uint32_t calls)
+{
+  uint32_t seed = 1;
+  uint64_t start;
+  uint32_t i, n;
+
+  for(i = 0; i < INSTANCES; ++i) {
+#ifdef __cplusplus
+    lc_coro_reset(pts[i].lc);
+#endif
+    PT_INIT(&pts[i]);
+    for(n = bench_rand(&seed) % points; n > 0; --n) {
+      thread(&pts[i]);
+    }
+  }
+
+  start = bench_now_ns();
+  for(n = 0; n < calls; n += INSTANCES) {
+    for(i = 0; i < INSTANCES; ++i) {
+      thread(&pts[i]);
+    }
+  }
+  return (double)(bench_now_ns() - start) / n;
+}
+
+int
+main(int argc, char *argv[])
+{
+  uint32_t calls = argc > 1 ? (uint32_t)atoi(argv[1]) : 100000000;
+
+  printf("%-16s %6s %12s %12s %12s\n", "backend", "lc_t", "4 points",
+         "32 points", "256 points");
+#ifdef __cplusplus
+  double ns[3];
+  std::size_t frame[3];
+
+  ns[0] = run(thread4, 4, calls);
+  frame[0] = bench_lc_frame_bytes / INSTANCES;
+  bench_lc_frame_bytes = 0;
+  ns[1] = run(thread32, 32, calls);
+  frame[1] = bench_lc_frame_bytes / INSTANCES;
+  bench_lc_frame_bytes = 0;
+  ns[2] = run(thread256, 256, calls);
+  frame[2] = bench_lc_frame_bytes / INSTANCES;
+  printf("%-16s %5uB %9.2f ns %9.2f ns %9.2f ns\n", BENCH_LC_NAME,
+         (unsigned)sizeof(lc_t), ns[0], ns[1], ns[2]);
+  printf("%-16s %6s %10uB %10uB %10uB\n", "  frame", "",
+         (unsigned)frame[0], (unsigned)frame[1], (unsigned)frame[2]);
+#else
+  printf("%-16s %5uB %9.2f ns %9.2f ns %9.2f ns\n", BENCH_LC_NAME,
+         (unsigned)sizeof(lc_t),
+         run(thread4, 4, calls),
+         run(thread32, 32, calls),
+         run(thread256, 256, calls));
+#endif
+  return 0;
+}
@@ -0,0 +1,6 @@
+/*
+ * bench_lc.c compiled as C++20 with the coroutine implementation of
+ * local continuations in lc-coro.h.
+ */
+
+#include "bench_lc.c"
@@ -0,0 +1,148 @@
+/*
+ * Compares a pt-sem.h semaphore with a count of one, used as a lock,
+ * with the mutexes in pt-mutex.h when many protothreads contend for
+ * one lock.
+ *
+ * N protothreads repeatedly take the lock, yield once while holding
+ * it and release it, until the lock has been taken a given number of
+ * times in total.
+ *
+ * - pt-sem: every protothread is polled on every pass and checks the
+ *   counter. A protothread that releases the semaphore and waits for
+ *   it again finds the counter at one and takes it back at once.
+ * - pt-mutex: under pt-sched.h, unlocking hands the mutex to the task
+ *   that has waited longest and the waiters are not run until then.
+ *
+ * Throughput is in acquisitions per second. Fairness is given by the
+ * fewest and most acquisitions of any protothread and by Jain's
+ * index, (sum x)^2 / (n * sum x^2), which is 1 when every protothread
+ * took the lock equally often and 1/n when one took it every time.
+ *
+ * Usage: bench_mutex [threads] [acquisitions-per-thread]
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pt-mutex.h"
+#include "pt-sem.h"
+
+struct worker {
+  struct pt_task task;
+  uint32_t acquired;
+};
+
+static struct pt_sem sem;
+static struct pt_mutex mutex;
+static uint64_t total;
+static uint64_t checks;
+
+static
+PT_THREAD(sem_thread(struct pt_task *t))
+{
+  struct worker *w = (struct worker *)t;
+
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    PT_WAIT_UNTIL(&t->pt, (++checks, sem.count > 0));
+    --sem.count;
+    ++w->acquired;
+    ++total;
+    PT_YIELD(&t->pt);
+    PT_SEM_SIGNAL(&t->pt, &sem);
+  }
+
+  PT_END(&t->pt);
+}
+
+static
+PT_THREAD(mutex_thread(struct pt_task *t))
+{
+  struct worker *w = (struct worker *)t;
+
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    ++checks;
+    PT_MUTEX_LOCK(t, &mutex);
+    ++w->acquired;
+    ++total;
+    PT_YIELD(&t->pt);
+    PT_MUTEX_UNLOCK(t, &mutex);
+  }
+
+  PT_END(&t->pt);
+}
+
+static void
+report(const char *name, const struct worker *w, uint32_t n, uint64_t ns)
+{
+  uint32_t i, min = UINT32_MAX, max = 0;
+  double sum = 0, sum2 = 0;
+
+  for(i = 0; i < n; ++i) {
+    uint32_t a = w[i].acquired;
+
+    min = a < min ? a : min;
+    max = a > max ? a : max;
+    sum += a;
+    sum2 += (double)a * a;
+  }
+  printf("%-10s %14.0f %12.1f %8u %8u %8.4f\n", name, total * 1e9 / ns,
+         (double)checks / total, min, max, sum * sum / (n * sum2));
+}
+
+int
+main(int argc, char *argv[])
+{
+  uint32_t n = argc > 1 ? (uint32_t)atoi(argv[1]) : 10000;
+  uint32_t per = argc > 2 ? (uint32_t)atoi(argv[2]) : 4;
+  uint64_t target = (uint64_t)n * per;
+  struct worker *w = calloc(n, sizeof(*w));
+  struct pt_sched sched;
+  uint64_t start;
+  uint32_t i;
+
+  if(w == NULL) {
+    perror("calloc");
+    return 1;
+  }
+
+  printf("%u threads, %llu acquisitions\n\n", n, (unsigned long long)target);
+  printf("%-10s %14s %12s %8s %8s %8s\n", "lock", "acq/s",
+         "checks/acq", "min", "max", "Jain");
+
+  /* A semaphore, polling every protothread */
+  PT_SEM_INIT(&sem, 1);
+  for(i = 0; i < n; ++i) {
+    PT_INIT(&w[i].task.pt);
+  }
+  total = checks = 0;
+  start = bench_now_ns();
+  while(total < target) {
+    for(i = 0; i < n; ++i) {
+      sem_thread(&w[i].task);
+    }
+  }
+  report("pt-sem", w, n, bench_now_ns() - start);
+
+  /* A mutex under the scheduler */
+  PT_MUTEX_INIT(&mutex);
+  pt_sched_init(&sched);
+  for(i = 0; i < n; ++i) {
+    w[i].acquired = 0;
+    pt_sched_spawn(&sched, &w[i].task, mutex_thread);
+  }
+  total = checks = 0;
+  start = bench_now_ns();
+  while(total < target) {
+    pt_sched_run_one(&sched);
+  }
+  report("pt-mutex", w, n, bench_now_ns() - start);
+
+  free(w);
+  return 0;
+}
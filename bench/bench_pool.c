@@ -0,0 +1,263 @@
+/*
+ * Compares pt-pool.h with malloc() for allocation-heavy workloads.
+ *
+ * - churn: allocate a batch of blocks and free them again, in the
+ *   same order and in random order.
+ * - spawn: spawn 1000 short-lived protothreads per round under the
+ *   scheduler, with each task in a block from malloc() that the
+ *   driver frees when the task ends, and with pt_sched_spawn_pool(),
+ *   which frees the block automatically.
+ * - remote: one thread allocates blocks and another frees them, with
+ *   free() and with pt_pool_free_remote().
+ *
+ * The churn test also measures a free list guarded by a mutex, the
+ * usual shared pool. When CMake finds jemalloc, the program is also
+ * built as bench_pool_jemalloc, where malloc() is jemalloc's.
+ *
+ * Usage: bench_pool [rounds]
+ */
+
+#include "bench.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pt-sched.h"
+
+#ifndef BENCH_POOL_MALLOC
+#define BENCH_POOL_MALLOC "malloc"
+#endif
+
+#define BATCH 1000
+
+typedef PT_TASK_LOCALS(struct {
+  uint32_t steps;
+  char payload[64];
+}) bench_task;
+
+/*---------------------------------------------------------------------------*/
+/* A shared free list with a lock. */
+struct locked_pool {
+  pthread_mutex_t lock;
+  struct pt_pool pool;
+};
+
+static void *
+locked_alloc(struct locked_pool *l)
+{
+  void *b;
+
+  pthread_mutex_lock(&l->lock);
+  b = pt_pool_alloc(&l->pool);
+  pthread_mutex_unlock(&l->lock);
+  return b;
+}
+
+static void
+locked_free(struct locked_pool *l, void *b)
+{
+  pthread_mutex_lock(&l->lock);
+  pt_pool_free(&l->pool, b);
+  pthread_mutex_unlock(&l->lock);
+}
+
+/*---------------------------------------------------------------------------*/
+enum allocator { MALLOC, POOL, LOCKED };
+
+static const char *const allocator_names[] = {
+  BENCH_POOL_MALLOC, "pt_pool", "locked pool"
+};
+
+static void *blocks[BATCH];
+static uint32_t order[BATCH];
+
+static double
+run_churn(enum allocator a, uint32_t rounds, int shuffle)
+{
+  struct pt_pool pool;
+  struct locked_pool locked;
+  uint64_t start;
+  uint32_t r, i;
+
+  pt_pool_init(&pool, sizeof(bench_task), 256);
+  pthread_mutex_init(&locked.lock, NULL);
+  pt_pool_init(&locked.pool, sizeof(bench_task), 256);
+
+  start = bench_now_ns();
+  for(r = 0; r < rounds; ++r) {
+    for(i = 0; i < BATCH; ++i) {
+      switch(a) {
+      case MALLOC: blocks[i] = malloc(sizeof(bench_task)); break;
+      case POOL: blocks[i] = pt_pool_alloc(&pool); break;
+      case LOCKED: blocks[i] = locked_alloc(&locked); break;
+      }
+      ((bench_task *)blocks[i])->locals.steps = i;
+    }
+    for(i = 0; i < BATCH; ++i) {
+      void *b = blocks[shuffle ? order[i] : i];
+      switch(a) {
+      case MALLOC: free(b); break;
+      case POOL: pt_pool_free(&pool, b); break;
+      case LOCKED: locked_free(&locked, b); break;
+      }
+    }
+  }
+  start = bench_now_ns() - start;
+
+  pt_pool_close(&pool);
+  pt_pool_close(&locked.pool);
+  pthread_mutex_destroy(&locked.lock);
+  return (double)start / ((uint64_t)rounds * BATCH);
+}
+
+/*---------------------------------------------------------------------------*/
+static struct pt_task *ended;
+
+static
+PT_THREAD(short_thread(struct pt_task *t))
+{
+  bench_task *self = (bench_task *)t;
+
+  PT_BEGIN(&t->pt);
+  while(self->locals.steps-- > 0) {
+    PT_YIELD(&t->pt);
+  }
+  ended = t;
+  PT_END(&t->pt);
+}
+
+static double
+run_spawn(enum allocator a, uint32_t rounds)
+{
+  struct pt_sched sched;
+  struct pt_pool pool;
+  uint64_t start;
+  uint32_t r, i;
+
+  pt_sched_init(&sched);
+  pt_pool_init(&pool, sizeof(bench_task), 256);
+
+  start = bench_now_ns();
+  for(r = 0; r < rounds; ++r) {
+    for(i = 0; i < BATCH; ++i) {
+      bench_task *t;
+
+      if(a == POOL) {
+        t = (bench_task *)pt_sched_spawn_pool(&sched, &pool, short_thread,
+                                              PT_SCHED_DEFAULT_PRIO);
+      } else {
+        t = malloc(sizeof(*t));
+        pt_sched_spawn(&sched, &t->task, short_thread);
+      }
+      t->locals.steps = i % 4;
+    }
+    while(!pt_sched_idle(&sched)) {
+      if(pt_sched_run_one(&sched) >= PT_EXITED && a != POOL) {
+        free(ended);
+      }
+    }
+  }
+  start = bench_now_ns() - start;
+
+  pt_pool_close(&pool);
+  return (double)start / ((uint64_t)rounds * BATCH);
+}
+
+/*---------------------------------------------------------------------------*/
+#define REMOTE_SLOTS 4096
+
+static _Atomic(void *) slots[REMOTE_SLOTS];
+static enum allocator remote_allocator;
+static struct pt_pool remote_pool;
+static uint64_t remote_count;
+
+static void *
+remote_free_main(void *arg)
+{
+  uint64_t i;
+  void *b;
+
+  (void)arg;
+  for(i = 0; i < remote_count; ++i) {
+    while((b = atomic_exchange(&slots[i % REMOTE_SLOTS], NULL)) == NULL) {
+      sched_yield();
+    }
+    if(remote_allocator == POOL) {
+      pt_pool_free_remote(&remote_pool, b);
+    } else {
+      free(b);
+    }
+  }
+  return NULL;
+}
+
+static double
+run_remote(enum allocator a, uint32_t rounds)
+{
+  pthread_t thread;
+  uint64_t start, i;
+  unsigned k;
+
+  remote_allocator = a;
+  remote_count = (uint64_t)rounds * BATCH;
+  pt_pool_init(&remote_pool, sizeof(bench_task), 256);
+  for(k = 0; k < REMOTE_SLOTS; ++k) {
+    atomic_init(&slots[k], NULL);
+  }
+
+  start = bench_now_ns();
+  pthread_create(&thread, NULL, remote_free_main, NULL);
+  for(i = 0; i < remote_count; ++i) {
+    void *b = a == POOL ? pt_pool_alloc(&remote_pool) :
+      malloc(sizeof(bench_task));
+
+    ((bench_task *)b)->locals.steps = (uint32_t)i;
+    while(atomic_load_explicit(&slots[i % REMOTE_SLOTS],
+                               memory_order_relaxed) != NULL) {
+      sched_yield();
+    }
+    atomic_store(&slots[i % REMOTE_SLOTS], b);
+  }
+  pthread_join(thread, NULL);
+  start = bench_now_ns() - start;
+
+  pt_pool_close(&remote_pool);
+  return (double)start / remote_count;
+}
+
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char *argv[])
+{
+  uint32_t rounds = argc > 1 ? (uint32_t)atoi(argv[1]) : 2000;
+  uint32_t seed = 1;
+  uint32_t i;
+  int a;
+
+  for(i = 0; i < BATCH; ++i) {
+    order[i] = i;
+  }
+  for(i = BATCH - 1; i > 0; --i) {
+    uint32_t j = bench_rand(&seed) % (i + 1), t = order[i];
+    order[i] = order[j];
+    order[j] = t;
+  }
+
+  printf("%u-byte blocks, %u rounds of %u, ns per block\n\n",
+         (unsigned)sizeof(bench_task), rounds, BATCH);
+  printf("%-14s %12s %12s %12s %12s\n",
+         "allocator", "churn", "churn rand", "spawn", "remote");
+  for(a = MALLOC; a <= LOCKED; ++a) {
+    printf("%-14s %12.1f %12.1f", allocator_names[a],
+           run_churn(a, rounds, 0), run_churn(a, rounds, 1));
+    if(a == LOCKED) {
+      printf(" %12s %12s\n", "-", "-");
+    } else {
+      printf(" %12.1f %12.1f\n", run_spawn(a, rounds), run_remote(a, rounds));
+    }
+  }
+  return 0;
+}
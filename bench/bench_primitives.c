@@ -0,0 +1,191 @@
+/*
+ * Microbenchmarks of the protothread primitives.
+ *
+ * This file is compiled once for every local continuation backend.
+ * LC_INCLUDE selects the backend, and BENCH_PRIMITIVES names the
+ * function that runs the benchmarks for it.
+ */
+
+#include "bench.h"
+
+#include "pt.h"
+#include "pt-sem.h"
+
+#include "bench_primitives.h"
+
+/*---------------------------------------------------------------------------*/
+/* Resume and yield: each call resumes and yields once. */
+static BENCH_NOINLINE
+PT_THREAD(yield_thread(struct pt *pt))
+{
+  PT_BEGIN(pt);
+  while(1) {
+    PT_YIELD(pt);
+  }
+  PT_END(pt);
+}
+
+static void
+bench_yield(uint64_t ops)
+{
+  struct pt pt;
+
+  PT_INIT(&pt);
+  while(ops-- > 0) {
+    yield_thread(&pt);
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Resume only: each call resumes and finds its condition false. */
+static volatile int never;
+
+static BENCH_NOINLINE
+PT_THREAD(blocked_thread(struct pt *pt))
+{
+  PT_BEGIN(pt);
+  PT_WAIT_UNTIL(pt, never);
+  PT_END(pt);
+}
+
+static void
+bench_resume(uint64_t ops)
+{
+  struct pt pt;
+
+  PT_INIT(&pt);
+  while(ops-- > 0) {
+    blocked_thread(&pt);
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Spawn: each operation spawns a child that yields once and ends. */
+static BENCH_NOINLINE
+PT_THREAD(short_child(struct pt *pt))
+{
+  PT_BEGIN(pt);
+  PT_YIELD(pt);
+  PT_END(pt);
+}
+
+static BENCH_NOINLINE
+PT_THREAD(spawning_parent(struct pt *pt, struct pt *child))
+{
+  PT_BEGIN(pt);
+  while(1) {
+    PT_SPAWN(pt, child, short_child(child));
+  }
+  PT_END(pt);
+}
+
+static void
+bench_spawn(uint64_t ops)
+{
+  struct pt pt, child;
+
+  /*
+   * Each call of the parent ends the previous child, then starts the
+   * next one and runs it up to its yield: one spawn per call.
+   */
+  PT_INIT(&pt);
+  while(ops-- > 0) {
+    spawning_parent(&pt, &child);
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+/*
+ * Nested wait: four levels of PT_WAIT_THREAD() above a leaf that
+ * yields. Each operation resumes all five protothreads.
+ */
+static BENCH_NOINLINE
+PT_THREAD(nested_leaf(struct pt *pt))
+{
+  PT_BEGIN(pt);
+  while(1) {
+    PT_YIELD(pt);
+  }
+  PT_END(pt);
+}
+
+#define NESTED_THREAD(name, child_fn)			\
+  static BENCH_NOINLINE					\
+  PT_THREAD(name(struct pt *pt))			\
+  {							\
+    PT_BEGIN(pt);					\
+    PT_INIT(pt + 1);					\
+    PT_WAIT_THREAD(pt, child_fn(pt + 1));		\
+    PT_END(pt);						\
+  }
+
+NESTED_THREAD(nested_3, nested_leaf)
+NESTED_THREAD(nested_2, nested_3)
+NESTED_THREAD(nested_1, nested_2)
+NESTED_THREAD(nested_0, nested_1)
+
+static void
+bench_nested(uint64_t ops)
+{
+  struct pt pts[5];
+
+  PT_INIT(&pts[0]);
+  while(ops-- > 0) {
+    nested_0(pts);
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Semaphore ping-pong: each operation is one handoff. */
+static struct pt_sem ping, pong;
+
+static BENCH_NOINLINE
+PT_THREAD(ping_thread(struct pt *pt))
+{
+  PT_BEGIN(pt);
+  while(1) {
+    PT_SEM_WAIT(pt, &ping);
+    PT_SEM_SIGNAL(pt, &pong);
+  }
+  PT_END(pt);
+}
+
+static BENCH_NOINLINE
+PT_THREAD(pong_thread(struct pt *pt))
+{
+  PT_BEGIN(pt);
+  while(1) {
+    PT_SEM_WAIT(pt, &pong);
+    PT_SEM_SIGNAL(pt, &ping);
+  }
+  PT_END(pt);
+}
+
+static void
+bench_sem_pingpong(uint64_t ops)
+{
+  struct pt a, b;
+
+  PT_SEM_INIT(&ping, 1);
+  PT_SEM_INIT(&pong, 0);
+  PT_INIT(&a);
+  PT_INIT(&b);
+  for(ops /= 2; ops > 0; --ops) {
+    ping_thread(&a);
+    pong_thread(&b);
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+int
+BENCH_PRIMITIVES(struct bench_result *r, uint64_t ops)
+{
+  bench_run(&r[0], "pt_yield", BENCH_BACKEND, bench_yield, ops);
+  bench_run(&r[1], "lc_resume", BENCH_BACKEND, bench_resume, ops);
+  bench_run(&r[2], "pt_spawn", BENCH_BACKEND, bench_spawn, ops);
+  bench_run(&r[3], "pt_wait_thread_depth5", BENCH_BACKEND,
+            bench_nested, ops / 4);
+  bench_run(&r[4], "pt_sem_pingpong", BENCH_BACKEND,
+            bench_sem_pingpong, ops);
+  return BENCH_PRIMITIVES_COUNT;
+}
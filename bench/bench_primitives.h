@@ -0,0 +1,14 @@
+/*
+ * Entry points of the primitive benchmarks, one per local
+ * continuation backend.
+ */
+
+#pragma once
+
+#include "bench.h"
+
+/* The number of results that each entry point stores. */
+#define BENCH_PRIMITIVES_COUNT 5
+
+int bench_primitives_switch(struct bench_result *r, uint64_t ops);
+int bench_primitives_addrlabels(struct bench_result *r, uint64_t ops);
@@ -0,0 +1,144 @@
+/*
+ * Measures the wakeup latency of a high-priority protothread that
+ * shares the scheduler in pt-sched.h with many runnable low-priority
+ * protothreads.
+ *
+ * N low-priority protothreads yield forever. A single protothread
+ * waits for an event; every few runs the driver sets the event, wakes
+ * it and records the time. The latency is the time until the woken
+ * protothread runs. With all protothreads at the same priority it
+ * waits behind every runnable one; with a higher priority it is the
+ * next to run.
+ *
+ * Usage: bench_prio [low-priority-threads] [wakeups]
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pt-sched.h"
+
+/* Runs of the scheduler between two wakeups. */
+#define PERIOD 1000
+
+struct spinner {
+  struct pt_task task;
+  unsigned count;
+};
+
+struct waiter {
+  struct pt_task task;
+  uint64_t woken_at;
+  uint64_t *latencies;
+  uint32_t n;
+};
+
+static
+PT_THREAD(spinner_thread(struct pt_task *t))
+{
+  struct spinner *s = (struct spinner *)t;
+
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    ++s->count;
+    PT_YIELD(&t->pt);
+  }
+
+  PT_END(&t->pt);
+}
+
+static
+PT_THREAD(waiter_thread(struct pt_task *t))
+{
+  struct waiter *w = (struct waiter *)t;
+
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    PT_WAIT_UNTIL(&t->pt, w->woken_at != 0);
+    w->latencies[w->n++] = bench_now_ns() - w->woken_at;
+    w->woken_at = 0;
+  }
+
+  PT_END(&t->pt);
+}
+
+static int
+compare_u64(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+static void
+run(const char *mode, struct spinner *s, uint32_t n, uint32_t wakeups,
+    unsigned prio, uint32_t aging)
+{
+  struct pt_sched sched;
+  struct waiter w;
+  uint64_t start, ns;
+  uint32_t i, runs = 0;
+
+  w.woken_at = 0;
+  w.n = 0;
+  w.latencies = malloc(wakeups * sizeof(*w.latencies));
+  if(w.latencies == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+
+  pt_sched_init(&sched);
+  pt_sched_set_aging(&sched, aging);
+  for(i = 0; i < n; ++i) {
+    pt_sched_spawn(&sched, &s[i].task, spinner_thread);
+  }
+  pt_sched_spawn_prio(&sched, &w.task, waiter_thread, prio);
+  pt_sched_run(&sched);
+
+  start = bench_now_ns();
+  while(w.n < wakeups) {
+    if(++runs % PERIOD == 0 && w.woken_at == 0) {
+      w.woken_at = bench_now_ns();
+      pt_task_wake(&w.task);
+    }
+    pt_sched_run_one(&sched);
+  }
+  ns = bench_now_ns() - start;
+
+  qsort(w.latencies, wakeups, sizeof(*w.latencies), compare_u64);
+  printf("%-16s %12llu %12llu %12llu %12llu %10.1f\n", mode,
+         (unsigned long long)w.latencies[wakeups / 2],
+         (unsigned long long)w.latencies[wakeups - 1 - wakeups / 100],
+         (unsigned long long)w.latencies[wakeups - 1 - wakeups / 1000],
+         (unsigned long long)w.latencies[wakeups - 1],
+         (double)ns / runs);
+  free(w.latencies);
+}
+
+int
+main(int argc, char *argv[])
+{
+  uint32_t n = argc > 1 ? (uint32_t)atoi(argv[1]) : 100000;
+  uint32_t wakeups = argc > 2 ? (uint32_t)atoi(argv[2]) : 1000;
+  struct spinner *s = calloc(n, sizeof(*s));
+
+  if(s == NULL || wakeups == 0) {
+    perror("calloc");
+    return 1;
+  }
+
+  printf("%u runnable low-priority threads, %u wakeups, latency in ns\n\n",
+         n, wakeups);
+  printf("%-16s %12s %12s %12s %12s %10s\n",
+         "mode", "p50", "p99", "p99.9", "max", "ns/run");
+  run("flat", s, n, wakeups, PT_SCHED_DEFAULT_PRIO, 0);
+  run("priority", s, n, wakeups, 0, 0);
+  run("priority+aging", s, n, wakeups, 0, 64);
+
+  free(s);
+  return 0;
+}
@@ -0,0 +1,136 @@
+/*
+ * Compares the polling semaphores in pt-sem.h with the wait-queue
+ * semaphores in pt-qsem.h under contention.
+ *
+ * N protothreads repeatedly take a semaphore with a single permit,
+ * yield once while holding it and release it. With pt-sem.h every
+ * waiter checks the counter on every pass, while with pt-qsem.h only
+ * the task that receives the permit is run.
+ *
+ * Usage: bench_qsem [rounds]
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pt-qsem.h"
+#include "pt-sem.h"
+
+struct worker {
+  struct pt_task task;
+  uint32_t i;
+};
+
+static struct pt_sem sem;
+static struct pt_qsem qsem;
+static uint32_t rounds;
+static uint64_t checks;
+
+static
+PT_THREAD(sem_thread(struct pt_task *t))
+{
+  struct worker *w = (struct worker *)t;
+
+  PT_BEGIN(&t->pt);
+
+  for(w->i = 0; w->i < rounds; ++w->i) {
+    PT_WAIT_UNTIL(&t->pt, (++checks, sem.count > 0));
+    --sem.count;
+    PT_YIELD(&t->pt);
+    PT_SEM_SIGNAL(&t->pt, &sem);
+  }
+
+  PT_END(&t->pt);
+}
+
+static
+PT_THREAD(qsem_thread(struct pt_task *t))
+{
+  struct worker *w = (struct worker *)t;
+
+  PT_BEGIN(&t->pt);
+
+  for(w->i = 0; w->i < rounds; ++w->i) {
+    ++checks;
+    PT_QSEM_WAIT(t, &qsem);
+    PT_YIELD(&t->pt);
+    PT_QSEM_SIGNAL(t, &qsem);
+  }
+
+  PT_END(&t->pt);
+}
+
+static double
+run(struct worker *w, uint32_t n, int queued)
+{
+  uint32_t i;
+  uint64_t start;
+
+  PT_SEM_INIT(&sem, 1);
+  PT_QSEM_INIT(&qsem, 1);
+  checks = 0;
+
+  start = bench_now_ns();
+  if(queued) {
+    struct pt_sched sched;
+
+    pt_sched_init(&sched);
+    for(i = 0; i < n; ++i) {
+      pt_sched_spawn(&sched, &w[i].task, qsem_thread);
+    }
+    while(!pt_sched_idle(&sched)) {
+      pt_sched_run(&sched);
+    }
+  } else {
+    uint32_t running = n;
+
+    for(i = 0; i < n; ++i) {
+      PT_INIT(&w[i].task.pt);
+      w[i].task.state = PT_TASK_READY;
+    }
+    while(running > 0) {
+      for(i = 0; i < n; ++i) {
+        if(w[i].task.state == PT_TASK_READY &&
+           !PT_SCHEDULE(sem_thread(&w[i].task))) {
+          w[i].task.state = PT_TASK_IDLE;
+          --running;
+        }
+      }
+    }
+  }
+  return (double)(bench_now_ns() - start) / ((double)n * rounds);
+}
+
+int
+main(int argc, char *argv[])
+{
+  static const uint32_t sizes[] = { 2, 16, 256, 4096 };
+  unsigned i;
+
+  rounds = argc > 1 ? (uint32_t)atoi(argv[1]) : 100;
+
+  printf("%8s %14s %14s %14s %14s\n", "threads",
+         "sem ns/acq", "sem checks", "qsem ns/acq", "qsem checks");
+
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    uint32_t n = sizes[i];
+    struct worker *w = calloc(n, sizeof(*w));
+    double sem_ns, qsem_ns;
+    uint64_t sem_checks;
+
+    if(w == NULL) {
+      perror("calloc");
+      return 1;
+    }
+    sem_ns = run(w, n, 0);
+    sem_checks = checks;
+    qsem_ns = run(w, n, 1);
+    printf("%8u %14.1f %14.1f %14.1f %14.1f\n", n,
+           sem_ns, (double)sem_checks / ((double)n * rounds),
+           qsem_ns, (double)checks / ((double)n * rounds));
+    free(w);
+  }
+  return 0;
+}
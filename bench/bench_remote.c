@@ -0,0 +1,133 @@
+/*
+ * Measures how quickly a protothread that is woken from another
+ * thread runs, and how much CPU time the idle event loop uses.
+ *
+ * A producer thread posts a timestamp 200 microseconds after the
+ * previous one was received. The event loop either polls a flag and
+ * calls usleep(10) while nothing is runnable, like example-buffer.c,
+ * or sleeps in pt_remote_wait() until pt_remote_wake() is called.
+ *
+ * Usage: bench_remote [posts]
+ */
+
+#include "bench.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pt-remote.h"
+
+static struct pt_sched sched;
+static struct pt_remote remote;
+static struct pt_task consumer;
+static struct pt_remote_node consumer_node;
+
+static atomic_uint_fast64_t posted_at;
+static int use_remote;
+static uint32_t posts;
+static uint32_t received;
+static uint64_t latency_ns;
+
+static
+PT_THREAD(consumer_thread(struct pt_task *t))
+{
+  uint64_t at;
+
+  PT_BEGIN(&t->pt);
+
+  while(received < posts) {
+    PT_WAIT_UNTIL(&t->pt, atomic_load(&posted_at) != 0);
+    at = atomic_exchange(&posted_at, 0);
+    latency_ns += bench_now_ns() - at;
+    ++received;
+  }
+
+  PT_END(&t->pt);
+}
+
+static void *
+producer_main(void *arg)
+{
+  uint32_t i;
+
+  (void)arg;
+  for(i = 0; i < posts; ++i) {
+    struct timespec ts = { 0, 200000 };
+
+    /* Post the next timestamp only after the last one was received. */
+    while(atomic_load(&posted_at) != 0) {
+      nanosleep(&ts, NULL);
+    }
+    nanosleep(&ts, NULL);
+    atomic_store(&posted_at, bench_now_ns());
+    if(use_remote) {
+      pt_remote_wake(&remote, &consumer_node);
+    }
+  }
+  return NULL;
+}
+
+static uint64_t
+thread_cpu_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void
+run(int remote_mode)
+{
+  pthread_t producer;
+  uint64_t start, cpu;
+
+  use_remote = remote_mode;
+  received = 0;
+  latency_ns = 0;
+  atomic_store(&posted_at, 0);
+
+  pt_sched_init(&sched);
+  pt_remote_init(&remote, &sched);
+  pt_sched_spawn(&sched, &consumer, consumer_thread);
+  pt_remote_node_init(&consumer_node, &consumer);
+
+  start = bench_now_ns();
+  cpu = thread_cpu_ns();
+  pthread_create(&producer, NULL, producer_main, NULL);
+  while(received < posts) {
+    if(use_remote) {
+      pt_remote_drain(&remote);
+      pt_sched_run(&sched);
+      if(received < posts && pt_sched_idle(&sched)) {
+        pt_remote_wait(&remote, -1);
+      }
+    } else {
+      /* Without remote wakeups the consumer has to be polled. */
+      consumer_thread(&consumer);
+      if(received < posts && atomic_load(&posted_at) == 0) {
+        usleep(10);
+      }
+    }
+  }
+  pthread_join(producer, NULL);
+  cpu = thread_cpu_ns() - cpu;
+
+  printf("%-24s %12.2f %14.1f\n",
+         use_remote ? "pt_remote_wait()" : "usleep(10) polling",
+         (double)latency_ns / posts / 1000.0,
+         100.0 * cpu / (bench_now_ns() - start));
+  pt_remote_close(&remote);
+}
+
+int
+main(int argc, char **argv)
+{
+  posts = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : 5000;
+
+  printf("%u posts from another thread, 200 us apart\n\n", posts);
+  printf("%-24s %12s %14s\n", "event loop", "latency (us)", "loop CPU (%)");
+  run(0);
+  run(1);
+  return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * Compares protecting a read-mostly table with a pt-sem.h semaphore,
+ * a pt-mutex.h mutex and a pt-rwlock.h reader-writer lock.
+ *
+ * N protothreads repeatedly read or, with a given probability, write
+ * the table. Each access takes the lock, yields once while holding
+ * it, as a lookup that waits for something would, and releases it.
+ * The program stops after a given number of accesses in total.
+ *
+ * - pt-sem: a semaphore with a count of one, with every protothread
+ *   polled on every pass. Readers are serialized.
+ * - pt-mutex: a mutex under pt-sched.h. Readers are serialized, but
+ *   waiters are not polled.
+ * - pt-rwlock: a reader-writer lock under pt-sched.h. Readers hold
+ *   the lock together.
+ *
+ * For each method the program prints the accesses per second, the
+ * protothread runs per access and the accesses per pass, where a pass
+ * runs every protothread that is runnable once. When the yield stands
+ * for waiting one tick for a device, the accesses per pass are the
+ * accesses per tick.
+ *
+ * Usage: bench_rwlock [threads] [accesses]
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pt-mutex.h"
+#include "pt-rwlock.h"
+#include "pt-sem.h"
+
+struct worker {
+  struct pt_task task;
+  uint32_t seed;
+  int write;
+};
+
+static struct pt_sem sem;
+static struct pt_mutex mutex;
+static struct pt_rwlock rwlock;
+static uint32_t write_pct;
+static uint64_t accesses;
+static uint64_t runs;
+static uint64_t passes;
+
+static
+PT_THREAD(sem_thread(struct pt_task *t))
+{
+  ++runs;
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    PT_SEM_WAIT(&t->pt, &sem);
+    ++accesses;
+    PT_YIELD(&t->pt);
+    PT_SEM_SIGNAL(&t->pt, &sem);
+  }
+
+  PT_END(&t->pt);
+}
+
+static
+PT_THREAD(mutex_thread(struct pt_task *t))
+{
+  ++runs;
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    PT_MUTEX_LOCK(t, &mutex);
+    ++accesses;
+    PT_YIELD(&t->pt);
+    PT_MUTEX_UNLOCK(t, &mutex);
+  }
+
+  PT_END(&t->pt);
+}
+
+static
+PT_THREAD(rwlock_thread(struct pt_task *t))
+{
+  struct worker *w = (struct worker *)t;
+
+  ++runs;
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    w->write = bench_rand(&w->seed) % 100 < write_pct;
+    if(w->write) {
+      PT_RWLOCK_WRITE(t, &rwlock);
+    } else {
+      PT_RWLOCK_READ(t, &rwlock);
+    }
+    ++accesses;
+    PT_YIELD(&t->pt);
+    if(w->write) {
+      PT_RWLOCK_WRITE_UNLOCK(t, &rwlock);
+    } else {
+      PT_RWLOCK_READ_UNLOCK(t, &rwlock);
+    }
+  }
+
+  PT_END(&t->pt);
+}
+
+static void
+report(const char *name, uint64_t ns)
+{
+  printf("  %-10s %14.0f %12.2f %12.2f\n", name, accesses * 1e9 / ns,
+         (double)runs / accesses, (double)accesses / passes);
+}
+
+static void
+run_sched(struct worker *w, uint32_t n, uint64_t target, pt_task_fn fn,
+          const char *name)
+{
+  struct pt_sched sched;
+  uint64_t start;
+  uint32_t i;
+
+  pt_sched_init(&sched);
+  for(i = 0; i < n; ++i) {
+    w[i].seed = i + 1;
+    pt_sched_spawn(&sched, &w[i].task, fn);
+  }
+  accesses = runs = passes = 0;
+  start = bench_now_ns();
+  while(accesses < target) {
+    pt_sched_run(&sched);
+    ++passes;
+  }
+  report(name, bench_now_ns() - start);
+}
+
+int
+main(int argc, char *argv[])
+{
+  static const uint32_t writes[] = { 1, 10, 50 };
+  uint32_t n = argc > 1 ? (uint32_t)atoi(argv[1]) : 1000;
+  uint64_t target = argc > 2 ? (uint64_t)atoll(argv[2]) : 200000;
+  struct worker *w = calloc(n, sizeof(*w));
+  unsigned k;
+
+  if(w == NULL) {
+    perror("calloc");
+    return 1;
+  }
+
+  printf("%u threads, %llu accesses\n", n, (unsigned long long)target);
+  for(k = 0; k < sizeof(writes) / sizeof(writes[0]); ++k) {
+    uint64_t start;
+    uint32_t i;
+
+    write_pct = writes[k];
+    printf("\n%u%% reads, %u%% writes\n", 100 - write_pct, write_pct);
+    printf("  %-10s %14s %12s %12s\n", "lock", "accesses/s", "runs/access",
+           "per pass");
+
+    /* The semaphore serializes every access, whatever its kind */
+    PT_SEM_INIT(&sem, 1);
+    for(i = 0; i < n; ++i) {
+      PT_INIT(&w[i].task.pt);
+    }
+    accesses = runs = passes = 0;
+    start = bench_now_ns();
+    while(accesses < target) {
+      for(i = 0; i < n; ++i) {
+        sem_thread(&w[i].task);
+      }
+      ++passes;
+    }
+    report("pt-sem", bench_now_ns() - start);
+
+    PT_MUTEX_INIT(&mutex);
+    run_sched(w, n, target, mutex_thread, "pt-mutex");
+
+    PT_RWLOCK_INIT(&rwlock);
+    run_sched(w, n, target, rwlock_thread, "pt-rwlock");
+  }
+
+  free(w);
+  return 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * Compares polling PT_WAIT_UNTIL() on a deadline in every protothread
+ * of a large array with scanning the deadlines with pt_group_scan().
+ *
+ * Every protothread waits until a tick between 1 and a maximum number
+ * of ticks away, so about N / (max / 2) of them are due on each tick.
+ * The struct pt and the deadline of each protothread are kept in
+ * dense arrays in both cases.
+ *
+ * - poll: each tick calls every protothread, which evaluates its
+ *   PT_WAIT_UNTIL() condition.
+ * - scan: each tick, pt_group_scan() lists the protothreads whose
+ *   deadlines have been reached and only those are called.
+ * - group: the same protothreads in a struct pt_group, advanced with
+ *   pt_group_advance() and run with pt_group_sweep().
+ *
+ * The program is built once per value of PT_GROUP_SIMD that the
+ * compiler supports: bench_scan (the default, SSE2 on x86-64),
+ * bench_scan_portable, bench_scan_avx2 and bench_scan_avx512.
+ *
+ * Usage: bench_scan [threads] [max-ticks] [ticks]
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pt-group.h"
+
+static uint32_t max_ticks;
+static uint32_t now;
+static uint32_t *deadline;
+static uint32_t *seeds;
+static uint64_t wakeups;
+
+static
+PT_THREAD(sleeper(struct pt *pt, uint32_t i))
+{
+  PT_BEGIN(pt);
+
+  while(1) {
+    deadline[i] = now + 1 + bench_rand(&seeds[i]) % max_ticks;
+    PT_WAIT_UNTIL(pt, now - deadline[i] < 0x80000000u);
+    ++wakeups;
+  }
+
+  PT_END(pt);
+}
+
+static
+PT_THREAD(group_sleeper(struct pt_group *g, uint32_t i))
+{
+  PT_BEGIN(pt_group_pt(g, i));
+
+  while(1) {
+    PT_GROUP_SLEEP(g, i, 1 + bench_rand(&seeds[i]) % max_ticks);
+    ++wakeups;
+  }
+
+  PT_END(pt_group_pt(g, i));
+}
+
+static const char *
+kernel_name(void)
+{
+  switch(PT_GROUP_SIMD) {
+  case 512: return "AVX-512";
+  case 256: return "AVX2";
+  case 128: return "SSE2";
+  default: return "portable C";
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  uint32_t n = argc > 1 ? (uint32_t)atoi(argv[1]) : 10000000;
+  uint32_t ticks = argc > 3 ? (uint32_t)atoi(argv[3]) : 20;
+  struct pt *pts;
+  uint32_t *due;
+  struct pt_group g;
+  uint64_t start, poll_ns, scan_ns, scan_only_ns = 0, group_ns;
+  uint64_t poll_wakeups, scan_wakeups, group_wakeups;
+  uint32_t i, k, tick;
+
+  max_ticks = argc > 2 ? (uint32_t)atoi(argv[2]) : 1000;
+
+  pts = malloc((size_t)n * sizeof(*pts));
+  deadline = malloc((size_t)n * sizeof(*deadline));
+  seeds = malloc((size_t)n * sizeof(*seeds));
+  due = malloc((size_t)n * sizeof(*due));
+  if(pts == NULL || deadline == NULL || seeds == NULL || due == NULL) {
+    perror("malloc");
+    return 1;
+  }
+
+  /* Poll every protothread */
+  now = 0;
+  for(i = 0; i < n; ++i) {
+    PT_INIT(&pts[i]);
+    seeds[i] = i + 1;
+    sleeper(&pts[i], i);
+  }
+  wakeups = 0;
+  start = bench_now_ns();
+  for(tick = 0; tick < ticks; ++tick) {
+    ++now;
+    for(i = 0; i < n; ++i) {
+      sleeper(&pts[i], i);
+    }
+  }
+  poll_ns = bench_now_ns() - start;
+  poll_wakeups = wakeups;
+
+  /* Scan the deadlines and run the listed protothreads */
+  now = 0;
+  for(i = 0; i < n; ++i) {
+    PT_INIT(&pts[i]);
+    seeds[i] = i + 1;
+    sleeper(&pts[i], i);
+  }
+  wakeups = 0;
+  start = bench_now_ns();
+  for(tick = 0; tick < ticks; ++tick) {
+    uint64_t t0 = bench_now_ns();
+    uint32_t count;
+
+    ++now;
+    count = pt_group_scan(deadline, n, now, due);
+    scan_only_ns += bench_now_ns() - t0;
+    for(k = 0; k < count; ++k) {
+      sleeper(&pts[due[k]], due[k]);
+    }
+  }
+  scan_ns = bench_now_ns() - start;
+  scan_wakeups = wakeups;
+  free(pts);
+  free(deadline);
+  free(due);
+
+  /* A group */
+  if(pt_group_init(&g, n, group_sleeper, NULL) != 0) {
+    perror("malloc");
+    return 1;
+  }
+  for(i = 0; i < n; ++i) {
+    seeds[i] = i + 1;
+    pt_group_spawn(&g, i);
+  }
+  pt_group_sweep(&g);
+  wakeups = 0;
+  start = bench_now_ns();
+  for(tick = 0; tick < ticks; ++tick) {
+    pt_group_advance(&g, 1);
+    pt_group_sweep(&g);
+  }
+  group_ns = bench_now_ns() - start;
+  group_wakeups = wakeups;
+  pt_group_close(&g);
+  free(seeds);
+
+  printf("%s, %u threads waiting 1..%u ticks, %u ticks, "
+         "%.0f wakeups/tick\n\n", kernel_name(), n, max_ticks, ticks,
+         (double)scan_wakeups / ticks);
+  printf("%-18s %14s %14s %10s\n", "method", "ms/tick", "ns/thread", "wakeups");
+  printf("%-18s %14.2f %14.3f %10llu\n", "poll PT_WAIT_UNTIL",
+         poll_ns / 1e6 / ticks, (double)poll_ns / ticks / n,
+         (unsigned long long)poll_wakeups);
+  printf("%-18s %14.2f %14.3f %10llu\n", "pt_group_scan",
+         scan_ns / 1e6 / ticks, (double)scan_ns / ticks / n,
+         (unsigned long long)scan_wakeups);
+  printf("%-18s %14.2f %14.3f\n", "  of which scan",
+         scan_only_ns / 1e6 / ticks, (double)scan_only_ns / ticks / n);
+  printf("%-18s %14.2f %14.3f %10llu\n", "pt_group",
+         group_ns / 1e6 / ticks, (double)group_ns / ticks / n,
+         (unsigned long long)group_wakeups);
+  return 0;
+}
@@ -0,0 +1,125 @@
+/*
+ * Compares the run-queue scheduler in pt-sched.h with the naive
+ * driver loop that calls every protothread on every pass.
+ *
+ * N protothreads block in PT_WAIT_UNTIL() on a per-thread flag. On
+ * every tick a fixed number of them get their flag set. The naive
+ * loop calls all N protothreads to find them, while the scheduler
+ * only runs the ones that were woken.
+ *
+ * Usage: bench_sched [runnable-per-tick]
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pt-sched.h"
+
+struct worker {
+  struct pt_task task;
+  int flag;
+  unsigned count;
+};
+
+static
+PT_THREAD(worker_thread(struct pt_task *t))
+{
+  struct worker *w = (struct worker *)t;
+
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    PT_WAIT_UNTIL(&t->pt, w->flag != 0);
+    w->flag = 0;
+    ++w->count;
+  }
+
+  PT_END(&t->pt);
+}
+
+static double
+run_naive(struct worker *w, uint32_t n, uint32_t runnable, uint32_t ticks)
+{
+  uint32_t seed = 1;
+  uint64_t start;
+  uint32_t tick, i;
+
+  for(i = 0; i < n; ++i) {
+    PT_INIT(&w[i].task.pt);
+    w[i].flag = 0;
+  }
+
+  start = bench_now_ns();
+  for(tick = 0; tick < ticks; ++tick) {
+    for(i = 0; i < runnable; ++i) {
+      w[bench_rand(&seed) % n].flag = 1;
+    }
+    for(i = 0; i < n; ++i) {
+      worker_thread(&w[i].task);
+    }
+  }
+  return (double)(bench_now_ns() - start) / ticks;
+}
+
+static double
+run_sched(struct worker *w, uint32_t n, uint32_t runnable, uint32_t ticks)
+{
+  struct pt_sched sched;
+  uint32_t seed = 1;
+  uint64_t start;
+  uint32_t tick, i;
+
+  pt_sched_init(&sched);
+  for(i = 0; i < n; ++i) {
+    w[i].flag = 0;
+    pt_sched_spawn(&sched, &w[i].task, worker_thread);
+  }
+  pt_sched_run(&sched);
+
+  start = bench_now_ns();
+  for(tick = 0; tick < ticks; ++tick) {
+    for(i = 0; i < runnable; ++i) {
+      struct worker *v = &w[bench_rand(&seed) % n];
+      v->flag = 1;
+      pt_task_wake(&v->task);
+    }
+    pt_sched_run(&sched);
+  }
+  return (double)(bench_now_ns() - start) / ticks;
+}
+
+int
+main(int argc, char *argv[])
+{
+  static const uint32_t sizes[] = { 10, 1000, 100000, 1000000 };
+  uint32_t runnable = argc > 1 ? (uint32_t)atoi(argv[1]) : 10;
+  unsigned i;
+
+  printf("%10s %10s %14s %14s %10s\n",
+         "threads", "runnable", "naive ns/tick", "sched ns/tick", "speedup");
+
+  for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    uint32_t n = sizes[i];
+    uint32_t r = runnable < n ? runnable : n;
+    /* Keep the naive loop at roughly 100M protothread calls. */
+    uint32_t ticks = n < 1000000 ? 100000000 / n : 100;
+    struct worker *w = calloc(n, sizeof(*w));
+    double naive, sched;
+
+    if(w == NULL) {
+      perror("calloc");
+      return 1;
+    }
+    if(ticks > 100000) {
+      ticks = 100000;
+    }
+    naive = run_naive(w, n, r, ticks);
+    sched = run_sched(w, n, r, ticks);
+    printf("%10u %10u %14.1f %14.1f %9.1fx\n",
+           n, r, naive, sched, naive / sched);
+    free(w);
+  }
+  return 0;
+}
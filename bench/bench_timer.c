@@ -0,0 +1,185 @@
+/*
+ * Measures the timing wheel in pt-timer.h with 1M concurrent timers.
+ *
+ * The first part measures the cost of adding, cancelling and expiring
+ * timers in the wheel. The second part runs 1M protothreads that
+ * sleep for random intervals, once with PT_SLEEP() under the
+ * scheduler and once with the polling timer from example-codelock.c,
+ * where every protothread checks its own deadline on every tick.
+ *
+ * Usage: bench_timer [timers] [max-ticks]
+ */
+
+#include "bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pt-sched.h"
+
+static uint32_t max_ticks;
+static uint64_t expired;
+
+static void
+count_expiry(struct pt_timer *t)
+{
+  (void)t;
+  ++expired;
+}
+
+struct sleeper {
+  struct pt_task task;
+  uint32_t seed;
+  uint32_t deadline;
+  unsigned wakeups;
+};
+
+static uint32_t now;
+
+static
+PT_THREAD(wheel_sleeper(struct pt_task *t))
+{
+  struct sleeper *s = (struct sleeper *)t;
+
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    PT_SLEEP(t, 1 + bench_rand(&s->seed) % max_ticks);
+    ++s->wakeups;
+  }
+
+  PT_END(&t->pt);
+}
+
+static
+PT_THREAD(polling_sleeper(struct pt_task *t))
+{
+  struct sleeper *s = (struct sleeper *)t;
+
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    s->deadline = now + 1 + bench_rand(&s->seed) % max_ticks;
+    PT_WAIT_UNTIL(&t->pt, (int32_t)(now - s->deadline) >= 0);
+    ++s->wakeups;
+  }
+
+  PT_END(&t->pt);
+}
+
+static void
+bench_wheel(uint32_t n)
+{
+  struct pt_timer_wheel *w = malloc(sizeof(*w));
+  struct pt_timer *timers = calloc(n, sizeof(*timers));
+  uint32_t seed = 1;
+  uint64_t start, add_ns, cancel_ns, expire_ns;
+  uint32_t i;
+
+  if(w == NULL || timers == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+  pt_timer_wheel_init(w, count_expiry);
+
+  start = bench_now_ns();
+  for(i = 0; i < n; ++i) {
+    pt_timer_add(w, &timers[i], 1 + bench_rand(&seed) % max_ticks);
+  }
+  add_ns = bench_now_ns() - start;
+
+  start = bench_now_ns();
+  for(i = 0; i < n; i += 2) {
+    pt_timer_cancel(&timers[i]);
+  }
+  cancel_ns = bench_now_ns() - start;
+
+  expired = 0;
+  start = bench_now_ns();
+  pt_timer_wheel_advance(w, max_ticks);
+  expire_ns = bench_now_ns() - start;
+
+  printf("wheel:   %u timers, add %.1f ns, cancel %.1f ns, "
+         "expire %.1f ns/timer (%llu expired over %u ticks)\n",
+         n, (double)add_ns / n, (double)cancel_ns / ((n + 1) / 2),
+         (double)expire_ns / (expired ? expired : 1),
+         (unsigned long long)expired, max_ticks);
+  free(timers);
+  free(w);
+}
+
+static uint64_t
+total_wakeups(struct sleeper *s, uint32_t n)
+{
+  uint64_t sum = 0;
+  uint32_t i;
+
+  for(i = 0; i < n; ++i) {
+    sum += s[i].wakeups;
+  }
+  return sum;
+}
+
+static void
+bench_sleepers(uint32_t n, uint32_t ticks)
+{
+  struct sleeper *s = calloc(n, sizeof(*s));
+  struct pt_sched *sched = malloc(sizeof(*sched));
+  uint64_t start, wheel_ns, poll_ns;
+  uint32_t i, tick;
+
+  if(s == NULL || sched == NULL) {
+    perror("malloc");
+    exit(1);
+  }
+
+  pt_sched_init(sched);
+  for(i = 0; i < n; ++i) {
+    s[i].seed = i + 1;
+    pt_sched_spawn(sched, &s[i].task, wheel_sleeper);
+  }
+  pt_sched_run(sched);
+  start = bench_now_ns();
+  for(tick = 0; tick < ticks; ++tick) {
+    pt_sched_advance(sched, 1);
+    pt_sched_run(sched);
+  }
+  wheel_ns = bench_now_ns() - start;
+  printf("sleep:   %u protothreads, PT_SLEEP %.1f us/tick (%llu wakeups)\n",
+         n, wheel_ns / 1000.0 / ticks,
+         (unsigned long long)total_wakeups(s, n));
+
+  now = 0;
+  for(i = 0; i < n; ++i) {
+    s[i].seed = i + 1;
+    s[i].wakeups = 0;
+    PT_INIT(&s[i].task.pt);
+    polling_sleeper(&s[i].task);
+  }
+  start = bench_now_ns();
+  for(tick = 0; tick < ticks; ++tick) {
+    ++now;
+    for(i = 0; i < n; ++i) {
+      polling_sleeper(&s[i].task);
+    }
+  }
+  poll_ns = bench_now_ns() - start;
+  printf("sleep:   %u protothreads, polling %.1f us/tick (%llu wakeups)\n",
+         n, poll_ns / 1000.0 / ticks,
+         (unsigned long long)total_wakeups(s, n));
+
+  free(sched);
+  free(s);
+}
+
+int
+main(int argc, char *argv[])
+{
+  uint32_t n = argc > 1 ? (uint32_t)atoi(argv[1]) : 1000000;
+
+  max_ticks = argc > 2 ? (uint32_t)atoi(argv[2]) : 100000;
+
+  bench_wheel(n);
+  bench_sleepers(n, 1000);
+  return 0;
+}
@@ -0,0 +1,34 @@
+/*
+ * Measures the overhead of PT_STATS and PT_TRACE on a protothread
+ * that yields in a loop. Each call of the protothread records two
+ * trace events, one when it is resumed and one when it yields.
+ *
+ * Usage: bench_trace [ops]
+ */
+
+#include "bench.h"
+
+#include <stdlib.h>
+
+#include "bench_trace.h"
+
+int
+main(int argc, char *argv[])
+{
+  struct bench_result results[4];
+  uint64_t ops = argc > 1 ? strtoull(argv[1], NULL, 10) : 50000000;
+  int n = 0;
+  int i;
+
+  n += bench_trace_plain(results + n, ops);
+  n += bench_trace_stats(results + n, ops);
+  n += bench_trace_trace(results + n, ops);
+
+  bench_print_header(stdout);
+  for(i = 0; i < n; ++i) {
+    bench_print(stdout, &results[i]);
+  }
+  printf("\nPT_TRACE: %.2f ns per event\n",
+         (results[n - 1].ns_per_op - results[0].ns_per_op) / 2);
+  return 0;
+}
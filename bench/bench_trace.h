@@ -0,0 +1,11 @@
+/*
+ * Entry points of bench_trace, one per instrumentation mode.
+ */
+
+#pragma once
+
+#include "bench.h"
+
+int bench_trace_plain(struct bench_result *r, uint64_t ops);
+int bench_trace_stats(struct bench_result *r, uint64_t ops);
+int bench_trace_trace(struct bench_result *r, uint64_t ops);
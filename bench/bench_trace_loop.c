@@ -0,0 +1,60 @@
+/*
+ * The loop measured by bench_trace.
+ *
+ * This file is compiled once without instrumentation, once with
+ * PT_STATS and once with PT_TRACE. BENCH_TRACE_MODE names the build
+ * and BENCH_TRACE_LOOP the function that runs the benchmark for it.
+ */
+
+#include "bench.h"
+
+#include "pt.h"
+
+#include "bench_trace.h"
+
+#ifdef PT_TRACE
+PT_TRACE_DEFINE;
+
+static struct pt_trace trace;
+static struct pt_trace_event events[1 << 16];
+#endif
+
+/* Each call resumes and yields once: two trace events. */
+static BENCH_NOINLINE
+PT_THREAD(yield_thread(struct pt *pt))
+{
+  PT_BEGIN(pt);
+  while(1) {
+    PT_YIELD(pt);
+  }
+  PT_END(pt);
+}
+
+static void
+bench_yield(uint64_t ops)
+{
+  struct pt pt;
+
+  PT_INIT(&pt);
+  while(ops-- > 0) {
+    yield_thread(&pt);
+  }
+}
+
+int
+BENCH_TRACE_LOOP(struct bench_result *r, uint64_t ops)
+{
+  int n = 0;
+
+#ifdef PT_TRACE
+  pt_trace_init(&trace, events, 1 << 16, 0);
+  bench_run(&r[n++], "pt_yield", BENCH_TRACE_MODE " detach",
+            bench_yield, ops);
+  pt_trace_attach(&trace);
+  bench_run(&r[n++], "pt_yield", BENCH_TRACE_MODE, bench_yield, ops);
+  pt_trace_attach(NULL);
+#else
+  bench_run(&r[n++], "pt_yield", BENCH_TRACE_MODE, bench_yield, ops);
+#endif
+  return n;
+}
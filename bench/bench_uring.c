@@ -0,0 +1,293 @@
+/*
+ * Compares the io_uring engine in pt-uring.h with its epoll fallback.
+ *
+ * The same protothreads are run with both engines:
+ *
+ * - File copy: several protothreads each copy their own file in
+ *   chunks with PT_IO_READ() and PT_IO_WRITE(). With epoll the
+ *   regular files are always ready, so every chunk costs a read() and
+ *   a write(); with io_uring the requests of all protothreads are
+ *   submitted together.
+ *
+ * - TCP echo: like bench_echo, one protothread per connection on
+ *   each side exchanges 64-byte messages over loopback.
+ *
+ * Usage: bench_uring [file-MiB] [connections] [round-trips]
+ */
+
+#include "bench.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+
+#include "pt-uring.h"
+
+#define FILES 8
+#define CHUNK (64 * 1024)
+#define MSG_SIZE 64
+
+static struct pt_sched sched;
+static struct pt_uring uring;
+static uint32_t done;
+
+/*---------------------------------------------------------------------------*/
+struct copy {
+  struct pt_task task;
+  struct pt_io_handle in;
+  struct pt_io_handle out;
+  ssize_t n;
+  ssize_t off;
+  ssize_t written;
+  char buf[CHUNK];
+};
+
+static
+PT_THREAD(copy_thread(struct pt_task *t))
+{
+  struct copy *c = (struct copy *)t;
+
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    PT_IO_READ(t, &uring, &c->in, c->buf, CHUNK, c->n);
+    if(c->n <= 0) {
+      break;
+    }
+    for(c->off = 0; c->off < c->n; c->off += c->written) {
+      PT_IO_WRITE(t, &uring, &c->out, c->buf + c->off, c->n - c->off,
+                  c->written);
+      if(c->written <= 0) {
+        PT_EXIT(&t->pt);
+      }
+    }
+  }
+  ++done;
+
+  PT_END(&t->pt);
+}
+
+static int
+temp_file(void)
+{
+  char name[] = "/tmp/bench_uring.XXXXXX";
+  int fd = mkstemp(name);
+
+  if(fd < 0) {
+    perror("mkstemp");
+    exit(1);
+  }
+  unlink(name);
+  return fd;
+}
+
+static void
+run_copy(const char *name, uint32_t entries, const int *src, const int *dst,
+         size_t size)
+{
+  static struct copy c[FILES];
+  uint64_t start, ns;
+  int i;
+
+  pt_sched_init(&sched);
+  pt_uring_init(&uring, &sched, entries);
+  for(i = 0; i < FILES; ++i) {
+    lseek(src[i], 0, SEEK_SET);
+    lseek(dst[i], 0, SEEK_SET);
+    pt_uring_add(&uring, &c[i].in, src[i]);
+    pt_uring_add(&uring, &c[i].out, dst[i]);
+    pt_sched_spawn(&sched, &c[i].task, copy_thread);
+  }
+  done = 0;
+
+  start = bench_now_ns();
+  while(1) {
+    pt_sched_run(&sched);
+    if(done == FILES) {
+      break;
+    }
+    pt_uring_poll(&uring, pt_sched_idle(&sched) ? -1 : 0);
+  }
+  ns = bench_now_ns() - start;
+
+  printf("%-20s %-10s %12.0f %12.0f\n", "file copy", name,
+         (double)size * FILES / ns * 1e9 / (1 << 20),
+         (double)size * FILES / CHUNK * 2 / ns * 1e9);
+  pt_uring_close(&uring);
+}
+
+/*---------------------------------------------------------------------------*/
+struct conn {
+  struct pt_task task;
+  struct pt_io_handle h;
+  char buf[MSG_SIZE];
+  ssize_t len;
+  ssize_t n;
+  uint32_t i;
+};
+
+static uint32_t rounds;
+
+/* Reads or writes a whole message, one request at a time. */
+#define TRANSFER(op, t, c)						\
+  for((c)->len = 0; (c)->len < MSG_SIZE; (c)->len += (c)->n) {		\
+    op((t), &uring, &(c)->h, (c)->buf + (c)->len,			\
+       MSG_SIZE - (c)->len, (c)->n);					\
+    if((c)->n <= 0) {							\
+      PT_EXIT(&(t)->pt);						\
+    }									\
+  }
+
+static
+PT_THREAD(server_thread(struct pt_task *t))
+{
+  struct conn *c = (struct conn *)t;
+
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    TRANSFER(PT_IO_READ, t, c);
+    TRANSFER(PT_IO_WRITE, t, c);
+  }
+
+  PT_END(&t->pt);
+}
+
+static
+PT_THREAD(client_thread(struct pt_task *t))
+{
+  struct conn *c = (struct conn *)t;
+
+  PT_BEGIN(&t->pt);
+
+  memset(c->buf, 'x', MSG_SIZE);
+  for(c->i = 0; c->i < rounds; ++c->i) {
+    TRANSFER(PT_IO_WRITE, t, c);
+    TRANSFER(PT_IO_READ, t, c);
+  }
+  ++done;
+
+  PT_END(&t->pt);
+}
+
+static uint32_t
+open_connections(int *client_fd, int *server_fd, uint32_t n)
+{
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  int one = 1;
+  int lfd;
+  uint32_t i;
+
+  lfd = socket(AF_INET, SOCK_STREAM, 0);
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if(bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+     listen(lfd, 64) < 0 ||
+     getsockname(lfd, (struct sockaddr *)&addr, &len) < 0) {
+    perror("listen");
+    exit(1);
+  }
+  for(i = 0; i < n; ++i) {
+    client_fd[i] = socket(AF_INET, SOCK_STREAM, 0);
+    if(client_fd[i] < 0 ||
+       connect(client_fd[i], (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+       (server_fd[i] = accept(lfd, NULL, NULL)) < 0) {
+      perror("connect");
+      break;
+    }
+    setsockopt(client_fd[i], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(server_fd[i], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    pt_io_nonblock(client_fd[i]);
+    pt_io_nonblock(server_fd[i]);
+  }
+  close(lfd);
+  return i;
+}
+
+static void
+run_echo(const char *name, uint32_t entries, struct conn *server,
+         struct conn *client, const int *server_fd, const int *client_fd,
+         uint32_t n)
+{
+  uint64_t start, ns;
+  uint32_t i;
+
+  pt_sched_init(&sched);
+  pt_uring_init(&uring, &sched, entries);
+  for(i = 0; i < n; ++i) {
+    pt_uring_add(&uring, &server[i].h, server_fd[i]);
+    pt_sched_spawn(&sched, &server[i].task, server_thread);
+    pt_uring_add(&uring, &client[i].h, client_fd[i]);
+    pt_sched_spawn(&sched, &client[i].task, client_thread);
+  }
+  done = 0;
+
+  start = bench_now_ns();
+  while(1) {
+    pt_sched_run(&sched);
+    if(done == n) {
+      break;
+    }
+    pt_uring_poll(&uring, pt_sched_idle(&sched) ? -1 : 0);
+  }
+  ns = bench_now_ns() - start;
+
+  printf("%-20s %-10s %12s %12.0f\n", "echo", name, "-",
+         (double)n * rounds * 1e9 / ns);
+  /* The servers still wait for a read, which closing the ring cancels. */
+  pt_uring_close(&uring);
+}
+
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  size_t size = (argc > 1 ? strtoul(argv[1], NULL, 0) : 16) << 20;
+  uint32_t n = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 0) : 1000;
+  int src[FILES], dst[FILES];
+  struct conn *server, *client;
+  int *server_fd, *client_fd;
+  struct pt_uring probe;
+  char *data;
+  int i;
+
+  rounds = argc > 3 ? (uint32_t)strtoul(argv[3], NULL, 0) : 100;
+
+  pt_sched_init(&sched);
+  pt_uring_init(&probe, &sched, 8);
+  if(!pt_uring_available(&probe)) {
+    printf("io_uring is not available, only the fallback is measured\n");
+  }
+  pt_uring_close(&probe);
+
+  data = malloc(size);
+  memset(data, 'c', size);
+  for(i = 0; i < FILES; ++i) {
+    src[i] = temp_file();
+    dst[i] = temp_file();
+    if(write(src[i], data, size) != (ssize_t)size) {
+      perror("write");
+      return 1;
+    }
+  }
+  free(data);
+
+  server = calloc(n, sizeof(*server));
+  client = calloc(n, sizeof(*client));
+  server_fd = calloc(n, sizeof(*server_fd));
+  client_fd = calloc(n, sizeof(*client_fd));
+  n = open_connections(client_fd, server_fd, n);
+
+  printf("%d files of %zu MiB in %d KiB chunks; %u connections, "
+         "%u round trips each\n\n", FILES, size >> 20, CHUNK >> 10, n, rounds);
+  printf("%-20s %-10s %12s %12s\n", "benchmark", "engine", "MiB/s", "ops/s");
+  run_copy("epoll", 0, src, dst, size);
+  run_copy("io_uring", 256, src, dst, size);
+  run_echo("epoll", 0, server, client, server_fd, client_fd, n);
+  run_echo("io_uring", 4096, server, client, server_fd, client_fd, n);
+  return 0;
+}
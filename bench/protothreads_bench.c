@@ -0,0 +1,49 @@
+/*
+ * Runs the microbenchmarks of the protothread primitives for every
+ * local continuation backend and reports the cost per operation.
+ *
+ * Usage: protothreads_bench [--json] [--ops N]
+ *
+ * With --json the results are written to stdout as JSON, so that they
+ * can be stored and compared between releases.
+ */
+
+#include "bench.h"
+
+#include <stdlib.h>
+
+#include "bench_primitives.h"
+
+int
+main(int argc, char *argv[])
+{
+  struct bench_result results[2 * BENCH_PRIMITIVES_COUNT];
+  uint64_t ops = 50000000;
+  int json = 0;
+  int n = 0;
+  int i;
+
+  for(i = 1; i < argc; ++i) {
+    if(strcmp(argv[i], "--json") == 0) {
+      json = 1;
+    } else if(strcmp(argv[i], "--ops") == 0 && i + 1 < argc) {
+      ops = strtoull(argv[++i], NULL, 10);
+    } else {
+      fprintf(stderr, "usage: %s [--json] [--ops N]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  n += bench_primitives_switch(results + n, ops);
+  n += bench_primitives_addrlabels(results + n, ops);
+
+  if(json) {
+    bench_print_json(stdout, results, n);
+  } else {
+    bench_print_header(stdout);
+    for(i = 0; i < n; ++i) {
+      bench_print(stdout, &results[i]);
+    }
+  }
+  return 0;
+}
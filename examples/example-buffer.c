@@ -81,57 +81,70 @@ consume_item(int item)
 }
 
 static struct pt_sem full, empty;
+
+/*
+ * The loop counters must survive PT_SEM_WAIT(), so they are kept with
+ * the protothread state instead of on the stack.
+ */
+typedef PT_LOCALS(struct {
+  int produced;
+}) producer_pt;
+
+typedef PT_LOCALS(struct {
+  int consumed;
+}) consumer_pt;
  
 static 
-PT_THREAD(producer(struct pt *pt))
+PT_THREAD(producer(producer_pt *self))
 {
-  static int produced;
-  
-  PT_BEGIN(pt);
+  PT_BEGIN(&self->pt);
   
-  for(produced = 0; produced < NUM_ITEMS; ++produced) {
+  for(self->locals.produced = 0;
+      self->locals.produced < NUM_ITEMS;
+      ++self->locals.produced) {
   
-    PT_SEM_WAIT(pt, &full);
+    PT_SEM_WAIT(&self->pt, &full);
     
     add_to_buffer(produce_item());
     
-    PT_SEM_SIGNAL(pt, &empty);
+    PT_SEM_SIGNAL(&self->pt, &empty);
   }
 
-  PT_END(pt);
+  PT_END(&self->pt);
 }
  
 static 
-PT_THREAD(consumer(struct pt *pt))
+PT_THREAD(consumer(consumer_pt *self))
 {
-  static int consumed;
-  
-  PT_BEGIN(pt);
+  PT_BEGIN(&self->pt);
  
-  for(consumed = 0; consumed < NUM_ITEMS; ++consumed) {
+  for(self->locals.consumed = 0;
+      self->locals.consumed < NUM_ITEMS;
+      ++self->locals.consumed) {
     
-    PT_SEM_WAIT(pt, &empty);
+    PT_SEM_WAIT(&self->pt, &empty);
     
     consume_item(get_from_buffer());    
     
-    PT_SEM_SIGNAL(pt, &full);
+    PT_SEM_SIGNAL(&self->pt, &full);
   }
  
-  PT_END(pt);
+  PT_END(&self->pt);
 }
  
 static 
 PT_THREAD(driver_thread(struct pt *pt))
 {
-  static struct pt pt_producer, pt_consumer;
+  static producer_pt pt_producer;
+  static consumer_pt pt_consumer;
  
   PT_BEGIN(pt);
   
   PT_SEM_INIT(&empty, 0);
   PT_SEM_INIT(&full, BUFSIZE);
  
-  PT_INIT(&pt_producer);
-  PT_INIT(&pt_consumer);
+  PT_INIT(&pt_producer.pt);
+  PT_INIT(&pt_consumer.pt);
  
   PT_WAIT_THREAD(pt, producer(&pt_producer) &
 		     consumer(&pt_consumer));
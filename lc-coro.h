@@ -0,0 +1,287 @@
+/**
+ * \addtogroup lc
+ * @{
+ */
+
+/**
+ * \file
+ * Implementation of local continuations based on C++20 coroutines
+ *
+ * This implementation turns the code between PT_BEGIN() and PT_END()
+ * into the body of a C++20 coroutine lambda. The first call of the
+ * protothread function creates the coroutine, and every call resumes
+ * it; the blocking macros of pt.h suspend it with co_yield and the
+ * exiting ones finish it with co_return, so a protothread returns the
+ * same PT_WAITING, PT_YIELDED, PT_EXITED and PT_ENDED codes in the
+ * same places as with lc-switch.h. Select it by compiling the program
+ * as C++20 with LC_INCLUDE defined to "lc-coro.h".
+ *
+ * Since the body is a coroutine, its local variables live in the
+ * coroutine frame and keep their values across blocking statements,
+ * so they need not be static, and LC_SET() works inside switch()
+ * statements. The frames and the lambdas' captures come from
+ * per-thread free lists with one list for every 16 bytes of size up
+ * to LC_CORO_POOL_MAX bytes, so starting a protothread after the
+ * first few does not call the global allocator. Define LC_CORO_ALLOC
+ * and LC_CORO_FREE to use another allocator.
+ *
+ * The lambda captures the variables of the protothread function by
+ * reference, and every call binds it to the variables of that call
+ * before resuming the coroutine: the body sees the function's
+ * arguments and the variables declared before PT_BEGIN() as the
+ * current call passed or set them, as with the other backends, and
+ * the changes it makes to them are seen by the code outside it. The
+ * body must not use return, and PT_TRACE records the line of PT_END()
+ * instead of that of the blocking statement.
+ *
+ * Each struct pt owns its coroutine and frees it when the protothread
+ * exits or ends, when the struct pt is destroyed and when PT_INIT()
+ * starts it over, so struct pt cannot be copied and PT_INIT() must
+ * only be used on a struct pt that has been constructed or
+ * initialized before. PT_INIT_RAW() initializes a struct pt in memory
+ * from malloc() or pt-pool.h without reading it, as in pt-group.h and
+ * pt_sched_spawn_pool().
+ *
+ * pt-sem.h, pt-timer.h, pt-sched.h, pt-group.h and the other headers
+ * that build on pt.h's macros and compile as C++ work with this
+ * implementation. The LC_RESUME(), LC_SET() and LC_END() macros do
+ * not exist.
+ */
+
+#pragma once
+
+#if !defined(__cplusplus) || __cplusplus < 202002L
+#error "lc-coro.h requires C++20"
+#endif
+
+#include <coroutine>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#define LC_CORO 1
+
+/**
+ * The size of the largest block kept in the free lists, in bytes.
+ * Larger frames are allocated with operator new.
+ */
+#ifndef LC_CORO_POOL_MAX
+#define LC_CORO_POOL_MAX 1024
+#endif
+
+#ifndef LC_CORO_ALLOC
+#define LC_CORO_ALLOC(size) lc_coro_pool_alloc(size)
+#define LC_CORO_FREE(p, size) lc_coro_pool_free((p), (size))
+#endif
+
+/*
+ * Per-thread free lists of blocks, one list for every 16 bytes of
+ * size. A block freed on another thread than the one that allocated
+ * it joins the list of the freeing thread, and a thread's blocks are
+ * released when it exits.
+ */
+struct lc_coro_pool {
+  void *free[LC_CORO_POOL_MAX / 16];
+
+  ~lc_coro_pool()
+  {
+    for(void *&head : free) {
+      while(head != nullptr) {
+        void *next = *static_cast<void **>(head);
+        ::operator delete(head);
+        head = next;
+      }
+    }
+  }
+};
+
+static inline lc_coro_pool &
+lc_coro_pool_local()
+{
+  static thread_local lc_coro_pool pool = {};
+  return pool;
+}
+
+static inline void *
+lc_coro_pool_alloc(std::size_t size)
+{
+  if(size == 0 || size > LC_CORO_POOL_MAX) {
+    return ::operator new(size != 0 ? size : 1);
+  }
+
+  void *&head = lc_coro_pool_local().free[(size - 1) / 16];
+  if(head == nullptr) {
+    return ::operator new((size + 15) & ~std::size_t{15});
+  }
+  void *block = head;
+  head = *static_cast<void **>(block);
+  return block;
+}
+
+static inline void
+lc_coro_pool_free(void *block, std::size_t size) noexcept
+{
+  if(size == 0 || size > LC_CORO_POOL_MAX) {
+    ::operator delete(block);
+    return;
+  }
+
+  void *&head = lc_coro_pool_local().free[(size - 1) / 16];
+  *static_cast<void **>(block) = head;
+  head = block;
+}
+
+/**
+ * The coroutine type of a protothread body.
+ */
+struct lc_coro {
+  struct promise_type {
+    char value = 0;
+    void *closure = nullptr;
+    void (*drop)(void *) = nullptr;
+
+    lc_coro get_return_object() noexcept
+    {
+      return lc_coro{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    std::suspend_always yield_value(char v) noexcept
+    {
+      value = v;
+      return {};
+    }
+    void return_value(char v) noexcept { value = v; }
+    void unhandled_exception() { throw; }
+
+    static void *operator new(std::size_t size) { return LC_CORO_ALLOC(size); }
+    static void operator delete(void *p, std::size_t size) noexcept
+    {
+      LC_CORO_FREE(p, size);
+    }
+  };
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+/**
+ * A local continuation: the coroutine of a protothread, if one has
+ * been started.
+ *
+ * \hideinitializer
+ */
+struct lc_t {
+  std::coroutine_handle<lc_coro::promise_type> frame;
+
+  lc_t() noexcept = default;
+  lc_t(const lc_t &) = delete;
+  lc_t &operator=(const lc_t &) = delete;
+  ~lc_t();
+};
+
+/**
+ * Destroy the coroutine of a local continuation and the lambda it
+ * runs.
+ */
+static inline void
+lc_coro_reset(lc_t &lc) noexcept
+{
+  if(lc.frame) {
+    void *closure = lc.frame.promise().closure;
+    void (*drop)(void *) = lc.frame.promise().drop;
+
+    lc.frame.destroy();
+    lc.frame = nullptr;
+    drop(closure);
+  }
+}
+
+inline lc_t::~lc_t() { lc_coro_reset(*this); }
+
+/*
+ * Check if a local continuation has a coroutine to resume. A coroutine
+ * that finished by throwing an exception is not resumed again.
+ */
+static inline bool
+lc_coro_running(const lc_t &lc) noexcept
+{
+  return lc.frame && !lc.frame.done();
+}
+
+/*
+ * Start the body of a protothread: move the lambda to a block of the
+ * pool, where it stays while its coroutine runs, and create the
+ * coroutine, which is suspended until lc_coro_resume().
+ */
+template<class F>
+static inline void
+lc_coro_start(lc_t &lc, F &&f)
+{
+  using closure_t = std::decay_t<F>;
+  closure_t *closure;
+
+  lc_coro_reset(lc);
+  void *block = LC_CORO_ALLOC(sizeof(closure_t));
+  try {
+    closure = ::new(block) closure_t(std::forward<F>(f));
+  } catch(...) {
+    LC_CORO_FREE(block, sizeof(closure_t));
+    throw;
+  }
+  try {
+    lc.frame = (*closure)().handle;
+  } catch(...) {
+    closure->~closure_t();
+    LC_CORO_FREE(block, sizeof(closure_t));
+    throw;
+  }
+  lc.frame.promise().closure = closure;
+  lc.frame.promise().drop = [](void *p) {
+    static_cast<closure_t *>(p)->~closure_t();
+    LC_CORO_FREE(p, sizeof(closure_t));
+  };
+}
+
+/*
+ * Run the body of a protothread until it suspends or finishes, and
+ * return the status code it produced. A finished coroutine is
+ * destroyed, so that the next call starts the body again.
+ */
+static inline char
+lc_coro_resume(lc_t &lc)
+{
+  lc.frame.resume();
+  char value = lc.frame.promise().value;
+  if(lc.frame.done()) {
+    lc_coro_reset(lc);
+  }
+  return value;
+}
+
+/*
+ * Start the body of a protothread, or bind the lambda of its running
+ * coroutine to the variables of this call, and resume it. The lambda
+ * captures only references, so replacing it in place is a copy of
+ * pointers, and the coroutine, which refers to the lambda's block,
+ * sees the new references.
+ */
+template<class F>
+static inline char
+lc_coro_enter(lc_t &lc, const F &f)
+{
+  static_assert(std::is_trivially_copyable_v<F>,
+                "the body of a protothread must capture by reference");
+
+  if(!lc_coro_running(lc)) {
+    lc_coro_start(lc, f);
+  } else {
+    ::new(lc.frame.promise().closure) F(f);
+  }
+  return lc_coro_resume(lc);
+}
+
+#define LC_INIT(s) lc_coro_reset(s)
+#define LC_INIT_RAW(s) ((void)::new(&(s)) lc_t())
+
+/** @} */
@@ -0,0 +1,63 @@
+/**
+ * \addtogroup lc
+ * @{
+ */
+
+/**
+ * \file
+ * Implementation of local continuations based on switch() and the
+ * __COUNTER__ macro
+ *
+ * This implementation of local continuations works like the one in
+ * lc-switch.h, but numbers the resume points of a function densely
+ * instead of using their line numbers. LC_RESUME() records the value
+ * of __COUNTER__, and every LC_SET() stores the difference to it, so
+ * the resume points of each function are numbered 1, 2, 3, ... in
+ * the order in which they appear.
+ *
+ * The dense case labels let the compiler implement LC_RESUME() with
+ * a jump table, so resuming costs a single indirect jump no matter
+ * how many resume points the function has, and the local
+ * continuation fits in a uint8_t for functions with up to 255 resume
+ * points. Define LC_COUNTER_TYPE to a wider unsigned type, for
+ * example uint16_t, for functions with more resume points. A function
+ * that has more resume points than fit in lc_t fails to compile
+ * instead of silently truncating.
+ *
+ * __COUNTER__ is supported by GCC, Clang and Microsoft Visual C++.
+ * Nothing else in a protothread function may expand __COUNTER__
+ * between PT_BEGIN() and PT_END(), since that would leave gaps in the
+ * numbering.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+/* WARNING! lc implementation using switch() does not work if an
+   LC_SET() is done within another switch() statement! */
+
+#ifndef LC_COUNTER_TYPE
+#define LC_COUNTER_TYPE uint8_t
+#endif
+
+/** \hideinitializer */
+typedef LC_COUNTER_TYPE lc_t;
+
+#define LC_INIT(s) s = 0;
+
+#define LC_RESUME(s)					\
+  enum { LC_COUNTER_BASE = __COUNTER__ };		\
+  switch(s) { case 0:
+
+#define LC_COUNTER_SET(s, n)						\
+  s = (lc_t)((n) - LC_COUNTER_BASE +					\
+             0 * sizeof(char[((n) - LC_COUNTER_BASE) <= (lc_t)~(lc_t)0	\
+                             ? 1 : -1]));				\
+  case (n) - LC_COUNTER_BASE:
+
+#define LC_SET(s) LC_COUNTER_SET(s, __COUNTER__)
+
+#define LC_END(s) }
+
+/** @} */
@@ -64,6 +64,9 @@
 /** \hideinitializer */
 typedef uint16_t lc_t;
 
+/* Identifies this implementation to protothreads.hpp. */
+#define LC_SWITCH 1
+
 #define LC_INIT(s) s = 0;
 
 #define LC_RESUME(s) switch(s) { case 0:
@@ -70,6 +70,17 @@
  */
 #define LC_INIT(lc)
 
+/**
+ * Initialize a local continuation in memory that holds none.
+ *
+ * Like LC_INIT(), but for memory from malloc() or a pool, which does
+ * not hold a local continuation whose state could be released. It is
+ * the same as LC_INIT() except with lc-coro.h.
+ *
+ * \hideinitializer
+ */
+#define LC_INIT_RAW(lc)
+
 /**
  * Set a local continuation.
  *
@@ -124,5 +135,9 @@
 #include "lc-switch.h"
 #endif /* LC_INCLUDE */
 
+#ifndef LC_INIT_RAW
+#define LC_INIT_RAW(lc) LC_INIT(lc)
+#endif
+
 /** @} */
 /** @} */
@@ -0,0 +1,324 @@
+/**
+ * \addtogroup pt
+ * @{
+ */
+
+/**
+ * \defgroup ptcxx C++ templates
+ * @{
+ *
+ * protothreads.hpp wraps protothreads in C++17 templates, so that C++
+ * code calls them directly instead of through function pointers or
+ * virtual functions, and the compiler can inline a protothread into
+ * the loop that runs it.
+ *
+ * A protothread is a class that derives from
+ * protothreads::thread<Derived, Locals> and implements the protothread
+ * in a public member function body() that returns char. The base class
+ * holds the struct pt, which body() reaches through pt(), and an
+ * object of type Locals for the variables that must keep their values
+ * across blocking statements, which it reaches through locals(). A
+ * protothreads::scheduler<Derived> runs protothreads of that one type
+ * with the same semantics as pt-sched.h: a protothread that waits is
+ * parked until it is woken with wake().
+ *
+ \code
+#include "protothreads.hpp"
+
+struct counter : protothreads::thread<counter, int> {
+  char body()
+  {
+    PT_BEGIN(pt());
+    for(locals() = 0; locals() < 10; ++locals()) {
+      PT_YIELD(pt());
+    }
+    PT_END(pt());
+  }
+};
+
+int
+main()
+{
+  protothreads::scheduler<counter> s;
+  counter c[100];
+
+  for(counter &t : c) {
+    s.spawn(t);
+  }
+  while(!s.idle()) {
+    s.run();
+  }
+}
+ \endcode
+ *
+ * The templates check at compile time that Derived derives from
+ * thread<Derived, Locals> and that body() returns char. With
+ * lc-switch.h and lc-counter.h they also check at every resume point
+ * that the value stored in lc_t fits: the line number with
+ * lc-switch.h, which would otherwise be truncated silently above line
+ * 65535, and the number of the resume point with lc-counter.h.
+ *
+ * The templates also work with lc-coro.h when the program is compiled
+ * as C++20. body() then runs as a coroutine, and restart() and
+ * spawn() free the coroutine of a protothread that is started over
+ * before it ends.
+ */
+
+/**
+ * \file
+ * C++ templates for protothreads
+ */
+
+#pragma once
+
+#include "pt.h"
+
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+#if __cplusplus < 201703L
+#error "protothreads.hpp requires C++17"
+#endif
+
+/*
+ * Check at compile time that every resume point fits in lc_t. These
+ * replace the definitions of lc-switch.h and lc-counter.h, which the
+ * macros of pt.h expand when a protothread is compiled.
+ */
+#if defined(LC_SWITCH)
+#undef LC_SET
+#define LC_SET(s)							\
+  static_assert(__LINE__ <= std::numeric_limits<lc_t>::max(),		\
+                "the line of a resume point does not fit in lc_t");	\
+  s = __LINE__; case __LINE__:
+#elif defined(LC_COUNTER_SET)
+#undef LC_COUNTER_SET
+#define LC_COUNTER_SET(s, n)						\
+  static_assert((n) - LC_COUNTER_BASE <= std::numeric_limits<lc_t>::max(), \
+                "more resume points than fit in lc_t, "			\
+                "define LC_COUNTER_TYPE to a wider type");		\
+  s = (lc_t)((n) - LC_COUNTER_BASE); case (n) - LC_COUNTER_BASE:
+#endif
+
+namespace protothreads {
+
+template<class Thread> class scheduler;
+
+/*
+ * The storage of the locals of a protothread, which takes no space
+ * when there are none.
+ */
+template<class Locals>
+struct locals_base {
+  Locals locals_;
+};
+
+template<>
+struct locals_base<void> {
+};
+
+/**
+ * Base class of a protothread.
+ *
+ * \param Derived The class that implements the protothread in body().
+ * \param Locals The type of the protothread's variables, or void.
+ */
+template<class Derived, class Locals = void>
+class thread : private locals_base<Locals> {
+public:
+  using locals_type = Locals;
+
+  thread() noexcept { PT_INIT(&pt_); }
+
+  /**
+   * Run the protothread until it blocks, yields, exits or ends.
+   *
+   * \return The status code returned by body().
+   */
+  char
+  run()
+  {
+    static_assert(std::is_base_of_v<thread, Derived>,
+                  "Derived must derive from thread<Derived, Locals>");
+    static_assert(std::is_same_v<decltype(std::declval<Derived &>().body()),
+                                 char>,
+                  "Derived::body() must return char");
+    return static_cast<Derived *>(this)->body();
+  }
+
+  /**
+   * Run the protothread once, like PT_SCHEDULE().
+   *
+   * \return Non-zero if the protothread is still running.
+   */
+  bool schedule() { return PT_SCHEDULE(run()); }
+
+  /**
+   * Start the protothread over, like PT_INIT().
+   *
+   * With lc-coro.h, this frees the coroutine of a protothread that
+   * has not ended.
+   */
+  void restart() noexcept { PT_INIT(&pt_); }
+
+  /**
+   * The protothread control structure, for the macros of pt.h.
+   */
+  struct pt *pt() noexcept { return &pt_; }
+
+  /**
+   * The variables of the protothread.
+   */
+  template<class L = Locals>
+  std::enable_if_t<!std::is_void_v<L>, L &>
+  locals() noexcept { return this->locals_; }
+
+private:
+  friend class scheduler<Derived>;
+
+  enum : unsigned char { idle, ready, running, parked, woken };
+
+  struct pt pt_;
+  Derived *next_ = nullptr;
+  unsigned char state_ = idle;
+};
+
+/**
+ * A run queue of protothreads of one type.
+ *
+ * Every protothread is called directly, so the compiler can inline it
+ * into run_one(). Runnable protothreads run in FIFO order.
+ *
+ * \param Thread The class of the protothreads, derived from
+ * thread<Thread, Locals>.
+ */
+template<class Thread>
+class scheduler {
+public:
+  /**
+   * Start a protothread and make it runnable.
+   *
+   * The protothread must not be in a scheduler.
+   */
+  void
+  spawn(Thread &t) noexcept
+  {
+    t.restart();
+    enqueue(t);
+  }
+
+  /**
+   * Make a protothread runnable.
+   *
+   * Waking a protothread that is running makes it run again when it
+   * waits; waking one that is runnable or not in the scheduler has no
+   * effect.
+   */
+  void
+  wake(Thread &t) noexcept
+  {
+    if(t.state_ == Thread::parked) {
+      enqueue(t);
+    } else if(t.state_ == Thread::running) {
+      t.state_ = Thread::woken;
+    }
+  }
+
+  /**
+   * Run the first runnable protothread.
+   *
+   * \return The status code of the protothread, or PT_ENDED if none
+   * was runnable.
+   */
+  char
+  run_one()
+  {
+    Thread *t = head_;
+
+    if(t == nullptr) {
+      return PT_ENDED;
+    }
+    head_ = t->next_;
+    if(head_ == nullptr) {
+      tail_ = nullptr;
+    }
+    --nready_;
+
+    t->state_ = Thread::running;
+    char ret = t->run();
+
+    if(ret == PT_YIELDED ||
+       (ret == PT_WAITING && t->state_ == Thread::woken)) {
+      enqueue(*t);
+    } else if(ret == PT_WAITING) {
+      t->state_ = Thread::parked;
+    } else {
+      t->state_ = Thread::idle;
+    }
+    return ret;
+  }
+
+  /**
+   * Run every protothread that is runnable once.
+   *
+   * \return The number of protothreads that were run.
+   */
+  std::size_t
+  run()
+  {
+    std::size_t n = nready_;
+
+    for(std::size_t i = 0; i < n; ++i) {
+      run_one();
+    }
+    return n;
+  }
+
+  /**
+   * Check if no protothread is runnable.
+   */
+  bool idle() const noexcept { return head_ == nullptr; }
+
+private:
+  static_assert(std::is_base_of_v<thread<Thread, typename Thread::locals_type>,
+                                  Thread>,
+                "Thread must derive from thread<Thread, Locals>");
+
+  void
+  enqueue(Thread &t) noexcept
+  {
+    t.state_ = Thread::ready;
+    t.next_ = nullptr;
+    if(tail_ != nullptr) {
+      tail_->next_ = &t;
+    } else {
+      head_ = &t;
+    }
+    tail_ = &t;
+    ++nready_;
+  }
+
+  Thread *head_ = nullptr;
+  Thread *tail_ = nullptr;
+  std::size_t nready_ = 0;
+};
+
+/**
+ * Run each of a fixed set of protothreads once.
+ *
+ * The protothreads may be of different types; each is called directly.
+ *
+ * \return True if any of the protothreads is still running.
+ */
+template<class... Threads>
+inline bool
+schedule(Threads &...t)
+{
+  return (false | ... | t.schedule());
+}
+
+} // namespace protothreads
+
+/** @} */
+/** @} */
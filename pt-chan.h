@@ -0,0 +1,475 @@
+/**
+ * \addtogroup pt
+ * @{
+ */
+
+/**
+ * \defgroup ptchan Channels
+ * @{
+ *
+ * A channel is a bounded single-producer, single-consumer FIFO of
+ * items of any type. It replaces the hand-written ring buffer and the
+ * pair of semaphores of the classic bounded buffer problem:
+ *
+ \code
+#include "pt-chan.h"
+
+static PT_CHAN(int, 8) chan;
+
+static
+PT_THREAD(producer(struct pt *pt))
+{
+  static int item;
+
+  PT_BEGIN(pt);
+  for(item = 0; item < 32; ++item) {
+    PT_CHAN_SEND(pt, &chan, item);
+  }
+  PT_END(pt);
+}
+
+static
+PT_THREAD(consumer(struct pt *pt))
+{
+  static int item;
+
+  PT_BEGIN(pt);
+  while(1) {
+    PT_CHAN_RECV(pt, &chan, &item);
+    consume_item(item);
+  }
+  PT_END(pt);
+}
+ \endcode
+ *
+ * The capacity of a channel must be a power of two. The indices of
+ * the producer and the consumer are C11 atomics on separate cache
+ * lines, and each side keeps a private copy of the other side's index
+ * that it only refreshes when the channel looks full or empty. The
+ * producer and the consumer protothread may therefore run on
+ * different operating system threads without any locks.
+ *
+ * The batch variants PT_CHAN_SEND_BATCH() and PT_CHAN_RECV_BATCH()
+ * move as many items as possible each time the protothread runs,
+ * which amortizes the atomic operations and the protothread switch
+ * over many items.
+ *
+ * A channel initialized with PT_CHAN_INIT() only works with
+ * protothreads that are polled, since nothing tells a waiting
+ * protothread that the channel has changed. A task of pt-sched.h that
+ * blocks on it returns PT_WAITING, is parked and never runs again.
+ * For such tasks, initialize the channel with PT_CHAN_INIT_WAKE()
+ * and a function that wakes a task: a side that blocks registers its
+ * struct pt, and the other side passes it to the function the next
+ * time it sends an item or frees a slot. Use pt_task_wake() when both
+ * tasks run on the same thread, and pt_remote_wake() when they do not:
+ *
+ \code
+static void
+wake_task(struct pt *pt)
+{
+  pt_task_wake((struct pt_task *)pt);
+}
+
+PT_CHAN_INIT_WAKE(&chan, wake_task);
+ \endcode
+ *
+ * The wake-up costs a memory fence on every send and receive, so
+ * channels without a wake function do without it.
+ *
+ * This module requires C11.
+ */
+
+/**
+ * \file
+ * Single-producer, single-consumer channels
+ */
+
+#pragma once
+
+#include "pt.h"
+
+#if !defined(__STDC_VERSION__) || __STDC_VERSION__ < 201112L || \
+    defined(__STDC_NO_ATOMICS__)
+#error "pt-chan.h requires C11 atomics"
+#endif
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * The size of a cache line, which separates the producer's and the
+ * consumer's part of a channel.
+ */
+#ifndef PT_CHAN_CACHE_LINE
+#define PT_CHAN_CACHE_LINE 64
+#endif
+
+/**
+ * The function that wakes a protothread that waits for a channel.
+ *
+ * \param pt A pointer to the protothread control structure that was
+ * passed to the blocking macro.
+ */
+typedef void (*pt_chan_wake_fn)(struct pt *pt);
+
+/**
+ * Channel indices.
+ *
+ * The contents of this structure are internal to the channel
+ * implementation.
+ */
+struct pt_chan_ring {
+  /* Written by the consumer */
+  alignas(PT_CHAN_CACHE_LINE) atomic_uint_least32_t head;
+  uint32_t tail_cache;
+  /* Written by the producer */
+  alignas(PT_CHAN_CACHE_LINE) atomic_uint_least32_t tail;
+  uint32_t head_cache;
+  /* Written only when a side blocks */
+  alignas(PT_CHAN_CACHE_LINE) pt_chan_wake_fn wake;
+  struct pt *_Atomic recv_waiter;
+  struct pt *_Atomic send_waiter;
+};
+
+/**
+ * Declare a channel type.
+ *
+ * \param type The type of the items.
+ * \param size The capacity of the channel, which must be a power of
+ * two.
+ *
+ * \hideinitializer
+ */
+#define PT_CHAN(type, size)						\
+  struct {								\
+    struct pt_chan_ring ring;						\
+    alignas(PT_CHAN_CACHE_LINE) type buf[size];			\
+    _Static_assert(((size) & ((size) - 1)) == 0,			\
+                   "channel size must be a power of two");		\
+  }
+
+/**
+ * The capacity of a channel.
+ *
+ * \param c A pointer to the channel.
+ *
+ * \hideinitializer
+ */
+#define PT_CHAN_SIZE(c) ((uint32_t)(sizeof((c)->buf) / sizeof((c)->buf[0])))
+
+/**
+ * Initialize a channel.
+ *
+ * A channel must be initialized before the producer and the consumer
+ * use it.
+ *
+ * \param c A pointer to the channel.
+ *
+ * \hideinitializer
+ */
+#define PT_CHAN_INIT(c) pt_chan_ring_init(&(c)->ring, NULL)
+
+/**
+ * Initialize a channel whose blocked sides are woken.
+ *
+ * \param c A pointer to the channel.
+ * \param wake (pt_chan_wake_fn) The function that wakes a protothread
+ * that waits for the channel.
+ *
+ * \hideinitializer
+ */
+#define PT_CHAN_INIT_WAKE(c, wake) pt_chan_ring_init(&(c)->ring, (wake))
+
+static inline void
+pt_chan_ring_init(struct pt_chan_ring *r, pt_chan_wake_fn wake)
+{
+  atomic_init(&r->head, 0);
+  atomic_init(&r->tail, 0);
+  r->tail_cache = 0;
+  r->head_cache = 0;
+  r->wake = wake;
+  atomic_init(&r->recv_waiter, NULL);
+  atomic_init(&r->send_waiter, NULL);
+}
+
+/*
+ * Wake the protothread that waits on the other side, if any. The
+ * fence orders the index that was just published before the load of
+ * the waiter, and pairs with the one in pt_chan_park().
+ */
+static inline void
+pt_chan_notify(struct pt_chan_ring *r, struct pt *_Atomic *waiter)
+{
+  struct pt *pt;
+
+  if(r->wake == NULL) {
+    return;
+  }
+  atomic_thread_fence(memory_order_seq_cst);
+  if(atomic_load_explicit(waiter, memory_order_relaxed) != NULL &&
+     (pt = atomic_exchange_explicit(waiter, NULL,
+                                    memory_order_acquire)) != NULL) {
+    r->wake(pt);
+  }
+}
+
+/*
+ * Register a protothread that is about to block, so that the other
+ * side wakes it. Returns zero if the channel has no wake function.
+ */
+static inline int
+pt_chan_park(struct pt_chan_ring *r, struct pt *_Atomic *waiter,
+             struct pt *pt)
+{
+  if(r->wake == NULL) {
+    return 0;
+  }
+  atomic_store_explicit(waiter, pt, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  return 1;
+}
+
+static inline uint32_t
+pt_chan_tail(struct pt_chan_ring *r)
+{
+  return atomic_load_explicit(&r->tail, memory_order_relaxed);
+}
+
+static inline uint32_t
+pt_chan_head(struct pt_chan_ring *r)
+{
+  return atomic_load_explicit(&r->head, memory_order_relaxed);
+}
+
+/*
+ * Free slots, seen by the producer. The consumer's index is only read
+ * if fewer than want slots are known to be free.
+ */
+static inline uint32_t
+pt_chan_space(struct pt_chan_ring *r, uint32_t size, uint32_t want)
+{
+  uint32_t tail = pt_chan_tail(r);
+
+  if(size - (tail - r->head_cache) < want) {
+    r->head_cache = atomic_load_explicit(&r->head, memory_order_acquire);
+  }
+  return size - (tail - r->head_cache);
+}
+
+/*
+ * Filled slots, seen by the consumer. The producer's index is only
+ * read if fewer than want items are known to be available.
+ */
+static inline uint32_t
+pt_chan_avail(struct pt_chan_ring *r, uint32_t want)
+{
+  uint32_t head = pt_chan_head(r);
+
+  if(r->tail_cache - head < want) {
+    r->tail_cache = atomic_load_explicit(&r->tail, memory_order_acquire);
+  }
+  return r->tail_cache - head;
+}
+
+/* Publish n items; only the producer writes the tail. */
+static inline void
+pt_chan_push(struct pt_chan_ring *r, uint32_t n)
+{
+  atomic_store_explicit(&r->tail, pt_chan_tail(r) + n, memory_order_release);
+  pt_chan_notify(r, &r->recv_waiter);
+}
+
+/* Release n slots; only the consumer writes the head. */
+static inline void
+pt_chan_pop(struct pt_chan_ring *r, uint32_t n)
+{
+  atomic_store_explicit(&r->head, pt_chan_head(r) + n, memory_order_release);
+  pt_chan_notify(r, &r->send_waiter);
+}
+
+/*
+ * Check for room as the producer; if there is none, register pt to
+ * be woken and check again, since the consumer may have freed a slot
+ * before it could see the registration.
+ */
+static inline int
+pt_chan_send_ready(struct pt_chan_ring *r, uint32_t size, struct pt *pt)
+{
+  if(pt_chan_space(r, size, 1) != 0) {
+    return 1;
+  }
+  if(!pt_chan_park(r, &r->send_waiter, pt) ||
+     pt_chan_space(r, size, 1) == 0) {
+    return 0;
+  }
+  atomic_store_explicit(&r->send_waiter, NULL, memory_order_relaxed);
+  return 1;
+}
+
+/* Check for items as the consumer, in the same way. */
+static inline int
+pt_chan_recv_ready(struct pt_chan_ring *r, struct pt *pt)
+{
+  if(pt_chan_avail(r, 1) != 0) {
+    return 1;
+  }
+  if(!pt_chan_park(r, &r->recv_waiter, pt) || pt_chan_avail(r, 1) == 0) {
+    return 0;
+  }
+  atomic_store_explicit(&r->recv_waiter, NULL, memory_order_relaxed);
+  return 1;
+}
+
+static inline uint32_t
+pt_chan_copy_in(struct pt_chan_ring *r, void *buf, size_t item_size,
+                uint32_t size, const void *items, uint32_t n)
+{
+  uint32_t space = pt_chan_space(r, size, n);
+  uint32_t i = pt_chan_tail(r) & (size - 1);
+  uint32_t first;
+
+  if(n > space) {
+    n = space;
+  }
+  first = n < size - i ? n : size - i;
+  memcpy((char *)buf + i * item_size, items, first * item_size);
+  memcpy(buf, (const char *)items + first * item_size,
+         (n - first) * item_size);
+  pt_chan_push(r, n);
+  return n;
+}
+
+static inline uint32_t
+pt_chan_copy_out(struct pt_chan_ring *r, const void *buf, size_t item_size,
+                 uint32_t size, void *items, uint32_t n)
+{
+  uint32_t avail = pt_chan_avail(r, n);
+  uint32_t i = pt_chan_head(r) & (size - 1);
+  uint32_t first;
+
+  if(n > avail) {
+    n = avail;
+  }
+  first = n < size - i ? n : size - i;
+  memcpy(items, (const char *)buf + i * item_size, first * item_size);
+  memcpy((char *)items + first * item_size, buf, (n - first) * item_size);
+  pt_chan_pop(r, n);
+  return n;
+}
+
+/**
+ * Send an item without blocking.
+ *
+ * This must only be called by the producer.
+ *
+ * \param c A pointer to the channel.
+ * \param item The item. It is only evaluated if there is room.
+ *
+ * \return Non-zero if the item was sent, zero if the channel is full.
+ *
+ * \hideinitializer
+ */
+#define pt_chan_try_send(c, item)					\
+  (pt_chan_space(&(c)->ring, PT_CHAN_SIZE(c), 1) != 0 &&			\
+   ((c)->buf[pt_chan_tail(&(c)->ring) & (PT_CHAN_SIZE(c) - 1)] = (item), \
+    pt_chan_push(&(c)->ring, 1), 1))
+
+/**
+ * Receive an item without blocking.
+ *
+ * This must only be called by the consumer.
+ *
+ * \param c A pointer to the channel.
+ * \param item A pointer to where the item is stored.
+ *
+ * \return Non-zero if an item was received, zero if the channel is
+ * empty.
+ *
+ * \hideinitializer
+ */
+#define pt_chan_try_recv(c, item)					\
+  (pt_chan_avail(&(c)->ring, 1) != 0 &&					\
+   (*(item) = (c)->buf[pt_chan_head(&(c)->ring) & (PT_CHAN_SIZE(c) - 1)], \
+    pt_chan_pop(&(c)->ring, 1), 1))
+
+/**
+ * Send an item, blocking while the channel is full.
+ *
+ * \param pt A pointer to the protothread control structure.
+ * \param c A pointer to the channel.
+ * \param item The item.
+ *
+ * \hideinitializer
+ */
+#define PT_CHAN_SEND(pt, c, item)					\
+  do {									\
+    PT_WAIT_UNTIL(pt, pt_chan_send_ready(&(c)->ring, PT_CHAN_SIZE(c),	\
+                                         (pt)));			\
+    (void)pt_chan_try_send(c, item);					\
+  } while(0)
+
+/**
+ * Receive an item, blocking while the channel is empty.
+ *
+ * \param pt A pointer to the protothread control structure.
+ * \param c A pointer to the channel.
+ * \param item A pointer to where the item is stored.
+ *
+ * \hideinitializer
+ */
+#define PT_CHAN_RECV(pt, c, item)					\
+  do {									\
+    PT_WAIT_UNTIL(pt, pt_chan_recv_ready(&(c)->ring, (pt)));		\
+    (void)pt_chan_try_recv(c, item);					\
+  } while(0)
+
+/**
+ * Send up to n items, blocking while the channel is full.
+ *
+ * Blocks until there is room for at least one item, then sends as
+ * many of the items as fit in the channel.
+ *
+ * \param pt A pointer to the protothread control structure.
+ * \param c A pointer to the channel.
+ * \param items A pointer to the first item.
+ * \param n (uint32_t) The number of items, which must not be zero.
+ * \param sent (uint32_t) Set to the number of items sent.
+ *
+ * \hideinitializer
+ */
+#define PT_CHAN_SEND_BATCH(pt, c, items, n, sent)			\
+  do {									\
+    PT_WAIT_UNTIL(pt, pt_chan_send_ready(&(c)->ring, PT_CHAN_SIZE(c),	\
+                                         (pt)));			\
+    (sent) = pt_chan_copy_in(&(c)->ring, (c)->buf, sizeof((c)->buf[0]), \
+                             PT_CHAN_SIZE(c), (items), (n));		\
+  } while(0)
+
+/**
+ * Receive up to n items, blocking while the channel is empty.
+ *
+ * Blocks until at least one item is available, then receives as many
+ * items as are available, up to n.
+ *
+ * \param pt A pointer to the protothread control structure.
+ * \param c A pointer to the channel.
+ * \param items A pointer to where the items are stored.
+ * \param n (uint32_t) The maximum number of items, which must not be
+ * zero.
+ * \param received (uint32_t) Set to the number of items received.
+ *
+ * \hideinitializer
+ */
+#define PT_CHAN_RECV_BATCH(pt, c, items, n, received)			\
+  do {									\
+    PT_WAIT_UNTIL(pt, pt_chan_recv_ready(&(c)->ring, (pt)));		\
+    (received) = pt_chan_copy_out(&(c)->ring, (c)->buf,		\
+                                  sizeof((c)->buf[0]),			\
+                                  PT_CHAN_SIZE(c), (items), (n));	\
+  } while(0)
+
+/** @} */
+/** @} */
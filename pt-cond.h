@@ -0,0 +1,218 @@
+/**
+ * \addtogroup ptsched
+ * @{
+ */
+
+/**
+ * \defgroup ptcond Condition variables
+ * @{
+ *
+ * This module implements condition variables for protothreads that
+ * run under the scheduler in pt-sched.h. A condition variable is a
+ * FIFO wait queue of tasks that wait for some shared state to change.
+ * The code that changes the state wakes them:
+ *
+ * - PT_COND_WAIT() puts the task at the end of the queue and blocks
+ *   it until it is signalled.
+ *
+ * - pt_cond_signal() makes the task that has waited longest runnable.
+ *
+ * - pt_cond_broadcast() makes every waiting task runnable. When the
+ *   waiters have the same priority and no deadline, the whole queue
+ *   is appended to the run queue in one operation, so a broadcast
+ *   costs the same for one waiter as for a hundred thousand.
+ *
+ * A waiting task is never run to evaluate its condition, unlike with
+ * PT_WAIT_UNTIL(), which tests the condition of every waiting
+ * protothread each time it is polled. Since protothreads are not
+ * preempted, the state cannot change between the test of the
+ * condition and PT_COND_WAIT(), so no lock is needed as long as the
+ * condition is tested in the same run. PT_COND_WAIT_UNTIL() waits
+ * until a condition is true, testing it again after every wakeup.
+ * PT_COND_WAIT_MUTEX() unlocks a pt-mutex.h mutex while waiting, for
+ * state that a task changes across blocking statements.
+ *
+ \code
+#include "pt-cond.h"
+
+static struct pt_cond changed;
+static uint32_t version;
+
+static
+PT_THREAD(reader(struct pt_task *t))
+{
+  static uint32_t seen;
+
+  PT_BEGIN(&t->pt);
+
+  seen = version;
+  PT_COND_WAIT_UNTIL(t, &changed, version != seen);
+  reload();
+
+  PT_END(&t->pt);
+}
+
+void
+update(void)
+{
+  ++version;
+  pt_cond_broadcast(&changed);
+}
+ \endcode
+ */
+
+/**
+ * \file
+ * Condition variables
+ */
+
+#pragma once
+
+#include "pt-mutex.h"
+#include "pt-sched.h"
+
+#include <stdint.h>
+
+/**
+ * Condition variable control structure.
+ *
+ * The contents of this structure are internal to the condition
+ * variable implementation and should not be accessed directly by the
+ * user.
+ *
+ * \sa PT_COND_INIT(), PT_COND_WAIT(), pt_cond_signal(),
+ * pt_cond_broadcast()
+ */
+struct pt_cond {
+  struct pt_waitq waiters;
+};
+
+/**
+ * Initialize a condition variable.
+ *
+ * \param c (struct pt_cond *) A pointer to the condition variable.
+ *
+ * \hideinitializer
+ */
+#define PT_COND_INIT(c) pt_waitq_init(&(c)->waiters)
+
+/**
+ * The number of tasks waiting on a condition variable.
+ *
+ * \param c (struct pt_cond *) A pointer to the condition variable.
+ *
+ * \hideinitializer
+ */
+#define pt_cond_waiters(c) ((c)->waiters.count)
+
+/**
+ * Wait on a condition variable.
+ *
+ * The task blocks until pt_cond_signal() or pt_cond_broadcast() wakes
+ * it.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param c (struct pt_cond *) A pointer to the condition variable.
+ *
+ * \hideinitializer
+ */
+#define PT_COND_WAIT(task, c)			\
+  do {						\
+    pt_waitq_push(&(c)->waiters, (task));	\
+    PT_BLOCK(task);				\
+  } while(0)
+
+/**
+ * Wait on a condition variable until a condition is true.
+ *
+ * The condition is tested first, and again each time the task is
+ * woken; the task continues as soon as it is true.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param c (struct pt_cond *) A pointer to the condition variable.
+ * \param condition The condition.
+ *
+ * \hideinitializer
+ */
+#define PT_COND_WAIT_UNTIL(task, c, condition)	\
+  do {						\
+    while(!(condition)) {			\
+      PT_COND_WAIT(task, c);			\
+    }						\
+  } while(0)
+
+/*
+ * Lock the mutex again for a task that was woken from a condition
+ * variable. If the mutex is taken, the task joins its wait queue and
+ * must block again; it owns the mutex when it is woken from there.
+ * Both waits resume at the same PT_BLOCK(), which lc-switch.h needs,
+ * since all the code of a macro is on one line.
+ */
+static inline int
+pt_cond_relock(struct pt_mutex *m, struct pt_task *t)
+{
+  if(m->owner == t || pt_mutex_trylock(m, t)) {
+    return 1;
+  }
+  pt_waitq_push(&m->waiters, t);
+  return 0;
+}
+
+/**
+ * Wait on a condition variable while unlocking a mutex.
+ *
+ * The task must own the mutex. It unlocks the mutex and waits on the
+ * condition variable; when it is woken, it locks the mutex again
+ * before it continues.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param c (struct pt_cond *) A pointer to the condition variable.
+ * \param m (struct pt_mutex *) A pointer to the mutex.
+ *
+ * \hideinitializer
+ */
+#define PT_COND_WAIT_MUTEX(task, c, m)			\
+  do {								\
+    PT_MUTEX_UNLOCK(task, m);					\
+    pt_waitq_push(&(c)->waiters, (task));			\
+    do {							\
+      PT_BLOCK(task);						\
+    } while(!pt_cond_relock((m), (task)));			\
+  } while(0)
+
+/**
+ * Wake the task that has waited longest on a condition variable.
+ *
+ * This function does not block and can be called from outside a
+ * protothread.
+ *
+ * \param c A pointer to the condition variable.
+ *
+ * \return The task that was woken, or NULL if none was waiting.
+ */
+static inline struct pt_task *
+pt_cond_signal(struct pt_cond *c)
+{
+  return pt_waitq_wake_one(&c->waiters);
+}
+
+/**
+ * Wake every task waiting on a condition variable.
+ *
+ * This function does not block and can be called from outside a
+ * protothread.
+ *
+ * \param c A pointer to the condition variable.
+ *
+ * \return The number of tasks that were woken.
+ *
+ * \sa pt_waitq_wake_all()
+ */
+static inline uint32_t
+pt_cond_broadcast(struct pt_cond *c)
+{
+  return pt_waitq_wake_all(&c->waiters);
+}
+
+/** @} */
+/** @} */
@@ -0,0 +1,342 @@
+/**
+ * \addtogroup ptsched
+ * @{
+ */
+
+/**
+ * \defgroup ptevent Event flag groups
+ * @{
+ *
+ * This module implements event flag groups for protothreads that run
+ * under the scheduler in pt-sched.h. A group is a word of 32 or 64
+ * flags. Tasks wait until any or all of the flags in a mask are set:
+ *
+ * - PT_EVENT_WAIT_ANY() blocks the task until at least one flag of
+ *   the mask is set.
+ *
+ * - PT_EVENT_WAIT_ALL() blocks the task until every flag of the mask
+ *   is set.
+ *
+ * - pt_event_set() sets flags and wakes the tasks whose condition has
+ *   become true; pt_event_clear() clears flags.
+ *
+ * Waiting tasks are indexed by their mask: the tasks that wait for
+ * the same mask in the same way share a wait queue, and the group
+ * keeps the union of the masks that are waited for. Setting flags
+ * that nobody waits for costs one test, and otherwise the cost
+ * depends on the number of distinct masks, not on the number of
+ * waiting tasks: the wait queue of a mask whose condition has become
+ * true is appended to the run queue at once, as in
+ * pt_waitq_wake_all(), and the other waiting tasks are not run. This
+ * replaces long PT_WAIT_UNTIL() conditions such as
+ * PT_WAIT_UNTIL(pt, key_pressed() || timer_expired(&t)), which every
+ * waiting protothread evaluates each time it is polled.
+ *
+ * A group has PT_EVENT_BUCKETS wait queues for distinct masks. When
+ * more masks are waited for at the same time, the remaining tasks
+ * share one more queue, which is woken when any flag of any of their
+ * masks is set; they test their conditions again and wait again if
+ * they are still false. Waiting tasks always test their condition
+ * when they run, so a flag that is set and cleared again before they
+ * run does not wake them.
+ *
+ \code
+#include "pt-event.h"
+
+#define EV_KEY     0x01
+#define EV_TIMEOUT 0x02
+
+static struct pt_event events;
+
+static
+PT_THREAD(codelock(struct pt_task *t))
+{
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    PT_EVENT_WAIT_ANY(t, &events, EV_KEY | EV_TIMEOUT);
+    if(pt_event_get(&events) & EV_TIMEOUT) {
+      reset_code();
+    } else {
+      enter_key(read_key());
+    }
+    pt_event_clear(&events, EV_KEY | EV_TIMEOUT);
+  }
+
+  PT_END(&t->pt);
+}
+
+// Called when a key is pressed
+void
+key_handler(void)
+{
+  pt_event_set(&events, EV_KEY);
+}
+ \endcode
+ *
+ * Like the scheduler, a group may only be changed from the thread
+ * that runs the scheduler of the tasks that wait for it, and those
+ * tasks must all belong to that scheduler. Other threads and
+ * interrupt handlers post flags with pt_event_post(), which is
+ * lock-free, and the scheduler's thread sets them with
+ * pt_event_deliver(); pt-remote.h can wake the scheduler's thread
+ * when it sleeps.
+ */
+
+/**
+ * \file
+ * Event flag groups
+ */
+
+#pragma once
+
+#include "pt-sched.h"
+
+#include <stdint.h>
+
+/**
+ * The number of flags in a group, 32 or 64.
+ */
+#ifndef PT_EVENT_BITS
+#define PT_EVENT_BITS 32
+#endif
+
+/**
+ * The number of distinct masks that a group indexes, at most 32.
+ */
+#ifndef PT_EVENT_BUCKETS
+#define PT_EVENT_BUCKETS 16
+#endif
+
+#if PT_EVENT_BITS == 32
+typedef uint32_t pt_event_flags_t;
+#elif PT_EVENT_BITS == 64
+typedef uint64_t pt_event_flags_t;
+#else
+#error "PT_EVENT_BITS must be 32 or 64"
+#endif
+
+#if PT_EVENT_BUCKETS < 1 || PT_EVENT_BUCKETS > 32
+#error "PT_EVENT_BUCKETS must be between 1 and 32"
+#endif
+
+/* The tasks that wait for one mask in one way. */
+struct pt_event_bucket {
+  pt_event_flags_t mask;
+  uint8_t all;
+  struct pt_waitq waiters;
+};
+
+/**
+ * Event flag group control structure.
+ *
+ * The contents of this structure are internal to the implementation
+ * and should not be accessed directly by the user.
+ *
+ * \sa pt_event_init(), pt_event_set(), PT_EVENT_WAIT_ANY(),
+ * PT_EVENT_WAIT_ALL()
+ */
+struct pt_event {
+  pt_event_flags_t flags;
+  pt_event_flags_t watched;
+  pt_event_flags_t pending;
+  pt_event_flags_t overflow_mask;
+  uint32_t used;
+  struct pt_waitq overflow;
+  struct pt_event_bucket buckets[PT_EVENT_BUCKETS];
+};
+
+/**
+ * Initialize an event flag group.
+ *
+ * \param g A pointer to the group.
+ * \param flags The flags that are set initially.
+ */
+static inline void
+pt_event_init(struct pt_event *g, pt_event_flags_t flags)
+{
+  g->flags = flags;
+  g->watched = 0;
+  g->pending = 0;
+  g->overflow_mask = 0;
+  g->used = 0;
+  pt_waitq_init(&g->overflow);
+}
+
+/**
+ * The flags of a group that are set.
+ *
+ * \param g (struct pt_event *) A pointer to the group.
+ *
+ * \hideinitializer
+ */
+#define pt_event_get(g) ((g)->flags)
+
+/**
+ * Clear flags of a group.
+ *
+ * \param g A pointer to the group.
+ * \param bits The flags to clear.
+ */
+static inline void
+pt_event_clear(struct pt_event *g, pt_event_flags_t bits)
+{
+  g->flags &= ~bits;
+}
+
+/**
+ * Set flags of a group.
+ *
+ * Wakes every task that waits for any of a mask that contains one of
+ * the flags, and every task that waits for all of a mask that
+ * contains one of the flags and is now completely set. This function
+ * does not block and can be called from outside a protothread.
+ *
+ * \param g A pointer to the group.
+ * \param bits The flags to set.
+ */
+static inline void
+pt_event_set(struct pt_event *g, pt_event_flags_t bits)
+{
+  pt_event_flags_t watched = 0;
+  uint32_t used;
+
+  g->flags |= bits;
+  if((bits & g->watched) == 0) {
+    return;
+  }
+
+  for(used = g->used; used != 0; used &= used - 1) {
+    unsigned i = pt_sched_first((pt_sched_bitmap_t)used);
+    struct pt_event_bucket *b = &g->buckets[i];
+
+    if((bits & b->mask) != 0 &&
+       (!b->all || (g->flags & b->mask) == b->mask)) {
+      pt_waitq_wake_all(&b->waiters);
+      g->used &= ~((uint32_t)1 << i);
+    } else {
+      watched |= b->mask;
+    }
+  }
+  if((bits & g->overflow_mask) != 0) {
+    pt_waitq_wake_all(&g->overflow);
+    g->overflow_mask = 0;
+  }
+  g->watched = watched | g->overflow_mask;
+}
+
+/*
+ * Put the running task in the wait queue of its mask, which is
+ * created if no task waits for the mask yet, or in the shared queue
+ * if every wait queue is in use.
+ */
+static inline void
+pt_event_enqueue(struct pt_event *g, struct pt_task *t,
+                 pt_event_flags_t mask, uint8_t all)
+{
+  uint32_t used, avail;
+  struct pt_event_bucket *b;
+
+  g->watched |= mask;
+  for(used = g->used; used != 0; used &= used - 1) {
+    b = &g->buckets[pt_sched_first((pt_sched_bitmap_t)used)];
+    if(b->mask == mask && b->all == all) {
+      pt_waitq_push(&b->waiters, t);
+      return;
+    }
+  }
+
+  avail = ~g->used &
+    (uint32_t)(((uint64_t)1 << PT_EVENT_BUCKETS) - 1);
+  if(avail == 0) {
+    g->overflow_mask |= mask;
+    pt_waitq_push(&g->overflow, t);
+    return;
+  }
+  b = &g->buckets[pt_sched_first((pt_sched_bitmap_t)avail)];
+  g->used |= avail & (0 - avail);
+  b->mask = mask;
+  b->all = all;
+  pt_waitq_init(&b->waiters);
+  pt_waitq_push(&b->waiters, t);
+}
+
+/**
+ * Wait until any flag of a mask is set.
+ *
+ * The task continues at once if one is set already.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param g (struct pt_event *) A pointer to the group.
+ * \param mask (pt_event_flags_t) The flags to wait for, not 0.
+ *
+ * \hideinitializer
+ */
+#define PT_EVENT_WAIT_ANY(task, g, mask)			\
+  do {								\
+    while((pt_event_get(g) & (mask)) == 0) {			\
+      pt_event_enqueue((g), (task), (mask), 0);			\
+      PT_BLOCK(task);						\
+    }								\
+  } while(0)
+
+/**
+ * Wait until every flag of a mask is set.
+ *
+ * The task continues at once if they are set already.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param g (struct pt_event *) A pointer to the group.
+ * \param mask (pt_event_flags_t) The flags to wait for.
+ *
+ * \hideinitializer
+ */
+#define PT_EVENT_WAIT_ALL(task, g, mask)			\
+  do {								\
+    while((pt_event_get(g) & (mask)) != (mask)) {		\
+      pt_event_enqueue((g), (task), (mask), 1);			\
+      PT_BLOCK(task);						\
+    }								\
+  } while(0)
+
+#if defined(__GNUC__)
+/**
+ * Post flags to a group from another thread or an interrupt handler.
+ *
+ * The flags are set by the next pt_event_deliver() on the thread that
+ * runs the scheduler. Requires GCC or Clang.
+ *
+ * \param g A pointer to the group.
+ * \param bits The flags to set.
+ */
+static inline void
+pt_event_post(struct pt_event *g, pt_event_flags_t bits)
+{
+  __atomic_fetch_or(&g->pending, bits, __ATOMIC_RELEASE);
+}
+
+/**
+ * Set the flags that have been posted to a group.
+ *
+ * Call this on the thread that runs the scheduler, for example after
+ * pt_remote_drain().
+ *
+ * \param g A pointer to the group.
+ *
+ * \return The flags that were set.
+ */
+static inline pt_event_flags_t
+pt_event_deliver(struct pt_event *g)
+{
+  pt_event_flags_t bits = __atomic_exchange_n(&g->pending, 0,
+                                              __ATOMIC_ACQUIRE);
+
+  if(bits != 0) {
+    pt_event_set(g, bits);
+  }
+  return bits;
+}
+#endif
+
+/** @} */
+/** @} */
@@ -0,0 +1,440 @@
+/**
+ * \addtogroup pt
+ * @{
+ */
+
+/**
+ * \defgroup ptexec Multi-core executor
+ * @{
+ *
+ * The executor runs a pool of protothreads on several operating
+ * system threads, the workers. Every worker has its own run queue, a
+ * Chase-Lev work-stealing deque of tasks. A worker takes tasks from
+ * the bottom of its own deque without atomic read-modify-write
+ * operations, and when its deque is empty it steals a task from the
+ * top of the deque of another worker, chosen at random.
+ *
+ * A task is in at most one deque or run by one worker at a time, so
+ * the state of a protothread is only ever touched by one thread at a
+ * time, and the deques order its accesses when it moves between
+ * workers. Static variables of a protothread function are only safe
+ * as long as there is a single task with that function; otherwise
+ * state must be kept in the task, as with pt-sched.h:
+ *
+ \code
+#include "pt-exec.h"
+
+struct job {
+  struct pt_exec_task task;
+  int i;
+};
+
+static
+PT_THREAD(job_thread(struct pt_exec_task *t))
+{
+  struct job *j = (struct job *)t;
+
+  PT_BEGIN(&t->pt);
+  for(j->i = 0; j->i < 100; ++j->i) {
+    compute(j);
+    PT_YIELD(&t->pt);
+  }
+  PT_END(&t->pt);
+}
+
+int
+main(void)
+{
+  static struct job jobs[1000];
+  struct pt_exec exec;
+  int i;
+
+  pt_exec_init(&exec, 8, 1000);
+  for(i = 0; i < 1000; ++i) {
+    pt_exec_spawn(&exec, &jobs[i].task, job_thread);
+  }
+  pt_exec_run(&exec);
+  pt_exec_close(&exec);
+}
+ \endcode
+ *
+ * Each pass of a worker runs every task in its deque once. Tasks that
+ * return PT_WAITING or PT_YIELDED are put back at the end of the pass,
+ * and tasks that end or exit leave the executor. pt_exec_run() returns
+ * when all tasks have left.
+ *
+ * This module requires C11 atomics and POSIX threads.
+ */
+
+/**
+ * \file
+ * Multi-core work-stealing executor
+ */
+
+#pragma once
+
+#include "pt.h"
+
+#if !defined(__STDC_VERSION__) || __STDC_VERSION__ < 201112L || \
+    defined(__STDC_NO_ATOMICS__)
+#error "pt-exec.h requires C11 atomics"
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * The size of a cache line, which separates the parts of a deque that
+ * the owner and the thieves write.
+ */
+#ifndef PT_EXEC_CACHE_LINE
+#define PT_EXEC_CACHE_LINE 64
+#endif
+
+/**
+ * The number of times an idle worker tries to steal before it yields
+ * its CPU to other threads.
+ */
+#ifndef PT_EXEC_SPIN
+#define PT_EXEC_SPIN 64
+#endif
+
+struct pt_exec_task;
+
+/**
+ * The function implementing a protothread run by the executor.
+ */
+typedef char (*pt_exec_fn)(struct pt_exec_task *t);
+
+/**
+ * Executor task.
+ *
+ * A task is typically the first member of a larger structure that
+ * holds the state of the protothread.
+ */
+struct pt_exec_task {
+  struct pt pt;
+  pt_exec_fn fn;
+};
+
+/**
+ * Chase-Lev work-stealing deque.
+ *
+ * The owner pushes and takes at the bottom; other threads steal at
+ * the top. The buffer never grows: the executor sizes it for all
+ * tasks.
+ */
+struct pt_exec_deque {
+  alignas(PT_EXEC_CACHE_LINE) atomic_size_t top;
+  alignas(PT_EXEC_CACHE_LINE) atomic_size_t bottom;
+  _Atomic(struct pt_exec_task *) *buf;
+  size_t mask;
+};
+
+/**
+ * Executor worker.
+ *
+ * The contents of this structure are internal to the executor.
+ */
+struct pt_exec_worker {
+  struct pt_exec_deque deque;
+  struct pt_exec_task **pass;
+  struct pt_exec *exec;
+  pthread_t thread;
+  uint32_t id;
+  uint32_t rand;
+  /** The number of times the worker ran a task. */
+  uint64_t runs;
+  /** The number of tasks the worker stole. */
+  uint64_t steals;
+};
+
+/**
+ * Executor control structure.
+ *
+ * \sa pt_exec_init()
+ */
+struct pt_exec {
+  struct pt_exec_worker *workers;
+  uint32_t nworkers;
+  uint32_t next;
+  size_t max_tasks;
+  alignas(PT_EXEC_CACHE_LINE) atomic_size_t live;
+};
+
+/*---------------------------------------------------------------------------*/
+static inline void
+pt_exec_deque_push(struct pt_exec_deque *d, struct pt_exec_task *t)
+{
+  size_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+
+  atomic_store_explicit(&d->buf[b & d->mask], t, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+}
+
+static inline struct pt_exec_task *
+pt_exec_deque_take(struct pt_exec_deque *d)
+{
+  size_t b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+  size_t t;
+  struct pt_exec_task *task;
+
+  atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  t = atomic_load_explicit(&d->top, memory_order_relaxed);
+  if((ptrdiff_t)(b - t) < 0) {
+    /* Empty */
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    return NULL;
+  }
+  task = atomic_load_explicit(&d->buf[b & d->mask], memory_order_relaxed);
+  if(b == t) {
+    /* The last task: race the thieves for it. */
+    if(!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+                                                memory_order_seq_cst,
+                                                memory_order_relaxed)) {
+      task = NULL;
+    }
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+  }
+  return task;
+}
+
+static inline struct pt_exec_task *
+pt_exec_deque_steal(struct pt_exec_deque *d)
+{
+  size_t t = atomic_load_explicit(&d->top, memory_order_acquire);
+  size_t b;
+  struct pt_exec_task *task;
+
+  atomic_thread_fence(memory_order_seq_cst);
+  b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+  if((ptrdiff_t)(b - t) <= 0) {
+    return NULL;
+  }
+  task = atomic_load_explicit(&d->buf[t & d->mask], memory_order_relaxed);
+  if(!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1,
+                                              memory_order_seq_cst,
+                                              memory_order_relaxed)) {
+    /* Another thread took it. */
+    return NULL;
+  }
+  return task;
+}
+
+/*---------------------------------------------------------------------------*/
+/**
+ * Initialize an executor.
+ *
+ * \param e A pointer to the executor control structure.
+ * \param nworkers The number of worker threads, at least one.
+ * \param max_tasks The largest number of tasks that are spawned.
+ *
+ * \return 0 on success, or -1 with errno set to ENOMEM.
+ */
+static inline int
+pt_exec_init(struct pt_exec *e, uint32_t nworkers, size_t max_tasks)
+{
+  size_t capacity = 1;
+  uint32_t i;
+
+  while(capacity < max_tasks) {
+    capacity <<= 1;
+  }
+  e->nworkers = nworkers > 0 ? nworkers : 1;
+  e->next = 0;
+  e->max_tasks = max_tasks;
+  atomic_init(&e->live, 0);
+  e->workers = aligned_alloc(PT_EXEC_CACHE_LINE,
+                             e->nworkers * sizeof(*e->workers));
+  if(e->workers == NULL) {
+    return -1;
+  }
+  for(i = 0; i < e->nworkers; ++i) {
+    struct pt_exec_worker *w = &e->workers[i];
+
+    atomic_init(&w->deque.top, 0);
+    atomic_init(&w->deque.bottom, 0);
+    w->deque.buf = calloc(capacity, sizeof(*w->deque.buf));
+    w->deque.mask = capacity - 1;
+    w->pass = malloc(capacity * sizeof(*w->pass));
+    w->exec = e;
+    w->id = i;
+    w->rand = 2654435761u * (i + 1);
+    w->runs = 0;
+    w->steals = 0;
+    if(w->deque.buf == NULL || w->pass == NULL) {
+      free(w->pass);
+      free(w->deque.buf);
+      while(i-- > 0) {
+        free(e->workers[i].pass);
+        free(e->workers[i].deque.buf);
+      }
+      free(e->workers);
+      errno = ENOMEM;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Free the memory of an executor.
+ *
+ * \param e A pointer to the executor control structure.
+ */
+static inline void
+pt_exec_close(struct pt_exec *e)
+{
+  uint32_t i;
+
+  for(i = 0; i < e->nworkers; ++i) {
+    free(e->workers[i].pass);
+    free(e->workers[i].deque.buf);
+  }
+  free(e->workers);
+}
+
+/**
+ * Add a protothread to an executor.
+ *
+ * Tasks are spread over the workers round robin. This must not be
+ * called while pt_exec_run() runs.
+ *
+ * \param e A pointer to the executor control structure.
+ * \param t A pointer to the task.
+ * \param fn The function implementing the protothread.
+ *
+ * \return 0 on success, or -1 with errno set to ENOSPC if the
+ * executor already has as many tasks as it was initialized for.
+ */
+static inline int
+pt_exec_spawn(struct pt_exec *e, struct pt_exec_task *t, pt_exec_fn fn)
+{
+  if(atomic_load_explicit(&e->live, memory_order_relaxed) >= e->max_tasks) {
+    errno = ENOSPC;
+    return -1;
+  }
+  PT_INIT(&t->pt);
+  t->fn = fn;
+  atomic_fetch_add_explicit(&e->live, 1, memory_order_relaxed);
+  pt_exec_deque_push(&e->workers[e->next].deque, t);
+  e->next = (e->next + 1) % e->nworkers;
+  return 0;
+}
+
+/* Runs a task once; returns non-zero if it is still alive. */
+static inline int
+pt_exec_step(struct pt_exec_worker *w, struct pt_exec_task *t)
+{
+  ++w->runs;
+  if(PT_SCHEDULE(t->fn(t))) {
+    return 1;
+  }
+  atomic_fetch_sub_explicit(&w->exec->live, 1, memory_order_release);
+  return 0;
+}
+
+static inline struct pt_exec_task *
+pt_exec_steal(struct pt_exec_worker *w)
+{
+  struct pt_exec *e = w->exec;
+  struct pt_exec_task *t;
+  uint32_t i, victim;
+
+  /* xorshift32 */
+  w->rand ^= w->rand << 13;
+  w->rand ^= w->rand >> 17;
+  w->rand ^= w->rand << 5;
+  victim = w->rand % e->nworkers;
+  for(i = 0; i < e->nworkers; ++i) {
+    if(victim != w->id &&
+       (t = pt_exec_deque_steal(&e->workers[victim].deque)) != NULL) {
+      ++w->steals;
+      return t;
+    }
+    victim = victim + 1 < e->nworkers ? victim + 1 : 0;
+  }
+  return NULL;
+}
+
+static inline void
+pt_exec_worker_run(struct pt_exec_worker *w)
+{
+  struct pt_exec *e = w->exec;
+  struct pt_exec_task *t;
+  unsigned idle = 0;
+  size_t n, i;
+
+  while(atomic_load_explicit(&e->live, memory_order_acquire) > 0) {
+    n = 0;
+    while((t = pt_exec_deque_take(&w->deque)) != NULL) {
+      if(pt_exec_step(w, t)) {
+        w->pass[n++] = t;
+      }
+    }
+    if(n == 0) {
+      t = pt_exec_steal(w);
+      if(t == NULL) {
+        if(++idle >= PT_EXEC_SPIN) {
+          idle = 0;
+          sched_yield();
+        }
+        continue;
+      }
+      if(pt_exec_step(w, t)) {
+        w->pass[n++] = t;
+      }
+    }
+    idle = 0;
+    /* Tasks are only stealable again once the pass is over. */
+    for(i = 0; i < n; ++i) {
+      pt_exec_deque_push(&w->deque, w->pass[i]);
+    }
+  }
+}
+
+static inline void *
+pt_exec_thread(void *arg)
+{
+  pt_exec_worker_run(arg);
+  return NULL;
+}
+
+/**
+ * Run all tasks of an executor until they have ended.
+ *
+ * The calling thread becomes the first worker, and a thread is
+ * started for each of the others. If a thread cannot be started, the
+ * remaining workers steal its tasks.
+ *
+ * \param e A pointer to the executor control structure.
+ */
+static inline void
+pt_exec_run(struct pt_exec *e)
+{
+  char *started = calloc(e->nworkers, 1);
+  uint32_t i;
+
+  for(i = 1; started != NULL && i < e->nworkers; ++i) {
+    started[i] = pthread_create(&e->workers[i].thread, NULL, pt_exec_thread,
+                                &e->workers[i]) == 0;
+  }
+  pt_exec_worker_run(&e->workers[0]);
+  for(i = 1; started != NULL && i < e->nworkers; ++i) {
+    if(started[i]) {
+      pthread_join(e->workers[i].thread, NULL);
+    }
+  }
+  free(started);
+}
+
+/** @} */
+/** @} */
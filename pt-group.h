@@ -0,0 +1,585 @@
+/**
+ * \addtogroup pt
+ * @{
+ */
+
+/**
+ * \defgroup ptgroup Protothread groups
+ * @{
+ *
+ * A group runs many instances of one protothread function and keeps
+ * their state as a structure of arrays: the struct pt of every
+ * instance in one dense array, whether each instance is runnable in a
+ * bitmap, and the tick at which a sleeping instance wakes up in an
+ * array of 32-bit timestamps. An instance is identified by its index.
+ *
+ * A sweep over the group reads the ready bitmap a 64-bit word at a
+ * time and only touches the state of the instances whose bits are
+ * set, so a mostly idle group of millions of protothreads costs one
+ * cache line per 512 instances. Advancing time reads the timestamps,
+ * 16 instances per cache line, and only for the words of the bitmap
+ * that have sleeping instances. The instances' own variables are best
+ * kept in arrays indexed the same way, which the function reaches
+ * through pt_group_data().
+ *
+ \code
+#include "pt-group.h"
+
+static uint32_t *counts;
+
+static
+PT_THREAD(blinker(struct pt_group *g, uint32_t i))
+{
+  PT_BEGIN(pt_group_pt(g, i));
+
+  while(1) {
+    ++counts[i];
+    PT_GROUP_SLEEP(g, i, 1 + i % 100);
+  }
+
+  PT_END(pt_group_pt(g, i));
+}
+
+int
+main(void)
+{
+  struct pt_group g;
+  uint32_t i;
+
+  pt_group_init(&g, 1000000, blinker, NULL);
+  for(i = 0; i < 1000000; ++i) {
+    pt_group_spawn(&g, i);
+  }
+  while(1) {
+    pt_group_sweep(&g);
+    pt_group_advance(&g, 1);
+  }
+}
+ \endcode
+ *
+ * Like pt-sched.h, a group never polls an instance that returned
+ * PT_WAITING: it is run again when it is woken with pt_group_wake()
+ * or when its sleep ends.
+ *
+ * The wake-up ticks are compared with vector instructions when the
+ * compiler targets AVX-512 (16 instances per instruction), AVX2 (8
+ * instances) or SSE2 (4 instances), and with a branch-free loop
+ * otherwise; PT_GROUP_SIMD
+ * selects the implementation. pt_group_scan() applies the same test
+ * to any array of deadlines and writes the indices of the due entries
+ * to a compact list, which replaces polling a PT_WAIT_UNTIL() on a
+ * deadline in every protothread of a large array.
+ */
+
+/**
+ * \file
+ * Groups of protothreads stored as a structure of arrays
+ */
+
+#pragma once
+
+#include "pt.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * The vector width used to compare wake-up ticks, in bits.
+ *
+ * Defaults to 512 when the compiler targets AVX-512F, 256 when it
+ * targets AVX2, 128 when it targets SSE2, as on every x86-64, and 0,
+ * portable C, otherwise. Define it to 0 before
+ * including pt-group.h to use portable C on any target.
+ *
+ * With GCC and Clang it can also be defined to 256 or 512 when the
+ * compiler does not target AVX2 or AVX-512F: only the comparison
+ * kernels are then compiled for the extension, so a program can check
+ * that the processor supports it before it uses a group.
+ */
+#ifndef PT_GROUP_SIMD
+#if defined(__AVX512F__)
+#define PT_GROUP_SIMD 512
+#elif defined(__AVX2__)
+#define PT_GROUP_SIMD 256
+#elif defined(__SSE2__) || defined(_M_X64)
+#define PT_GROUP_SIMD 128
+#else
+#define PT_GROUP_SIMD 0
+#endif
+#endif
+
+#if PT_GROUP_SIMD != 0
+#include <immintrin.h>
+#endif
+
+/* Compiles a kernel for a wider extension than the rest of the program. */
+#if PT_GROUP_SIMD == 512 && !defined(__AVX512F__) && defined(__GNUC__)
+#define PT_GROUP_TARGET __attribute__((target("avx512f")))
+#elif PT_GROUP_SIMD == 256 && !defined(__AVX2__) && defined(__GNUC__)
+#define PT_GROUP_TARGET __attribute__((target("avx2")))
+#else
+#define PT_GROUP_TARGET
+#endif
+
+struct pt_group;
+
+/**
+ * The function implementing the protothreads of a group.
+ *
+ * \param g A pointer to the group.
+ * \param i The index of the instance that runs.
+ */
+typedef char (*pt_group_fn)(struct pt_group *g, uint32_t i);
+
+/**
+ * Group control structure.
+ *
+ * The contents of this structure are internal to the group.
+ *
+ * \sa pt_group_init()
+ */
+struct pt_group {
+  struct pt *pt;
+  uint64_t *ready;
+  uint64_t *sleeping;
+  uint32_t *wake;
+  uint32_t n;
+  uint32_t live;
+  uint32_t now;
+  pt_group_fn fn;
+  void *data;
+};
+
+#define PT_GROUP_WORDS(n) (((n) + 63) / 64)
+#define PT_GROUP_BIT(i) ((uint64_t)1 << ((i) & 63))
+
+static inline unsigned
+pt_group_ctz(uint64_t b)
+{
+#if defined(__GNUC__)
+  return (unsigned)__builtin_ctzll(b);
+#else
+  unsigned i = 0;
+
+  while((b & 1) == 0) {
+    b >>= 1;
+    ++i;
+  }
+  return i;
+#endif
+}
+
+static inline unsigned
+pt_group_popcount(uint64_t b)
+{
+#if defined(__GNUC__)
+  return (unsigned)__builtin_popcountll(b);
+#else
+  unsigned n = 0;
+
+  for(; b != 0; b &= b - 1) {
+    ++n;
+  }
+  return n;
+#endif
+}
+
+/*
+ * Mask of the first count (at most 64) of the deadlines that have been
+ * reached at tick now. A deadline is reached when it is at most 2^31 - 1
+ * ticks before now, so ticks can wrap around.
+ */
+static inline PT_GROUP_TARGET uint64_t
+pt_group_due64(const uint32_t *deadline, uint32_t count, uint32_t now)
+{
+  uint64_t due = 0;
+  uint32_t k = 0;
+
+#if PT_GROUP_SIMD == 512
+  if(count == 64) {
+    __m512i vnow = _mm512_set1_epi32((int)now);
+
+    for(; k < 64; k += 16) {
+      __m512i d = _mm512_sub_epi32(vnow,
+                    _mm512_loadu_si512((const void *)(deadline + k)));
+      due |= (uint64_t)_mm512_cmpge_epi32_mask(d, _mm512_setzero_si512()) << k;
+    }
+  }
+#elif PT_GROUP_SIMD == 256
+  if(count == 64) {
+    __m256i vnow = _mm256_set1_epi32((int)now);
+
+    for(; k < 64; k += 8) {
+      __m256i d = _mm256_sub_epi32(vnow,
+                    _mm256_loadu_si256((const __m256i *)(deadline + k)));
+      due |= (uint64_t)(~_mm256_movemask_ps(_mm256_castsi256_ps(d)) & 0xff)
+        << k;
+    }
+  }
+#elif PT_GROUP_SIMD == 128
+  if(count == 64) {
+    __m128i vnow = _mm_set1_epi32((int)now);
+
+    for(; k < 64; k += 4) {
+      __m128i d = _mm_sub_epi32(vnow,
+                    _mm_loadu_si128((const __m128i *)(deadline + k)));
+      due |= (uint64_t)(~_mm_movemask_ps(_mm_castsi128_ps(d)) & 0xf) << k;
+    }
+  }
+#endif
+  if(k < count) {
+    uint64_t late = 0;
+
+    for(; k < count; ++k) {
+      late |= (uint64_t)((now - deadline[k]) >> 31) << k;
+    }
+    due = ~late & (~(uint64_t)0 >> (64 - count));
+  }
+  return due;
+}
+
+/*
+ * Write base plus the index of every bit set in due to out.
+ */
+static inline PT_GROUP_TARGET uint32_t
+pt_group_compact(uint64_t due, uint32_t base, uint32_t *out)
+{
+#if PT_GROUP_SIMD == 512
+  __m512i idx = _mm512_add_epi32(_mm512_set1_epi32((int)base),
+                  _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8,
+                                   7, 6, 5, 4, 3, 2, 1, 0));
+  __m512i step = _mm512_set1_epi32(16);
+  uint32_t count = 0;
+  unsigned k;
+
+  for(k = 0; k < 4; ++k) {
+    __mmask16 m = (__mmask16)(due >> (16 * k));
+
+    _mm512_mask_compressstoreu_epi32(out + count, m, idx);
+    count += pt_group_popcount(m);
+    idx = _mm512_add_epi32(idx, step);
+  }
+  return count;
+#else
+  uint32_t count = 0;
+
+  while(due != 0) {
+    out[count++] = base + pt_group_ctz(due);
+    due &= due - 1;
+  }
+  return count;
+#endif
+}
+
+/**
+ * Initialize a group.
+ *
+ * No instance runs until it is started with pt_group_spawn().
+ *
+ * \param g A pointer to the group.
+ * \param n The number of instances.
+ * \param fn The function implementing the protothreads.
+ * \param data A pointer that the function can read with
+ * pt_group_data().
+ *
+ * \return 0 on success, or -1 with errno set to ENOMEM.
+ */
+static inline int
+pt_group_init(struct pt_group *g, uint32_t n, pt_group_fn fn, void *data)
+{
+  size_t words = PT_GROUP_WORDS((size_t)n);
+  uint32_t i;
+
+  g->pt = (struct pt *)malloc((n != 0 ? n : 1) * sizeof(*g->pt));
+  g->wake = (uint32_t *)malloc((n != 0 ? n : 1) * sizeof(*g->wake));
+  g->ready = (uint64_t *)calloc(words != 0 ? words : 1, sizeof(*g->ready));
+  g->sleeping = (uint64_t *)calloc(words != 0 ? words : 1,
+                                   sizeof(*g->sleeping));
+  if(g->pt == NULL || g->wake == NULL || g->ready == NULL ||
+     g->sleeping == NULL) {
+    free(g->pt);
+    free(g->wake);
+    free(g->ready);
+    free(g->sleeping);
+    errno = ENOMEM;
+    return -1;
+  }
+  for(i = 0; i < n; ++i) {
+    PT_INIT_RAW(&g->pt[i]);
+  }
+  g->n = n;
+  g->live = 0;
+  g->now = 0;
+  g->fn = fn;
+  g->data = data;
+  return 0;
+}
+
+/**
+ * Free the memory of a group.
+ *
+ * \param g A pointer to the group.
+ */
+static inline void
+pt_group_close(struct pt_group *g)
+{
+#ifdef LC_CORO
+  uint32_t i;
+
+  for(i = 0; i < g->n; ++i) {
+    lc_coro_reset(g->pt[i].lc);
+  }
+#endif
+  free(g->pt);
+  free(g->wake);
+  free(g->ready);
+  free(g->sleeping);
+}
+
+/**
+ * The protothread control structure of an instance.
+ *
+ * \param g (struct pt_group *) A pointer to the group.
+ * \param i (uint32_t) The index of the instance.
+ *
+ * \hideinitializer
+ */
+#define pt_group_pt(g, i) (&(g)->pt[i])
+
+/**
+ * The data pointer of a group.
+ *
+ * \param g (struct pt_group *) A pointer to the group.
+ *
+ * \hideinitializer
+ */
+#define pt_group_data(g) ((g)->data)
+
+/**
+ * Check if an instance is runnable.
+ *
+ * \param g (struct pt_group *) A pointer to the group.
+ * \param i (uint32_t) The index of the instance.
+ *
+ * \hideinitializer
+ */
+#define pt_group_ready(g, i) (((g)->ready[(i) / 64] & PT_GROUP_BIT(i)) != 0)
+
+/**
+ * Check if an instance is sleeping.
+ *
+ * \param g (struct pt_group *) A pointer to the group.
+ * \param i (uint32_t) The index of the instance.
+ *
+ * \hideinitializer
+ */
+#define pt_group_sleeping(g, i) \
+  (((g)->sleeping[(i) / 64] & PT_GROUP_BIT(i)) != 0)
+
+/**
+ * Start an instance of the protothread of a group.
+ *
+ * The instance must not be running.
+ *
+ * \param g A pointer to the group.
+ * \param i The index of the instance.
+ */
+static inline void
+pt_group_spawn(struct pt_group *g, uint32_t i)
+{
+  PT_INIT(&g->pt[i]);
+  g->sleeping[i / 64] &= ~PT_GROUP_BIT(i);
+  g->ready[i / 64] |= PT_GROUP_BIT(i);
+  ++g->live;
+}
+
+/**
+ * Make an instance runnable.
+ *
+ * Waking an instance that is runnable or running has no effect
+ * other than making the running instance run again. A sleeping
+ * instance stops sleeping.
+ *
+ * \param g A pointer to the group.
+ * \param i The index of the instance.
+ */
+static inline void
+pt_group_wake(struct pt_group *g, uint32_t i)
+{
+  g->sleeping[i / 64] &= ~PT_GROUP_BIT(i);
+  g->ready[i / 64] |= PT_GROUP_BIT(i);
+}
+
+/**
+ * Make an instance sleep.
+ *
+ * Used by PT_GROUP_SLEEP(); the instance must then return
+ * PT_WAITING.
+ *
+ * \param g A pointer to the group.
+ * \param i The index of the instance.
+ * \param ticks The number of ticks to sleep. A value of zero is
+ * treated as one tick.
+ */
+static inline void
+pt_group_sleep(struct pt_group *g, uint32_t i, uint32_t ticks)
+{
+  g->wake[i] = g->now + (ticks != 0 ? ticks : 1);
+  g->sleeping[i / 64] |= PT_GROUP_BIT(i);
+}
+
+/**
+ * Sleep for a number of ticks.
+ *
+ * \param g (struct pt_group *) A pointer to the group.
+ * \param i (uint32_t) The index of the running instance.
+ * \param ticks (uint32_t) The number of ticks to sleep.
+ *
+ * \hideinitializer
+ */
+#define PT_GROUP_SLEEP(g, i, ticks)					\
+  do {									\
+    pt_group_sleep((g), (i), (ticks));					\
+    PT_WAIT_UNTIL(pt_group_pt(g, i), !pt_group_sleeping(g, i));	\
+  } while(0)
+
+/**
+ * Run every runnable instance of a group once.
+ *
+ * Instances run in the order of their indices. An instance that
+ * yields stays runnable; one that waits is not run again until it is
+ * woken; one that exits or ends is stopped. An instance that is woken
+ * during the sweep runs in the same sweep if its index is in a later
+ * word of the bitmap, otherwise in the next.
+ *
+ * \param g A pointer to the group.
+ *
+ * \return The number of instances that were run.
+ */
+static inline uint32_t
+pt_group_sweep(struct pt_group *g)
+{
+  uint32_t words = PT_GROUP_WORDS(g->n);
+  uint32_t w, runs = 0;
+
+  for(w = 0; w < words; ++w) {
+    uint64_t bits = g->ready[w];
+
+    while(bits != 0) {
+      uint32_t i = w * 64 + pt_group_ctz(bits);
+      uint64_t bit = bits & -bits;
+      char ret;
+
+      bits ^= bit;
+      g->ready[w] &= ~bit;
+      ret = g->fn(g, i);
+      ++runs;
+      if(ret == PT_YIELDED) {
+        g->ready[w] |= bit;
+      } else if(ret != PT_WAITING) {
+        g->ready[w] &= ~bit;
+        g->sleeping[w] &= ~bit;
+        --g->live;
+      }
+    }
+  }
+  return runs;
+}
+
+/**
+ * Advance the time of a group.
+ *
+ * Makes the sleeping instances whose wake-up tick has been reached
+ * runnable.
+ *
+ * \param g A pointer to the group.
+ * \param ticks The number of ticks that have passed.
+ */
+static inline void
+pt_group_advance(struct pt_group *g, uint32_t ticks)
+{
+  uint32_t words = PT_GROUP_WORDS(g->n);
+  uint32_t now = g->now += ticks;
+  uint32_t w;
+
+  for(w = 0; w < words; ++w) {
+    uint64_t due;
+
+    if(g->sleeping[w] == 0) {
+      continue;
+    }
+    due = g->sleeping[w] &
+      pt_group_due64(&g->wake[w * 64], g->n - w * 64 < 64 ? g->n - w * 64 : 64,
+                     now);
+    g->sleeping[w] &= ~due;
+    g->ready[w] |= due;
+  }
+}
+
+/**
+ * Find the deadlines that have been reached.
+ *
+ * Writes the indices of the entries of an array of deadlines that are
+ * at most 2^31 - 1 ticks before a tick, in increasing order, to a
+ * compact list. The protothreads waiting for these deadlines are the
+ * ones to resume at that tick; the others need not be polled.
+ *
+ \code
+for(i = 0; i < n; ++i) {
+  sleeper(&pt[i]);   // PT_WAIT_UNTIL(&pt[i], now - deadline[i] < 0x80000000u)
+}
+// does the same work as
+count = pt_group_scan(deadline, n, now, due);
+for(k = 0; k < count; ++k) {
+  sleeper(&pt[due[k]]);
+}
+ \endcode
+ *
+ * \param deadline A pointer to the array of deadlines.
+ * \param n The number of deadlines.
+ * \param now The current tick.
+ * \param out A pointer to an array of n indices, which receives the list.
+ *
+ * \return The number of indices written.
+ */
+static inline uint32_t
+pt_group_scan(const uint32_t *deadline, uint32_t n, uint32_t now,
+              uint32_t *out)
+{
+  uint32_t base, count = 0;
+
+  for(base = 0; base < n; base += 64) {
+    uint64_t due = pt_group_due64(deadline + base,
+                                  n - base < 64 ? n - base : 64, now);
+
+    if(due != 0) {
+      count += pt_group_compact(due, base, out + count);
+    }
+  }
+  return count;
+}
+
+/**
+ * Check if a group has no runnable instances.
+ *
+ * This takes time proportional to the number of instances.
+ *
+ * \param g A pointer to the group.
+ */
+static inline int
+pt_group_idle(const struct pt_group *g)
+{
+  uint32_t words = PT_GROUP_WORDS(g->n);
+  uint32_t w;
+
+  for(w = 0; w < words; ++w) {
+    if(g->ready[w] != 0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/** @} */
+/** @} */
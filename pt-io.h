@@ -0,0 +1,454 @@
+/**
+ * \addtogroup ptsched
+ * @{
+ */
+
+/**
+ * \defgroup ptio Waiting for file descriptors
+ * @{
+ *
+ * This module lets scheduled protothreads block on nonblocking file
+ * descriptors, such as sockets and pipes, without polling them. A
+ * struct pt_io is a reactor that belongs to one scheduler and watches
+ * its file descriptors with epoll in edge-triggered mode.
+ *
+ * Every file descriptor is represented by a struct pt_io_handle,
+ * which remembers whether the descriptor was last seen readable and
+ * writable. The readiness is cleared when a read or write returns
+ * EAGAIN, and set again by pt_io_poll() when epoll reports a new edge.
+ * A protothread that waits for a descriptor is parked, and
+ * pt_io_poll() wakes it when the descriptor becomes ready:
+ *
+ * - PT_WAIT_READABLE() and PT_WAIT_WRITABLE() block until the
+ *   descriptor is ready. pt_io_read() and pt_io_write() then perform
+ *   a single read or write and keep the readiness up to date.
+ *
+ * - PT_READ() and PT_WRITE() transfer a whole buffer, blocking as
+ *   often as needed on partial reads and writes.
+ *
+ * At most one task may wait for reading and one task for writing on
+ * each handle at a time.
+ *
+ \code
+#include "pt-io.h"
+
+struct conn {
+  struct pt_task task;
+  struct pt_io_handle h;
+  char buf[64];
+  ssize_t n;
+};
+
+static
+PT_THREAD(echo(struct pt_task *t))
+{
+  struct conn *c = (struct conn *)t;
+
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    PT_READ(t, &c->h, c->buf, sizeof(c->buf), c->n);
+    if(c->n != sizeof(c->buf)) {
+      break;
+    }
+    PT_WRITE(t, &c->h, c->buf, sizeof(c->buf), c->n);
+  }
+  pt_io_del(&c->h);
+  close(c->h.fd);
+
+  PT_END(&t->pt);
+}
+
+void
+event_loop(struct pt_sched *sched, struct pt_io *io)
+{
+  while(1) {
+    pt_sched_run(sched);
+    pt_io_poll(io, pt_sched_idle(sched) ? -1 : 0);
+  }
+}
+ \endcode
+ *
+ * This module requires Linux.
+ */
+
+/**
+ * \file
+ * Waiting for file descriptors with epoll
+ */
+
+#pragma once
+
+#include "pt-sched.h"
+
+#ifndef __linux__
+#error "pt-io.h requires epoll (Linux)"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+/**
+ * The maximum number of events that pt_io_poll() harvests with one
+ * system call.
+ */
+#ifndef PT_IO_EVENTS
+#define PT_IO_EVENTS 256
+#endif
+
+/** The file descriptor is readable. */
+#define PT_IO_IN  1
+
+/** The file descriptor is writable. */
+#define PT_IO_OUT 2
+
+/**
+ * I/O reactor control structure.
+ *
+ * \sa pt_io_init()
+ */
+struct pt_io {
+  int epfd;
+  struct pt_sched *sched;
+};
+
+/**
+ * File descriptor handle.
+ *
+ * The members other than fd are internal to the reactor.
+ *
+ * \sa pt_io_add()
+ */
+struct pt_io_handle {
+  int fd;
+  uint8_t ready;
+  struct pt_task *reader;
+  struct pt_task *writer;
+  ssize_t nread;
+  ssize_t nwritten;
+  struct pt_io *io;
+};
+
+/**
+ * Initialize an I/O reactor.
+ *
+ * \param io A pointer to the reactor.
+ * \param s A pointer to the scheduler whose tasks wait for I/O.
+ *
+ * \return 0 on success, or -1 with errno set.
+ */
+static inline int
+pt_io_init(struct pt_io *io, struct pt_sched *s)
+{
+  io->sched = s;
+  io->epfd = epoll_create1(EPOLL_CLOEXEC);
+  return io->epfd < 0 ? -1 : 0;
+}
+
+/**
+ * Release the resources of an I/O reactor.
+ *
+ * \param io A pointer to the reactor.
+ */
+static inline void
+pt_io_close(struct pt_io *io)
+{
+  close(io->epfd);
+}
+
+/**
+ * Put a file descriptor in nonblocking mode.
+ *
+ * \param fd The file descriptor.
+ *
+ * \return 0 on success, or -1 with errno set.
+ */
+static inline int
+pt_io_nonblock(int fd)
+{
+  int flags = fcntl(fd, F_GETFL);
+
+  if(flags < 0) {
+    return -1;
+  }
+  return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/**
+ * Watch a file descriptor.
+ *
+ * The file descriptor must be in nonblocking mode. It is assumed to
+ * be readable and writable until a read or write says otherwise.
+ *
+ * \param io A pointer to the reactor.
+ * \param h A pointer to the handle of the file descriptor.
+ * \param fd The file descriptor.
+ *
+ * \return 0 on success, or -1 with errno set.
+ */
+static inline int
+pt_io_add(struct pt_io *io, struct pt_io_handle *h, int fd)
+{
+  struct epoll_event ev;
+
+  h->fd = fd;
+  h->ready = PT_IO_IN | PT_IO_OUT;
+  h->reader = NULL;
+  h->writer = NULL;
+  h->nread = 0;
+  h->nwritten = 0;
+  h->io = io;
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  ev.data.ptr = h;
+  return epoll_ctl(io->epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/**
+ * Stop watching a file descriptor.
+ *
+ * This must be called before the file descriptor is closed, and no
+ * task may be waiting for it.
+ *
+ * \param h A pointer to the handle of the file descriptor.
+ *
+ * \return 0 on success, or -1 with errno set.
+ */
+static inline int
+pt_io_del(struct pt_io_handle *h)
+{
+  return epoll_ctl(h->io->epfd, EPOLL_CTL_DEL, h->fd, NULL);
+}
+
+/**
+ * Wait for file descriptors to become ready.
+ *
+ * Tasks that wait for a file descriptor that has become ready are
+ * woken. Call this from the event loop after pt_sched_run(), with a
+ * timeout of zero if the scheduler still has runnable tasks.
+ *
+ * \param io A pointer to the reactor.
+ * \param timeout_ms The maximum time to wait in milliseconds, or -1
+ * to wait until a file descriptor is ready.
+ *
+ * \return The number of file descriptors that became ready, or -1
+ * with errno set.
+ */
+static inline int
+pt_io_poll(struct pt_io *io, int timeout_ms)
+{
+  struct epoll_event ev[PT_IO_EVENTS];
+  int n, i;
+
+  n = epoll_wait(io->epfd, ev, PT_IO_EVENTS, timeout_ms);
+  for(i = 0; i < n; ++i) {
+    struct pt_io_handle *h = ev[i].data.ptr;
+    uint32_t e = ev[i].events;
+
+    if(e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+      h->ready |= PT_IO_IN;
+      if(h->reader != NULL) {
+        pt_task_wake(h->reader);
+      }
+    }
+    if(e & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+      h->ready |= PT_IO_OUT;
+      if(h->writer != NULL) {
+        pt_task_wake(h->writer);
+      }
+    }
+  }
+  return n < 0 && errno == EINTR ? 0 : n;
+}
+
+/**
+ * Read from a file descriptor once.
+ *
+ * Like read(), but clears the readiness of the handle when the file
+ * descriptor has no more data.
+ *
+ * \param h A pointer to the handle of the file descriptor.
+ * \param buf The buffer to read into.
+ * \param len The size of the buffer.
+ *
+ * \return The value returned by read().
+ */
+static inline ssize_t
+pt_io_read(struct pt_io_handle *h, void *buf, size_t len)
+{
+  ssize_t n;
+
+  do {
+    n = read(h->fd, buf, len);
+  } while(n < 0 && errno == EINTR);
+  if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    h->ready &= ~PT_IO_IN;
+  }
+  return n;
+}
+
+/**
+ * Write to a file descriptor once.
+ *
+ * Like write(), but clears the readiness of the handle when the file
+ * descriptor cannot take more data.
+ *
+ * \param h A pointer to the handle of the file descriptor.
+ * \param buf The data to write.
+ * \param len The number of bytes to write.
+ *
+ * \return The value returned by write().
+ */
+static inline ssize_t
+pt_io_write(struct pt_io_handle *h, const void *buf, size_t len)
+{
+  ssize_t n;
+
+  do {
+    n = write(h->fd, buf, len);
+  } while(n < 0 && errno == EINTR);
+  if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    h->ready &= ~PT_IO_OUT;
+  }
+  return n;
+}
+
+static inline int
+pt_io_ready(struct pt_task *t, struct pt_io_handle *h, uint8_t dir)
+{
+  struct pt_task **waiter = dir == PT_IO_IN ? &h->reader : &h->writer;
+
+  if(h->ready & dir) {
+    *waiter = NULL;
+    return 1;
+  }
+  *waiter = t;
+  return 0;
+}
+
+static inline int
+pt_io_read_step(struct pt_task *t, struct pt_io_handle *h,
+                void *buf, size_t len)
+{
+  while((size_t)h->nread < len) {
+    ssize_t n = pt_io_read(h, (char *)buf + h->nread, len - h->nread);
+
+    if(n > 0) {
+      h->nread += n;
+    } else if(n == 0) {
+      break;
+    } else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+      return pt_io_ready(t, h, PT_IO_IN);
+    } else {
+      h->nread = -1;
+      break;
+    }
+  }
+  h->reader = NULL;
+  return 1;
+}
+
+static inline int
+pt_io_write_step(struct pt_task *t, struct pt_io_handle *h,
+                 const void *buf, size_t len)
+{
+  while((size_t)h->nwritten < len) {
+    ssize_t n = pt_io_write(h, (const char *)buf + h->nwritten,
+                            len - h->nwritten);
+
+    if(n >= 0) {
+      h->nwritten += n;
+    } else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+      return pt_io_ready(t, h, PT_IO_OUT);
+    } else {
+      h->nwritten = -1;
+      break;
+    }
+  }
+  h->writer = NULL;
+  return 1;
+}
+
+/**
+ * \name Blocking I/O for scheduled protothreads
+ *
+ * These macros take a pointer to the running struct pt_task and park
+ * it until the file descriptor is ready.
+ * @{
+ */
+
+/**
+ * Block until a file descriptor is readable.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param h (struct pt_io_handle *) A pointer to the handle.
+ *
+ * \hideinitializer
+ */
+#define PT_WAIT_READABLE(task, h) \
+  PT_WAIT_UNTIL(&(task)->pt, pt_io_ready((task), (h), PT_IO_IN))
+
+/**
+ * Block until a file descriptor is writable.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param h (struct pt_io_handle *) A pointer to the handle.
+ *
+ * \hideinitializer
+ */
+#define PT_WAIT_WRITABLE(task, h) \
+  PT_WAIT_UNTIL(&(task)->pt, pt_io_ready((task), (h), PT_IO_OUT))
+
+/**
+ * Read a whole buffer from a file descriptor.
+ *
+ * Reads until the buffer is full, the end of file is reached or an
+ * error occurs, blocking whenever the file descriptor has no data.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param h (struct pt_io_handle *) A pointer to the handle.
+ * \param buf A pointer to the buffer, which must stay valid while the
+ * task blocks.
+ * \param len (size_t) The number of bytes to read.
+ * \param res (ssize_t) Set to the number of bytes read, which is less
+ * than len at the end of file, or to -1 with errno set on error.
+ *
+ * \hideinitializer
+ */
+#define PT_READ(task, h, buf, len, res)					\
+  do {									\
+    (h)->nread = 0;							\
+    PT_WAIT_UNTIL(&(task)->pt,						\
+                  pt_io_read_step((task), (h), (buf), (len)));		\
+    (res) = (h)->nread;							\
+  } while(0)
+
+/**
+ * Write a whole buffer to a file descriptor.
+ *
+ * Writes until all data is written or an error occurs, blocking
+ * whenever the file descriptor cannot take more data.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param h (struct pt_io_handle *) A pointer to the handle.
+ * \param buf A pointer to the data, which must stay valid while the
+ * task blocks.
+ * \param len (size_t) The number of bytes to write.
+ * \param res (ssize_t) Set to len, or to -1 with errno set on error.
+ *
+ * \hideinitializer
+ */
+#define PT_WRITE(task, h, buf, len, res)				\
+  do {									\
+    (h)->nwritten = 0;							\
+    PT_WAIT_UNTIL(&(task)->pt,						\
+                  pt_io_write_step((task), (h), (buf), (len)));	\
+    (res) = (h)->nwritten;						\
+  } while(0)
+
+/** @} */
+
+/** @} */
+/** @} */
@@ -0,0 +1,177 @@
+/**
+ * \addtogroup ptsched
+ * @{
+ */
+
+/**
+ * \defgroup ptmutex Mutexes
+ * @{
+ *
+ * This module implements mutexes for protothreads that run under the
+ * scheduler in pt-sched.h. A mutex has an owner, the task that locked
+ * it, and a FIFO wait queue of the tasks that want it:
+ *
+ * - PT_MUTEX_LOCK() takes the mutex if it is free. Otherwise the task
+ *   is put at the end of the wait queue and blocks.
+ *
+ * - PT_MUTEX_UNLOCK() hands the mutex directly to the task at the
+ *   head of the wait queue and makes it runnable. The mutex is only
+ *   free when nobody is waiting.
+ *
+ * Because ownership passes from task to task, a task that unlocks the
+ * mutex and locks it again goes to the end of the queue instead of
+ * taking the mutex back before the waiters run, and a blocked task
+ * costs nothing until it owns the mutex. Using a pt-sem.h semaphore
+ * with a count of one as a lock instead polls every waiter on every
+ * pass and lets the fastest task take the lock again.
+ *
+ \code
+#include "pt-mutex.h"
+
+static struct pt_mutex lock;
+
+static
+PT_THREAD(worker(struct pt_task *t))
+{
+  PT_BEGIN(&t->pt);
+
+  PT_MUTEX_LOCK(t, &lock);
+  PT_WAIT_UNTIL(&t->pt, device_ready());
+  use_device();
+  PT_MUTEX_UNLOCK(t, &lock);
+
+  PT_END(&t->pt);
+}
+ \endcode
+ *
+ * A mutex is not recursive: a task that locks a mutex it owns waits
+ * for itself forever. Only the owner may unlock the mutex, and a task
+ * must not exit or end while it owns one.
+ */
+
+/**
+ * \file
+ * Mutexes with ownership handoff
+ */
+
+#pragma once
+
+#include "pt-sched.h"
+
+#include <assert.h>
+
+#include <stdint.h>
+
+/**
+ * Mutex control structure.
+ *
+ * The contents of this structure are internal to the mutex
+ * implementation and should not be accessed directly by the user.
+ *
+ * \sa PT_MUTEX_INIT(), PT_MUTEX_LOCK(), PT_MUTEX_UNLOCK()
+ */
+struct pt_mutex {
+  struct pt_task *owner;
+  struct pt_waitq waiters;
+};
+
+/**
+ * Initialize a mutex.
+ *
+ * The mutex is free.
+ *
+ * \param m (struct pt_mutex *) A pointer to the mutex.
+ *
+ * \hideinitializer
+ */
+#define PT_MUTEX_INIT(m)			\
+  do {						\
+    (m)->owner = NULL;				\
+    pt_waitq_init(&(m)->waiters);		\
+  } while(0)
+
+/**
+ * The task that owns a mutex.
+ *
+ * \param m (struct pt_mutex *) A pointer to the mutex.
+ *
+ * \return The owner, or NULL if the mutex is free.
+ *
+ * \hideinitializer
+ */
+#define pt_mutex_owner(m) ((m)->owner)
+
+/**
+ * Lock a mutex if it is free.
+ *
+ * \param m A pointer to the mutex.
+ * \param t A pointer to the running task.
+ *
+ * \return Non-zero if the task now owns the mutex.
+ */
+static inline int
+pt_mutex_trylock(struct pt_mutex *m, struct pt_task *t)
+{
+  if(m->owner != NULL) {
+    return 0;
+  }
+  m->owner = t;
+  return 1;
+}
+
+/**
+ * Lock a mutex.
+ *
+ * Takes the mutex if it is free. Otherwise the task blocks until
+ * PT_MUTEX_UNLOCK() hands the mutex to it.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param m (struct pt_mutex *) A pointer to the mutex.
+ *
+ * \hideinitializer
+ */
+#define PT_MUTEX_LOCK(task, m)				\
+  do {							\
+    if(!pt_mutex_trylock((m), (task))) {		\
+      pt_waitq_push(&(m)->waiters, (task));		\
+      PT_BLOCK(task);					\
+    }							\
+  } while(0)
+
+/**
+ * Unlock a mutex.
+ *
+ * If a task is waiting, the task that has waited longest becomes the
+ * owner and is made runnable. Otherwise the mutex is free. This
+ * function does not block and can be called from outside a
+ * protothread on behalf of the owner.
+ *
+ * \param m A pointer to the mutex.
+ */
+static inline void
+pt_mutex_unlock(struct pt_mutex *m)
+{
+  m->owner = pt_waitq_wake_one(&m->waiters);
+}
+
+/**
+ * Unlock a mutex from the protothread that owns it.
+ *
+ * Unless NDEBUG is defined, an assertion checks that the task owns
+ * the mutex.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param m (struct pt_mutex *) A pointer to the mutex.
+ *
+ * \sa pt_mutex_unlock()
+ *
+ * \hideinitializer
+ */
+#define PT_MUTEX_UNLOCK(task, m)		\
+  do {						\
+    assert(pt_mutex_owner(m) == (task));	\
+    pt_mutex_unlock(m);				\
+  } while(0)
+
+/** @} */
+/** @} */
@@ -0,0 +1,259 @@
+/**
+ * \addtogroup pt
+ * @{
+ */
+
+/**
+ * \defgroup ptpool Protothread pools
+ * @{
+ *
+ * A pool hands out fixed-size blocks for protothread control
+ * structures and their local variables, usually a struct pt_task
+ * declared with PT_TASK_LOCALS(). Blocks are carved from slabs that
+ * are allocated with malloc() a number of blocks at a time, and freed
+ * blocks are kept in an intrusive free list, so allocating and freeing
+ * a block are a few instructions and never call into the C library
+ * once the pool has grown to its working size. Memory is returned to
+ * the system only by pt_pool_close().
+ *
+ * A pool is not locked. Like a scheduler, it belongs to one thread,
+ * and every thread that spawns protothreads has its own pool, so each
+ * core allocates from its own free list. Blocks that end on another
+ * thread, for example after being stolen by another worker of an
+ * executor, are given back with pt_pool_free_remote(), which pushes
+ * them on a lock-free list that the owner takes over in one atomic
+ * exchange when its own free list runs empty. pt_pool_free_remote()
+ * is available when the program is compiled as C11 with atomics.
+ *
+ * pt_sched_spawn_pool() in pt-sched.h allocates a task from a pool and
+ * spawns it; the scheduler frees the block when the protothread exits
+ * or ends:
+ *
+ \code
+typedef PT_TASK_LOCALS(struct {
+  int fd;
+}) conn_task;
+
+static struct pt_pool pool;
+
+void
+accept_connection(struct pt_sched *sched, int fd)
+{
+  conn_task *c = (conn_task *)pt_sched_spawn_pool(sched, &pool, conn_thread,
+                                                  PT_SCHED_DEFAULT_PRIO);
+  if(c != NULL) {
+    c->locals.fd = fd;
+  }
+}
+
+int
+main(void)
+{
+  pt_pool_init(&pool, sizeof(conn_task), 1024);
+  ...
+}
+ \endcode
+ */
+
+/**
+ * \file
+ * Fixed-size block pools for protothreads
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && \
+    !defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#define PT_POOL_REMOTE 1
+#endif
+
+/**
+ * The alignment of the blocks, which must be a power of two and at
+ * least the alignment of a pointer. It may exceed the alignment of
+ * malloc(), for example 64 to give every block its own cache lines:
+ * slabs are then allocated PT_POOL_ALIGN - 1 bytes larger and the
+ * first block is placed at the next multiple of PT_POOL_ALIGN.
+ */
+#ifndef PT_POOL_ALIGN
+#define PT_POOL_ALIGN 16
+#endif
+
+#define PT_POOL_ROUND(n) \
+  (((n) + PT_POOL_ALIGN - 1) & ~(size_t)(PT_POOL_ALIGN - 1))
+
+/* A free block. */
+struct pt_pool_block {
+  struct pt_pool_block *next;
+};
+
+/* The header of a slab, followed by its blocks. */
+struct pt_pool_slab {
+  struct pt_pool_slab *next;
+};
+
+/**
+ * Pool control structure.
+ *
+ * The contents of this structure are internal to the pool.
+ *
+ * \sa pt_pool_init()
+ */
+struct pt_pool {
+  struct pt_pool_block *free;
+  char *bump;
+  char *end;
+  size_t size;
+  size_t per_slab;
+  struct pt_pool_slab *slabs;
+  size_t nslabs;
+#ifdef PT_POOL_REMOTE
+  _Atomic(struct pt_pool_block *) remote;
+#endif
+};
+
+/**
+ * Initialize a pool.
+ *
+ * No memory is allocated until the first block is.
+ *
+ * \param p A pointer to the pool.
+ * \param size The size of a block in bytes.
+ * \param per_slab The number of blocks allocated at a time.
+ */
+static inline void
+pt_pool_init(struct pt_pool *p, size_t size, size_t per_slab)
+{
+  if(size < sizeof(struct pt_pool_block)) {
+    size = sizeof(struct pt_pool_block);
+  }
+  p->free = NULL;
+  p->bump = NULL;
+  p->end = NULL;
+  p->size = PT_POOL_ROUND(size);
+  p->per_slab = per_slab != 0 ? per_slab : 1;
+  p->slabs = NULL;
+  p->nslabs = 0;
+#ifdef PT_POOL_REMOTE
+  atomic_init(&p->remote, NULL);
+#endif
+}
+
+/**
+ * Free all memory of a pool.
+ *
+ * All blocks of the pool become invalid.
+ *
+ * \param p A pointer to the pool.
+ */
+static inline void
+pt_pool_close(struct pt_pool *p)
+{
+  struct pt_pool_slab *slab, *next;
+
+  for(slab = p->slabs; slab != NULL; slab = next) {
+    next = slab->next;
+    free(slab);
+  }
+  pt_pool_init(p, p->size, p->per_slab);
+}
+
+/* Allocates a block when the free list is empty. */
+static inline void *
+pt_pool_alloc_slow(struct pt_pool *p)
+{
+  struct pt_pool_slab *slab;
+  void *b;
+
+#ifdef PT_POOL_REMOTE
+  if(atomic_load_explicit(&p->remote, memory_order_relaxed) != NULL) {
+    struct pt_pool_block *list =
+      atomic_exchange_explicit(&p->remote, NULL, memory_order_acquire);
+    p->free = list->next;
+    return list;
+  }
+#endif
+  if(p->bump == p->end) {
+    slab = (struct pt_pool_slab *)
+      malloc(sizeof(*slab) + PT_POOL_ALIGN - 1 + p->size * p->per_slab);
+    if(slab == NULL) {
+      return NULL;
+    }
+    slab->next = p->slabs;
+    p->slabs = slab;
+    ++p->nslabs;
+    p->bump = (char *)slab +
+      PT_POOL_ROUND((uintptr_t)slab + sizeof(*slab)) - (uintptr_t)slab;
+    p->end = p->bump + p->size * p->per_slab;
+  }
+  b = p->bump;
+  p->bump += p->size;
+  return b;
+}
+
+/**
+ * Allocate a block from a pool.
+ *
+ * The contents of the block are undefined.
+ *
+ * \param p A pointer to the pool.
+ *
+ * \return A pointer to the block, or NULL with errno set to ENOMEM
+ * if a new slab could not be allocated.
+ */
+static inline void *
+pt_pool_alloc(struct pt_pool *p)
+{
+  struct pt_pool_block *b = p->free;
+
+  if(b != NULL) {
+    p->free = b->next;
+    return b;
+  }
+  return pt_pool_alloc_slow(p);
+}
+
+/**
+ * Return a block to a pool from the thread that owns the pool.
+ *
+ * \param p A pointer to the pool the block was allocated from.
+ * \param block A pointer to the block.
+ */
+static inline void
+pt_pool_free(struct pt_pool *p, void *block)
+{
+  struct pt_pool_block *b = (struct pt_pool_block *)block;
+
+  b->next = p->free;
+  p->free = b;
+}
+
+#ifdef PT_POOL_REMOTE
+/**
+ * Return a block to a pool from any thread.
+ *
+ * The block becomes available to the owner of the pool the next time
+ * its own free list is empty.
+ *
+ * \param p A pointer to the pool the block was allocated from.
+ * \param block A pointer to the block.
+ */
+static inline void
+pt_pool_free_remote(struct pt_pool *p, void *block)
+{
+  struct pt_pool_block *b = (struct pt_pool_block *)block;
+
+  b->next = atomic_load_explicit(&p->remote, memory_order_relaxed);
+  while(!atomic_compare_exchange_weak_explicit(&p->remote, &b->next, b,
+                                               memory_order_release,
+                                               memory_order_relaxed)) {
+  }
+}
+#endif
+
+/** @} */
+/** @} */
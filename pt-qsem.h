@@ -0,0 +1,136 @@
+/**
+ * \addtogroup ptsched
+ * @{
+ */
+
+/**
+ * \defgroup ptqsem Wait-queue semaphores
+ * @{
+ *
+ * This module implements counting semaphores for protothreads that
+ * run under the scheduler in pt-sched.h. It has the same semantics as
+ * the semaphores in pt-sem.h, but blocked protothreads are kept in a
+ * FIFO wait queue instead of polling the counter:
+ *
+ * - PT_QSEM_WAIT() takes a permit if one is available. Otherwise the
+ *   task is put at the end of the wait queue and blocks.
+ *
+ * - PT_QSEM_SIGNAL() hands the permit directly to the task at the
+ *   head of the wait queue and makes it runnable. The counter is only
+ *   incremented when nobody is waiting.
+ *
+ * A blocked task is not run again until it owns a permit, so
+ * contention costs no condition checks, and waiters are served in the
+ * order in which they arrived. Programs that do not use the
+ * scheduler should keep using pt-sem.h.
+ *
+ \code
+#include "pt-qsem.h"
+
+static struct pt_qsem mutex;
+
+static
+PT_THREAD(worker(struct pt_task *t))
+{
+  PT_BEGIN(&t->pt);
+
+  PT_QSEM_WAIT(t, &mutex);
+  use_shared_resource();
+  PT_QSEM_SIGNAL(t, &mutex);
+
+  PT_END(&t->pt);
+}
+ \endcode
+ */
+
+/**
+ * \file
+ * Counting semaphores with wait queues
+ */
+
+#pragma once
+
+#include "pt-sched.h"
+
+#include <stdint.h>
+
+/**
+ * Wait-queue semaphore control structure.
+ *
+ * The contents of this structure are internal to the semaphore
+ * implementation and should not be accessed directly by the user.
+ *
+ * \sa PT_QSEM_INIT(), PT_QSEM_WAIT(), PT_QSEM_SIGNAL()
+ */
+struct pt_qsem {
+  uint32_t count;
+  struct pt_waitq waiters;
+};
+
+/**
+ * Initialize a wait-queue semaphore.
+ *
+ * \param s (struct pt_qsem *) A pointer to the semaphore.
+ * \param c (uint32_t) The initial count of the semaphore.
+ *
+ * \hideinitializer
+ */
+#define PT_QSEM_INIT(s, c)			\
+  do {						\
+    (s)->count = (c);				\
+    pt_waitq_init(&(s)->waiters);		\
+  } while(0)
+
+/**
+ * Wait for a wait-queue semaphore.
+ *
+ * Takes a permit from the semaphore. If no permit is available, the
+ * task blocks until PT_QSEM_SIGNAL() hands one to it.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param s (struct pt_qsem *) A pointer to the semaphore.
+ *
+ * \hideinitializer
+ */
+#define PT_QSEM_WAIT(task, s)			\
+  do {						\
+    if((s)->count > 0) {			\
+      --(s)->count;				\
+    } else {					\
+      pt_waitq_push(&(s)->waiters, (task));	\
+      PT_BLOCK(task);				\
+    }						\
+  } while(0)
+
+/**
+ * Signal a wait-queue semaphore.
+ *
+ * If a task is waiting, the permit is handed to the task that has
+ * waited longest and it is made runnable. Otherwise the counter is
+ * incremented. This function does not block and can be called from
+ * outside a protothread.
+ *
+ * \param s A pointer to the semaphore.
+ */
+static inline void
+pt_qsem_signal(struct pt_qsem *s)
+{
+  if(pt_waitq_wake_one(&s->waiters) == NULL) {
+    ++s->count;
+  }
+}
+
+/**
+ * Signal a wait-queue semaphore from a protothread.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param s (struct pt_qsem *) A pointer to the semaphore.
+ *
+ * \sa pt_qsem_signal()
+ *
+ * \hideinitializer
+ */
+#define PT_QSEM_SIGNAL(task, s) pt_qsem_signal(s)
+
+/** @} */
+/** @} */
@@ -0,0 +1,327 @@
+/**
+ * \addtogroup ptsched
+ * @{
+ */
+
+/**
+ * \defgroup ptremote Wakeups from other threads
+ * @{
+ *
+ * The scheduler in pt-sched.h is not thread safe: pt_task_wake() may
+ * only be called from the thread that runs the scheduler. This module
+ * lets other operating system threads, signal handlers or interrupt
+ * handlers wake scheduled protothreads.
+ *
+ * A struct pt_remote belongs to one scheduler. It has a lock-free
+ * multi-producer, single-consumer inbox of struct pt_remote_node,
+ * each of which refers to one task. pt_remote_wake() puts a node in
+ * the inbox from any thread, and pt_remote_drain() wakes the tasks of
+ * all nodes in the inbox from the scheduler's thread.
+ *
+ * When nothing is runnable, the scheduler's thread sleeps in the
+ * kernel with pt_remote_wait(). It is woken through an eventfd (a
+ * pipe on systems other than Linux) as soon as another thread posts a
+ * wakeup. The file descriptor is only written when the scheduler's
+ * thread is actually sleeping, so a busy scheduler costs no system
+ * calls.
+ *
+ \code
+#include "pt-remote.h"
+
+static struct pt_sched sched;
+static struct pt_remote remote;
+static struct pt_task consumer;
+static struct pt_remote_node consumer_node;
+
+// Called from any thread
+void
+produce(int item)
+{
+  put_item(item);
+  pt_remote_wake(&remote, &consumer_node);
+}
+
+void
+event_loop(void)
+{
+  pt_sched_init(&sched);
+  pt_remote_init(&remote, &sched);
+  pt_sched_spawn(&sched, &consumer, consumer_thread);
+  pt_remote_node_init(&consumer_node, &consumer);
+
+  while(1) {
+    pt_remote_drain(&remote);
+    pt_sched_run(&sched);
+    if(pt_sched_idle(&sched)) {
+      pt_remote_wait(&remote, -1);
+    }
+  }
+}
+ \endcode
+ *
+ * This module requires C11 atomics and a POSIX system.
+ */
+
+/**
+ * \file
+ * Waking scheduled protothreads from other threads
+ */
+
+#pragma once
+
+#include "pt-sched.h"
+
+#if !defined(__STDC_VERSION__) || __STDC_VERSION__ < 201112L || \
+    defined(__STDC_NO_ATOMICS__)
+#error "pt-remote.h requires C11 atomics"
+#endif
+
+#include <errno.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/eventfd.h>
+#else
+#include <fcntl.h>
+#endif
+
+/**
+ * Remote wakeup node.
+ *
+ * A node refers to the task that it wakes. A node is in the inbox at
+ * most once, so any number of wakeups that are posted before the
+ * scheduler's thread drains the inbox wake the task once.
+ *
+ * \sa pt_remote_node_init()
+ */
+struct pt_remote_node {
+  _Atomic(struct pt_remote_node *) next;
+  atomic_int queued;
+  struct pt_task *task;
+};
+
+/**
+ * Remote wakeup control structure.
+ *
+ * \sa pt_remote_init()
+ */
+struct pt_remote {
+  _Atomic(struct pt_remote_node *) head;
+  struct pt_remote_node *tail;
+  struct pt_remote_node stub;
+  atomic_int sleeping;
+  int fd[2];
+  struct pt_sched *sched;
+};
+
+/**
+ * Initialize a remote wakeup node.
+ *
+ * \param n A pointer to the node.
+ * \param task A pointer to the task that the node wakes.
+ */
+static inline void
+pt_remote_node_init(struct pt_remote_node *n, struct pt_task *task)
+{
+  atomic_init(&n->next, NULL);
+  atomic_init(&n->queued, 0);
+  n->task = task;
+}
+
+/**
+ * Initialize a remote wakeup structure.
+ *
+ * \param r A pointer to the remote wakeup structure.
+ * \param s A pointer to the scheduler whose tasks are woken.
+ *
+ * \return 0 on success, or -1 with errno set if the file descriptor
+ * used for waking the scheduler's thread could not be created.
+ */
+static inline int
+pt_remote_init(struct pt_remote *r, struct pt_sched *s)
+{
+  pt_remote_node_init(&r->stub, NULL);
+  atomic_init(&r->head, &r->stub);
+  r->tail = &r->stub;
+  atomic_init(&r->sleeping, 0);
+  r->sched = s;
+#ifdef __linux__
+  r->fd[0] = r->fd[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  return r->fd[0] < 0 ? -1 : 0;
+#else
+  if(pipe(r->fd) < 0) {
+    return -1;
+  }
+  fcntl(r->fd[0], F_SETFL, O_NONBLOCK);
+  fcntl(r->fd[1], F_SETFL, O_NONBLOCK);
+  fcntl(r->fd[0], F_SETFD, FD_CLOEXEC);
+  fcntl(r->fd[1], F_SETFD, FD_CLOEXEC);
+  return 0;
+#endif
+}
+
+/**
+ * Release the resources of a remote wakeup structure.
+ *
+ * \param r A pointer to the remote wakeup structure.
+ */
+static inline void
+pt_remote_close(struct pt_remote *r)
+{
+  close(r->fd[0]);
+  if(r->fd[1] != r->fd[0]) {
+    close(r->fd[1]);
+  }
+}
+
+/**
+ * Get the file descriptor that becomes readable when a wakeup is
+ * posted while the scheduler's thread sleeps.
+ *
+ * This can be used to wait for wakeups together with other file
+ * descriptors, for example in the epoll reactor of an event loop.
+ * Call pt_remote_wait() with a timeout of zero to clear it.
+ *
+ * \param r A pointer to the remote wakeup structure.
+ */
+#define pt_remote_fd(r) ((r)->fd[0])
+
+static inline void
+pt_remote_push(struct pt_remote *r, struct pt_remote_node *n)
+{
+  struct pt_remote_node *prev;
+
+  atomic_store_explicit(&n->next, NULL, memory_order_relaxed);
+  prev = atomic_exchange_explicit(&r->head, n, memory_order_acq_rel);
+  atomic_store_explicit(&prev->next, n, memory_order_release);
+}
+
+static inline struct pt_remote_node *
+pt_remote_pop(struct pt_remote *r)
+{
+  struct pt_remote_node *tail = r->tail;
+  struct pt_remote_node *next =
+    atomic_load_explicit(&tail->next, memory_order_acquire);
+
+  if(tail == &r->stub) {
+    if(next == NULL) {
+      return NULL;
+    }
+    r->tail = tail = next;
+    next = atomic_load_explicit(&tail->next, memory_order_acquire);
+  }
+  if(next != NULL) {
+    r->tail = next;
+    return tail;
+  }
+  if(tail != atomic_load_explicit(&r->head, memory_order_acquire)) {
+    /* A producer is in the middle of a push; pick it up next time. */
+    return NULL;
+  }
+  pt_remote_push(r, &r->stub);
+  next = atomic_load_explicit(&tail->next, memory_order_acquire);
+  if(next != NULL) {
+    r->tail = next;
+    return tail;
+  }
+  return NULL;
+}
+
+/**
+ * Wake a task from any thread.
+ *
+ * The node is put in the inbox unless it is already there, and the
+ * scheduler's thread is woken if it sleeps in pt_remote_wait(). The
+ * task is woken the next time pt_remote_drain() is called. This
+ * function is lock-free and async-signal-safe.
+ *
+ * \param r A pointer to the remote wakeup structure.
+ * \param n A pointer to the node of the task.
+ */
+static inline void
+pt_remote_wake(struct pt_remote *r, struct pt_remote_node *n)
+{
+  if(atomic_exchange(&n->queued, 1) != 0) {
+    return;
+  }
+  pt_remote_push(r, n);
+  /* Pairs with the check for an empty inbox in pt_remote_wait(). */
+  atomic_thread_fence(memory_order_seq_cst);
+  if(atomic_load(&r->sleeping) && atomic_exchange(&r->sleeping, 0)) {
+    uint64_t one = 1;
+    ssize_t ret;
+    do {
+      ret = write(r->fd[1], &one, r->fd[0] == r->fd[1] ? 8 : 1);
+    } while(ret < 0 && errno == EINTR);
+  }
+}
+
+/**
+ * Wake the tasks of all nodes in the inbox.
+ *
+ * This function must be called from the thread that runs the
+ * scheduler.
+ *
+ * \param r A pointer to the remote wakeup structure.
+ *
+ * \return The number of tasks that were woken.
+ */
+static inline uint32_t
+pt_remote_drain(struct pt_remote *r)
+{
+  struct pt_remote_node *n;
+  uint32_t count = 0;
+
+  while((n = pt_remote_pop(r)) != NULL) {
+    if(n == &r->stub) {
+      continue;
+    }
+    atomic_store(&n->queued, 0);
+    pt_task_wake(n->task);
+    ++count;
+  }
+  return count;
+}
+
+/**
+ * Check if the inbox is empty.
+ *
+ * \param r A pointer to the remote wakeup structure.
+ */
+#define pt_remote_empty(r)						\
+  ((r)->tail == &(r)->stub &&						\
+   atomic_load(&(r)->head) == &(r)->stub)
+
+/**
+ * Sleep until a wakeup is posted.
+ *
+ * Blocks the calling thread in the kernel until another thread calls
+ * pt_remote_wake() or the timeout expires. Returns immediately if the
+ * inbox is not empty. This function must be called from the thread
+ * that runs the scheduler, usually when pt_sched_idle() is true.
+ *
+ * \param r A pointer to the remote wakeup structure.
+ * \param timeout_ms The maximum time to sleep in milliseconds, or -1
+ * to sleep until a wakeup is posted.
+ */
+static inline void
+pt_remote_wait(struct pt_remote *r, int timeout_ms)
+{
+  struct pollfd pfd;
+  uint64_t buf;
+
+  atomic_store(&r->sleeping, 1);
+  if(pt_remote_empty(r)) {
+    pfd.fd = r->fd[0];
+    pfd.events = POLLIN;
+    poll(&pfd, 1, timeout_ms);
+  }
+  atomic_store(&r->sleeping, 0);
+  while(read(r->fd[0], &buf, sizeof(buf)) > 0) {
+  }
+}
+
+/** @} */
+/** @} */
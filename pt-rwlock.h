@@ -0,0 +1,276 @@
+/**
+ * \addtogroup ptsched
+ * @{
+ */
+
+/**
+ * \defgroup ptrwlock Reader-writer locks
+ * @{
+ *
+ * This module implements reader-writer locks for protothreads that
+ * run under the scheduler in pt-sched.h. Any number of readers or a
+ * single writer can hold the lock. Tasks that cannot take it wait in
+ * one of two FIFO wait queues, for readers and for writers, and are
+ * handed the lock when it is their turn:
+ *
+ * - PT_RWLOCK_READ() takes the lock for reading if no writer holds it
+ *   or waits for it. A reader that arrives while a writer waits
+ *   queues behind the writer, so a steady stream of readers cannot
+ *   starve the writers.
+ *
+ * - PT_RWLOCK_WRITE() takes the lock for writing if nobody holds it.
+ *
+ * - When the last reader unlocks, the lock is handed to the writer
+ *   that has waited longest.
+ *
+ * - When a writer unlocks, every reader that is waiting is admitted
+ *   at once, with one splice of the wait queue into the run queue as
+ *   in pt_waitq_wake_all(). If no reader waits, the lock is handed to
+ *   the next writer.
+ *
+ * Readers and writers thus alternate in phases under contention: a
+ * writer, then every reader that waits when it unlocks, then the next
+ * writer. Neither kind starves, and a waiting task is not run until it
+ * holds the lock.
+ *
+ \code
+#include "pt-rwlock.h"
+
+static struct pt_rwlock table_lock;
+
+static
+PT_THREAD(lookup(struct pt_task *t))
+{
+  PT_BEGIN(&t->pt);
+
+  PT_RWLOCK_READ(t, &table_lock);
+  PT_WAIT_UNTIL(&t->pt, use_entry(find_entry()));
+  PT_RWLOCK_READ_UNLOCK(t, &table_lock);
+
+  PT_END(&t->pt);
+}
+
+static
+PT_THREAD(reconfigure(struct pt_task *t))
+{
+  PT_BEGIN(&t->pt);
+
+  PT_RWLOCK_WRITE(t, &table_lock);
+  rewrite_table();
+  PT_RWLOCK_WRITE_UNLOCK(t, &table_lock);
+
+  PT_END(&t->pt);
+}
+ \endcode
+ *
+ * The lock is not recursive, and a reader cannot upgrade its lock to
+ * a writer lock.
+ */
+
+/**
+ * \file
+ * Reader-writer locks
+ */
+
+#pragma once
+
+#include "pt-sched.h"
+
+#include <assert.h>
+
+#include <stdint.h>
+
+/**
+ * Reader-writer lock control structure.
+ *
+ * The contents of this structure are internal to the lock
+ * implementation and should not be accessed directly by the user.
+ *
+ * \sa PT_RWLOCK_INIT(), PT_RWLOCK_READ(), PT_RWLOCK_WRITE()
+ */
+struct pt_rwlock {
+  uint32_t readers;
+  struct pt_task *writer;
+  struct pt_waitq readq;
+  struct pt_waitq writeq;
+};
+
+/**
+ * Initialize a reader-writer lock.
+ *
+ * \param rw (struct pt_rwlock *) A pointer to the lock.
+ *
+ * \hideinitializer
+ */
+#define PT_RWLOCK_INIT(rw)			\
+  do {						\
+    (rw)->readers = 0;				\
+    (rw)->writer = NULL;			\
+    pt_waitq_init(&(rw)->readq);		\
+    pt_waitq_init(&(rw)->writeq);		\
+  } while(0)
+
+/**
+ * The number of tasks that hold a reader-writer lock for reading.
+ *
+ * \hideinitializer
+ */
+#define pt_rwlock_readers(rw) ((rw)->readers)
+
+/**
+ * The task that holds a reader-writer lock for writing.
+ *
+ * \return The writer, or NULL.
+ *
+ * \hideinitializer
+ */
+#define pt_rwlock_writer(rw) ((rw)->writer)
+
+/**
+ * Take a reader-writer lock for reading if no writer holds it or
+ * waits for it.
+ *
+ * \param rw A pointer to the lock.
+ *
+ * \return Non-zero if the lock was taken.
+ */
+static inline int
+pt_rwlock_tryread(struct pt_rwlock *rw)
+{
+  if(rw->writer != NULL || rw->writeq.count > 0) {
+    return 0;
+  }
+  ++rw->readers;
+  return 1;
+}
+
+/**
+ * Take a reader-writer lock for writing if nobody holds it.
+ *
+ * \param rw A pointer to the lock.
+ * \param t A pointer to the running task.
+ *
+ * \return Non-zero if the lock was taken.
+ */
+static inline int
+pt_rwlock_trywrite(struct pt_rwlock *rw, struct pt_task *t)
+{
+  if(rw->writer != NULL || rw->readers > 0) {
+    return 0;
+  }
+  rw->writer = t;
+  return 1;
+}
+
+/**
+ * Take a reader-writer lock for reading.
+ *
+ * The task blocks while a writer holds the lock or waits for it.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param rw (struct pt_rwlock *) A pointer to the lock.
+ *
+ * \hideinitializer
+ */
+#define PT_RWLOCK_READ(task, rw)			\
+  do {							\
+    if(!pt_rwlock_tryread(rw)) {			\
+      pt_waitq_push(&(rw)->readq, (task));		\
+      PT_BLOCK(task);					\
+    }							\
+  } while(0)
+
+/**
+ * Take a reader-writer lock for writing.
+ *
+ * The task blocks while any task holds the lock.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param rw (struct pt_rwlock *) A pointer to the lock.
+ *
+ * \hideinitializer
+ */
+#define PT_RWLOCK_WRITE(task, rw)			\
+  do {							\
+    if(!pt_rwlock_trywrite((rw), (task))) {		\
+      pt_waitq_push(&(rw)->writeq, (task));		\
+      PT_BLOCK(task);					\
+    }							\
+  } while(0)
+
+/**
+ * Release a reader-writer lock held for reading.
+ *
+ * When the last reader releases the lock, the writer that has waited
+ * longest gets it and is made runnable. This function does not block.
+ *
+ * \param rw A pointer to the lock.
+ */
+static inline void
+pt_rwlock_read_unlock(struct pt_rwlock *rw)
+{
+  if(--rw->readers == 0) {
+    rw->writer = pt_waitq_wake_one(&rw->writeq);
+  }
+}
+
+/**
+ * Release a reader-writer lock held for writing.
+ *
+ * Every waiting reader gets the lock and is made runnable; if none
+ * waits, the writer that has waited longest gets it. This function
+ * does not block.
+ *
+ * \param rw A pointer to the lock.
+ */
+static inline void
+pt_rwlock_write_unlock(struct pt_rwlock *rw)
+{
+  if(rw->readq.count > 0) {
+    rw->writer = NULL;
+    rw->readers = pt_waitq_wake_all(&rw->readq);
+  } else {
+    rw->writer = pt_waitq_wake_one(&rw->writeq);
+  }
+}
+
+/**
+ * Release a reader-writer lock held for reading, from a protothread.
+ *
+ * Unless NDEBUG is defined, an assertion checks that the lock is held
+ * for reading.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param rw (struct pt_rwlock *) A pointer to the lock.
+ *
+ * \sa pt_rwlock_read_unlock()
+ *
+ * \hideinitializer
+ */
+#define PT_RWLOCK_READ_UNLOCK(task, rw)			\
+  do {							\
+    assert(pt_rwlock_readers(rw) > 0);			\
+    pt_rwlock_read_unlock(rw);				\
+  } while(0)
+
+/**
+ * Release a reader-writer lock held for writing, from a protothread.
+ *
+ * Unless NDEBUG is defined, an assertion checks that the task holds
+ * the lock for writing.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param rw (struct pt_rwlock *) A pointer to the lock.
+ *
+ * \sa pt_rwlock_write_unlock()
+ *
+ * \hideinitializer
+ */
+#define PT_RWLOCK_WRITE_UNLOCK(task, rw)			\
+  do {							\
+    assert(pt_rwlock_writer(rw) == (task));		\
+    pt_rwlock_write_unlock(rw);				\
+  } while(0)
+
+/** @} */
+/** @} */
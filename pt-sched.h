@@ -0,0 +1,1156 @@
+/**
+ * \addtogroup pt
+ * @{
+ */
+
+/**
+ * \defgroup ptsched Protothread scheduler
+ * @{
+ *
+ * The scheduler keeps an intrusive run queue of protothreads so that
+ * a driver loop only calls the protothreads that can make progress.
+ *
+ * A protothread that is managed by the scheduler is represented by a
+ * struct pt_task, which holds the struct pt together with the
+ * function implementing the protothread and the link used by the run
+ * queue. The return value of the protothread decides what happens
+ * next:
+ *
+ * - PT_YIELDED puts the task back at the end of the run queue.
+ * - PT_WAITING parks the task. A parked task is not called again
+ *   until somebody wakes it with pt_task_wake().
+ * - PT_EXITED and PT_ENDED remove the task from the scheduler, and
+ *   return it to its pool if it was spawned with
+ *   pt_sched_spawn_pool().
+ *
+ * Because a parked task is never polled, a protothread that blocks in
+ * PT_WAIT_UNTIL() must be woken by the code that makes its condition
+ * true. The condition is evaluated again when the task runs, so a
+ * spurious wakeup is harmless.
+ *
+ \code
+#include "pt-sched.h"
+
+static int flag;
+static struct pt_task waiter;
+
+static
+PT_THREAD(waiter_thread(struct pt_task *t))
+{
+  PT_BEGIN(&t->pt);
+  PT_WAIT_UNTIL(&t->pt, flag != 0);
+  PT_END(&t->pt);
+}
+
+void
+example(struct pt_sched *sched)
+{
+  pt_sched_spawn(sched, &waiter, waiter_thread);
+  pt_sched_run(sched);  // waiter runs once and parks
+
+  flag = 1;
+  pt_task_wake(&waiter);
+  pt_sched_run(sched);  // waiter runs again and ends
+}
+ \endcode
+ *
+ * The cost of pt_sched_run() is proportional to the number of
+ * runnable tasks, not to the number of tasks known to the scheduler.
+ *
+ * Every task has a priority from 0, the highest, to
+ * PT_SCHED_LEVELS - 1. The run queue has a FIFO per priority level
+ * and a bitmap of the levels that have runnable tasks, so the next
+ * task is found with a single find-first-set instruction. Tasks that
+ * are spawned with pt_sched_spawn() all have the priority
+ * PT_SCHED_DEFAULT_PRIO and are run in FIFO order.
+ *
+ * With strict priorities a busy high-priority task starves the tasks
+ * below it. pt_sched_set_aging() makes the scheduler move the oldest
+ * task of the lowest non-empty level up by one level every given
+ * number of runs, so every runnable task eventually runs. A task
+ * returns to its own priority when it runs.
+ *
+ * A task can also run with a deadline, counted in ticks of the
+ * scheduler's timing wheel, by yielding with PT_YIELD_DEADLINE() or
+ * waiting for its next period with PT_WAIT_PERIOD(). Runnable tasks
+ * with deadlines are kept in a pairing heap and are run before all
+ * priority levels, earliest deadline first. A task that finishes a
+ * job after its deadline is counted in pt_sched_misses().
+ *
+ * Each scheduler also has a timing wheel (see pt-timer.h) that is
+ * advanced with pt_sched_advance(). A task whose timer expires is
+ * woken.
+ */
+
+/**
+ * \file
+ * Run-queue scheduler for protothreads
+ */
+
+#pragma once
+
+#include "pt.h"
+#include "pt-timer.h"
+#include "pt-pool.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The number of priority levels, at most 64.
+ */
+#ifndef PT_SCHED_LEVELS
+#define PT_SCHED_LEVELS 32
+#endif
+
+/**
+ * The priority of tasks spawned with pt_sched_spawn().
+ */
+#ifndef PT_SCHED_DEFAULT_PRIO
+#define PT_SCHED_DEFAULT_PRIO (PT_SCHED_LEVELS / 2)
+#endif
+
+#if PT_SCHED_LEVELS <= 32
+typedef uint32_t pt_sched_bitmap_t;
+#elif PT_SCHED_LEVELS <= 64
+typedef uint64_t pt_sched_bitmap_t;
+#else
+#error "PT_SCHED_LEVELS must be at most 64"
+#endif
+
+#define PT_SCHED_BIT(level) ((pt_sched_bitmap_t)1 << (level))
+
+struct pt_task;
+struct pt_sched;
+struct pt_latch;
+
+/**
+ * The function implementing a scheduled protothread.
+ *
+ * Declare it with PT_THREAD() and pass the task's struct pt to
+ * PT_BEGIN() and the other protothread macros.
+ */
+typedef char (*pt_task_fn)(struct pt_task *task);
+
+/**
+ * \name Task states
+ * @{
+ */
+
+/** The task is not known to any scheduler (new or finished). */
+#define PT_TASK_IDLE    0
+
+/** The task is in the run queue. */
+#define PT_TASK_READY   1
+
+/** The task is currently being run by the scheduler. */
+#define PT_TASK_RUNNING 2
+
+/** The task was woken while it was running. */
+#define PT_TASK_WOKEN   3
+
+/** The task returned PT_WAITING and waits for pt_task_wake(). */
+#define PT_TASK_PARKED  4
+
+/** The task is in a wait queue and ignores pt_task_wake(). */
+#define PT_TASK_BLOCKED 5
+
+/** @} */
+
+/**
+ * Scheduled protothread control structure.
+ *
+ * This structure wraps a struct pt with the bookkeeping needed by the
+ * scheduler. It is usually embedded as the first member of a larger
+ * structure that holds the protothread's own state. The members other
+ * than pt are internal to the scheduler.
+ *
+ * \sa pt_sched_spawn(), pt_task_wake()
+ */
+struct pt_task {
+  struct pt pt;
+  uint8_t state;
+  uint8_t prio;
+  uint8_t edf;
+  uint32_t deadline;
+  pt_task_fn fn;
+  struct pt_task *next;
+  struct pt_task *child;
+  struct pt_sched *sched;
+  struct pt_pool *pool;
+  struct pt_latch *latch;
+  struct pt_timer timer;
+};
+
+/**
+ * Declare a scheduled protothread control structure with local
+ * variables.
+ *
+ * Like PT_LOCALS(), but the structure holds a struct pt_task, as
+ * member task, followed by the variables, as member locals. The task
+ * is the first member, so the protothread function converts the
+ * struct pt_task pointer it is called with to the declared type:
+ *
+ \code
+typedef PT_TASK_LOCALS(struct {
+  int fd;
+  size_t done;
+}) conn_task;
+
+static
+PT_THREAD(conn_thread(struct pt_task *t))
+{
+  conn_task *self = (conn_task *)t;
+
+  PT_BEGIN(&t->pt);
+  ...
+  PT_END(&t->pt);
+}
+ \endcode
+ *
+ * \param ... The type of the local variables, usually a structure,
+ * which may contain commas as with PT_LOCALS().
+ *
+ * \hideinitializer
+ */
+#define PT_TASK_LOCALS(...) struct { struct pt_task task; __VA_ARGS__ locals; }
+
+/**
+ * Scheduler control structure.
+ *
+ * \sa pt_sched_init()
+ */
+struct pt_sched {
+  pt_sched_bitmap_t ready;
+  uint32_t nready;
+  uint32_t aging;
+  uint32_t aging_runs;
+  uint32_t misses;
+  struct pt_task *edf;
+  struct {
+    struct pt_task *head;
+    struct pt_task *tail;
+  } levels[PT_SCHED_LEVELS];
+  struct pt_timer_wheel wheel;
+};
+
+/* The highest priority level in a non-empty bitmap. */
+static inline unsigned
+pt_sched_first(pt_sched_bitmap_t b)
+{
+#if defined(__GNUC__)
+  return PT_SCHED_LEVELS <= 32 ? (unsigned)__builtin_ctz((uint32_t)b) :
+    (unsigned)__builtin_ctzll(b);
+#else
+  unsigned i = 0;
+
+  while((b & 1) == 0) {
+    b >>= 1;
+    ++i;
+  }
+  return i;
+#endif
+}
+
+/* The lowest priority level in a non-empty bitmap. */
+static inline unsigned
+pt_sched_last(pt_sched_bitmap_t b)
+{
+#if defined(__GNUC__)
+  return PT_SCHED_LEVELS <= 32 ? 31 - (unsigned)__builtin_clz((uint32_t)b) :
+    63 - (unsigned)__builtin_clzll(b);
+#else
+  unsigned i = 0;
+
+  while(b >>= 1) {
+    ++i;
+  }
+  return i;
+#endif
+}
+
+static inline void pt_task_wake(struct pt_task *t);
+
+static inline void
+pt_sched_timer_expired(struct pt_timer *timer)
+{
+  pt_task_wake((struct pt_task *)((char *)timer -
+                                  offsetof(struct pt_task, timer)));
+}
+
+/**
+ * Initialize a scheduler.
+ *
+ * \param s A pointer to the scheduler control structure.
+ */
+static inline void
+pt_sched_init(struct pt_sched *s)
+{
+  unsigned i;
+
+  s->ready = 0;
+  s->nready = 0;
+  s->aging = 0;
+  s->aging_runs = 0;
+  s->misses = 0;
+  s->edf = NULL;
+  for(i = 0; i < PT_SCHED_LEVELS; ++i) {
+    s->levels[i].head = NULL;
+    s->levels[i].tail = NULL;
+  }
+  pt_timer_wheel_init(&s->wheel, pt_sched_timer_expired);
+}
+
+/**
+ * Make the scheduler age waiting tasks.
+ *
+ * Every given number of runs, the task that has waited longest in the
+ * lowest non-empty priority level is moved to the end of the next
+ * higher level.
+ *
+ * \param s A pointer to the scheduler control structure.
+ * \param runs The number of runs between promotions, or 0 to disable
+ * aging (the default).
+ */
+static inline void
+pt_sched_set_aging(struct pt_sched *s, uint32_t runs)
+{
+  s->aging = runs;
+  s->aging_runs = 0;
+}
+
+/* Appends a task to the FIFO of a level. */
+static inline void
+pt_sched_append(struct pt_sched *s, struct pt_task *t, unsigned level)
+{
+  t->next = NULL;
+  if(s->levels[level].tail != NULL) {
+    s->levels[level].tail->next = t;
+  } else {
+    s->levels[level].head = t;
+    s->ready |= PT_SCHED_BIT(level);
+  }
+  s->levels[level].tail = t;
+}
+
+/* Removes the first task of a non-empty level. */
+static inline struct pt_task *
+pt_sched_remove(struct pt_sched *s, unsigned level)
+{
+  struct pt_task *t = s->levels[level].head;
+
+  s->levels[level].head = t->next;
+  if(t->next == NULL) {
+    s->levels[level].tail = NULL;
+    s->ready &= ~PT_SCHED_BIT(level);
+  }
+  return t;
+}
+
+/* Melds two pairing heaps ordered by deadline. */
+static inline struct pt_task *
+pt_sched_meld(struct pt_task *a, struct pt_task *b)
+{
+  struct pt_task *t;
+
+  if(a == NULL) {
+    return b;
+  }
+  if(b == NULL) {
+    return a;
+  }
+  if((int32_t)(b->deadline - a->deadline) < 0) {
+    t = a;
+    a = b;
+    b = t;
+  }
+  b->next = a->child;
+  a->child = b;
+  return a;
+}
+
+/* Removes the task with the earliest deadline from a non-empty heap. */
+static inline struct pt_task *
+pt_sched_edf_remove(struct pt_sched *s)
+{
+  struct pt_task *t = s->edf;
+  struct pt_task *a = t->child, *b, *rest, *pairs = NULL, *heap = NULL;
+
+  /* Meld the children in pairs from left to right... */
+  while(a != NULL) {
+    b = a->next;
+    if(b == NULL) {
+      a->next = pairs;
+      pairs = a;
+      break;
+    }
+    rest = b->next;
+    a = pt_sched_meld(a, b);
+    a->next = pairs;
+    pairs = a;
+    a = rest;
+  }
+  /* ...then the pairs into one heap from right to left. */
+  while(pairs != NULL) {
+    a = pairs->next;
+    pairs->next = NULL;
+    heap = pt_sched_meld(heap, pairs);
+    pairs = a;
+  }
+  s->edf = heap;
+  return t;
+}
+
+/**
+ * Put a task at the end of the run queue of its priority.
+ *
+ * This is used by the scheduler and by the synchronization
+ * primitives built on top of it. Use pt_task_wake() instead, which
+ * only enqueues tasks that are parked.
+ *
+ * \param s A pointer to the scheduler control structure.
+ * \param t A pointer to the task.
+ */
+static inline void
+pt_sched_enqueue(struct pt_sched *s, struct pt_task *t)
+{
+  t->state = PT_TASK_READY;
+  if(t->edf) {
+    t->next = NULL;
+    t->child = NULL;
+    s->edf = pt_sched_meld(s->edf, t);
+  } else {
+    pt_sched_append(s, t, t->prio);
+  }
+  ++s->nready;
+}
+
+/**
+ * Start a protothread with a priority under a scheduler.
+ *
+ * Initializes the task's protothread and puts it in the run queue.
+ * The task must not already be scheduled.
+ *
+ * \param s A pointer to the scheduler control structure.
+ * \param t A pointer to the task.
+ * \param fn The function implementing the protothread.
+ * \param prio The priority, from 0 (highest) to PT_SCHED_LEVELS - 1.
+ */
+static inline void
+pt_sched_spawn_prio(struct pt_sched *s, struct pt_task *t, pt_task_fn fn,
+                    unsigned prio)
+{
+  PT_INIT(&t->pt);
+  t->fn = fn;
+  t->sched = s;
+  t->prio = (uint8_t)prio;
+  t->edf = 0;
+  t->pool = NULL;
+  t->latch = NULL;
+  pt_timer_init(&t->timer);
+  pt_sched_enqueue(s, t);
+}
+
+/**
+ * Start a protothread under a scheduler.
+ *
+ * The task gets the priority PT_SCHED_DEFAULT_PRIO.
+ *
+ * \param s A pointer to the scheduler control structure.
+ * \param t A pointer to the task.
+ * \param fn The function implementing the protothread.
+ */
+static inline void
+pt_sched_spawn(struct pt_sched *s, struct pt_task *t, pt_task_fn fn)
+{
+  pt_sched_spawn_prio(s, t, fn, PT_SCHED_DEFAULT_PRIO);
+}
+
+/**
+ * Start a protothread in a block allocated from a pool.
+ *
+ * The block is returned to the pool when the protothread exits or
+ * ends, so the task must not be used after that. The pool's blocks
+ * must be at least as large as a struct pt_task; the rest of the
+ * block, such as the locals of a PT_TASK_LOCALS() structure, may be
+ * initialized after this call and before the scheduler runs the task.
+ *
+ * \param s A pointer to the scheduler control structure.
+ * \param pool A pointer to the pool, which belongs to the scheduler's
+ * thread.
+ * \param fn The function implementing the protothread.
+ * \param prio The priority, from 0 (highest) to PT_SCHED_LEVELS - 1.
+ *
+ * \return A pointer to the task, or NULL if no block could be
+ * allocated.
+ */
+static inline struct pt_task *
+pt_sched_spawn_pool(struct pt_sched *s, struct pt_pool *pool, pt_task_fn fn,
+                    unsigned prio)
+{
+  struct pt_task *t = (struct pt_task *)pt_pool_alloc(pool);
+
+  if(t != NULL) {
+    PT_INIT_RAW(&t->pt);
+    pt_sched_spawn_prio(s, t, fn, prio);
+    t->pool = pool;
+  }
+  return t;
+}
+
+/**
+ * Change the priority of a task.
+ *
+ * A task that is runnable or blocked keeps its place; the new
+ * priority takes effect the next time the task yields or waits.
+ *
+ * \param t A pointer to the task.
+ * \param prio The priority, from 0 (highest) to PT_SCHED_LEVELS - 1.
+ */
+static inline void
+pt_task_set_prio(struct pt_task *t, unsigned prio)
+{
+  t->prio = (uint8_t)prio;
+}
+
+/**
+ * Wake a parked task.
+ *
+ * A parked task is put at the end of its scheduler's run queue. If
+ * the task is running, it is put back in the run queue when it
+ * returns PT_WAITING, so that a wakeup is never lost. Waking a task
+ * that is already runnable or not scheduled does nothing.
+ *
+ * \param t A pointer to the task.
+ */
+static inline void
+pt_task_wake(struct pt_task *t)
+{
+  if(t->state == PT_TASK_PARKED) {
+    pt_sched_enqueue(t->sched, t);
+  } else if(t->state == PT_TASK_RUNNING) {
+    t->state = PT_TASK_WOKEN;
+  }
+}
+
+/* Moves the oldest task of the lowest non-empty level up one level. */
+static inline void
+pt_sched_age(struct pt_sched *s)
+{
+  unsigned level;
+  struct pt_task *t;
+
+  s->aging_runs = 0;
+  level = pt_sched_last(s->ready);
+  if(level == pt_sched_first(s->ready)) {
+    return;
+  }
+  t = pt_sched_remove(s, level);
+  pt_sched_append(s, t, level - 1);
+}
+
+static inline void pt_latch_count_down(struct pt_latch *l);
+
+/**
+ * Run the task with the earliest deadline, or the first task of the
+ * highest-priority non-empty level if no task has a deadline.
+ *
+ * \param s A pointer to the scheduler control structure.
+ *
+ * \return The value returned by the protothread, or PT_ENDED if the
+ * run queue was empty.
+ */
+static inline char
+pt_sched_run_one(struct pt_sched *s)
+{
+  struct pt_task *t;
+  char ret;
+
+  if(s->edf != NULL) {
+    t = pt_sched_edf_remove(s);
+  } else if(s->ready != 0) {
+    if(s->aging != 0 && ++s->aging_runs >= s->aging) {
+      pt_sched_age(s);
+    }
+    t = pt_sched_remove(s, pt_sched_first(s->ready));
+  } else {
+    return PT_ENDED;
+  }
+  --s->nready;
+
+  t->state = PT_TASK_RUNNING;
+  ret = t->fn(t);
+
+  if(ret == PT_YIELDED ||
+     (ret == PT_WAITING && t->state == PT_TASK_WOKEN)) {
+    pt_sched_enqueue(s, t);
+  } else if(ret == PT_WAITING) {
+    if(t->state == PT_TASK_RUNNING) {
+      t->state = PT_TASK_PARKED;
+    }
+  } else {
+    struct pt_latch *latch = t->latch;
+
+    pt_timer_cancel(&t->timer);
+    t->state = PT_TASK_IDLE;
+    if(t->pool != NULL) {
+      pt_pool_free(t->pool, t);
+    }
+    if(latch != NULL) {
+      pt_latch_count_down(latch);
+    }
+  }
+  return ret;
+}
+
+/**
+ * Run every task that is runnable.
+ *
+ * Runs as many tasks as were in the run queue when this function was
+ * called. When all tasks have the same priority, each of them runs
+ * once, and tasks that yield or are woken while this function runs
+ * are run by the next call. Otherwise tasks run by deadline and
+ * priority, so a task that yields or is woken may run again before
+ * tasks with later deadlines or lower priorities.
+ *
+ * \param s A pointer to the scheduler control structure.
+ *
+ * \return The number of tasks that were run.
+ */
+static inline uint32_t
+pt_sched_run(struct pt_sched *s)
+{
+  uint32_t n = s->nready;
+  uint32_t i;
+
+  for(i = 0; i < n; ++i) {
+    pt_sched_run_one(s);
+  }
+  return n;
+}
+
+/**
+ * Check if the scheduler has no runnable tasks.
+ *
+ * \param s A pointer to the scheduler control structure.
+ */
+#define pt_sched_idle(s) ((s)->ready == 0 && (s)->edf == NULL)
+
+/**
+ * Advance the time of a scheduler.
+ *
+ * Advances the scheduler's timing wheel and wakes the tasks whose
+ * timers expire.
+ *
+ * \param s A pointer to the scheduler control structure.
+ * \param ticks The number of ticks that have passed.
+ */
+static inline void
+pt_sched_advance(struct pt_sched *s, uint32_t ticks)
+{
+  pt_timer_wheel_advance(&s->wheel, ticks);
+}
+
+/**
+ * \name Wait queues
+ *
+ * A wait queue is an intrusive FIFO of blocked tasks. It is the
+ * building block for synchronization primitives that hand a resource
+ * directly to the task that has waited longest, instead of letting
+ * every waiter poll for it. A blocked task reuses its run queue link,
+ * so a wait queue costs no memory per waiter.
+ *
+ * All tasks in a wait queue must belong to the same scheduler.
+ * @{
+ */
+
+/**
+ * Wait queue control structure.
+ *
+ * \sa pt_waitq_init()
+ */
+struct pt_waitq {
+  struct pt_task *head;
+  struct pt_task *tail;
+  uint32_t count;
+  uint8_t level;
+  uint8_t mixed;
+};
+
+/**
+ * Initialize a wait queue.
+ *
+ * \param q A pointer to the wait queue.
+ */
+static inline void
+pt_waitq_init(struct pt_waitq *q)
+{
+  q->head = NULL;
+  q->tail = NULL;
+  q->count = 0;
+  q->level = 0;
+  q->mixed = 0;
+}
+
+/**
+ * Put the running task at the end of a wait queue.
+ *
+ * The task must block with PT_BLOCK() right after this call.
+ *
+ * \param q A pointer to the wait queue.
+ * \param t A pointer to the running task.
+ */
+static inline void
+pt_waitq_push(struct pt_waitq *q, struct pt_task *t)
+{
+  t->state = PT_TASK_BLOCKED;
+  t->next = NULL;
+  if(q->tail != NULL) {
+    q->tail->next = t;
+    q->mixed |= t->prio != q->level || t->edf;
+  } else {
+    q->head = t;
+    q->level = t->prio;
+    q->mixed = t->edf;
+  }
+  q->tail = t;
+  ++q->count;
+}
+
+/**
+ * Make the task that has waited longest runnable.
+ *
+ * \param q A pointer to the wait queue.
+ *
+ * \return The task that was woken, or NULL if the queue was empty.
+ */
+static inline struct pt_task *
+pt_waitq_wake_one(struct pt_waitq *q)
+{
+  struct pt_task *t = q->head;
+
+  if(t != NULL) {
+    q->head = t->next;
+    if(q->head == NULL) {
+      q->tail = NULL;
+    }
+    --q->count;
+    pt_sched_enqueue(t->sched, t);
+  }
+  return t;
+}
+
+/**
+ * Make every task in a wait queue runnable.
+ *
+ * When all waiters have the same priority and no deadline, the whole
+ * queue is appended to the run queue in one operation, so the cost
+ * does not depend on the number of waiters. Otherwise each waiter is
+ * put in the run queue of its priority or in the deadline heap. The
+ * tasks of each priority keep their waiting order.
+ *
+ * \param q A pointer to the wait queue.
+ *
+ * \return The number of tasks that were woken.
+ */
+static inline uint32_t
+pt_waitq_wake_all(struct pt_waitq *q)
+{
+  uint32_t n = q->count;
+  struct pt_sched *s;
+  struct pt_task *t, *next;
+
+  if(n == 0) {
+    return 0;
+  }
+  s = q->head->sched;
+  if(q->mixed) {
+    for(t = q->head; t != NULL; t = next) {
+      next = t->next;
+      pt_sched_enqueue(s, t);
+    }
+    pt_waitq_init(q);
+    return n;
+  }
+  if(s->levels[q->level].tail != NULL) {
+    s->levels[q->level].tail->next = q->head;
+  } else {
+    s->levels[q->level].head = q->head;
+    s->ready |= PT_SCHED_BIT(q->level);
+  }
+  s->levels[q->level].tail = q->tail;
+  s->nready += n;
+  pt_waitq_init(q);
+  return n;
+}
+
+/**
+ * Block the running task until it is woken through a wait queue.
+ *
+ * This macro must follow pt_waitq_push(). The protothread returns
+ * PT_WAITING and continues after the PT_BLOCK() statement once
+ * pt_waitq_wake_one() or pt_waitq_wake_all() has made it runnable.
+ *
+ * \param task A pointer to the running task.
+ *
+ * \hideinitializer
+ */
+#ifdef LC_CORO
+#define PT_BLOCK(task) co_yield PT_WAITING
+#else
+#define PT_BLOCK(task)				\
+  do {						\
+    PT_YIELD_FLAG = 0;				\
+    LC_SET((task)->pt.lc);			\
+    if(PT_YIELD_FLAG == 0) {			\
+      PT_HOOK_LEAVE(&(task)->pt, PT_WAITING);	\
+      return PT_WAITING;			\
+    }						\
+  } while(0)
+#endif
+
+/** @} */
+
+/**
+ * \name Latches and barriers
+ *
+ * A latch counts down to zero and wakes the tasks that wait for it
+ * once, when it gets there. PT_SPAWN_ALL() uses a latch to let a task
+ * start a number of children under the scheduler and sleep until all
+ * of them have exited or ended: each child counts the latch down when
+ * it finishes, and the parent is not run in the meantime, unlike
+ * PT_WAIT_THREAD(), which runs every child each time the parent runs.
+ *
+ \code
+typedef PT_TASK_LOCALS(struct {
+  int part;
+}) worker_task;
+
+static worker_task workers[8];
+static struct pt_latch done;
+
+static
+PT_THREAD(parent(struct pt_task *t))
+{
+  PT_BEGIN(&t->pt);
+
+  prepare_parts(workers, 8);
+  PT_SPAWN_ALL(t, &done, workers, 8, worker);
+  combine_parts();
+
+  PT_END(&t->pt);
+}
+ \endcode
+ *
+ * A barrier makes a fixed number of tasks wait for each other: each
+ * task that arrives blocks until the last one arrives, which wakes
+ * them all and resets the barrier for the next round.
+ * @{
+ */
+
+/**
+ * Latch control structure.
+ *
+ * \sa pt_latch_init(), PT_LATCH_WAIT(), pt_latch_count_down()
+ */
+struct pt_latch {
+  uint32_t count;
+  struct pt_waitq waiters;
+};
+
+/**
+ * Initialize a latch.
+ *
+ * \param l A pointer to the latch.
+ * \param count The number of count downs before the latch opens.
+ */
+static inline void
+pt_latch_init(struct pt_latch *l, uint32_t count)
+{
+  l->count = count;
+  pt_waitq_init(&l->waiters);
+}
+
+/**
+ * Count a latch down.
+ *
+ * When the count reaches zero, every task waiting for the latch is
+ * made runnable. Counting down an open latch does nothing. This
+ * function does not block and can be called from outside a
+ * protothread.
+ *
+ * \param l A pointer to the latch.
+ */
+static inline void
+pt_latch_count_down(struct pt_latch *l)
+{
+  if(l->count > 0 && --l->count == 0) {
+    pt_waitq_wake_all(&l->waiters);
+  }
+}
+
+/**
+ * Start a protothread that counts a latch down when it exits or ends.
+ *
+ * The task is spawned with pt_sched_spawn_prio() and the latch is
+ * counted up by one.
+ *
+ * \param l A pointer to the latch.
+ * \param s A pointer to the scheduler control structure.
+ * \param t A pointer to the task.
+ * \param fn The function implementing the protothread.
+ * \param prio The priority, from 0 (highest) to PT_SCHED_LEVELS - 1.
+ */
+static inline void
+pt_latch_spawn(struct pt_latch *l, struct pt_sched *s, struct pt_task *t,
+               pt_task_fn fn, unsigned prio)
+{
+  pt_sched_spawn_prio(s, t, fn, prio);
+  t->latch = l;
+  ++l->count;
+}
+
+/* Spawns the n tasks at the start of each stride-sized element of base. */
+static inline void
+pt_latch_spawn_array(struct pt_latch *l, struct pt_task *parent, void *base,
+                     size_t stride, uint32_t n, pt_task_fn fn)
+{
+  char *p = (char *)base;
+  uint32_t i;
+
+  for(i = 0; i < n; ++i, p += stride) {
+    pt_latch_spawn(l, parent->sched, (struct pt_task *)p, fn, parent->prio);
+  }
+}
+
+/**
+ * Wait until a latch is open.
+ *
+ * The task blocks until the count of the latch reaches zero. It
+ * continues at once if the latch is open.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param l (struct pt_latch *) A pointer to the latch.
+ *
+ * \hideinitializer
+ */
+#define PT_LATCH_WAIT(task, l)			\
+  do {						\
+    if((l)->count > 0) {			\
+      pt_waitq_push(&(l)->waiters, (task));	\
+      PT_BLOCK(task);				\
+    }						\
+  } while(0)
+
+/**
+ * Start an array of children and wait until all of them have exited
+ * or ended.
+ *
+ * Each element of the array is a struct pt_task or a structure whose
+ * first member is one, such as a PT_TASK_LOCALS() structure. The
+ * children run under the scheduler of the running task, with its
+ * priority, and the running task is woken once, when the last child
+ * finishes. The latch must not be in use.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param l (struct pt_latch *) A pointer to the latch.
+ * \param children An array of tasks.
+ * \param n (uint32_t) The number of children.
+ * \param fn (pt_task_fn) The function implementing the children.
+ *
+ * \hideinitializer
+ */
+#define PT_SPAWN_ALL(task, l, children, n, fn)				\
+  do {									\
+    pt_latch_init((l), 0);						\
+    pt_latch_spawn_array((l), (task), (children), sizeof((children)[0]), \
+                         (n), (fn));					\
+    PT_LATCH_WAIT(task, l);						\
+  } while(0)
+
+/**
+ * Barrier control structure.
+ *
+ * \sa pt_barrier_init(), PT_BARRIER_WAIT()
+ */
+struct pt_barrier {
+  uint32_t parties;
+  uint32_t arrived;
+  struct pt_waitq waiters;
+};
+
+/**
+ * Initialize a barrier.
+ *
+ * \param b A pointer to the barrier.
+ * \param parties The number of tasks that wait for each other.
+ */
+static inline void
+pt_barrier_init(struct pt_barrier *b, uint32_t parties)
+{
+  b->parties = parties;
+  b->arrived = 0;
+  pt_waitq_init(&b->waiters);
+}
+
+/*
+ * Counts a task that arrives at a barrier. The last one wakes the
+ * others and resets the barrier; it returns non-zero and does not
+ * wait.
+ */
+static inline int
+pt_barrier_arrive(struct pt_barrier *b)
+{
+  if(++b->arrived < b->parties) {
+    return 0;
+  }
+  b->arrived = 0;
+  pt_waitq_wake_all(&b->waiters);
+  return 1;
+}
+
+/**
+ * Wait at a barrier until all parties have arrived.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param b (struct pt_barrier *) A pointer to the barrier.
+ *
+ * \hideinitializer
+ */
+#define PT_BARRIER_WAIT(task, b)		\
+  do {						\
+    if(!pt_barrier_arrive(b)) {			\
+      pt_waitq_push(&(b)->waiters, (task));	\
+      PT_BLOCK(task);				\
+    }						\
+  } while(0)
+
+/** @} */
+
+/**
+ * \name Deadlines
+ *
+ * A task that declares a deadline leaves its priority level and is
+ * scheduled earliest deadline first until pt_task_clear_deadline() is
+ * called. Deadlines are absolute times of the scheduler's timing wheel
+ * and are compared with wraparound, so they must be less than 2^31
+ * ticks in the future.
+ *
+ * The work a task does between two declarations is a job. When a task
+ * declares the deadline of its next job after the deadline of the
+ * current one has passed, the scheduler counts a miss. A task that
+ * waits or blocks keeps its deadline, so a job may span several runs.
+ *
+ \code
+static
+PT_THREAD(sampler(struct pt_task *t))
+{
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    read_sample();
+    PT_WAIT_PERIOD(t, 10);  // released every 10 ticks, due by the next release
+  }
+
+  PT_END(&t->pt);
+}
+ \endcode
+ * @{
+ */
+
+/**
+ * The number of jobs that finished after their deadline.
+ *
+ * \param s A pointer to the scheduler control structure.
+ *
+ * \hideinitializer
+ */
+#define pt_sched_misses(s) ((s)->misses)
+
+/* Ends the current job of a task and sets the deadline of the next. */
+static inline void
+pt_task_next_deadline(struct pt_task *t, uint32_t deadline)
+{
+  if(t->edf && (int32_t)(t->sched->wheel.now - t->deadline) > 0) {
+    ++t->sched->misses;
+  }
+  t->deadline = deadline;
+  t->edf = 1;
+}
+
+/**
+ * Return a task to scheduling by priority.
+ *
+ * A task that is runnable keeps its place in the deadline heap until
+ * it runs.
+ *
+ * \param t A pointer to the task.
+ */
+static inline void
+pt_task_clear_deadline(struct pt_task *t)
+{
+  t->edf = 0;
+}
+
+/* Sets the next release of a periodic task and wakes it at that time. */
+static inline void
+pt_task_period(struct pt_task *t, uint32_t period)
+{
+  uint32_t now = t->sched->wheel.now;
+  uint32_t release;
+
+  if(!t->edf) {
+    t->deadline = now + period;
+    t->edf = 1;
+  }
+  release = t->deadline;
+  pt_task_next_deadline(t, release + period);
+  if((int32_t)(release - now) > 0) {
+    pt_timer_add(&t->sched->wheel, &t->timer, release - now);
+  } else {
+    pt_task_wake(t);
+  }
+}
+
+/**
+ * Yield and declare a deadline.
+ *
+ * Ends the current job and puts the task in the deadline heap with a
+ * deadline of the given number of ticks from now.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param ticks (uint32_t) The relative deadline.
+ *
+ * \hideinitializer
+ */
+#define PT_YIELD_DEADLINE(task, ticks)					\
+  do {									\
+    pt_task_next_deadline((task), (task)->sched->wheel.now + (ticks));	\
+    PT_YIELD(&(task)->pt);						\
+  } while(0)
+
+/**
+ * Wait for the next period of a periodic task.
+ *
+ * Ends the current job and parks the task until the next release,
+ * which is one period after the previous one. The job released then
+ * is due one period later, when the following one is released. The
+ * first call releases the task one period from now. If the task is
+ * late, the next job is released at once, but the task still yields
+ * to tasks with earlier deadlines.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param period (uint32_t) The period in ticks.
+ *
+ * \hideinitializer
+ */
+#define PT_WAIT_PERIOD(task, period)		\
+  do {						\
+    pt_task_period((task), (period));		\
+    PT_BLOCK(task);				\
+  } while(0)
+
+/** @} */
+
+/** @} */
+/** @} */
@@ -145,6 +145,9 @@ PT_THREAD(driver_thread(struct pt *pt))
  * overwritten during a protothread wait operation. Similarly, both
  * the "consumer" and "producer" protothreads declare their local
  * variables as static, to avoid them being stored on the stack.
+ * Static variables allow only one instance of each protothread; to
+ * run several producers or consumers, declare the variables with
+ * PT_LOCALS() instead, as in example-buffer.c.
  * 
  *
  */
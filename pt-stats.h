@@ -0,0 +1,227 @@
+/**
+ * \addtogroup pt
+ * @{
+ */
+
+/**
+ * \defgroup ptstats Per-protothread statistics
+ * @{
+ *
+ * When the program is compiled with PT_STATS defined, struct pt has a
+ * member stats of type struct pt_stats, which PT_BEGIN(), PT_END(),
+ * PT_WAIT_UNTIL(), PT_YIELD() and the other blocking macros update
+ * every time the protothread runs:
+ *
+ * - resumes: how many times the protothread function was called.
+ * - yields: how many times it returned PT_YIELDED.
+ * - waits: how many times it returned PT_WAITING.
+ * - ns: the total time spent between PT_BEGIN() and returning.
+ * - max_ns: the longest time of a single call.
+ *
+ * The times include child protothreads that are run with
+ * PT_WAIT_THREAD() or PT_SPAWN(). PT_INIT() clears the statistics,
+ * while ending, exiting or restarting the protothread keeps them.
+ * Without PT_STATS, struct pt and the macros are unchanged.
+ *
+ * pt_stats_print() and pt_stats_print_json() print the protothreads
+ * that have used the most time:
+ *
+ \code
+#define PT_STATS
+#include "pt.h"
+
+static struct pt pt_a, pt_b;
+
+void
+dump(void)
+{
+  struct pt_stats *stats[] = { PT_STATS_OF(&pt_a), PT_STATS_OF(&pt_b) };
+
+  pt_stats_print(stderr, stats, 2, 10);
+}
+ \endcode
+ *
+ * Time is read with clock_gettime(CLOCK_MONOTONIC) where it is
+ * available and with clock() otherwise. Define PT_STATS_NOW() to
+ * return the time in nanoseconds as a uint64_t to use another clock.
+ */
+
+/**
+ * \file
+ * Per-protothread statistics
+ */
+
+#pragma once
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/**
+ * Statistics of a protothread.
+ */
+struct pt_stats {
+  /** The name of the protothread function. */
+  const char *name;
+  /** The number of times the protothread ran. */
+  uint64_t resumes;
+  /** The number of times the protothread yielded. */
+  uint64_t yields;
+  /** The number of times the protothread waited. */
+  uint64_t waits;
+  /** The total time the protothread ran, in nanoseconds. */
+  uint64_t ns;
+  /** The longest time the protothread ran at once, in nanoseconds. */
+  uint64_t max_ns;
+};
+
+#ifndef PT_STATS_NOW
+static inline uint64_t
+pt_stats_now(void)
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#else
+  return (uint64_t)clock() * 1000000000u / CLOCKS_PER_SEC;
+#endif
+}
+#define PT_STATS_NOW() pt_stats_now()
+#endif
+
+/**
+ * The statistics of a protothread.
+ *
+ * \param pt A pointer to the protothread control structure.
+ *
+ * \hideinitializer
+ */
+#define PT_STATS_OF(pt) (&(pt)->stats)
+
+/**
+ * Clear the statistics of a protothread.
+ *
+ * \param s A pointer to the statistics.
+ */
+static inline void
+pt_stats_reset(struct pt_stats *s)
+{
+  s->name = NULL;
+  s->resumes = 0;
+  s->yields = 0;
+  s->waits = 0;
+  s->ns = 0;
+  s->max_ns = 0;
+}
+
+/* Called by PT_BEGIN(); returns the time the protothread started. */
+static inline uint64_t
+pt_stats_enter(struct pt_stats *s, const char *name)
+{
+  s->name = name;
+  ++s->resumes;
+  return PT_STATS_NOW();
+}
+
+/* Called before the protothread returns. */
+static inline void
+pt_stats_leave(struct pt_stats *s, uint64_t start, int waited, int yielded)
+{
+  uint64_t ns = PT_STATS_NOW() - start;
+
+  s->waits += waited;
+  s->yields += yielded;
+  s->ns += ns;
+  if(ns > s->max_ns) {
+    s->max_ns = ns;
+  }
+}
+
+static inline int
+pt_stats_compare(const void *a, const void *b)
+{
+  const struct pt_stats *sa = *(struct pt_stats *const *)a;
+  const struct pt_stats *sb = *(struct pt_stats *const *)b;
+
+  return (sa->ns < sb->ns) - (sa->ns > sb->ns);
+}
+
+/**
+ * Sort statistics by time, the protothread that ran longest first.
+ *
+ * \param stats An array of pointers to the statistics.
+ * \param count The number of elements in the array.
+ * \param n The number of protothreads wanted.
+ *
+ * \return The smaller of n and count; the first elements of stats
+ * are the top protothreads.
+ */
+static inline size_t
+pt_stats_top(struct pt_stats **stats, size_t count, size_t n)
+{
+  qsort(stats, count, sizeof(*stats), pt_stats_compare);
+  return n < count ? n : count;
+}
+
+/**
+ * Print the protothreads that ran longest as a table.
+ *
+ * Reorders the array as pt_stats_top() does.
+ *
+ * \param f The stream to print to.
+ * \param stats An array of pointers to the statistics.
+ * \param count The number of elements in the array.
+ * \param n The number of protothreads to print.
+ */
+static inline void
+pt_stats_print(FILE *f, struct pt_stats **stats, size_t count, size_t n)
+{
+  size_t i;
+
+  n = pt_stats_top(stats, count, n);
+  fprintf(f, "%-24s %12s %12s %12s %14s %12s\n", "protothread", "resumes",
+          "yields", "waits", "total us", "max us");
+  for(i = 0; i < n; ++i) {
+    const struct pt_stats *s = stats[i];
+
+    fprintf(f, "%-24s %12" PRIu64 " %12" PRIu64 " %12" PRIu64
+            " %14.1f %12.1f\n", s->name != NULL ? s->name : "-",
+            s->resumes, s->yields, s->waits, s->ns / 1e3, s->max_ns / 1e3);
+  }
+}
+
+/**
+ * Print the protothreads that ran longest as a JSON array.
+ *
+ * Reorders the array as pt_stats_top() does.
+ *
+ * \param f The stream to print to.
+ * \param stats An array of pointers to the statistics.
+ * \param count The number of elements in the array.
+ * \param n The number of protothreads to print.
+ */
+static inline void
+pt_stats_print_json(FILE *f, struct pt_stats **stats, size_t count, size_t n)
+{
+  size_t i;
+
+  n = pt_stats_top(stats, count, n);
+  fprintf(f, "[");
+  for(i = 0; i < n; ++i) {
+    const struct pt_stats *s = stats[i];
+
+    fprintf(f, "%s\n  {\"name\": \"%s\", \"resumes\": %" PRIu64
+            ", \"yields\": %" PRIu64 ", \"waits\": %" PRIu64
+            ", \"ns\": %" PRIu64 ", \"max_ns\": %" PRIu64 "}",
+            i > 0 ? "," : "", s->name != NULL ? s->name : "",
+            s->resumes, s->yields, s->waits, s->ns, s->max_ns);
+  }
+  fprintf(f, "\n]\n");
+}
+
+/** @} */
+/** @} */
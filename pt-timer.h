@@ -0,0 +1,327 @@
+/**
+ * \addtogroup ptsched
+ * @{
+ */
+
+/**
+ * \defgroup pttimer Timers
+ * @{
+ *
+ * This module implements a hierarchical timing wheel. Time is counted
+ * in ticks of a 32-bit counter that the program advances with
+ * pt_timer_wheel_advance(), for example from a periodic interrupt or
+ * from the main loop.
+ *
+ * The wheel has several levels of 2^PT_TIMER_WHEEL_BITS slots each. A
+ * timer is put in the slot of the lowest level that can represent its
+ * distance to the deadline. When the lower levels wrap around, the
+ * timers of the next slot of the higher level are moved down
+ * ("cascaded"). Adding and cancelling a timer are O(1), and each timer
+ * is cascaded at most once per level, so expiry is amortized O(1).
+ *
+ * The scheduler in pt-sched.h has a timing wheel, and every struct
+ * pt_task has a timer, which is used by PT_SLEEP() and
+ * PT_WAIT_UNTIL_TIMEOUT(). A protothread that sleeps is parked and is
+ * not run again until its deadline has passed:
+ *
+ \code
+#include "pt-sched.h"
+
+static
+PT_THREAD(blink(struct pt_task *t))
+{
+  PT_BEGIN(&t->pt);
+
+  while(1) {
+    led_toggle();
+    PT_SLEEP(t, 500);
+  }
+
+  PT_END(&t->pt);
+}
+
+int
+main(void)
+{
+  ...
+  while(1) {
+    pt_sched_run(&sched);
+    wait_for_next_millisecond();
+    pt_sched_advance(&sched, 1);
+  }
+}
+ \endcode
+ */
+
+/**
+ * \file
+ * Hierarchical timing wheel
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The number of bits of the tick counter that each level of the
+ * timing wheel covers. Every level has 2^PT_TIMER_WHEEL_BITS slots.
+ */
+#ifndef PT_TIMER_WHEEL_BITS
+#define PT_TIMER_WHEEL_BITS 6
+#endif
+
+/** The number of slots in each level of the timing wheel. */
+#define PT_TIMER_WHEEL_SIZE (1u << PT_TIMER_WHEEL_BITS)
+
+/** The number of levels needed to cover a 32-bit tick counter. */
+#define PT_TIMER_WHEEL_LEVELS \
+  ((32 + PT_TIMER_WHEEL_BITS - 1) / PT_TIMER_WHEEL_BITS)
+
+#define PT_TIMER_WHEEL_MASK (PT_TIMER_WHEEL_SIZE - 1)
+
+/**
+ * Timer control structure.
+ *
+ * The contents of this structure are internal to the timing wheel.
+ *
+ * \sa pt_timer_init(), pt_timer_add()
+ */
+struct pt_timer {
+  struct pt_timer *next;
+  struct pt_timer **pprev;
+  uint32_t expires;
+};
+
+/**
+ * Timing wheel control structure.
+ *
+ * \sa pt_timer_wheel_init()
+ */
+struct pt_timer_wheel {
+  uint32_t now;
+  void (*expire)(struct pt_timer *t);
+  struct pt_timer *slot[PT_TIMER_WHEEL_LEVELS][PT_TIMER_WHEEL_SIZE];
+};
+
+/**
+ * Initialize a timing wheel.
+ *
+ * \param w A pointer to the timing wheel.
+ * \param expire The function that is called for every timer that
+ * expires. The timer is no longer pending when it is called, and it
+ * may add the timer again.
+ */
+static inline void
+pt_timer_wheel_init(struct pt_timer_wheel *w, void (*expire)(struct pt_timer *t))
+{
+  unsigned level, i;
+
+  w->now = 0;
+  w->expire = expire;
+  for(level = 0; level < PT_TIMER_WHEEL_LEVELS; ++level) {
+    for(i = 0; i < PT_TIMER_WHEEL_SIZE; ++i) {
+      w->slot[level][i] = NULL;
+    }
+  }
+}
+
+/**
+ * Initialize a timer.
+ *
+ * \param t A pointer to the timer.
+ */
+static inline void
+pt_timer_init(struct pt_timer *t)
+{
+  t->next = NULL;
+  t->pprev = NULL;
+  t->expires = 0;
+}
+
+/**
+ * Check if a timer is waiting to expire.
+ *
+ * \param t A pointer to the timer.
+ */
+#define pt_timer_pending(t) ((t)->pprev != NULL)
+
+/**
+ * Check if the deadline of a timer has been reached.
+ *
+ * This is true after the timer has expired, and stays true after
+ * the timer has been cancelled if its deadline has passed.
+ *
+ * \param w A pointer to the timing wheel.
+ * \param t A pointer to the timer.
+ */
+#define pt_timer_expired(w, t) ((int32_t)((w)->now - (t)->expires) >= 0)
+
+static inline void
+pt_timer_wheel_insert(struct pt_timer_wheel *w, struct pt_timer *t)
+{
+  uint32_t delta = t->expires - w->now;
+  unsigned level = 0;
+  struct pt_timer **slot;
+
+  while(level < PT_TIMER_WHEEL_LEVELS - 1 &&
+        (delta >> (PT_TIMER_WHEEL_BITS * (level + 1))) != 0) {
+    ++level;
+  }
+  slot = &w->slot[level][(t->expires >> (PT_TIMER_WHEEL_BITS * level)) &
+                         PT_TIMER_WHEEL_MASK];
+  t->next = *slot;
+  if(t->next != NULL) {
+    t->next->pprev = &t->next;
+  }
+  *slot = t;
+  t->pprev = slot;
+}
+
+/**
+ * Cancel a timer.
+ *
+ * Cancelling a timer that is not pending does nothing.
+ *
+ * \param t A pointer to the timer.
+ */
+static inline void
+pt_timer_cancel(struct pt_timer *t)
+{
+  if(t->pprev != NULL) {
+    *t->pprev = t->next;
+    if(t->next != NULL) {
+      t->next->pprev = t->pprev;
+    }
+    t->next = NULL;
+    t->pprev = NULL;
+  }
+}
+
+/**
+ * Start a timer.
+ *
+ * The timer expires when the wheel has been advanced by the given
+ * number of ticks. A timer that is already pending is restarted.
+ *
+ * \param w A pointer to the timing wheel.
+ * \param t A pointer to the timer.
+ * \param ticks The number of ticks until the timer expires. A value
+ * of zero is treated as one tick.
+ */
+static inline void
+pt_timer_add(struct pt_timer_wheel *w, struct pt_timer *t, uint32_t ticks)
+{
+  pt_timer_cancel(t);
+  t->expires = w->now + (ticks != 0 ? ticks : 1);
+  pt_timer_wheel_insert(w, t);
+}
+
+static inline void
+pt_timer_wheel_cascade(struct pt_timer_wheel *w, unsigned level, unsigned i)
+{
+  struct pt_timer *t = w->slot[level][i];
+
+  w->slot[level][i] = NULL;
+  while(t != NULL) {
+    struct pt_timer *next = t->next;
+    pt_timer_wheel_insert(w, t);
+    t = next;
+  }
+}
+
+/**
+ * Advance the time of a timing wheel.
+ *
+ * The expire function of the wheel is called for every timer whose
+ * deadline is reached, in the order of the deadlines.
+ *
+ * \param w A pointer to the timing wheel.
+ * \param ticks The number of ticks that have passed.
+ */
+static inline void
+pt_timer_wheel_advance(struct pt_timer_wheel *w, uint32_t ticks)
+{
+  while(ticks-- > 0) {
+    unsigned idx = ++w->now & PT_TIMER_WHEEL_MASK;
+    struct pt_timer *t;
+
+    if(idx == 0) {
+      unsigned level;
+      for(level = 1; level < PT_TIMER_WHEEL_LEVELS; ++level) {
+        unsigned i = (w->now >> (PT_TIMER_WHEEL_BITS * level)) &
+          PT_TIMER_WHEEL_MASK;
+        pt_timer_wheel_cascade(w, level, i);
+        if(i != 0) {
+          break;
+        }
+      }
+    }
+
+    while((t = w->slot[0][idx]) != NULL) {
+      pt_timer_cancel(t);
+      w->expire(t);
+    }
+  }
+}
+
+/**
+ * \name Timeouts for scheduled protothreads
+ *
+ * These macros take a pointer to a struct pt_task from pt-sched.h
+ * and use the task's timer and the timing wheel of its scheduler.
+ * @{
+ */
+
+/**
+ * Sleep for a number of ticks.
+ *
+ * The task is parked until its scheduler's timing wheel has been
+ * advanced by the given number of ticks.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param ticks (uint32_t) The number of ticks to sleep.
+ *
+ * \hideinitializer
+ */
+#define PT_SLEEP(task, ticks)						\
+  do {									\
+    pt_timer_add(&(task)->sched->wheel, &(task)->timer, (ticks));	\
+    PT_WAIT_UNTIL(&(task)->pt, !pt_timer_pending(&(task)->timer));	\
+  } while(0)
+
+/**
+ * Block until a condition is true or a timeout expires.
+ *
+ * The condition is evaluated when the task is woken, as with
+ * PT_WAIT_UNTIL(). If the timeout expires first, the task continues
+ * anyway, and PT_TIMEDOUT() is true.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param cond The condition.
+ * \param ticks (uint32_t) The maximum number of ticks to wait.
+ *
+ * \hideinitializer
+ */
+#define PT_WAIT_UNTIL_TIMEOUT(task, cond, ticks)			\
+  do {									\
+    pt_timer_add(&(task)->sched->wheel, &(task)->timer, (ticks));	\
+    PT_WAIT_UNTIL(&(task)->pt,						\
+                  (cond) || !pt_timer_pending(&(task)->timer));	\
+    pt_timer_cancel(&(task)->timer);					\
+  } while(0)
+
+/**
+ * Check if the last PT_WAIT_UNTIL_TIMEOUT() of a task timed out.
+ *
+ * \param task (struct pt_task *) A pointer to the task.
+ *
+ * \hideinitializer
+ */
+#define PT_TIMEDOUT(task) \
+  pt_timer_expired(&(task)->sched->wheel, &(task)->timer)
+
+/** @} */
+
+/** @} */
+/** @} */
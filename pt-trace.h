@@ -0,0 +1,282 @@
+/**
+ * \addtogroup pt
+ * @{
+ */
+
+/**
+ * \defgroup pttrace Tracing
+ * @{
+ *
+ * When the program is compiled with PT_TRACE defined, every time a
+ * protothread is resumed or returns, an event is recorded in the trace
+ * buffer of the calling thread. An event holds a timestamp, the
+ * protothread, the name of its function, the line of the statement it
+ * returned from and what it returned. pt_trace_write_json() writes the
+ * buffers in the Chrome trace event format, which chrome://tracing and
+ * the Perfetto UI (https://ui.perfetto.dev) display as a timeline with
+ * one track per thread and child protothreads nested in their parents.
+ *
+ * Each thread that runs protothreads has its own struct pt_trace, so
+ * recording an event takes no locks or atomic operations. The buffer
+ * is a ring: when it is full, the oldest events are overwritten, so
+ * that it always holds the most recent history. Threads without a
+ * buffer record nothing.
+ *
+ * The thread-local pointer to the buffer must be defined in exactly
+ * one source file of the program with PT_TRACE_DEFINE:
+ *
+ \code
+#define PT_TRACE
+#include "pt.h"
+
+PT_TRACE_DEFINE;
+
+static struct pt_trace trace;
+static struct pt_trace_event events[1 << 16];
+
+int
+main(void)
+{
+  struct pt_trace *traces[] = { &trace };
+
+  pt_trace_init(&trace, events, 1 << 16, 0);
+  pt_trace_attach(&trace);
+  run_protothreads();
+  pt_trace_attach(NULL);
+  pt_trace_write_json(stdout, traces, 1);
+}
+ \endcode
+ *
+ * Timestamps are read from the time stamp counter on x86 and from the
+ * monotonic clock elsewhere, and are converted to time when the trace
+ * is written. Define PT_TRACE_TICKS() to return a uint64_t tick count
+ * to use another clock. A buffer must only be written out when its
+ * thread has detached it or has stopped running protothreads.
+ */
+
+/**
+ * \file
+ * Tracing of protothread scheduling
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && \
+    !defined(__STDC_NO_THREADS__)
+#define PT_TRACE_TLS _Thread_local
+#elif defined(__GNUC__)
+#define PT_TRACE_TLS __thread
+#elif defined(_MSC_VER)
+#define PT_TRACE_TLS __declspec(thread)
+#else
+#error "pt-trace.h requires thread-local storage"
+#endif
+
+/** The event type of a protothread being resumed. */
+#define PT_TRACE_RESUME (-1)
+
+/**
+ * A trace event.
+ */
+struct pt_trace_event {
+  /** The time stamp, in ticks. */
+  uint64_t ticks;
+  /** The protothread control structure. */
+  const void *pt;
+  /** The name of the protothread function. */
+  const char *name;
+  /** The line the protothread returned from, or zero when resumed. */
+  uint32_t line;
+  /** The value the protothread returned, or PT_TRACE_RESUME. */
+  int32_t ret;
+};
+
+/**
+ * The trace buffer of a thread.
+ *
+ * The contents of this structure are internal to the tracing
+ * implementation.
+ */
+struct pt_trace {
+  struct pt_trace_event *events;
+  uint64_t head;
+  uint32_t mask;
+  uint32_t id;
+  uint64_t ticks0;
+  uint64_t ns0;
+};
+
+/**
+ * Define the thread-local pointer to the trace buffer.
+ *
+ * This must be used at file scope in exactly one source file of a
+ * program that is compiled with PT_TRACE.
+ *
+ * \hideinitializer
+ */
+#define PT_TRACE_DEFINE PT_TRACE_TLS struct pt_trace *pt_trace_current
+
+extern PT_TRACE_TLS struct pt_trace *pt_trace_current;
+
+static inline uint64_t
+pt_trace_clock_ns(void)
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#else
+  return (uint64_t)clock() * 1000000000u / CLOCKS_PER_SEC;
+#endif
+}
+
+#ifndef PT_TRACE_TICKS
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define PT_TRACE_TICKS() __rdtsc()
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PT_TRACE_TICKS() __rdtsc()
+#else
+#define PT_TRACE_TICKS() pt_trace_clock_ns()
+#endif
+#endif
+
+/**
+ * Initialize a trace buffer.
+ *
+ * \param t A pointer to the trace buffer.
+ * \param events An array of events.
+ * \param size The number of events, which must be a power of two.
+ * \param id The thread id shown in the trace.
+ */
+static inline void
+pt_trace_init(struct pt_trace *t, struct pt_trace_event *events,
+              uint32_t size, uint32_t id)
+{
+  t->events = events;
+  t->head = 0;
+  t->mask = size - 1;
+  t->id = id;
+  t->ticks0 = PT_TRACE_TICKS();
+  t->ns0 = pt_trace_clock_ns();
+}
+
+/**
+ * Record the events of the calling thread in a trace buffer.
+ *
+ * \param t A pointer to the trace buffer, or NULL to stop recording.
+ */
+static inline void
+pt_trace_attach(struct pt_trace *t)
+{
+  pt_trace_current = t;
+}
+
+/**
+ * The number of events in a trace buffer.
+ *
+ * \param t A pointer to the trace buffer.
+ */
+static inline uint32_t
+pt_trace_count(const struct pt_trace *t)
+{
+  return t->head > t->mask ? t->mask + 1 : (uint32_t)t->head;
+}
+
+/**
+ * An event of a trace buffer.
+ *
+ * \param t A pointer to the trace buffer.
+ * \param i The index of the event, 0 being the oldest.
+ */
+static inline const struct pt_trace_event *
+pt_trace_event(const struct pt_trace *t, uint32_t i)
+{
+  return &t->events[(t->head - pt_trace_count(t) + i) & t->mask];
+}
+
+/* Called by PT_BEGIN() and before the protothread returns. */
+static inline void
+pt_trace_record(const void *pt, const char *name, uint32_t line, int ret)
+{
+  struct pt_trace *t = pt_trace_current;
+  struct pt_trace_event *e;
+
+  if(t == NULL) {
+    return;
+  }
+  e = &t->events[t->head++ & t->mask];
+  e->ticks = PT_TRACE_TICKS();
+  e->pt = pt;
+  e->name = name;
+  e->line = line;
+  e->ret = ret;
+}
+
+static inline const char *
+pt_trace_ret_name(int ret)
+{
+  static const char *const names[] = {
+    "PT_WAITING", "PT_YIELDED", "PT_EXITED", "PT_ENDED"
+  };
+
+  return ret >= 0 && ret < 4 ? names[ret] : "?";
+}
+
+/**
+ * Write trace buffers in the Chrome trace event format.
+ *
+ * Each resume and the following return become a slice named after the
+ * protothread function. Events that were overwritten are lost; the
+ * returns of slices whose start was lost are skipped.
+ *
+ * \param f The stream to write to.
+ * \param traces An array of pointers to the trace buffers.
+ * \param n The number of trace buffers.
+ */
+static inline void
+pt_trace_write_json(FILE *f, struct pt_trace *const *traces, size_t n)
+{
+  const char *sep = "";
+  size_t i;
+
+  fprintf(f, "{\"traceEvents\": [");
+  for(i = 0; i < n; ++i) {
+    const struct pt_trace *t = traces[i];
+    uint64_t ticks = PT_TRACE_TICKS() - t->ticks0;
+    uint64_t ns = pt_trace_clock_ns() - t->ns0;
+    double ns_per_tick = ticks > 0 ? (double)ns / ticks : 1;
+    uint32_t count = pt_trace_count(t), j, depth = 0;
+
+    for(j = 0; j < count; ++j) {
+      const struct pt_trace_event *e = pt_trace_event(t, j);
+      double us = (t->ns0 + (e->ticks - t->ticks0) * ns_per_tick) / 1e3;
+
+      if(e->ret == PT_TRACE_RESUME) {
+        ++depth;
+        fprintf(f, "%s\n  {\"name\": \"%s\", \"ph\": \"B\", \"ts\": %.3f, "
+                "\"pid\": 1, \"tid\": %u, \"args\": {\"pt\": \"%p\"}}",
+                sep, e->name, us, (unsigned)t->id, e->pt);
+      } else if(depth > 0) {
+        --depth;
+        fprintf(f, "%s\n  {\"name\": \"%s\", \"ph\": \"E\", \"ts\": %.3f, "
+                "\"pid\": 1, \"tid\": %u, \"args\": {\"line\": %u, "
+                "\"ret\": \"%s\"}}", sep, e->name, us, (unsigned)t->id,
+                (unsigned)e->line, pt_trace_ret_name(e->ret));
+      } else {
+        continue;
+      }
+      sep = ",";
+    }
+  }
+  fprintf(f, "\n]}\n");
+}
+
+/** @} */
+/** @} */
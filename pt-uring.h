@@ -0,0 +1,535 @@
+/**
+ * \addtogroup ptio
+ * @{
+ */
+
+/**
+ * \defgroup pturing Completion-based I/O with io_uring
+ * @{
+ *
+ * This module performs I/O for scheduled protothreads through the
+ * io_uring interface of Linux. PT_IO_READ() and PT_IO_WRITE() put a
+ * request in the submission queue and block the task. The requests of
+ * all tasks are submitted together by pt_uring_poll(), which also
+ * harvests the completions and wakes the task of each completed
+ * request. The user_data of a request points to the handle of the
+ * file descriptor, which refers to the waiting task, so a completion
+ * resumes exactly the protothread that issued it.
+ *
+ * Unlike pt-io.h, which waits for readiness and then calls read() or
+ * write(), a whole pass of the event loop costs a single system call
+ * no matter how many requests it submits and completes. Requests also
+ * work on regular files, which epoll cannot wait for.
+ *
+ * If the kernel does not support io_uring, or it is disabled, the
+ * engine falls back to the epoll reactor of pt-io.h. The same
+ * protothreads then wait for readiness and call read() and write().
+ *
+ * The io_uring system calls are made with syscall(), so programs
+ * that are compiled in a strict ISO C mode must define _GNU_SOURCE
+ * before including any header.
+ *
+ \code
+#include "pt-uring.h"
+
+static struct pt_uring uring;
+
+static
+PT_THREAD(copy(struct pt_task *t))
+{
+  struct copy *c = (struct copy *)t;
+
+  PT_BEGIN(&t->pt);
+
+  do {
+    PT_IO_READ(t, &uring, &c->in, c->buf, sizeof(c->buf), c->n);
+    if(c->n > 0) {
+      PT_IO_WRITE(t, &uring, &c->out, c->buf, c->n, c->n);
+    }
+  } while(c->n > 0);
+
+  PT_END(&t->pt);
+}
+
+void
+event_loop(struct pt_sched *sched)
+{
+  pt_uring_init(&uring, sched, 256);
+  ...
+  while(1) {
+    pt_sched_run(sched);
+    pt_uring_poll(&uring, pt_sched_idle(sched) ? -1 : 0);
+  }
+}
+ \endcode
+ */
+
+/**
+ * \file
+ * Completion-based I/O with io_uring
+ */
+
+#pragma once
+
+#include "pt-io.h"
+
+#include <linux/io_uring.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/**
+ * I/O engine control structure.
+ *
+ * The members other than io are internal to the engine.
+ *
+ * \sa pt_uring_init()
+ */
+struct pt_uring {
+  struct pt_io io;
+  int ring_fd;
+  uint32_t features;
+  uint32_t to_submit;
+  void *sq_ring;
+  void *cq_ring;
+  size_t sq_ring_size;
+  size_t cq_ring_size;
+  struct io_uring_sqe *sqes;
+  size_t sqes_size;
+  uint32_t *sq_head;
+  uint32_t *sq_tail;
+  uint32_t *sq_array;
+  uint32_t sq_mask;
+  uint32_t sq_entries;
+  uint32_t *cq_head;
+  uint32_t *cq_tail;
+  struct io_uring_cqe *cqes;
+  uint32_t cq_mask;
+};
+
+/**
+ * Check if an engine uses io_uring.
+ *
+ * This is false if the engine has fallen back to epoll.
+ *
+ * \param u A pointer to the engine.
+ */
+#define pt_uring_available(u) ((u)->ring_fd >= 0)
+
+static inline int
+pt_uring_enter(struct pt_uring *u, uint32_t to_submit,
+               uint32_t min_complete, uint32_t flags, void *arg,
+               size_t argsz)
+{
+  return (int)syscall(__NR_io_uring_enter, u->ring_fd, to_submit,
+                      min_complete, flags, arg, argsz);
+}
+
+static inline void
+pt_uring_unmap(struct pt_uring *u)
+{
+  if(u->sqes != MAP_FAILED) {
+    munmap(u->sqes, u->sqes_size);
+  }
+  if(u->cq_ring != MAP_FAILED && u->cq_ring != u->sq_ring) {
+    munmap(u->cq_ring, u->cq_ring_size);
+  }
+  if(u->sq_ring != MAP_FAILED) {
+    munmap(u->sq_ring, u->sq_ring_size);
+  }
+}
+
+static inline int
+pt_uring_setup(struct pt_uring *u, uint32_t entries)
+{
+  struct io_uring_params p;
+  char *sq, *cq;
+
+  memset(&p, 0, sizeof(p));
+  u->ring_fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+  if(u->ring_fd < 0) {
+    return -1;
+  }
+  u->features = p.features;
+  u->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+  u->cq_ring_size = p.cq_off.cqes +
+    p.cq_entries * sizeof(struct io_uring_cqe);
+  if(p.features & IORING_FEAT_SINGLE_MMAP) {
+    if(u->cq_ring_size > u->sq_ring_size) {
+      u->sq_ring_size = u->cq_ring_size;
+    }
+    u->cq_ring_size = u->sq_ring_size;
+  }
+  u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+  u->sq_ring = mmap(NULL, u->sq_ring_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED, u->ring_fd, IORING_OFF_SQ_RING);
+  u->cq_ring = u->sq_ring;
+  if(u->sq_ring != MAP_FAILED && !(p.features & IORING_FEAT_SINGLE_MMAP)) {
+    u->cq_ring = mmap(NULL, u->cq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED, u->ring_fd, IORING_OFF_CQ_RING);
+  }
+  u->sqes = mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED, u->ring_fd, IORING_OFF_SQES);
+  if(u->sq_ring == MAP_FAILED || u->cq_ring == MAP_FAILED ||
+     u->sqes == MAP_FAILED) {
+    pt_uring_unmap(u);
+    close(u->ring_fd);
+    u->ring_fd = -1;
+    return -1;
+  }
+
+  sq = u->sq_ring;
+  cq = u->cq_ring;
+  u->sq_head = (uint32_t *)(sq + p.sq_off.head);
+  u->sq_tail = (uint32_t *)(sq + p.sq_off.tail);
+  u->sq_array = (uint32_t *)(sq + p.sq_off.array);
+  u->sq_mask = *(uint32_t *)(sq + p.sq_off.ring_mask);
+  u->sq_entries = p.sq_entries;
+  u->cq_head = (uint32_t *)(cq + p.cq_off.head);
+  u->cq_tail = (uint32_t *)(cq + p.cq_off.tail);
+  u->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+  u->cq_mask = *(uint32_t *)(cq + p.cq_off.ring_mask);
+  return 0;
+}
+
+/**
+ * Initialize an I/O engine.
+ *
+ * Sets up an io_uring with the given number of submission queue
+ * entries. If that fails, the engine falls back to epoll.
+ *
+ * \param u A pointer to the engine.
+ * \param s A pointer to the scheduler whose tasks perform I/O.
+ * \param entries The size of the submission queue, which is rounded
+ * up to a power of two. The completion queue is twice as large. Zero
+ * selects the epoll fallback.
+ *
+ * \return 0 on success, or -1 with errno set if neither io_uring nor
+ * epoll could be set up.
+ */
+static inline int
+pt_uring_init(struct pt_uring *u, struct pt_sched *s, uint32_t entries)
+{
+  u->ring_fd = -1;
+  u->to_submit = 0;
+  u->sq_ring = MAP_FAILED;
+  u->cq_ring = MAP_FAILED;
+  u->sqes = MAP_FAILED;
+  if(entries > 0 && pt_uring_setup(u, entries) == 0) {
+    u->io.sched = s;
+    u->io.epfd = -1;
+    return 0;
+  }
+  return pt_io_init(&u->io, s);
+}
+
+/**
+ * Release the resources of an I/O engine.
+ *
+ * \param u A pointer to the engine.
+ */
+static inline void
+pt_uring_close(struct pt_uring *u)
+{
+  if(pt_uring_available(u)) {
+    pt_uring_unmap(u);
+    close(u->ring_fd);
+  } else {
+    pt_io_close(&u->io);
+  }
+}
+
+/**
+ * Use a file descriptor with an I/O engine.
+ *
+ * The file descriptor must be in nonblocking mode if it is a socket
+ * or a pipe, so that the epoll fallback works. Regular files may be
+ * blocking.
+ *
+ * \param u A pointer to the engine.
+ * \param h A pointer to the handle of the file descriptor.
+ * \param fd The file descriptor.
+ *
+ * \return 0 on success, or -1 with errno set.
+ */
+static inline int
+pt_uring_add(struct pt_uring *u, struct pt_io_handle *h, int fd)
+{
+  if(pt_uring_available(u)) {
+    h->fd = fd;
+    h->ready = PT_IO_IN | PT_IO_OUT;
+    h->reader = NULL;
+    h->writer = NULL;
+    h->io = &u->io;
+    return 0;
+  }
+  /* epoll refuses regular files, which are always ready. */
+  if(pt_io_add(&u->io, h, fd) < 0 && errno != EPERM) {
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Stop using a file descriptor with an I/O engine.
+ *
+ * No request may be pending on the file descriptor.
+ *
+ * \param u A pointer to the engine.
+ * \param h A pointer to the handle of the file descriptor.
+ */
+static inline void
+pt_uring_del(struct pt_uring *u, struct pt_io_handle *h)
+{
+  if(!pt_uring_available(u)) {
+    pt_io_del(h);
+  }
+}
+
+static inline uint32_t
+pt_uring_complete(struct pt_uring *u)
+{
+  uint32_t head = *u->cq_head;
+  uint32_t tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+  uint32_t n = tail - head;
+
+  while(head != tail) {
+    struct io_uring_cqe *cqe = &u->cqes[head & u->cq_mask];
+    struct pt_io_handle *h =
+      (struct pt_io_handle *)(uintptr_t)(cqe->user_data & ~(uint64_t)1);
+    struct pt_task *t;
+
+    if(cqe->user_data & 1) {
+      h->nwritten = cqe->res;
+      t = h->writer;
+      h->writer = NULL;
+    } else {
+      h->nread = cqe->res;
+      t = h->reader;
+      h->reader = NULL;
+    }
+    pt_task_wake(t);
+    ++head;
+  }
+  __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+  return n;
+}
+
+/**
+ * Submit requests, harvest completions and wake the waiting tasks.
+ *
+ * Call this from the event loop after pt_sched_run(), with a timeout
+ * of zero if the scheduler still has runnable tasks. With the epoll
+ * fallback this calls pt_io_poll().
+ *
+ * \param u A pointer to the engine.
+ * \param timeout_ms The maximum time to wait for a completion in
+ * milliseconds, or -1 to wait until a request completes. Kernels
+ * without IORING_FEAT_EXT_ARG treat positive timeouts like -1.
+ *
+ * \return 0 or a positive number on success, or -1 with errno set.
+ */
+static inline int
+pt_uring_poll(struct pt_uring *u, int timeout_ms)
+{
+  uint32_t flags = 0;
+  uint32_t wait = 0;
+  void *arg = NULL;
+  size_t argsz = 0;
+  int ret = 0;
+#ifdef IORING_ENTER_EXT_ARG
+  struct __kernel_timespec ts;
+  struct io_uring_getevents_arg ext;
+#endif
+
+  if(!pt_uring_available(u)) {
+    return pt_io_poll(&u->io, timeout_ms);
+  }
+
+  if(timeout_ms != 0 &&
+     *u->cq_head == __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) {
+    flags = IORING_ENTER_GETEVENTS;
+    wait = 1;
+#ifdef IORING_ENTER_EXT_ARG
+    if(timeout_ms > 0 && (u->features & IORING_FEAT_EXT_ARG)) {
+      ts.tv_sec = timeout_ms / 1000;
+      ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+      memset(&ext, 0, sizeof(ext));
+      ext.ts = (uint64_t)(uintptr_t)&ts;
+      flags |= IORING_ENTER_EXT_ARG;
+      arg = &ext;
+      argsz = sizeof(ext);
+    }
+#endif
+  }
+  if(u->to_submit > 0 || wait) {
+    ret = pt_uring_enter(u, u->to_submit, wait, flags, arg, argsz);
+    if(ret >= 0) {
+      u->to_submit -= (uint32_t)ret;
+    } else if(errno == EINTR || errno == ETIME || errno == EBUSY) {
+      ret = 0;
+    }
+  }
+  pt_uring_complete(u);
+  return ret < 0 ? -1 : ret;
+}
+
+static inline int
+pt_uring_prep(struct pt_uring *u, struct pt_task *t, struct pt_io_handle *h,
+              uint8_t opcode, const void *buf, size_t len)
+{
+  uint32_t tail = *u->sq_tail;
+  struct io_uring_sqe *sqe;
+  int write = opcode == IORING_OP_WRITE;
+
+  /* Make room if the submission queue is full. */
+  while(tail - __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE) >=
+        u->sq_entries) {
+    int ret = pt_uring_enter(u, u->to_submit, 0, 0, NULL, 0);
+    if(ret > 0) {
+      u->to_submit -= (uint32_t)ret;
+      continue;
+    }
+    if(ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if(ret < 0 && errno != EBUSY && errno != EAGAIN) {
+      return -1;
+    }
+    /* The completion queue is full; harvest it, or give up if it is
+       empty and the kernel still takes nothing. */
+    if(pt_uring_complete(u) == 0) {
+      if(ret == 0) {
+        errno = EAGAIN;
+      }
+      return -1;
+    }
+  }
+
+  sqe = &u->sqes[tail & u->sq_mask];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = h->fd;
+  sqe->off = (uint64_t)-1;
+  sqe->addr = (uint64_t)(uintptr_t)buf;
+  sqe->len = (uint32_t)len;
+  sqe->user_data = (uint64_t)(uintptr_t)h | (uint64_t)write;
+  u->sq_array[tail & u->sq_mask] = tail & u->sq_mask;
+  __atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  ++u->to_submit;
+
+  if(write) {
+    h->writer = t;
+  } else {
+    h->reader = t;
+  }
+  return 0;
+}
+
+/*
+ * Queue a request. If the submission queue stays full, the request
+ * completes at once with -errno, which pt_uring_done() reports.
+ */
+static inline int
+pt_uring_start(struct pt_uring *u, struct pt_task *t, struct pt_io_handle *h,
+               uint8_t opcode, const void *buf, size_t len)
+{
+  if(pt_uring_available(u) &&
+     pt_uring_prep(u, t, h, opcode, buf, len) < 0) {
+    *(opcode == IORING_OP_WRITE ? &h->nwritten : &h->nread) = -errno;
+    return -1;
+  }
+  return 0;
+}
+
+static inline int
+pt_uring_done(struct pt_uring *u, struct pt_task *t, struct pt_io_handle *h,
+              uint8_t opcode, const void *buf, size_t len)
+{
+  int write = opcode == IORING_OP_WRITE;
+  ssize_t *res = write ? &h->nwritten : &h->nread;
+
+  if(pt_uring_available(u)) {
+    if((write ? h->writer : h->reader) != NULL) {
+      return 0;
+    }
+    if(*res < 0) {
+      errno = (int)-*res;
+      *res = -1;
+    }
+    return 1;
+  }
+
+  while(1) {
+    *res = write ? pt_io_write(h, buf, len) : pt_io_read(h, (void *)buf, len);
+    if(*res >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+      return 1;
+    }
+    if(!pt_io_ready(t, h, write ? PT_IO_OUT : PT_IO_IN)) {
+      return 0;
+    }
+  }
+}
+
+/**
+ * \name I/O requests for scheduled protothreads
+ *
+ * These macros take a pointer to the running struct pt_task. Each
+ * performs a single read or write at the current file position, like
+ * read() and write(), and may transfer fewer bytes than requested.
+ * At most one read and one write may be pending on each handle.
+ * @{
+ */
+
+/**
+ * Read from a file descriptor.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param u (struct pt_uring *) A pointer to the engine.
+ * \param h (struct pt_io_handle *) A pointer to the handle.
+ * \param buf A pointer to the buffer, which must stay valid while the
+ * task blocks.
+ * \param len (size_t) The size of the buffer.
+ * \param res (ssize_t) Set to the number of bytes read, zero at the
+ * end of file, or -1 with errno set on error.
+ *
+ * \hideinitializer
+ */
+#define PT_IO_READ(task, u, h, buf, len, res)				\
+  do {									\
+    pt_uring_start((u), (task), (h), IORING_OP_READ, (buf), (len));	\
+    PT_WAIT_UNTIL(&(task)->pt, pt_uring_done((u), (task), (h),		\
+                                             IORING_OP_READ,		\
+                                             (buf), (len)));		\
+    (res) = (h)->nread;							\
+  } while(0)
+
+/**
+ * Write to a file descriptor.
+ *
+ * \param task (struct pt_task *) A pointer to the running task.
+ * \param u (struct pt_uring *) A pointer to the engine.
+ * \param h (struct pt_io_handle *) A pointer to the handle.
+ * \param buf A pointer to the data, which must stay valid while the
+ * task blocks.
+ * \param len (size_t) The number of bytes to write.
+ * \param res (ssize_t) Set to the number of bytes written, or -1
+ * with errno set on error.
+ *
+ * \hideinitializer
+ */
+#define PT_IO_WRITE(task, u, h, buf, len, res)				\
+  do {									\
+    pt_uring_start((u), (task), (h), IORING_OP_WRITE, (buf), (len));	\
+    PT_WAIT_UNTIL(&(task)->pt, pt_uring_done((u), (task), (h),		\
+                                             IORING_OP_WRITE,		\
+                                             (buf), (len)));		\
+    (res) = (h)->nwritten;						\
+  } while(0)
+
+/** @} */
+
+/** @} */
+/** @} */
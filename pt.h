@@ -50,6 +50,13 @@
 
 #include "lc.h"
 
+#ifdef PT_STATS
+#include "pt-stats.h"
+#endif
+#ifdef PT_TRACE
+#include "pt-trace.h"
+#endif
+
 /**
  * Protothread control structure.
  *
@@ -62,8 +69,41 @@
  */
 struct pt {
   lc_t lc;
+#ifdef PT_STATS
+  struct pt_stats stats;
+#endif
 };
 
+/*
+ * Hooks for the statistics of pt-stats.h and the tracing of
+ * pt-trace.h. PT_HOOK_ENTER() is placed in the block opened by
+ * PT_BEGIN(), where PT_STATS_ENTER() declares the start time, and
+ * PT_HOOK_LEAVE() before each return from the protothread. Without
+ * PT_STATS and PT_TRACE they expand to nothing.
+ */
+#ifdef PT_STATS
+#define PT_STATS_ENTER(pt)						\
+  uint64_t PT_STATS_START = pt_stats_enter(&(pt)->stats, __func__);
+#define PT_STATS_LEAVE(pt, ret)						\
+  pt_stats_leave(&(pt)->stats, PT_STATS_START,				\
+                 (ret) == PT_WAITING, (ret) == PT_YIELDED)
+#else
+#define PT_STATS_ENTER(pt)
+#define PT_STATS_LEAVE(pt, ret)
+#endif
+
+#ifdef PT_TRACE
+#define PT_TRACE_ENTER(pt) pt_trace_record((pt), __func__, 0, PT_TRACE_RESUME);
+#define PT_TRACE_LEAVE(pt, ret) pt_trace_record((pt), __func__, __LINE__, (ret))
+#else
+#define PT_TRACE_ENTER(pt)
+#define PT_TRACE_LEAVE(pt, ret)
+#endif
+
+#define PT_HOOK_ENTER(pt) PT_STATS_ENTER(pt) PT_TRACE_ENTER(pt)
+#define PT_HOOK_LEAVE(pt, ret)						\
+  do { PT_STATS_LEAVE(pt, ret); PT_TRACE_LEAVE(pt, ret); } while(0)
+
 /**
  * \name Protothread status codes
  *
@@ -102,7 +142,31 @@ struct pt {
  *
  * \hideinitializer
  */
+#ifdef PT_STATS
+#define PT_INIT(pt)   do { LC_INIT((pt)->lc); pt_stats_reset(&(pt)->stats); } while(0)
+#else
 #define PT_INIT(pt)   LC_INIT((pt)->lc)
+#endif
+
+/**
+ * Initialize a protothread in memory that holds no protothread.
+ *
+ * Like PT_INIT(), but for a control structure in memory from malloc()
+ * or pt-pool.h that has not been initialized. With lc-coro.h,
+ * PT_INIT() frees the coroutine of a protothread that has not ended
+ * and so reads the control structure, and this macro does not; with
+ * the other implementations the two are the same.
+ *
+ * \param pt A pointer to the protothread control structure.
+ *
+ * \hideinitializer
+ */
+#ifdef PT_STATS
+#define PT_INIT_RAW(pt) \
+  do { LC_INIT_RAW((pt)->lc); pt_stats_reset(&(pt)->stats); } while(0)
+#else
+#define PT_INIT_RAW(pt) LC_INIT_RAW((pt)->lc)
+#endif
 
 /** @} */
 
@@ -124,6 +188,55 @@ struct pt {
  */
 #define PT_THREAD(name_args) char name_args
 
+/**
+ * Declare a protothread control structure with local variables.
+ *
+ * Protothreads do not preserve the stack, so a variable that must
+ * keep its value across a blocking statement cannot be an automatic
+ * variable of the protothread function. Declaring it static limits
+ * the function to a single instance. This macro instead declares a
+ * structure that holds the struct pt, as member pt, together with
+ * the variables, as member locals, so that every instance has its
+ * own copy in a single object. The variables are reached through the
+ * pointer that is passed to the protothread, at the same cost as
+ * any other structure member, and an array of instances keeps each
+ * instance's state contiguous.
+ *
+ \code
+typedef PT_LOCALS(struct {
+  int produced;
+}) producer_pt;
+
+static
+PT_THREAD(producer(producer_pt *self))
+{
+  PT_BEGIN(&self->pt);
+
+  for(self->locals.produced = 0;
+      self->locals.produced < NUM_ITEMS;
+      ++self->locals.produced) {
+    PT_SEM_WAIT(&self->pt, &full);
+    add_to_buffer(produce_item());
+    PT_SEM_SIGNAL(&self->pt, &empty);
+  }
+
+  PT_END(&self->pt);
+}
+
+static producer_pt producers[1000];
+ \endcode
+ *
+ * The struct pt is the first member, so a pointer to the structure
+ * may also be converted to and from a pointer to its struct pt.
+ *
+ * \param ... The type of the local variables, usually a structure.
+ * The macro is variadic, so the type may contain commas, as in
+ * struct { int a, b; }.
+ *
+ * \hideinitializer
+ */
+#define PT_LOCALS(...) struct { struct pt pt; __VA_ARGS__ locals; }
+
 /**
  * Declare the start of a protothread inside the C function
  * implementing the protothread.
@@ -137,7 +250,13 @@ struct pt {
  *
  * \hideinitializer
  */
-#define PT_BEGIN(pt) { char PT_YIELD_FLAG = 1; LC_RESUME((pt)->lc)
+#ifdef LC_CORO
+#define PT_BEGIN(pt) { PT_HOOK_ENTER(pt)				\
+    auto PT_CORO_BODY = [&]() -> lc_coro {
+#else
+#define PT_BEGIN(pt) { char PT_YIELD_FLAG = 1; PT_HOOK_ENTER(pt) \
+                     LC_RESUME((pt)->lc)
+#endif
 
 /**
  * Declare the end of a protothread.
@@ -149,8 +268,16 @@ struct pt {
  *
  * \hideinitializer
  */
+#ifdef LC_CORO
+#define PT_END(pt) co_return PT_ENDED; };				\
+    char PT_CORO_RET = lc_coro_enter((pt)->lc, PT_CORO_BODY);		\
+    PT_HOOK_LEAVE(pt, PT_CORO_RET);					\
+    return PT_CORO_RET; }
+#else
 #define PT_END(pt) LC_END((pt)->lc); PT_YIELD_FLAG = 0; \
-                   PT_INIT(pt); return PT_ENDED; }
+                   PT_HOOK_LEAVE(pt, PT_ENDED); LC_INIT((pt)->lc); \
+                   return PT_ENDED; }
+#endif
 
 /** @} */
 
@@ -170,13 +297,23 @@ struct pt {
  *
  * \hideinitializer
  */
+#ifdef LC_CORO
+#define PT_WAIT_UNTIL(pt, condition)		\
+  do {						\
+    while(!(condition)) {			\
+      co_yield PT_WAITING;			\
+    }						\
+  } while(0)
+#else
 #define PT_WAIT_UNTIL(pt, condition)	        \
   do {						\
     LC_SET((pt)->lc);				\
     if(!(condition)) {				\
+      PT_HOOK_LEAVE(pt, PT_WAITING);		\
       return PT_WAITING;			\
     }						\
   } while(0)
+#endif
 
 /**
  * Block and wait while condition is true.
@@ -251,11 +388,16 @@ struct pt {
  *
  * \hideinitializer
  */
+#ifdef LC_CORO
+#define PT_RESTART(pt) co_return PT_WAITING
+#else
 #define PT_RESTART(pt)				\
   do {						\
-    PT_INIT(pt);				\
+    PT_HOOK_LEAVE(pt, PT_WAITING);		\
+    LC_INIT((pt)->lc);				\
     return PT_WAITING;			\
   } while(0)
+#endif
 
 /**
  * Exit the protothread.
@@ -268,11 +410,16 @@ struct pt {
  *
  * \hideinitializer
  */
+#ifdef LC_CORO
+#define PT_EXIT(pt) co_return PT_EXITED
+#else
 #define PT_EXIT(pt)				\
   do {						\
-    PT_INIT(pt);				\
+    PT_HOOK_LEAVE(pt, PT_EXITED);		\
+    LC_INIT((pt)->lc);				\
     return PT_EXITED;			\
   } while(0)
+#endif
 
 /** @} */
 
@@ -312,14 +459,19 @@ struct pt {
  *
  * \hideinitializer
  */
+#ifdef LC_CORO
+#define PT_YIELD(pt) co_yield PT_YIELDED
+#else
 #define PT_YIELD(pt)				\
   do {						\
     PT_YIELD_FLAG = 0;				\
     LC_SET((pt)->lc);				\
     if(PT_YIELD_FLAG == 0) {			\
+      PT_HOOK_LEAVE(pt, PT_YIELDED);		\
       return PT_YIELDED;			\
     }						\
   } while(0)
+#endif
 
 /**
  * \brief      Yield from the protothread until a condition occurs.
@@ -332,14 +484,22 @@ struct pt {
  *
  * \hideinitializer
  */
+#ifdef LC_CORO
+#define PT_YIELD_UNTIL(pt, cond)		\
+  do {						\
+    co_yield PT_YIELDED;			\
+  } while(!(cond))
+#else
 #define PT_YIELD_UNTIL(pt, cond)		\
   do {						\
     PT_YIELD_FLAG = 0;				\
     LC_SET((pt)->lc);				\
     if((PT_YIELD_FLAG == 0) || !(cond)) {	\
+      PT_HOOK_LEAVE(pt, PT_YIELDED);		\
       return PT_YIELDED;			\
     }						\
   } while(0)
+#endif
 
 /** @} */
 
@@ -0,0 +1,280 @@
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+/* Count the blocks of frames and captures that are alive */
+static int live_blocks;
+
+static void *count_alloc(std::size_t size) {
+    live_blocks++;
+    return ::operator new(size);
+}
+
+static void count_free(void *p, std::size_t size) {
+    (void)size;
+    live_blocks--;
+    ::operator delete(p);
+}
+
+#define LC_CORO_ALLOC(size) count_alloc(size)
+#define LC_CORO_FREE(p, size) count_free((p), (size))
+
+#include "unity.h"
+#include "pt.h"
+#include "pt-sem.h"
+
+void setUp(void) { live_blocks = 0; }
+void tearDown(void) {}
+
+static int flag;
+static int step;
+
+/* Thread that waits for the flag, yields and ends */
+static PT_THREAD(thread_wait_yield(struct pt *pt)) {
+    PT_BEGIN(pt);
+    step = 1;
+    PT_WAIT_UNTIL(pt, flag);
+    step = 2;
+    PT_YIELD(pt);
+    step = 3;
+    PT_END(pt);
+}
+
+/* Thread that counts in a local variable */
+static PT_THREAD(thread_local_count(struct pt *pt, int *out)) {
+    PT_BEGIN(pt);
+    int count = 0;
+    while (count < 3) {
+        count++;
+        *out = count;
+        PT_YIELD(pt);
+    }
+    PT_END(pt);
+}
+
+/* Thread that waits for an argument, with a variable set before PT_BEGIN */
+static PT_THREAD(thread_wait_arg(struct pt *pt, int input, int *seen)) {
+    int doubled = 2 * input;
+    PT_BEGIN(pt);
+    while (1) {
+        PT_WAIT_UNTIL(pt, input == 3);
+        *seen = doubled;
+        input = 0;
+        PT_YIELD(pt);
+    }
+    PT_END(pt);
+}
+
+/* Thread that exits or restarts depending on the flag */
+static PT_THREAD(thread_exit_restart(struct pt *pt)) {
+    PT_BEGIN(pt);
+    step++;
+    PT_YIELD(pt);
+    if (flag) {
+        PT_EXIT(pt);
+    }
+    PT_RESTART(pt);
+    PT_END(pt);
+}
+
+/* Child that yields twice */
+static PT_THREAD(thread_child(struct pt *pt)) {
+    PT_BEGIN(pt);
+    PT_YIELD(pt);
+    PT_YIELD(pt);
+    PT_END(pt);
+}
+
+/* Parent that spawns the child, yielding inside a switch */
+static PT_THREAD(thread_parent(struct pt *pt, struct pt *child)) {
+    PT_BEGIN(pt);
+    PT_SPAWN(pt, child, thread_child(child));
+    switch (flag) {
+    case 1:
+        PT_YIELD(pt);
+        step = 10;
+        break;
+    default:
+        step = 20;
+        break;
+    }
+    PT_END(pt);
+}
+
+/* Thread that takes a semaphore */
+static PT_THREAD(thread_sem(struct pt *pt, struct pt_sem *sem)) {
+    PT_BEGIN(pt);
+    PT_SEM_WAIT(pt, sem);
+    step++;
+    PT_END(pt);
+}
+
+/* Test: Status codes and resume points match the C backends */
+void test_status_codes(void) {
+    struct pt pt;
+    flag = 0;
+    PT_INIT(&pt);
+    TEST_ASSERT_EQUAL_INT(PT_WAITING, thread_wait_yield(&pt));
+    TEST_ASSERT_EQUAL_INT(1, step);
+    TEST_ASSERT_EQUAL_INT(PT_WAITING, thread_wait_yield(&pt));
+    flag = 1;
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, thread_wait_yield(&pt));
+    TEST_ASSERT_EQUAL_INT(2, step);
+    TEST_ASSERT_EQUAL_INT(PT_ENDED, thread_wait_yield(&pt));
+    TEST_ASSERT_EQUAL_INT(3, step);
+    TEST_ASSERT_EQUAL_INT(0, live_blocks);
+
+    /* An ended protothread starts again */
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, thread_wait_yield(&pt));
+    TEST_ASSERT_EQUAL_INT(2, step);
+}
+
+/* Test: Local variables keep their values per instance */
+void test_locals(void) {
+    struct pt a, b;
+    int out_a = 0, out_b = 0;
+    PT_INIT(&a);
+    PT_INIT(&b);
+    thread_local_count(&a, &out_a);
+    thread_local_count(&a, &out_a);
+    thread_local_count(&b, &out_b);
+    TEST_ASSERT_EQUAL_INT(2, out_a);
+    TEST_ASSERT_EQUAL_INT(1, out_b);
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, thread_local_count(&a, &out_a));
+    TEST_ASSERT_EQUAL_INT(3, out_a);
+    TEST_ASSERT_EQUAL_INT(PT_ENDED, thread_local_count(&a, &out_a));
+    TEST_ASSERT_EQUAL_INT(1, out_b);
+}
+
+/* Test: Arguments and variables before PT_BEGIN have the values of each call */
+void test_arguments(void) {
+    struct pt pt;
+    int seen = 0;
+    PT_INIT(&pt);
+    TEST_ASSERT_EQUAL_INT(PT_WAITING, thread_wait_arg(&pt, 1, &seen));
+    TEST_ASSERT_EQUAL_INT(PT_WAITING, thread_wait_arg(&pt, 2, &seen));
+    TEST_ASSERT_EQUAL_INT(0, seen);
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, thread_wait_arg(&pt, 3, &seen));
+    TEST_ASSERT_EQUAL_INT(6, seen);
+    TEST_ASSERT_EQUAL_INT(PT_WAITING, thread_wait_arg(&pt, 4, &seen));
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, thread_wait_arg(&pt, 3, &seen));
+    lc_coro_reset(pt.lc);
+}
+
+/* Test: PT_EXIT ends the protothread and PT_RESTART starts it over */
+void test_exit_restart(void) {
+    struct pt pt;
+    PT_INIT(&pt);
+    step = 0;
+    flag = 0;
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, thread_exit_restart(&pt));
+    TEST_ASSERT_EQUAL_INT(PT_WAITING, thread_exit_restart(&pt));
+    TEST_ASSERT_EQUAL_INT(0, live_blocks);
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, thread_exit_restart(&pt));
+    TEST_ASSERT_EQUAL_INT(2, step);
+    flag = 1;
+    TEST_ASSERT_EQUAL_INT(PT_EXITED, thread_exit_restart(&pt));
+    TEST_ASSERT_EQUAL_INT(0, live_blocks);
+}
+
+/* Test: PT_SPAWN waits for a child and LC_SET works inside switch() */
+void test_spawn_switch(void) {
+    struct pt parent, child;
+    int calls = 0;
+    PT_INIT(&parent);
+    flag = 1;
+    step = 0;
+    while (PT_SCHEDULE(thread_parent(&parent, &child))) {
+        calls++;
+    }
+    TEST_ASSERT_EQUAL_INT(3, calls);
+    TEST_ASSERT_EQUAL_INT(10, step);
+    TEST_ASSERT_EQUAL_INT(0, live_blocks);
+}
+
+/* Test: lc_coro_reset and destruction free a suspended coroutine */
+void test_reset_frees(void) {
+    {
+        struct pt pt;
+        flag = 0;
+        PT_INIT(&pt);
+        thread_wait_yield(&pt);
+        TEST_ASSERT_EQUAL_INT(2, live_blocks);
+        lc_coro_reset(pt.lc);
+        TEST_ASSERT_EQUAL_INT(0, live_blocks);
+        TEST_ASSERT_EQUAL_INT(PT_WAITING, thread_wait_yield(&pt));
+        TEST_ASSERT_EQUAL_INT(2, live_blocks);
+    }
+    TEST_ASSERT_EQUAL_INT(0, live_blocks);
+}
+
+/* Test: PT_INIT starts a suspended protothread over and frees its coroutine */
+void test_init_restart(void) {
+    struct pt pt;
+    flag = 1;
+    PT_INIT(&pt);
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, thread_wait_yield(&pt));
+    TEST_ASSERT_EQUAL_INT(2, live_blocks);
+    PT_INIT(&pt);
+    TEST_ASSERT_EQUAL_INT(0, live_blocks);
+    step = 0;
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, thread_wait_yield(&pt));
+    TEST_ASSERT_EQUAL_INT(2, step);
+    TEST_ASSERT_EQUAL_INT(PT_ENDED, thread_wait_yield(&pt));
+    TEST_ASSERT_EQUAL_INT(0, live_blocks);
+}
+
+/* Test: PT_INIT_RAW works on memory that was not constructed */
+void test_init_raw(void) {
+    struct pt *pt = static_cast<struct pt *>(std::malloc(sizeof(*pt)));
+    std::memset(static_cast<void *>(pt), 0xa5, sizeof(*pt));
+    flag = 1;
+    PT_INIT_RAW(pt);
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, thread_wait_yield(pt));
+    TEST_ASSERT_EQUAL_INT(PT_ENDED, thread_wait_yield(pt));
+    TEST_ASSERT_EQUAL_INT(0, live_blocks);
+    std::free(pt);
+}
+
+/* Test: Headers built on pt.h work unchanged */
+void test_semaphore(void) {
+    struct pt a, b;
+    struct pt_sem sem;
+    PT_SEM_INIT(&sem, 1);
+    PT_INIT(&a);
+    PT_INIT(&b);
+    step = 0;
+    TEST_ASSERT_EQUAL_INT(PT_ENDED, thread_sem(&a, &sem));
+    TEST_ASSERT_EQUAL_INT(PT_WAITING, thread_sem(&b, &sem));
+    PT_SEM_SIGNAL(&a, &sem);
+    TEST_ASSERT_EQUAL_INT(PT_ENDED, thread_sem(&b, &sem));
+    TEST_ASSERT_EQUAL_INT(2, step);
+}
+
+/* Test: The pool reuses freed blocks of the same size class */
+void test_pool_reuse(void) {
+    void *a = lc_coro_pool_alloc(100);
+    void *b;
+    lc_coro_pool_free(a, 100);
+    b = lc_coro_pool_alloc(112);
+    TEST_ASSERT_EQUAL_PTR(a, b);
+    lc_coro_pool_free(b, 112);
+    b = lc_coro_pool_alloc(113);
+    TEST_ASSERT_NOT_EQUAL(a, b);
+    lc_coro_pool_free(b, 113);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_status_codes);
+    RUN_TEST(test_locals);
+    RUN_TEST(test_arguments);
+    RUN_TEST(test_exit_restart);
+    RUN_TEST(test_spawn_switch);
+    RUN_TEST(test_reset_frees);
+    RUN_TEST(test_init_restart);
+    RUN_TEST(test_init_raw);
+    RUN_TEST(test_semaphore);
+    RUN_TEST(test_pool_reuse);
+    return UNITY_END();
+}
@@ -0,0 +1,130 @@
+#include "unity.h"
+#include "protothreads.hpp"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static int flag;
+
+/* Thread that counts to three in its locals, yielding each time */
+struct counter : protothreads::thread<counter, int> {
+    char body() {
+        PT_BEGIN(pt());
+        for (locals() = 1; locals() <= 3; ++locals()) {
+            PT_YIELD(pt());
+        }
+        PT_END(pt());
+    }
+};
+
+/* Thread that records its id when it runs, waits for the flag, then exits */
+static int order[8];
+static int norder;
+
+struct waiter : protothreads::thread<waiter> {
+    int id = 0;
+    char body() {
+        PT_BEGIN(pt());
+        order[norder++] = id;
+        PT_WAIT_UNTIL(pt(), flag);
+        order[norder++] = id;
+        PT_EXIT(pt());
+        PT_END(pt());
+    }
+};
+
+/* Thread that waits for the flag */
+struct flag_waiter : protothreads::thread<flag_waiter> {
+    char body() {
+        PT_BEGIN(pt());
+        PT_WAIT_UNTIL(pt(), flag);
+        PT_END(pt());
+    }
+};
+
+/* Test: A thread runs through run() and keeps its locals */
+void test_run_locals(void) {
+    counter c;
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, c.run());
+    TEST_ASSERT_EQUAL_INT(1, c.locals());
+    TEST_ASSERT_TRUE(c.schedule());
+    TEST_ASSERT_TRUE(c.schedule());
+    TEST_ASSERT_EQUAL_INT(3, c.locals());
+    TEST_ASSERT_FALSE(c.schedule());
+
+    c.restart();
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, c.run());
+    TEST_ASSERT_EQUAL_INT(1, c.locals());
+}
+
+/* Test: restart() and spawn() start a suspended thread over */
+void test_restart_suspended(void) {
+    counter c;
+    protothreads::scheduler<counter> s;
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, c.run());
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, c.run());
+    TEST_ASSERT_EQUAL_INT(2, c.locals());
+
+    c.restart();
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, c.run());
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, c.run());
+    TEST_ASSERT_EQUAL_INT(2, c.locals());
+
+    s.spawn(c);
+    TEST_ASSERT_EQUAL_INT(PT_YIELDED, s.run_one());
+    TEST_ASSERT_EQUAL_INT(1, c.locals());
+}
+
+/* Test: The scheduler runs in FIFO order and parks waiting threads */
+void test_scheduler(void) {
+    protothreads::scheduler<waiter> s;
+    waiter w[3];
+    int i;
+    flag = 0;
+    norder = 0;
+    for (i = 0; i < 3; i++) {
+        w[i].id = i + 1;
+        s.spawn(w[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, s.run());
+    TEST_ASSERT_TRUE(s.idle());
+    TEST_ASSERT_EQUAL_INT(PT_ENDED, s.run_one());
+
+    flag = 1;
+    s.wake(w[2]);
+    s.wake(w[0]);
+    s.wake(w[0]);
+    TEST_ASSERT_EQUAL_INT(PT_EXITED, s.run_one());
+    TEST_ASSERT_EQUAL_UINT32(1, s.run());
+    TEST_ASSERT_TRUE(s.idle());
+    TEST_ASSERT_EQUAL_INT(5, norder);
+    TEST_ASSERT_EQUAL_INT(1, order[0]);
+    TEST_ASSERT_EQUAL_INT(2, order[1]);
+    TEST_ASSERT_EQUAL_INT(3, order[2]);
+    TEST_ASSERT_EQUAL_INT(3, order[3]);
+    TEST_ASSERT_EQUAL_INT(1, order[4]);
+}
+
+/* Test: schedule() runs threads of different types once each */
+void test_schedule_set(void) {
+    counter c;
+    flag_waiter f;
+    int calls = 0;
+    flag = 0;
+    while (protothreads::schedule(c, f)) {
+        if (++calls == 3) {
+            flag = 1;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(3, calls);
+    TEST_ASSERT_EQUAL_INT(4, c.locals());
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_run_locals);
+    RUN_TEST(test_restart_suspended);
+    RUN_TEST(test_scheduler);
+    RUN_TEST(test_schedule_set);
+    return UNITY_END();
+}
@@ -0,0 +1,19 @@
+/*
+ * Must fail to compile: with lc-switch.h, protothreads.hpp rejects a
+ * resume point whose line number does not fit in lc_t.
+ */
+#include "protothreads.hpp"
+
+struct too_far : protothreads::thread<too_far> {
+    char body() {
+        PT_BEGIN(pt());
+#line 70000
+        PT_YIELD(pt());
+        PT_END(pt());
+    }
+};
+
+int main(void) {
+    too_far t;
+    return t.run();
+}
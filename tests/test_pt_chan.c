@@ -0,0 +1,275 @@
+#include "unity.h"
+#include "pt-chan.h"
+#include "pt-sched.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static PT_CHAN(int, 8) chan;
+static int sent_count;
+static int recv_items[64];
+static int recv_count;
+
+static PT_THREAD(producer(struct pt *pt, int n)) {
+    PT_BEGIN(pt);
+    for (sent_count = 0; sent_count < n; ++sent_count) {
+        PT_CHAN_SEND(pt, &chan, sent_count);
+    }
+    PT_END(pt);
+}
+
+static PT_THREAD(consumer(struct pt *pt, int n)) {
+    PT_BEGIN(pt);
+    for (recv_count = 0; recv_count < n; ++recv_count) {
+        PT_CHAN_RECV(pt, &chan, &recv_items[recv_count]);
+    }
+    PT_END(pt);
+}
+
+/* Test: Channel capacity is taken from the declaration */
+void test_chan_size(void) {
+    PT_CHAN(double, 4096) big;
+    TEST_ASSERT_EQUAL_UINT32(8, PT_CHAN_SIZE(&chan));
+    TEST_ASSERT_EQUAL_UINT32(4096, PT_CHAN_SIZE(&big));
+    TEST_ASSERT_EQUAL_INT(0, (int)((uintptr_t)&chan.ring.tail % PT_CHAN_CACHE_LINE));
+    TEST_ASSERT_TRUE((char *)&chan.ring.tail - (char *)&chan.ring.head >= PT_CHAN_CACHE_LINE);
+}
+
+/* Test: Producer blocks when the channel is full */
+void test_send_blocks_when_full(void) {
+    struct pt pt;
+    PT_CHAN_INIT(&chan);
+    PT_INIT(&pt);
+
+    TEST_ASSERT_EQUAL(PT_WAITING, producer(&pt, 20));
+    TEST_ASSERT_EQUAL_INT(8, sent_count);
+    TEST_ASSERT_EQUAL(PT_WAITING, producer(&pt, 20));
+    TEST_ASSERT_EQUAL_INT(8, sent_count);
+}
+
+/* Test: Consumer blocks when the channel is empty */
+void test_recv_blocks_when_empty(void) {
+    struct pt pt;
+    int item;
+    PT_CHAN_INIT(&chan);
+    PT_INIT(&pt);
+
+    TEST_ASSERT_EQUAL(PT_WAITING, consumer(&pt, 1));
+    TEST_ASSERT_EQUAL_INT(0, recv_count);
+    TEST_ASSERT_FALSE(pt_chan_try_recv(&chan, &item));
+
+    TEST_ASSERT_TRUE(pt_chan_try_send(&chan, 42));
+    TEST_ASSERT_EQUAL(PT_ENDED, consumer(&pt, 1));
+    TEST_ASSERT_EQUAL_INT(42, recv_items[0]);
+}
+
+/* Test: Items arrive in order across many wraparounds */
+void test_fifo_order(void) {
+    struct pt pt_producer, pt_consumer;
+    int i, rounds = 0;
+    int producing = 1, consuming = 1;
+    PT_CHAN_INIT(&chan);
+    PT_INIT(&pt_producer);
+    PT_INIT(&pt_consumer);
+
+    while (producing || consuming) {
+        producing = producing && PT_SCHEDULE(producer(&pt_producer, 64));
+        consuming = consuming && PT_SCHEDULE(consumer(&pt_consumer, 64));
+        rounds++;
+    }
+    TEST_ASSERT_EQUAL_INT(64, recv_count);
+    TEST_ASSERT_TRUE(rounds >= 64 / 8);
+    for (i = 0; i < 64; i++) {
+        TEST_ASSERT_EQUAL_INT(i, recv_items[i]);
+    }
+}
+
+/* Test: Batches move as many items as fit and wrap around the ring */
+void test_batches(void) {
+    static const int in[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+    int out[12];
+    uint32_t n;
+
+    PT_CHAN_INIT(&chan);
+    TEST_ASSERT_EQUAL_UINT32(5, pt_chan_copy_in(&chan.ring, chan.buf, sizeof(int), 8, in, 5));
+    TEST_ASSERT_EQUAL_UINT32(3, pt_chan_copy_out(&chan.ring, chan.buf, sizeof(int), 8, out, 3));
+
+    /* 6 free slots, wrapping at the end of the buffer */
+    n = pt_chan_copy_in(&chan.ring, chan.buf, sizeof(int), 8, in + 5, 7);
+    TEST_ASSERT_EQUAL_UINT32(6, n);
+    n = pt_chan_copy_out(&chan.ring, chan.buf, sizeof(int), 8, out + 3, 9);
+    TEST_ASSERT_EQUAL_UINT32(8, n);
+    TEST_ASSERT_EQUAL_INT_ARRAY(in, out, 11);
+}
+
+static const int *batch_in;
+static int batch_out[100];
+static uint32_t batch_sent, batch_received, batch_n;
+
+static PT_THREAD(batch_producer(struct pt *pt)) {
+    PT_BEGIN(pt);
+    while (batch_sent < 100) {
+        PT_CHAN_SEND_BATCH(pt, &chan, batch_in + batch_sent, 100 - batch_sent, batch_n);
+        batch_sent += batch_n;
+    }
+    PT_END(pt);
+}
+
+static PT_THREAD(batch_consumer(struct pt *pt)) {
+    PT_BEGIN(pt);
+    while (batch_received < 100) {
+        PT_CHAN_RECV_BATCH(pt, &chan, batch_out + batch_received, 3, batch_n);
+        batch_received += batch_n;
+    }
+    PT_END(pt);
+}
+
+/* Test: Batch macros block on full and empty channels */
+void test_batch_macros(void) {
+    static int in[100];
+    struct pt pt_producer, pt_consumer;
+    int producing = 1, consuming = 1;
+    int i;
+    for (i = 0; i < 100; i++) {
+        in[i] = i * 3;
+    }
+    batch_in = in;
+    batch_sent = batch_received = 0;
+    PT_CHAN_INIT(&chan);
+    PT_INIT(&pt_producer);
+    PT_INIT(&pt_consumer);
+
+    TEST_ASSERT_EQUAL(PT_WAITING, batch_consumer(&pt_consumer));
+    TEST_ASSERT_EQUAL(PT_WAITING, batch_producer(&pt_producer));
+    TEST_ASSERT_EQUAL_UINT32(8, batch_sent);
+
+    while (producing || consuming) {
+        producing = producing && PT_SCHEDULE(batch_producer(&pt_producer));
+        consuming = consuming && PT_SCHEDULE(batch_consumer(&pt_consumer));
+    }
+    TEST_ASSERT_EQUAL_INT_ARRAY(in, batch_out, 100);
+}
+
+/* Producer and consumer tasks under the scheduler */
+static int task_sent, task_received, task_sum;
+
+static PT_THREAD(task_producer(struct pt_task *t)) {
+    PT_BEGIN(&t->pt);
+    for (task_sent = 1; task_sent <= 50; ++task_sent) {
+        PT_CHAN_SEND(&t->pt, &chan, task_sent);
+    }
+    PT_END(&t->pt);
+}
+
+static PT_THREAD(task_consumer(struct pt_task *t)) {
+    static int item;
+    PT_BEGIN(&t->pt);
+    for (task_received = 0; task_received < 50; ++task_received) {
+        PT_CHAN_RECV(&t->pt, &chan, &item);
+        task_sum += item;
+    }
+    PT_END(&t->pt);
+}
+
+static void wake_task(struct pt *pt) {
+    pt_task_wake((struct pt_task *)pt);
+}
+
+/* Test: Tasks that block on a channel with a wake function are woken */
+void test_sched_wake(void) {
+    struct pt_sched s;
+    struct pt_task consumer_task, producer_task;
+    int passes = 0;
+    PT_CHAN_INIT_WAKE(&chan, wake_task);
+    pt_sched_init(&s);
+    task_sum = 0;
+
+    /* The consumer parks on the empty channel */
+    pt_sched_spawn(&s, &consumer_task, task_consumer);
+    pt_sched_run(&s);
+    TEST_ASSERT_TRUE(pt_sched_idle(&s));
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_PARKED, consumer_task.state);
+
+    pt_sched_spawn(&s, &producer_task, task_producer);
+    while (!pt_sched_idle(&s) && passes++ < 1000) {
+        pt_sched_run(&s);
+    }
+    TEST_ASSERT_EQUAL_INT(50, task_received);
+    TEST_ASSERT_EQUAL_INT(50 * 51 / 2, task_sum);
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_IDLE, producer_task.state);
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_IDLE, consumer_task.state);
+}
+
+/* Producer and consumer protothreads on different OS threads */
+#define THREAD_ITEMS 200000
+static PT_CHAN(uint32_t, 64) tchan;
+static uint64_t thread_sum;
+
+static PT_THREAD(thread_producer(struct pt *pt, uint32_t *i)) {
+    PT_BEGIN(pt);
+    for (*i = 1; *i <= THREAD_ITEMS; ++*i) {
+        PT_CHAN_SEND(pt, &tchan, *i);
+    }
+    PT_END(pt);
+}
+
+static void *producer_main(void *arg) {
+    struct pt pt;
+    uint32_t i;
+    (void)arg;
+    PT_INIT(&pt);
+    while (PT_SCHEDULE(thread_producer(&pt, &i))) {
+        sched_yield();
+    }
+    return NULL;
+}
+
+static PT_THREAD(thread_consumer(struct pt *pt, uint32_t *n)) {
+    static uint32_t items[16];
+    static uint32_t got, k;
+    PT_BEGIN(pt);
+    while (*n < THREAD_ITEMS) {
+        PT_CHAN_RECV_BATCH(pt, &tchan, items, 16, got);
+        for (k = 0; k < got; k++) {
+            TEST_ASSERT_EQUAL_UINT32(*n + 1, items[k]);
+            thread_sum += items[k];
+            ++*n;
+        }
+    }
+    PT_END(pt);
+}
+
+/* Test: The channel is safe across OS threads */
+void test_cross_thread(void) {
+    pthread_t producer_thread;
+    struct pt pt;
+    uint32_t n = 0;
+    PT_CHAN_INIT(&tchan);
+    PT_INIT(&pt);
+    thread_sum = 0;
+
+    pthread_create(&producer_thread, NULL, producer_main, NULL);
+    while (PT_SCHEDULE(thread_consumer(&pt, &n))) {
+        sched_yield();
+    }
+    pthread_join(producer_thread, NULL);
+
+    TEST_ASSERT_EQUAL_UINT32(THREAD_ITEMS, n);
+    TEST_ASSERT_TRUE(thread_sum == (uint64_t)THREAD_ITEMS * (THREAD_ITEMS + 1) / 2);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_chan_size);
+    RUN_TEST(test_send_blocks_when_full);
+    RUN_TEST(test_recv_blocks_when_empty);
+    RUN_TEST(test_fifo_order);
+    RUN_TEST(test_batches);
+    RUN_TEST(test_batch_macros);
+    RUN_TEST(test_sched_wake);
+    RUN_TEST(test_cross_thread);
+    return UNITY_END();
+}
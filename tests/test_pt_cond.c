@@ -0,0 +1,250 @@
+#include "unity.h"
+#include "pt-cond.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static struct pt_cond cond;
+static struct pt_mutex mutex;
+static int ready;
+
+struct cond_task {
+    struct pt_task task;
+    int id;
+    int runs;
+    int done;
+};
+
+static int order[8], order_len;
+
+/* Thread that waits on the condition variable once */
+static PT_THREAD(thread_waits(struct pt_task *t)) {
+    struct cond_task *ct = (struct cond_task *)t;
+    ct->runs++;
+    PT_BEGIN(&t->pt);
+    PT_COND_WAIT(t, &cond);
+    ct->done = 1;
+    order[order_len++] = ct->id;
+    PT_END(&t->pt);
+}
+
+/* Thread that waits on the condition variable until ready is set */
+static PT_THREAD(thread_waits_until(struct pt_task *t)) {
+    struct cond_task *ct = (struct cond_task *)t;
+    ct->runs++;
+    PT_BEGIN(&t->pt);
+    PT_COND_WAIT_UNTIL(t, &cond, ready);
+    ct->done = 1;
+    PT_END(&t->pt);
+}
+
+/* Thread that waits for ready while holding the mutex */
+static PT_THREAD(thread_waits_mutex(struct pt_task *t)) {
+    struct cond_task *ct = (struct cond_task *)t;
+    ct->runs++;
+    PT_BEGIN(&t->pt);
+    PT_MUTEX_LOCK(t, &mutex);
+    while (!ready) {
+        PT_COND_WAIT_MUTEX(t, &cond, &mutex);
+    }
+    TEST_ASSERT_EQUAL_PTR(t, pt_mutex_owner(&mutex));
+    ct->done = 1;
+    PT_MUTEX_UNLOCK(t, &mutex);
+    PT_END(&t->pt);
+}
+
+/* Thread that sets ready under the mutex, signals and holds the mutex for a yield */
+static PT_THREAD(thread_sets_ready(struct pt_task *t)) {
+    PT_BEGIN(&t->pt);
+    PT_MUTEX_LOCK(t, &mutex);
+    ready = 1;
+    pt_cond_signal(&cond);
+    PT_YIELD(&t->pt);
+    PT_MUTEX_UNLOCK(t, &mutex);
+    PT_END(&t->pt);
+}
+
+static void spawn_waiters(struct pt_sched *s, struct cond_task *ct, int n,
+                          pt_task_fn fn) {
+    int i;
+    for (i = 0; i < n; i++) {
+        ct[i] = (struct cond_task){0};
+        ct[i].id = i;
+        pt_sched_spawn(s, &ct[i].task, fn);
+    }
+}
+
+static void run_all(struct pt_sched *s) {
+    int passes = 0;
+    while (!pt_sched_idle(s) && passes++ < 100) {
+        pt_sched_run(s);
+    }
+}
+
+/* Test: PT_COND_INIT leaves no waiters */
+void test_cond_init(void) {
+    PT_COND_INIT(&cond);
+    TEST_ASSERT_EQUAL_UINT32(0, pt_cond_waiters(&cond));
+    TEST_ASSERT_NULL(pt_cond_signal(&cond));
+    TEST_ASSERT_EQUAL_UINT32(0, pt_cond_broadcast(&cond));
+}
+
+/* Test: Waiters block and are not polled */
+void test_cond_wait_blocks(void) {
+    struct pt_sched s;
+    struct cond_task ct[3];
+    int i;
+    pt_sched_init(&s);
+    PT_COND_INIT(&cond);
+    spawn_waiters(&s, ct, 3, thread_waits);
+
+    for (i = 0; i < 5; i++) {
+        pt_sched_run(&s);
+    }
+    TEST_ASSERT_TRUE(pt_sched_idle(&s));
+    TEST_ASSERT_EQUAL_UINT32(3, pt_cond_waiters(&cond));
+    for (i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_INT(1, ct[i].runs);
+        TEST_ASSERT_EQUAL_UINT8(PT_TASK_BLOCKED, ct[i].task.state);
+    }
+}
+
+/* Test: Signal wakes the waiters one at a time in FIFO order */
+void test_cond_signal_fifo(void) {
+    struct pt_sched s;
+    struct cond_task ct[3];
+    int i;
+    pt_sched_init(&s);
+    PT_COND_INIT(&cond);
+    order_len = 0;
+    spawn_waiters(&s, ct, 3, thread_waits);
+    pt_sched_run(&s);
+
+    for (i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_PTR(&ct[i].task, pt_cond_signal(&cond));
+        TEST_ASSERT_EQUAL_UINT32(1, pt_sched_run(&s));
+        TEST_ASSERT_EQUAL_INT(i + 1, order_len);
+        TEST_ASSERT_EQUAL_INT(i, order[i]);
+    }
+    TEST_ASSERT_NULL(pt_cond_signal(&cond));
+}
+
+/* Test: Broadcast wakes every waiter in one pass, in FIFO order */
+void test_cond_broadcast(void) {
+    struct pt_sched s;
+    struct cond_task ct[4];
+    int i;
+    pt_sched_init(&s);
+    PT_COND_INIT(&cond);
+    order_len = 0;
+    spawn_waiters(&s, ct, 4, thread_waits);
+    pt_sched_run(&s);
+
+    TEST_ASSERT_EQUAL_UINT32(4, pt_cond_broadcast(&cond));
+    TEST_ASSERT_EQUAL_UINT32(0, pt_cond_waiters(&cond));
+    TEST_ASSERT_EQUAL_UINT32(4, pt_sched_run(&s));
+    TEST_ASSERT_TRUE(pt_sched_idle(&s));
+    for (i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_INT(1, ct[i].done);
+        TEST_ASSERT_EQUAL_INT(i, order[i]);
+    }
+}
+
+/* Test: Broadcast wakes waiters of different priorities */
+void test_cond_broadcast_priorities(void) {
+    struct pt_sched s;
+    struct cond_task ct[2];
+    pt_sched_init(&s);
+    PT_COND_INIT(&cond);
+    order_len = 0;
+    ct[0] = (struct cond_task){0};
+    ct[1] = (struct cond_task){0};
+    ct[0].id = 0;
+    ct[1].id = 1;
+    pt_sched_spawn_prio(&s, &ct[0].task, thread_waits, PT_SCHED_DEFAULT_PRIO);
+    pt_sched_spawn_prio(&s, &ct[1].task, thread_waits, 0);
+    pt_sched_run(&s);
+
+    TEST_ASSERT_EQUAL_UINT32(2, pt_cond_broadcast(&cond));
+    run_all(&s);
+    TEST_ASSERT_EQUAL_INT(2, order_len);
+    TEST_ASSERT_EQUAL_INT(1, order[0]);
+    TEST_ASSERT_EQUAL_INT(0, order[1]);
+}
+
+/* Test: PT_COND_WAIT_UNTIL waits again after a wakeup while the condition is false */
+void test_cond_wait_until(void) {
+    struct pt_sched s;
+    struct cond_task ct[1];
+    pt_sched_init(&s);
+    PT_COND_INIT(&cond);
+    ready = 0;
+    spawn_waiters(&s, ct, 1, thread_waits_until);
+    pt_sched_run(&s);
+
+    pt_cond_broadcast(&cond);
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_INT(0, ct[0].done);
+    TEST_ASSERT_EQUAL_UINT32(1, pt_cond_waiters(&cond));
+
+    ready = 1;
+    pt_cond_broadcast(&cond);
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_INT(1, ct[0].done);
+    TEST_ASSERT_EQUAL_INT(3, ct[0].runs);
+}
+
+/* Test: PT_COND_WAIT_UNTIL does not wait when the condition is true */
+void test_cond_wait_until_true(void) {
+    struct pt_sched s;
+    struct cond_task ct[1];
+    pt_sched_init(&s);
+    PT_COND_INIT(&cond);
+    ready = 1;
+    spawn_waiters(&s, ct, 1, thread_waits_until);
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_INT(1, ct[0].done);
+    TEST_ASSERT_EQUAL_UINT32(0, pt_cond_waiters(&cond));
+}
+
+/* Test: PT_COND_WAIT_MUTEX unlocks the mutex while waiting and locks it again */
+void test_cond_wait_mutex(void) {
+    struct pt_sched s;
+    struct cond_task ct[1];
+    struct pt_task setter;
+    pt_sched_init(&s);
+    PT_COND_INIT(&cond);
+    PT_MUTEX_INIT(&mutex);
+    ready = 0;
+    spawn_waiters(&s, ct, 1, thread_waits_mutex);
+    pt_sched_run(&s);
+    TEST_ASSERT_NULL(pt_mutex_owner(&mutex));
+    TEST_ASSERT_EQUAL_UINT32(1, pt_cond_waiters(&cond));
+
+    /* The setter signals while it holds the mutex, so the waiter queues for it
+       and gets it when the setter unlocks */
+    pt_sched_spawn(&s, &setter, thread_sets_ready);
+    pt_sched_run(&s);
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_INT(0, ct[0].done);
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_READY, ct[0].task.state);
+    TEST_ASSERT_EQUAL_PTR(&ct[0].task, pt_mutex_owner(&mutex));
+
+    run_all(&s);
+    TEST_ASSERT_EQUAL_INT(1, ct[0].done);
+    TEST_ASSERT_EQUAL_INT(3, ct[0].runs);
+    TEST_ASSERT_NULL(pt_mutex_owner(&mutex));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_cond_init);
+    RUN_TEST(test_cond_wait_blocks);
+    RUN_TEST(test_cond_signal_fifo);
+    RUN_TEST(test_cond_broadcast);
+    RUN_TEST(test_cond_broadcast_priorities);
+    RUN_TEST(test_cond_wait_until);
+    RUN_TEST(test_cond_wait_until_true);
+    RUN_TEST(test_cond_wait_mutex);
+    return UNITY_END();
+}
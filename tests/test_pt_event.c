@@ -0,0 +1,252 @@
+#include "unity.h"
+#include "pt-event.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static struct pt_event ev;
+
+struct ev_task {
+    struct pt_task task;
+    pt_event_flags_t mask;
+    int runs;
+    int done;
+};
+
+/* Thread that waits until any flag of its mask is set */
+static PT_THREAD(thread_any(struct pt_task *t)) {
+    struct ev_task *et = (struct ev_task *)t;
+    et->runs++;
+    PT_BEGIN(&t->pt);
+    PT_EVENT_WAIT_ANY(t, &ev, et->mask);
+    TEST_ASSERT_TRUE(pt_event_get(&ev) & et->mask);
+    et->done = 1;
+    PT_END(&t->pt);
+}
+
+/* Thread that waits until every flag of its mask is set */
+static PT_THREAD(thread_all(struct pt_task *t)) {
+    struct ev_task *et = (struct ev_task *)t;
+    et->runs++;
+    PT_BEGIN(&t->pt);
+    PT_EVENT_WAIT_ALL(t, &ev, et->mask);
+    TEST_ASSERT_EQUAL_HEX32(et->mask, pt_event_get(&ev) & et->mask);
+    et->done = 1;
+    PT_END(&t->pt);
+}
+
+static void spawn(struct pt_sched *s, struct ev_task *et, pt_event_flags_t mask,
+                  pt_task_fn fn) {
+    *et = (struct ev_task){0};
+    et->mask = mask;
+    pt_sched_spawn(s, &et->task, fn);
+}
+
+static void run_all(struct pt_sched *s) {
+    int passes = 0;
+    while (!pt_sched_idle(s) && passes++ < 100) {
+        pt_sched_run(s);
+    }
+}
+
+/* Test: pt_event_init sets the initial flags; set and clear change them */
+void test_event_set_clear(void) {
+    pt_event_init(&ev, 0x5);
+    TEST_ASSERT_EQUAL_HEX32(0x5, pt_event_get(&ev));
+    pt_event_set(&ev, 0x12);
+    TEST_ASSERT_EQUAL_HEX32(0x17, pt_event_get(&ev));
+    pt_event_clear(&ev, 0x3);
+    TEST_ASSERT_EQUAL_HEX32(0x14, pt_event_get(&ev));
+}
+
+/* Test: A waiter continues at once if its condition is already true */
+void test_event_no_wait(void) {
+    struct pt_sched s;
+    struct ev_task a, b;
+    pt_sched_init(&s);
+    pt_event_init(&ev, 0x6);
+    spawn(&s, &a, 0x4 | 0x8, thread_any);
+    spawn(&s, &b, 0x2 | 0x4, thread_all);
+
+    run_all(&s);
+    TEST_ASSERT_EQUAL_INT(1, a.done);
+    TEST_ASSERT_EQUAL_INT(1, b.done);
+    TEST_ASSERT_EQUAL_UINT32(0, ev.used);
+}
+
+/* Test: WAIT_ANY wakes on any flag of the mask */
+void test_event_wait_any(void) {
+    struct pt_sched s;
+    struct ev_task a;
+    pt_sched_init(&s);
+    pt_event_init(&ev, 0);
+    spawn(&s, &a, 0x1 | 0x2 | 0x4, thread_any);
+
+    run_all(&s);
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_BLOCKED, a.task.state);
+    TEST_ASSERT_EQUAL_HEX32(0x7, ev.watched);
+
+    pt_event_set(&ev, 0x2);
+    TEST_ASSERT_EQUAL_UINT32(1, pt_sched_run(&s));
+    TEST_ASSERT_EQUAL_INT(1, a.done);
+    TEST_ASSERT_EQUAL_INT(2, a.runs);
+    TEST_ASSERT_EQUAL_HEX32(0, ev.watched);
+}
+
+/* Test: WAIT_ALL wakes only when the last flag of the mask is set */
+void test_event_wait_all(void) {
+    struct pt_sched s;
+    struct ev_task a;
+    pt_sched_init(&s);
+    pt_event_init(&ev, 0);
+    spawn(&s, &a, 0x1 | 0x2 | 0x4, thread_all);
+
+    run_all(&s);
+    pt_event_set(&ev, 0x1);
+    pt_event_set(&ev, 0x4);
+    TEST_ASSERT_TRUE(pt_sched_idle(&s));
+    TEST_ASSERT_EQUAL_INT(1, a.runs);
+
+    pt_event_set(&ev, 0x2);
+    run_all(&s);
+    TEST_ASSERT_EQUAL_INT(1, a.done);
+    TEST_ASSERT_EQUAL_INT(2, a.runs);
+}
+
+/* Test: Setting a flag wakes only the waiters whose condition became true */
+void test_event_wakes_only_matching(void) {
+    struct pt_sched s;
+    struct ev_task a[3], b[2], c, d;
+    int i;
+    pt_sched_init(&s);
+    pt_event_init(&ev, 0);
+    for (i = 0; i < 3; i++) {
+        spawn(&s, &a[i], 0x1 | 0x2, thread_any);
+    }
+    for (i = 0; i < 2; i++) {
+        spawn(&s, &b[i], 0x4, thread_any);
+    }
+    spawn(&s, &c, 0x1 | 0x8, thread_all);
+    spawn(&s, &d, 0x10, thread_any);
+
+    run_all(&s);
+    TEST_ASSERT_EQUAL_HEX32(0xF, ev.used);
+
+    /* Flags nobody waits for wake nobody */
+    pt_event_set(&ev, 0x20);
+    TEST_ASSERT_TRUE(pt_sched_idle(&s));
+
+    pt_event_set(&ev, 0x1);
+    TEST_ASSERT_EQUAL_UINT32(3, pt_sched_run(&s));
+    for (i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_INT(1, a[i].done);
+        TEST_ASSERT_EQUAL_INT(2, a[i].runs);
+    }
+    for (i = 0; i < 2; i++) {
+        TEST_ASSERT_EQUAL_INT(1, b[i].runs);
+    }
+    TEST_ASSERT_EQUAL_INT(1, c.runs);
+    TEST_ASSERT_EQUAL_INT(1, d.runs);
+    TEST_ASSERT_EQUAL_HEX32(0x4 | 0x1 | 0x8 | 0x10, ev.watched);
+
+    pt_event_set(&ev, 0x8);
+    TEST_ASSERT_EQUAL_UINT32(1, pt_sched_run(&s));
+    TEST_ASSERT_EQUAL_INT(1, c.done);
+    TEST_ASSERT_EQUAL_INT(0, b[0].done);
+    TEST_ASSERT_EQUAL_INT(0, d.done);
+    TEST_ASSERT_EQUAL_HEX32(0x4 | 0x10, ev.watched);
+}
+
+/* Test: Waiters for more distinct masks than there are buckets share a queue */
+void test_event_overflow(void) {
+    struct pt_sched s;
+    struct ev_task a[PT_EVENT_BUCKETS + 2];
+    int i, n = PT_EVENT_BUCKETS + 2;
+    pt_sched_init(&s);
+    pt_event_init(&ev, 0);
+    for (i = 0; i < n; i++) {
+        spawn(&s, &a[i], (pt_event_flags_t)1 << i, thread_any);
+    }
+
+    run_all(&s);
+    TEST_ASSERT_EQUAL_UINT32(2, ev.overflow.count);
+    TEST_ASSERT_EQUAL_HEX32((pt_event_flags_t)3 << PT_EVENT_BUCKETS,
+                            ev.overflow_mask);
+
+    /* Both overflow waiters run; the one whose flag is not set waits again */
+    pt_event_set(&ev, (pt_event_flags_t)1 << PT_EVENT_BUCKETS);
+    TEST_ASSERT_EQUAL_UINT32(2, pt_sched_run(&s));
+    TEST_ASSERT_EQUAL_INT(1, a[PT_EVENT_BUCKETS].done);
+    TEST_ASSERT_EQUAL_INT(0, a[PT_EVENT_BUCKETS + 1].done);
+    TEST_ASSERT_EQUAL_INT(2, a[PT_EVENT_BUCKETS + 1].runs);
+    for (i = 0; i < PT_EVENT_BUCKETS; i++) {
+        TEST_ASSERT_EQUAL_INT(1, a[i].runs);
+    }
+
+    /* A freed bucket is reused */
+    pt_event_set(&ev, 0x1);
+    run_all(&s);
+    TEST_ASSERT_EQUAL_INT(1, a[0].done);
+
+    pt_event_set(&ev, ~(pt_event_flags_t)0);
+    run_all(&s);
+    for (i = 0; i < n; i++) {
+        TEST_ASSERT_EQUAL_INT(1, a[i].done);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, ev.used);
+    TEST_ASSERT_EQUAL_HEX32(0, ev.watched);
+}
+
+/* Test: A flag that is set and cleared before the waiter runs does not release it */
+void test_event_cleared_before_run(void) {
+    struct pt_sched s;
+    struct ev_task a;
+    pt_sched_init(&s);
+    pt_event_init(&ev, 0);
+    spawn(&s, &a, 0x1, thread_any);
+
+    run_all(&s);
+    pt_event_set(&ev, 0x1);
+    pt_event_clear(&ev, 0x1);
+    run_all(&s);
+    TEST_ASSERT_EQUAL_INT(0, a.done);
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_BLOCKED, a.task.state);
+
+    pt_event_set(&ev, 0x1);
+    run_all(&s);
+    TEST_ASSERT_EQUAL_INT(1, a.done);
+}
+
+/* Test: Posted flags are set by pt_event_deliver */
+void test_event_post_deliver(void) {
+    struct pt_sched s;
+    struct ev_task a;
+    pt_sched_init(&s);
+    pt_event_init(&ev, 0);
+    spawn(&s, &a, 0x2 | 0x4, thread_all);
+
+    run_all(&s);
+    pt_event_post(&ev, 0x2);
+    pt_event_post(&ev, 0x4);
+    TEST_ASSERT_EQUAL_HEX32(0, pt_event_get(&ev));
+    TEST_ASSERT_TRUE(pt_sched_idle(&s));
+
+    TEST_ASSERT_EQUAL_HEX32(0x6, pt_event_deliver(&ev));
+    TEST_ASSERT_EQUAL_HEX32(0x6, pt_event_get(&ev));
+    run_all(&s);
+    TEST_ASSERT_EQUAL_INT(1, a.done);
+    TEST_ASSERT_EQUAL_HEX32(0, pt_event_deliver(&ev));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_event_set_clear);
+    RUN_TEST(test_event_no_wait);
+    RUN_TEST(test_event_wait_any);
+    RUN_TEST(test_event_wait_all);
+    RUN_TEST(test_event_wakes_only_matching);
+    RUN_TEST(test_event_overflow);
+    RUN_TEST(test_event_cleared_before_run);
+    RUN_TEST(test_event_post_deliver);
+    return UNITY_END();
+}
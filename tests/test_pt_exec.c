@@ -0,0 +1,161 @@
+#include "unity.h"
+#include "pt-exec.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+#define STEPS 100
+
+struct job {
+    struct pt_exec_task task;
+    atomic_int running;
+    int steps;
+    int order[4];
+};
+
+static atomic_int overlaps;
+static int order_pos;
+
+static PT_THREAD(job_thread(struct pt_exec_task *t)) {
+    struct job *j = (struct job *)t;
+    if (atomic_exchange(&j->running, 1) != 0) {
+        atomic_fetch_add(&overlaps, 1);
+    }
+    PT_BEGIN(&t->pt);
+    for (j->steps = 0; j->steps < STEPS; ++j->steps) {
+        atomic_store(&j->running, 0);
+        PT_YIELD(&t->pt);
+    }
+    atomic_store(&j->running, 0);
+    PT_END(&t->pt);
+}
+
+/* Records the order of the first runs; only for a single worker */
+static PT_THREAD(order_thread(struct pt_exec_task *t)) {
+    struct job *j = (struct job *)t;
+    PT_BEGIN(&t->pt);
+    for (j->steps = 0; j->steps < 4; ++j->steps) {
+        j->order[j->steps] = order_pos++;
+        PT_YIELD(&t->pt);
+    }
+    PT_END(&t->pt);
+}
+
+/* Test: The owner takes LIFO and thieves steal FIFO */
+void test_deque(void) {
+    struct pt_exec exec;
+    struct pt_exec_deque *d;
+    struct pt_exec_task t[3];
+
+    TEST_ASSERT_EQUAL_INT(0, pt_exec_init(&exec, 1, 4));
+    d = &exec.workers[0].deque;
+    TEST_ASSERT_NULL(pt_exec_deque_take(d));
+    TEST_ASSERT_NULL(pt_exec_deque_steal(d));
+
+    pt_exec_deque_push(d, &t[0]);
+    pt_exec_deque_push(d, &t[1]);
+    pt_exec_deque_push(d, &t[2]);
+    TEST_ASSERT_EQUAL_PTR(&t[2], pt_exec_deque_take(d));
+    TEST_ASSERT_EQUAL_PTR(&t[0], pt_exec_deque_steal(d));
+    TEST_ASSERT_EQUAL_PTR(&t[1], pt_exec_deque_take(d));
+    TEST_ASSERT_NULL(pt_exec_deque_take(d));
+    TEST_ASSERT_NULL(pt_exec_deque_steal(d));
+    pt_exec_close(&exec);
+}
+
+/* Test: No more tasks than the executor was initialized for */
+void test_spawn_limit(void) {
+    struct pt_exec exec;
+    static struct job jobs[3];
+
+    TEST_ASSERT_EQUAL_INT(0, pt_exec_init(&exec, 2, 2));
+    TEST_ASSERT_EQUAL_INT(0, pt_exec_spawn(&exec, &jobs[0].task, job_thread));
+    TEST_ASSERT_EQUAL_INT(0, pt_exec_spawn(&exec, &jobs[1].task, job_thread));
+    TEST_ASSERT_EQUAL_INT(-1, pt_exec_spawn(&exec, &jobs[2].task, job_thread));
+    TEST_ASSERT_EQUAL_INT(ENOSPC, errno);
+    pt_exec_run(&exec);
+    pt_exec_close(&exec);
+}
+
+/* Test: A single worker runs every task once per pass */
+void test_passes(void) {
+    struct pt_exec exec;
+    static struct job jobs[5];
+    int i, k;
+
+    order_pos = 0;
+    TEST_ASSERT_EQUAL_INT(0, pt_exec_init(&exec, 1, 5));
+    for (i = 0; i < 5; i++) {
+        pt_exec_spawn(&exec, &jobs[i].task, order_thread);
+    }
+    pt_exec_run(&exec);
+
+    for (k = 0; k < 4; k++) {
+        for (i = 0; i < 5; i++) {
+            TEST_ASSERT_TRUE(jobs[i].order[k] >= 5 * k);
+            TEST_ASSERT_TRUE(jobs[i].order[k] < 5 * (k + 1));
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT64(25, exec.workers[0].runs);
+    pt_exec_close(&exec);
+}
+
+/* Test: Many workers run all tasks to the end, each on one worker at a time */
+void test_workers(void) {
+    enum { TASKS = 1000, WORKERS = 8 };
+    static struct job jobs[TASKS];
+    struct pt_exec exec;
+    uint64_t runs = 0;
+    int i;
+
+    atomic_store(&overlaps, 0);
+    TEST_ASSERT_EQUAL_INT(0, pt_exec_init(&exec, WORKERS, TASKS));
+    for (i = 0; i < TASKS; i++) {
+        atomic_init(&jobs[i].running, 0);
+        TEST_ASSERT_EQUAL_INT(0, pt_exec_spawn(&exec, &jobs[i].task, job_thread));
+    }
+    pt_exec_run(&exec);
+
+    TEST_ASSERT_EQUAL_INT(0, atomic_load(&overlaps));
+    for (i = 0; i < TASKS; i++) {
+        TEST_ASSERT_EQUAL_INT(STEPS, jobs[i].steps);
+    }
+    for (i = 0; i < WORKERS; i++) {
+        runs += exec.workers[i].runs;
+    }
+    TEST_ASSERT_EQUAL_UINT64((uint64_t)TASKS * (STEPS + 1), runs);
+    pt_exec_close(&exec);
+}
+
+/* Test: Tasks spawned on one worker are finished with the help of thieves */
+void test_stealing(void) {
+    enum { TASKS = 64 };
+    static struct job jobs[TASKS];
+    struct pt_exec exec;
+    int i;
+
+    TEST_ASSERT_EQUAL_INT(0, pt_exec_init(&exec, 4, TASKS));
+    /* Put every task on the first worker */
+    for (i = 0; i < TASKS; i++) {
+        atomic_init(&jobs[i].running, 0);
+        exec.next = 0;
+        pt_exec_spawn(&exec, &jobs[i].task, job_thread);
+    }
+    pt_exec_run(&exec);
+
+    for (i = 0; i < TASKS; i++) {
+        TEST_ASSERT_EQUAL_INT(STEPS, jobs[i].steps);
+    }
+    TEST_ASSERT_EQUAL_INT(0, atomic_load(&overlaps));
+    pt_exec_close(&exec);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_deque);
+    RUN_TEST(test_spawn_limit);
+    RUN_TEST(test_passes);
+    RUN_TEST(test_workers);
+    RUN_TEST(test_stealing);
+    return UNITY_END();
+}
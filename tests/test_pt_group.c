@@ -0,0 +1,197 @@
+#include "unity.h"
+#include "pt-group.h"
+
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+enum { N = 200 };
+static int runs[N];
+static int flags[N];
+
+/* Thread that waits for its flag, then yields once and ends */
+static PT_THREAD(thread_waits(struct pt_group *g, uint32_t i)) {
+    runs[i]++;
+    PT_BEGIN(pt_group_pt(g, i));
+    PT_WAIT_UNTIL(pt_group_pt(g, i), flags[i]);
+    PT_YIELD(pt_group_pt(g, i));
+    PT_END(pt_group_pt(g, i));
+}
+
+/* Thread that sleeps for its index modulo 10 plus one, three times */
+static PT_THREAD(thread_sleeps(struct pt_group *g, uint32_t i)) {
+    uint32_t *woke = pt_group_data(g);
+    runs[i]++;
+    PT_BEGIN(pt_group_pt(g, i));
+    while (runs[i] <= 3) {
+        PT_GROUP_SLEEP(g, i, i % 10 + 1);
+        woke[i] = g->now;
+    }
+    PT_END(pt_group_pt(g, i));
+}
+
+/* Thread that wakes itself before waiting */
+static PT_THREAD(thread_wakes_itself(struct pt_group *g, uint32_t i)) {
+    runs[i]++;
+    PT_BEGIN(pt_group_pt(g, i));
+    pt_group_wake(g, i);
+    PT_WAIT_UNTIL(pt_group_pt(g, i), runs[i] > 1);
+    PT_END(pt_group_pt(g, i));
+}
+
+static void reset(void) {
+    int i;
+    for (i = 0; i < N; i++) {
+        runs[i] = 0;
+        flags[i] = 0;
+    }
+}
+
+/* Test: Spawned instances run once per sweep and waiting ones are parked */
+void test_sweep(void) {
+    struct pt_group g;
+    uint32_t i;
+    reset();
+    TEST_ASSERT_EQUAL_INT(0, pt_group_init(&g, N, thread_waits, NULL));
+    TEST_ASSERT_TRUE(pt_group_idle(&g));
+    for (i = 0; i < N; i += 2) {
+        pt_group_spawn(&g, i);
+    }
+    TEST_ASSERT_EQUAL_UINT32(N / 2, g.live);
+    TEST_ASSERT_EQUAL_UINT32(N / 2, pt_group_sweep(&g));
+    TEST_ASSERT_TRUE(pt_group_idle(&g));
+    TEST_ASSERT_EQUAL_UINT32(0, pt_group_sweep(&g));
+
+    flags[64] = flags[130] = 1;
+    pt_group_wake(&g, 64);
+    pt_group_wake(&g, 130);
+    TEST_ASSERT_TRUE(pt_group_ready(&g, 130));
+    TEST_ASSERT_EQUAL_UINT32(2, pt_group_sweep(&g));
+    TEST_ASSERT_EQUAL_UINT32(2, pt_group_sweep(&g));
+    TEST_ASSERT_EQUAL_UINT32(N / 2 - 2, g.live);
+    TEST_ASSERT_TRUE(pt_group_idle(&g));
+    for (i = 0; i < N; i++) {
+        TEST_ASSERT_EQUAL_INT(i % 2 ? 0 : i == 64 || i == 130 ? 3 : 1, runs[i]);
+    }
+    pt_group_close(&g);
+}
+
+/* Test: Sleeping instances wake when their tick is reached */
+void test_sleep(void) {
+    struct pt_group g;
+    static uint32_t woke[N];
+    uint32_t i, t;
+    reset();
+    TEST_ASSERT_EQUAL_INT(0, pt_group_init(&g, N, thread_sleeps, woke));
+    for (i = 0; i < N; i++) {
+        pt_group_spawn(&g, i);
+    }
+    pt_group_sweep(&g);
+    for (i = 0; i < N; i++) {
+        TEST_ASSERT_TRUE(pt_group_sleeping(&g, i));
+    }
+    for (t = 0; t < 40; t++) {
+        pt_group_advance(&g, 1);
+        pt_group_sweep(&g);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, g.live);
+    for (i = 0; i < N; i++) {
+        TEST_ASSERT_EQUAL_INT(4, runs[i]);
+        TEST_ASSERT_EQUAL_UINT32(3 * (i % 10 + 1), woke[i]);
+    }
+    pt_group_close(&g);
+}
+
+/* Test: Waking an instance ends its sleep */
+void test_wake_sleeper(void) {
+    struct pt_group g;
+    static uint32_t woke[N];
+    reset();
+    TEST_ASSERT_EQUAL_INT(0, pt_group_init(&g, N, thread_sleeps, woke));
+    pt_group_spawn(&g, 9);
+    pt_group_sweep(&g);
+    pt_group_advance(&g, 3);
+    TEST_ASSERT_TRUE(pt_group_sleeping(&g, 9));
+
+    pt_group_wake(&g, 9);
+    TEST_ASSERT_FALSE(pt_group_sleeping(&g, 9));
+    TEST_ASSERT_EQUAL_UINT32(1, pt_group_sweep(&g));
+    TEST_ASSERT_EQUAL_UINT32(3, woke[9]);
+    pt_group_close(&g);
+}
+
+/* Test: A wake while running is not lost */
+void test_wake_while_running(void) {
+    struct pt_group g;
+    reset();
+    TEST_ASSERT_EQUAL_INT(0, pt_group_init(&g, 3, thread_wakes_itself, NULL));
+    pt_group_spawn(&g, 1);
+    pt_group_sweep(&g);
+    TEST_ASSERT_TRUE(pt_group_ready(&g, 1));
+    pt_group_sweep(&g);
+    TEST_ASSERT_EQUAL_INT(2, runs[1]);
+    TEST_ASSERT_EQUAL_UINT32(0, g.live);
+    pt_group_close(&g);
+}
+
+/* Test: The scan lists every reached deadline, across wraparound and tails */
+void test_scan(void) {
+    enum { M = 1000 };
+    static uint32_t deadline[M], due[M];
+    uint32_t seed = 1, now, i, k, count;
+    for (now = 0xfffffff0u; now != 0x10; now += 4) {
+        for (i = 0; i < M; i++) {
+            seed = seed * 1103515245u + 12345u;
+            deadline[i] = now + (seed >> 16) % 64 - 32;
+        }
+        for (i = 0; i <= M; i += M / 4 - 1) {
+            count = pt_group_scan(deadline, i, now, due);
+            for (k = 0; k < i; k++) {
+                if ((int32_t)(now - deadline[k]) >= 0) {
+                    TEST_ASSERT_NOT_EQUAL(0, count);
+                    TEST_ASSERT_EQUAL_UINT32(k, due[0]);
+                    count--;
+                    memmove(due, due + 1, count * sizeof(*due));
+                }
+            }
+            TEST_ASSERT_EQUAL_UINT32(0, count);
+        }
+    }
+}
+
+/* Test: Only sleeping instances are woken when time advances */
+void test_advance_sleeping_only(void) {
+    struct pt_group g;
+    static uint32_t woke[N];
+    uint32_t i;
+    reset();
+    TEST_ASSERT_EQUAL_INT(0, pt_group_init(&g, N, thread_sleeps, woke));
+    for (i = 0; i < N; i += 3) {
+        pt_group_spawn(&g, i);
+    }
+    pt_group_sweep(&g);
+    pt_group_advance(&g, 10);
+    for (i = 0; i < N; i++) {
+        TEST_ASSERT_EQUAL(i % 3 == 0, pt_group_ready(&g, i));
+        TEST_ASSERT_FALSE(pt_group_sleeping(&g, i));
+    }
+    pt_group_close(&g);
+}
+
+int main(void) {
+#if PT_GROUP_SIMD > 128 && defined(__GNUC__)
+    /* Built for a vector extension that this processor lacks: skip */
+    if (!__builtin_cpu_supports(PT_GROUP_SIMD == 512 ? "avx512f" : "avx2")) {
+        return 77;
+    }
+#endif
+    UNITY_BEGIN();
+    RUN_TEST(test_sweep);
+    RUN_TEST(test_sleep);
+    RUN_TEST(test_wake_sleeper);
+    RUN_TEST(test_wake_while_running);
+    RUN_TEST(test_scan);
+    RUN_TEST(test_advance_sleeping_only);
+    return UNITY_END();
+}
@@ -0,0 +1,188 @@
+#include "unity.h"
+#include "pt-io.h"
+
+#include <string.h>
+#include <sys/socket.h>
+
+static struct pt_sched sched;
+static struct pt_io io;
+static int fds[2];
+
+void setUp(void) {
+    pt_sched_init(&sched);
+    TEST_ASSERT_EQUAL_INT(0, pt_io_init(&io, &sched));
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    TEST_ASSERT_EQUAL_INT(0, pt_io_nonblock(fds[0]));
+}
+
+void tearDown(void) {
+    close(fds[0]);
+    if (fds[1] >= 0) {
+        close(fds[1]);
+    }
+    pt_io_close(&io);
+}
+
+struct io_task {
+    struct pt_task task;
+    struct pt_io_handle h;
+    char buf[8];
+    char *big;
+    size_t len;
+    ssize_t res;
+    int runs;
+    int done;
+};
+
+static void run(void) {
+    pt_io_poll(&io, 0);
+    pt_sched_run(&sched);
+}
+
+static PT_THREAD(thread_waits_readable(struct pt_task *t)) {
+    struct io_task *it = (struct io_task *)t;
+    it->runs++;
+    PT_BEGIN(&t->pt);
+    do {
+        PT_WAIT_READABLE(t, &it->h);
+        it->res = pt_io_read(&it->h, it->buf, sizeof(it->buf));
+    } while (it->res < 0 && errno == EAGAIN);
+    it->done = 1;
+    PT_END(&t->pt);
+}
+
+static PT_THREAD(thread_reads(struct pt_task *t)) {
+    struct io_task *it = (struct io_task *)t;
+    it->runs++;
+    PT_BEGIN(&t->pt);
+    PT_READ(t, &it->h, it->buf, sizeof(it->buf), it->res);
+    it->done = 1;
+    PT_END(&t->pt);
+}
+
+static PT_THREAD(thread_writes(struct pt_task *t)) {
+    struct io_task *it = (struct io_task *)t;
+    it->runs++;
+    PT_BEGIN(&t->pt);
+    PT_WRITE(t, &it->h, it->big, it->len, it->res);
+    it->done = 1;
+    PT_END(&t->pt);
+}
+
+static void spawn(struct io_task *it, pt_task_fn fn) {
+    memset(it, 0, sizeof(*it));
+    TEST_ASSERT_EQUAL_INT(0, pt_io_add(&io, &it->h, fds[0]));
+    pt_sched_spawn(&sched, &it->task, fn);
+}
+
+/* Test: Waiting for a readable descriptor parks the task until data arrives */
+void test_wait_readable(void) {
+    struct io_task it;
+    spawn(&it, thread_waits_readable);
+
+    run();
+    TEST_ASSERT_EQUAL_INT(0, it.done);
+    TEST_ASSERT_EQUAL_INT(1, it.runs);
+    TEST_ASSERT_FALSE(it.h.ready & PT_IO_IN);
+    TEST_ASSERT_TRUE(pt_sched_idle(&sched));
+
+    /* Nothing happens without an edge */
+    run();
+    TEST_ASSERT_EQUAL_INT(1, it.runs);
+
+    TEST_ASSERT_EQUAL_INT(3, write(fds[1], "abc", 3));
+    run();
+    TEST_ASSERT_EQUAL_INT(1, it.done);
+    TEST_ASSERT_EQUAL_INT(3, it.res);
+    TEST_ASSERT_EQUAL_MEMORY("abc", it.buf, 3);
+}
+
+/* Test: PT_READ collects a buffer from several partial writes */
+void test_read_partial(void) {
+    struct io_task it;
+    spawn(&it, thread_reads);
+
+    run();
+    TEST_ASSERT_EQUAL_INT(0, it.done);
+
+    TEST_ASSERT_EQUAL_INT(3, write(fds[1], "012", 3));
+    run();
+    TEST_ASSERT_EQUAL_INT(0, it.done);
+    TEST_ASSERT_EQUAL_INT(2, it.runs);
+
+    TEST_ASSERT_EQUAL_INT(5, write(fds[1], "34567", 5));
+    run();
+    TEST_ASSERT_EQUAL_INT(1, it.done);
+    TEST_ASSERT_EQUAL_INT(8, it.res);
+    TEST_ASSERT_EQUAL_MEMORY("01234567", it.buf, 8);
+}
+
+/* Test: PT_READ returns a short count at the end of file */
+void test_read_eof(void) {
+    struct io_task it;
+    spawn(&it, thread_reads);
+
+    TEST_ASSERT_EQUAL_INT(2, write(fds[1], "xy", 2));
+    run();
+    TEST_ASSERT_EQUAL_INT(0, it.done);
+
+    close(fds[1]);
+    fds[1] = -1;
+    run();
+    TEST_ASSERT_EQUAL_INT(1, it.done);
+    TEST_ASSERT_EQUAL_INT(2, it.res);
+}
+
+/* Test: PT_WRITE blocks while the socket is full and finishes after it drains */
+void test_write_blocks_when_full(void) {
+    static char big[1 << 20];
+    static char sink[1 << 16];
+    struct io_task it;
+    size_t total = 0;
+    ssize_t n;
+    int rounds = 0;
+
+    memset(big, 'z', sizeof(big));
+    spawn(&it, thread_writes);
+    it.big = big;
+    it.len = sizeof(big);
+
+    run();
+    TEST_ASSERT_EQUAL_INT(0, it.done);
+    TEST_ASSERT_FALSE(it.h.ready & PT_IO_OUT);
+    TEST_ASSERT_TRUE(pt_sched_idle(&sched));
+
+    TEST_ASSERT_EQUAL_INT(0, pt_io_nonblock(fds[1]));
+    while (total < sizeof(big) && rounds++ < 100000) {
+        while ((n = read(fds[1], sink, sizeof(sink))) > 0) {
+            total += (size_t)n;
+        }
+        run();
+    }
+    TEST_ASSERT_EQUAL_INT(1, it.done);
+    TEST_ASSERT_EQUAL_INT((int)sizeof(big), (int)it.res);
+    TEST_ASSERT_EQUAL_size_t(sizeof(big), total);
+}
+
+/* Test: A removed descriptor no longer wakes its task */
+void test_del(void) {
+    struct io_task it;
+    spawn(&it, thread_waits_readable);
+    run();
+    TEST_ASSERT_EQUAL_INT(0, pt_io_del(&it.h));
+
+    TEST_ASSERT_EQUAL_INT(1, write(fds[1], "a", 1));
+    TEST_ASSERT_EQUAL_INT(0, pt_io_poll(&io, 0));
+    TEST_ASSERT_TRUE(pt_sched_idle(&sched));
+    TEST_ASSERT_EQUAL_INT(0, it.done);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_wait_readable);
+    RUN_TEST(test_read_partial);
+    RUN_TEST(test_read_eof);
+    RUN_TEST(test_write_blocks_when_full);
+    RUN_TEST(test_del);
+    return UNITY_END();
+}
@@ -0,0 +1,175 @@
+#include "unity.h"
+#include "pt-sched.h"
+
+#include <stddef.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+typedef PT_LOCALS(struct {
+    int i;
+    int sum;
+}) summer_pt;
+
+/* Thread that sums 1..limit, yielding after each step */
+static int limit;
+static PT_THREAD(summer(summer_pt *self)) {
+    PT_BEGIN(&self->pt);
+    self->locals.sum = 0;
+    for (self->locals.i = 1; self->locals.i <= limit; self->locals.i++) {
+        self->locals.sum += self->locals.i;
+        PT_YIELD(&self->pt);
+    }
+    PT_END(&self->pt);
+}
+
+/* Test: Interleaved instances of one protothread keep their own locals */
+void test_instances(void) {
+    enum { N = 100 };
+    static summer_pt s[N];
+    static int done[N];
+    int i, running;
+    limit = 10;
+    for (i = 0; i < N; i++) {
+        PT_INIT(&s[i].pt);
+    }
+    /* Start the instances at different times */
+    for (i = 0; i < N; i++) {
+        int k;
+        for (k = 0; k <= i % 5; k++) {
+            summer(&s[i]);
+        }
+    }
+    do {
+        running = 0;
+        for (i = 0; i < N; i++) {
+            /* An ended protothread starts over when it is called again */
+            if (!done[i]) {
+                done[i] = !PT_SCHEDULE(summer(&s[i]));
+                running |= !done[i];
+            }
+        }
+    } while (running);
+
+    for (i = 0; i < N; i++) {
+        TEST_ASSERT_EQUAL_INT(55, s[i].locals.sum);
+    }
+}
+
+/* Test: The control structure comes first and instances are contiguous */
+void test_layout(void) {
+    summer_pt s[2];
+    TEST_ASSERT_EQUAL_size_t(0, offsetof(summer_pt, pt));
+    TEST_ASSERT_EQUAL_PTR(&s[0], (struct pt *)&s[0]);
+    TEST_ASSERT_EQUAL_INT((int)sizeof(summer_pt), (int)((char *)&s[1] - (char *)&s[0]));
+    TEST_ASSERT_TRUE(sizeof(summer_pt) <= sizeof(struct pt) + 2 * sizeof(int) + 8);
+}
+
+typedef PT_LOCALS(struct {
+    summer_pt child;
+    int spawned;
+}) parent_pt;
+
+/* Thread that runs a child instance with its own locals */
+static PT_THREAD(parent(parent_pt *self)) {
+    PT_BEGIN(&self->pt);
+    self->locals.spawned++;
+    PT_SPAWN(&self->pt, &self->locals.child.pt, summer(&self->locals.child));
+    PT_END(&self->pt);
+}
+
+/* Test: Locals can hold child protothreads */
+void test_child(void) {
+    parent_pt p = {0};
+    PT_INIT(&p.pt);
+    limit = 4;
+    while (PT_SCHEDULE(parent(&p))) {
+    }
+    TEST_ASSERT_EQUAL_INT(10, p.locals.child.locals.sum);
+    TEST_ASSERT_EQUAL_INT(1, p.locals.spawned);
+}
+
+typedef PT_TASK_LOCALS(struct {
+    int count;
+    int target;
+}) counter_task;
+
+/* Scheduled thread that counts to its own target */
+static PT_THREAD(counter(struct pt_task *t)) {
+    counter_task *self = (counter_task *)t;
+    PT_BEGIN(&t->pt);
+    for (self->locals.count = 0; self->locals.count < self->locals.target;
+         self->locals.count++) {
+        PT_YIELD(&t->pt);
+    }
+    PT_END(&t->pt);
+}
+
+/* Test: Scheduled tasks keep their own locals */
+void test_tasks(void) {
+    enum { N = 1000 };
+    static counter_task c[N];
+    struct pt_sched s;
+    int i;
+    pt_sched_init(&s);
+    for (i = 0; i < N; i++) {
+        c[i].locals.target = i % 17;
+        pt_sched_spawn(&s, &c[i].task, counter);
+    }
+    while (!pt_sched_idle(&s)) {
+        pt_sched_run(&s);
+    }
+    for (i = 0; i < N; i++) {
+        TEST_ASSERT_EQUAL_INT(i % 17, c[i].locals.count);
+        TEST_ASSERT_EQUAL_UINT8(PT_TASK_IDLE, c[i].task.state);
+    }
+}
+
+typedef PT_LOCALS(struct {
+    int a, b;
+    unsigned char buf[4], len;
+}) pair_pt;
+
+typedef PT_TASK_LOCALS(struct {
+    int a, b;
+}) pair_task;
+
+/* Thread that fills its buffer with the running sum of a and b */
+static PT_THREAD(pair(pair_pt *self)) {
+    PT_BEGIN(&self->pt);
+    for (self->locals.len = 0; self->locals.len < sizeof(self->locals.buf);
+         self->locals.len++) {
+        self->locals.buf[self->locals.len] =
+            (unsigned char)(self->locals.a + self->locals.b);
+        self->locals.a = self->locals.b;
+        self->locals.b = self->locals.buf[self->locals.len];
+        PT_YIELD(&self->pt);
+    }
+    PT_END(&self->pt);
+}
+
+/* Test: Locals may declare several members in one declaration */
+void test_multiple_declarators(void) {
+    pair_pt p;
+    pair_task t;
+    PT_INIT(&p.pt);
+    p.locals.a = 1;
+    p.locals.b = 1;
+    while (PT_SCHEDULE(pair(&p))) {
+    }
+    TEST_ASSERT_EQUAL_UINT8(4, p.locals.len);
+    TEST_ASSERT_EQUAL_UINT8(2, p.locals.buf[0]);
+    TEST_ASSERT_EQUAL_UINT8(8, p.locals.buf[3]);
+    TEST_ASSERT_EQUAL_PTR(&t, (struct pt_task *)&t);
+    TEST_ASSERT_EQUAL_size_t(sizeof(struct pt_task), offsetof(pair_task, locals));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_instances);
+    RUN_TEST(test_layout);
+    RUN_TEST(test_child);
+    RUN_TEST(test_tasks);
+    RUN_TEST(test_multiple_declarators);
+    return UNITY_END();
+}
@@ -0,0 +1,162 @@
+#include "unity.h"
+#include "pt-mutex.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static struct pt_mutex mutex;
+
+struct lock_task {
+    struct pt_task task;
+    int id;
+    int runs;
+    int rounds;
+    int i;
+};
+
+static int order[16], order_len;
+
+/* Thread that locks the mutex, yields while holding it and unlocks it, rounds times */
+static PT_THREAD(thread_locker(struct pt_task *t)) {
+    struct lock_task *lt = (struct lock_task *)t;
+    lt->runs++;
+    PT_BEGIN(&t->pt);
+    for (lt->i = 0; lt->i < lt->rounds; lt->i++) {
+        PT_MUTEX_LOCK(t, &mutex);
+        TEST_ASSERT_EQUAL_PTR(t, pt_mutex_owner(&mutex));
+        order[order_len++] = lt->id;
+        PT_YIELD(&t->pt);
+        PT_MUTEX_UNLOCK(t, &mutex);
+    }
+    PT_END(&t->pt);
+}
+
+static void spawn_lockers(struct pt_sched *s, struct lock_task *lt, int n, int rounds) {
+    int i;
+    for (i = 0; i < n; i++) {
+        lt[i] = (struct lock_task){0};
+        lt[i].id = i;
+        lt[i].rounds = rounds;
+        pt_sched_spawn(s, &lt[i].task, thread_locker);
+    }
+}
+
+/* Test: PT_MUTEX_INIT leaves the mutex free with an empty queue */
+void test_mutex_init(void) {
+    PT_MUTEX_INIT(&mutex);
+    TEST_ASSERT_NULL(pt_mutex_owner(&mutex));
+    TEST_ASSERT_EQUAL_UINT32(0, mutex.waiters.count);
+}
+
+/* Test: Locking a free mutex makes the task its owner */
+void test_mutex_lock_free(void) {
+    struct pt_sched s;
+    struct lock_task lt[1];
+    pt_sched_init(&s);
+    PT_MUTEX_INIT(&mutex);
+    order_len = 0;
+    spawn_lockers(&s, lt, 1, 1);
+
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_PTR(&lt[0].task, pt_mutex_owner(&mutex));
+
+    pt_sched_run(&s);
+    TEST_ASSERT_NULL(pt_mutex_owner(&mutex));
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_IDLE, lt[0].task.state);
+}
+
+/* Test: Contending tasks block and are not polled */
+void test_mutex_contention_blocks(void) {
+    struct pt_sched s;
+    struct lock_task lt[4];
+    int i;
+    pt_sched_init(&s);
+    PT_MUTEX_INIT(&mutex);
+    order_len = 0;
+    spawn_lockers(&s, lt, 4, 1);
+
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_PTR(&lt[0].task, pt_mutex_owner(&mutex));
+    TEST_ASSERT_EQUAL_UINT32(3, mutex.waiters.count);
+    for (i = 1; i < 4; i++) {
+        TEST_ASSERT_EQUAL_UINT8(PT_TASK_BLOCKED, lt[i].task.state);
+    }
+
+    pt_task_wake(&lt[1].task);
+    for (i = 0; i < 3; i++) {
+        pt_sched_run(&s);
+    }
+    TEST_ASSERT_EQUAL_INT(1, lt[2].runs);
+    TEST_ASSERT_EQUAL_INT(1, lt[3].runs);
+}
+
+/* Test: Unlock hands ownership to the next waiter in FIFO order */
+void test_mutex_handoff_fifo(void) {
+    struct pt_sched s;
+    struct lock_task lt[4];
+    int i;
+    pt_sched_init(&s);
+    PT_MUTEX_INIT(&mutex);
+    order_len = 0;
+    spawn_lockers(&s, lt, 4, 1);
+    pt_sched_run(&s);
+
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_PTR(&lt[1].task, pt_mutex_owner(&mutex));
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_READY, lt[1].task.state);
+
+    while (!pt_sched_idle(&s)) {
+        pt_sched_run(&s);
+    }
+    TEST_ASSERT_NULL(pt_mutex_owner(&mutex));
+    TEST_ASSERT_EQUAL_INT(4, order_len);
+    TEST_ASSERT_EQUAL_INT(2, lt[0].runs);
+    for (i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_INT(i, order[i]);
+    }
+    for (i = 1; i < 4; i++) {
+        TEST_ASSERT_EQUAL_INT(3, lt[i].runs);
+    }
+}
+
+/* Test: A task that unlocks and locks again queues behind the waiters */
+void test_mutex_relock_queues(void) {
+    struct pt_sched s;
+    struct lock_task lt[3];
+    int i;
+    pt_sched_init(&s);
+    PT_MUTEX_INIT(&mutex);
+    order_len = 0;
+    spawn_lockers(&s, lt, 3, 3);
+
+    while (!pt_sched_idle(&s)) {
+        pt_sched_run(&s);
+    }
+    TEST_ASSERT_EQUAL_INT(9, order_len);
+    for (i = 0; i < 9; i++) {
+        TEST_ASSERT_EQUAL_INT(i % 3, order[i]);
+    }
+}
+
+/* Test: pt_mutex_trylock only takes a free mutex */
+void test_mutex_trylock(void) {
+    struct pt_task a, b;
+    PT_MUTEX_INIT(&mutex);
+    TEST_ASSERT_TRUE(pt_mutex_trylock(&mutex, &a));
+    TEST_ASSERT_FALSE(pt_mutex_trylock(&mutex, &b));
+    TEST_ASSERT_EQUAL_PTR(&a, pt_mutex_owner(&mutex));
+    pt_mutex_unlock(&mutex);
+    TEST_ASSERT_TRUE(pt_mutex_trylock(&mutex, &b));
+    TEST_ASSERT_EQUAL_PTR(&b, pt_mutex_owner(&mutex));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_mutex_init);
+    RUN_TEST(test_mutex_lock_free);
+    RUN_TEST(test_mutex_contention_blocks);
+    RUN_TEST(test_mutex_handoff_fifo);
+    RUN_TEST(test_mutex_relock_queues);
+    RUN_TEST(test_mutex_trylock);
+    return UNITY_END();
+}
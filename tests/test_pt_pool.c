@@ -0,0 +1,184 @@
+#include "unity.h"
+#include "pt-sched.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+typedef PT_TASK_LOCALS(struct {
+    int steps;
+    int exit;
+}) pooled_task;
+
+static int ended;
+
+/* Thread that yields a number of times, then ends or exits */
+static PT_THREAD(thread_pooled(struct pt_task *t)) {
+    pooled_task *self = (pooled_task *)t;
+    PT_BEGIN(&t->pt);
+    while (self->locals.steps-- > 0) {
+        PT_YIELD(&t->pt);
+    }
+    ended++;
+    if (self->locals.exit) {
+        PT_EXIT(&t->pt);
+    }
+    PT_END(&t->pt);
+}
+
+/* Test: Blocks are aligned, distinct and reused last in, first out */
+void test_alloc_free(void) {
+    struct pt_pool pool;
+    char *a, *b, *c;
+    pt_pool_init(&pool, 24, 8);
+    TEST_ASSERT_EQUAL_size_t(PT_POOL_ROUND(24), pool.size);
+
+    a = pt_pool_alloc(&pool);
+    b = pt_pool_alloc(&pool);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+    TEST_ASSERT_EQUAL_INT(0, (int)((uintptr_t)a % PT_POOL_ALIGN));
+    TEST_ASSERT_EQUAL_INT((int)PT_POOL_ROUND(24), (int)(b - a));
+
+    pt_pool_free(&pool, a);
+    pt_pool_free(&pool, b);
+    c = pt_pool_alloc(&pool);
+    TEST_ASSERT_EQUAL_PTR(b, c);
+    c = pt_pool_alloc(&pool);
+    TEST_ASSERT_EQUAL_PTR(a, c);
+    pt_pool_close(&pool);
+}
+
+/* Test: Every block of every slab is aligned to PT_POOL_ALIGN */
+void test_alignment(void) {
+    struct pt_pool pool;
+    int i;
+    pt_pool_init(&pool, 40, 3);
+    for (i = 0; i < 10; i++) {
+        void *b = pt_pool_alloc(&pool);
+        TEST_ASSERT_NOT_NULL(b);
+        TEST_ASSERT_EQUAL_INT(0, (int)((uintptr_t)b % PT_POOL_ALIGN));
+    }
+    TEST_ASSERT_EQUAL_size_t(4, pool.nslabs);
+    pt_pool_close(&pool);
+}
+
+/* Test: A pool grows one slab at a time and close releases every slab */
+void test_slabs(void) {
+    struct pt_pool pool;
+    int i;
+    pt_pool_init(&pool, sizeof(pooled_task), 4);
+    TEST_ASSERT_EQUAL_size_t(0, pool.nslabs);
+
+    for (i = 0; i < 12; i++) {
+        TEST_ASSERT_NOT_NULL(pt_pool_alloc(&pool));
+    }
+    TEST_ASSERT_EQUAL_size_t(3, pool.nslabs);
+    TEST_ASSERT_NOT_NULL(pt_pool_alloc(&pool));
+    TEST_ASSERT_EQUAL_size_t(4, pool.nslabs);
+
+    pt_pool_close(&pool);
+    TEST_ASSERT_EQUAL_size_t(0, pool.nslabs);
+    TEST_ASSERT_NULL(pool.slabs);
+}
+
+/* Test: The scheduler returns the blocks of ended and exited tasks */
+void test_sched_release(void) {
+    struct pt_sched s;
+    struct pt_pool pool;
+    pooled_task *t[8];
+    int i, round;
+    pt_sched_init(&s);
+    pt_pool_init(&pool, sizeof(pooled_task), 8);
+    ended = 0;
+
+    for (round = 0; round < 100; round++) {
+        for (i = 0; i < 8; i++) {
+            t[i] = (pooled_task *)pt_sched_spawn_pool(&s, &pool, thread_pooled, 3);
+            TEST_ASSERT_NOT_NULL(t[i]);
+            t[i]->locals.steps = i;
+            t[i]->locals.exit = i & 1;
+        }
+        while (!pt_sched_idle(&s)) {
+            pt_sched_run(&s);
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(800, ended);
+    TEST_ASSERT_EQUAL_size_t(1, pool.nslabs);
+    pt_pool_close(&pool);
+}
+
+/* Test: Tasks spawned without a pool are not freed */
+void test_no_pool(void) {
+    struct pt_sched s;
+    pooled_task t;
+    pt_sched_init(&s);
+    ended = 0;
+
+    pt_sched_spawn(&s, &t.task, thread_pooled);
+    t.locals.steps = 0;
+    t.locals.exit = 0;
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_INT(1, ended);
+    TEST_ASSERT_NULL(t.task.pool);
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_IDLE, t.task.state);
+}
+
+enum { REMOTE_BLOCKS = 1000 };
+static void *remote_blocks[REMOTE_BLOCKS];
+
+static void *remote_free_main(void *arg) {
+    struct pt_pool *pool = arg;
+    int i;
+    for (i = 0; i < REMOTE_BLOCKS; i++) {
+        pt_pool_free_remote(pool, remote_blocks[i]);
+        if (i % 64 == 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/* Test: Blocks freed by another thread are reused by the owner */
+void test_remote_free(void) {
+    struct pt_pool pool;
+    pthread_t thread;
+    size_t slabs;
+    int i, reused = 0;
+    pt_pool_init(&pool, 64, 256);
+
+    for (i = 0; i < REMOTE_BLOCKS; i++) {
+        remote_blocks[i] = pt_pool_alloc(&pool);
+    }
+    slabs = pool.nslabs;
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&thread, NULL, remote_free_main, &pool));
+    pthread_join(thread, NULL);
+
+    /* Freed blocks are reused before the rest of the last slab */
+    for (i = 0; i < REMOTE_BLOCKS; i++) {
+        char *b = pt_pool_alloc(&pool);
+        int k;
+        for (k = 0; k < REMOTE_BLOCKS; k++) {
+            if (b == remote_blocks[k]) {
+                reused++;
+                break;
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL_size_t(slabs, pool.nslabs);
+    TEST_ASSERT_EQUAL_INT(REMOTE_BLOCKS, reused);
+    pt_pool_close(&pool);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_alloc_free);
+    RUN_TEST(test_alignment);
+    RUN_TEST(test_slabs);
+    RUN_TEST(test_sched_release);
+    RUN_TEST(test_no_pool);
+    RUN_TEST(test_remote_free);
+    return UNITY_END();
+}
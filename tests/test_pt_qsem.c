@@ -0,0 +1,232 @@
+#include "unity.h"
+#include "pt-qsem.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static struct pt_qsem sem;
+
+struct sem_task {
+    struct pt_task task;
+    int id;
+    int runs;
+    int acquired;
+};
+
+static int order[8], order_len;
+
+/* Thread that takes the semaphore once and records when it got it */
+static PT_THREAD(thread_takes_sem(struct pt_task *t)) {
+    struct sem_task *st = (struct sem_task *)t;
+    st->runs++;
+    PT_BEGIN(&t->pt);
+    PT_QSEM_WAIT(t, &sem);
+    st->acquired = 1;
+    order[order_len++] = st->id;
+    PT_END(&t->pt);
+}
+
+static void spawn_takers(struct pt_sched *s, struct sem_task *st, int n) {
+    int i;
+    for (i = 0; i < n; i++) {
+        st[i] = (struct sem_task){0};
+        st[i].id = i;
+        pt_sched_spawn(s, &st[i].task, thread_takes_sem);
+    }
+}
+
+/* Test: PT_QSEM_INIT sets count and empty queue */
+void test_qsem_init(void) {
+    PT_QSEM_INIT(&sem, 3);
+    TEST_ASSERT_EQUAL_UINT32(3, sem.count);
+    TEST_ASSERT_EQUAL_UINT32(0, sem.waiters.count);
+    TEST_ASSERT_NULL(sem.waiters.head);
+}
+
+/* Test: Wait with available permit does not block */
+void test_qsem_wait_takes_permit(void) {
+    struct pt_sched s;
+    struct sem_task st[1];
+    pt_sched_init(&s);
+    PT_QSEM_INIT(&sem, 1);
+    order_len = 0;
+    spawn_takers(&s, st, 1);
+
+    pt_sched_run(&s);
+
+    TEST_ASSERT_EQUAL_INT(1, st[0].acquired);
+    TEST_ASSERT_EQUAL_UINT32(0, sem.count);
+}
+
+/* Test: Wait without permit blocks and queues the task */
+void test_qsem_wait_blocks_when_zero(void) {
+    struct pt_sched s;
+    struct sem_task st[2];
+    pt_sched_init(&s);
+    PT_QSEM_INIT(&sem, 0);
+    order_len = 0;
+    spawn_takers(&s, st, 2);
+
+    pt_sched_run(&s);
+
+    TEST_ASSERT_EQUAL_INT(0, st[0].acquired);
+    TEST_ASSERT_EQUAL_UINT32(2, sem.waiters.count);
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_BLOCKED, st[0].task.state);
+    TEST_ASSERT_TRUE(pt_sched_idle(&s));
+}
+
+/* Test: Blocked tasks are not polled */
+void test_qsem_blocked_tasks_are_not_polled(void) {
+    struct pt_sched s;
+    struct sem_task st[4];
+    int i;
+    pt_sched_init(&s);
+    PT_QSEM_INIT(&sem, 0);
+    order_len = 0;
+    spawn_takers(&s, st, 4);
+
+    for (i = 0; i < 10; i++) {
+        pt_sched_run(&s);
+    }
+
+    for (i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_INT(1, st[i].runs);
+    }
+}
+
+/* Test: Wake ups of blocked tasks are ignored */
+void test_qsem_blocked_task_ignores_wake(void) {
+    struct pt_sched s;
+    struct sem_task st[1];
+    pt_sched_init(&s);
+    PT_QSEM_INIT(&sem, 0);
+    order_len = 0;
+    spawn_takers(&s, st, 1);
+    pt_sched_run(&s);
+
+    pt_task_wake(&st[0].task);
+    TEST_ASSERT_EQUAL_UINT32(0, pt_sched_run(&s));
+    TEST_ASSERT_EQUAL_INT(1, st[0].runs);
+}
+
+/* Test: Signal hands the permit to exactly one waiter */
+void test_qsem_signal_wakes_one(void) {
+    struct pt_sched s;
+    struct sem_task st[3];
+    pt_sched_init(&s);
+    PT_QSEM_INIT(&sem, 0);
+    order_len = 0;
+    spawn_takers(&s, st, 3);
+    pt_sched_run(&s);
+
+    pt_qsem_signal(&sem);
+    TEST_ASSERT_EQUAL_UINT32(1, pt_sched_run(&s));
+
+    TEST_ASSERT_EQUAL_INT(1, st[0].acquired);
+    TEST_ASSERT_EQUAL_INT(0, st[1].acquired);
+    TEST_ASSERT_EQUAL_INT(0, st[2].acquired);
+    TEST_ASSERT_EQUAL_UINT32(0, sem.count);
+}
+
+/* Test: Signal without waiters increments count */
+void test_qsem_signal_without_waiters(void) {
+    PT_QSEM_INIT(&sem, 0);
+    pt_qsem_signal(&sem);
+    pt_qsem_signal(&sem);
+    TEST_ASSERT_EQUAL_UINT32(2, sem.count);
+}
+
+/* Test: Waiters are served in FIFO order */
+void test_qsem_fifo_order(void) {
+    struct pt_sched s;
+    struct sem_task st[4];
+    int i;
+    pt_sched_init(&s);
+    PT_QSEM_INIT(&sem, 0);
+    order_len = 0;
+    spawn_takers(&s, st, 4);
+    pt_sched_run(&s);
+
+    for (i = 0; i < 4; i++) {
+        pt_qsem_signal(&sem);
+        pt_sched_run(&s);
+    }
+
+    TEST_ASSERT_EQUAL_INT(4, order_len);
+    for (i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_INT(i, order[i]);
+        TEST_ASSERT_EQUAL_INT(2, st[i].runs);
+    }
+}
+
+/* Producer-consumer with wait-queue semaphores */
+#define BUFSIZE 4
+#define NUM_ITEMS 20
+
+static struct pt_qsem full, empty;
+static int buffer[BUFSIZE];
+static int head, tail;
+static int produced_sum, consumed_sum;
+
+static PT_THREAD(producer(struct pt_task *t)) {
+    static int i;
+    PT_BEGIN(&t->pt);
+    for (i = 1; i <= NUM_ITEMS; i++) {
+        PT_QSEM_WAIT(t, &full);
+        buffer[head] = i;
+        head = (head + 1) % BUFSIZE;
+        produced_sum += i;
+        PT_QSEM_SIGNAL(t, &empty);
+    }
+    PT_END(&t->pt);
+}
+
+static PT_THREAD(consumer(struct pt_task *t)) {
+    static int i;
+    PT_BEGIN(&t->pt);
+    for (i = 1; i <= NUM_ITEMS; i++) {
+        PT_QSEM_WAIT(t, &empty);
+        consumed_sum += buffer[tail];
+        tail = (tail + 1) % BUFSIZE;
+        PT_QSEM_SIGNAL(t, &full);
+    }
+    PT_END(&t->pt);
+}
+
+/* Test: Producer-consumer completes with wait-queue semaphores */
+void test_qsem_producer_consumer(void) {
+    struct pt_sched s;
+    struct pt_task prod, cons;
+    int passes = 0;
+    pt_sched_init(&s);
+    PT_QSEM_INIT(&full, BUFSIZE);
+    PT_QSEM_INIT(&empty, 0);
+    head = tail = 0;
+    produced_sum = consumed_sum = 0;
+
+    pt_sched_spawn(&s, &prod, producer);
+    pt_sched_spawn(&s, &cons, consumer);
+    while (!pt_sched_idle(&s) && passes < 100) {
+        pt_sched_run(&s);
+        passes++;
+    }
+
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_IDLE, prod.state);
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_IDLE, cons.state);
+    TEST_ASSERT_EQUAL_INT(NUM_ITEMS * (NUM_ITEMS + 1) / 2, produced_sum);
+    TEST_ASSERT_EQUAL_INT(produced_sum, consumed_sum);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_qsem_init);
+    RUN_TEST(test_qsem_wait_takes_permit);
+    RUN_TEST(test_qsem_wait_blocks_when_zero);
+    RUN_TEST(test_qsem_blocked_tasks_are_not_polled);
+    RUN_TEST(test_qsem_blocked_task_ignores_wake);
+    RUN_TEST(test_qsem_signal_wakes_one);
+    RUN_TEST(test_qsem_signal_without_waiters);
+    RUN_TEST(test_qsem_fifo_order);
+    RUN_TEST(test_qsem_producer_consumer);
+    return UNITY_END();
+}
@@ -0,0 +1,183 @@
+#include "unity.h"
+#include "pt-remote.h"
+
+#include <pthread.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static struct pt_sched sched;
+static struct pt_remote remote;
+
+struct remote_task {
+    struct pt_task task;
+    struct pt_remote_node node;
+    atomic_uint posted;
+    unsigned consumed;
+    unsigned target;
+    int runs;
+};
+
+/* Thread that consumes everything posted to it until it reaches its target */
+static PT_THREAD(thread_consumes(struct pt_task *t)) {
+    struct remote_task *rt = (struct remote_task *)t;
+    rt->runs++;
+    PT_BEGIN(&t->pt);
+    while (rt->consumed < rt->target) {
+        PT_WAIT_UNTIL(&t->pt, atomic_load(&rt->posted) != rt->consumed);
+        rt->consumed = atomic_load(&rt->posted);
+    }
+    PT_END(&t->pt);
+}
+
+static void start(struct remote_task *rt, int n, unsigned target) {
+    int i;
+    pt_sched_init(&sched);
+    TEST_ASSERT_EQUAL_INT(0, pt_remote_init(&remote, &sched));
+    for (i = 0; i < n; i++) {
+        rt[i].consumed = 0;
+        rt[i].target = target;
+        rt[i].runs = 0;
+        atomic_init(&rt[i].posted, 0);
+        pt_sched_spawn(&sched, &rt[i].task, thread_consumes);
+        pt_remote_node_init(&rt[i].node, &rt[i].task);
+    }
+    pt_sched_run(&sched);
+}
+
+static void post(struct remote_task *rt) {
+    atomic_fetch_add(&rt->posted, 1);
+    pt_remote_wake(&remote, &rt->node);
+}
+
+/* Test: Remote wake is delivered by drain */
+void test_remote_wake_and_drain(void) {
+    struct remote_task rt[1];
+    start(rt, 1, 1);
+    TEST_ASSERT_TRUE(pt_sched_idle(&sched));
+    TEST_ASSERT_TRUE(pt_remote_empty(&remote));
+
+    post(&rt[0]);
+    TEST_ASSERT_FALSE(pt_remote_empty(&remote));
+    TEST_ASSERT_TRUE(pt_sched_idle(&sched));
+
+    TEST_ASSERT_EQUAL_UINT32(1, pt_remote_drain(&remote));
+    TEST_ASSERT_TRUE(pt_remote_empty(&remote));
+    pt_sched_run(&sched);
+    TEST_ASSERT_EQUAL_UINT(1, rt[0].consumed);
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_IDLE, rt[0].task.state);
+    pt_remote_close(&remote);
+}
+
+/* Test: Repeated wakes before a drain wake the task once */
+void test_remote_wakes_are_coalesced(void) {
+    struct remote_task rt[1];
+    start(rt, 1, 3);
+
+    post(&rt[0]);
+    post(&rt[0]);
+    post(&rt[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, pt_remote_drain(&remote));
+    pt_sched_run(&sched);
+
+    TEST_ASSERT_EQUAL_INT(2, rt[0].runs);
+    TEST_ASSERT_EQUAL_UINT(3, rt[0].consumed);
+    pt_remote_close(&remote);
+}
+
+/* Test: A node can be posted again after it has been drained */
+void test_remote_node_reused_after_drain(void) {
+    struct remote_task rt[2];
+    start(rt, 2, 2);
+
+    post(&rt[0]);
+    post(&rt[1]);
+    TEST_ASSERT_EQUAL_UINT32(2, pt_remote_drain(&remote));
+    pt_sched_run(&sched);
+
+    post(&rt[1]);
+    post(&rt[0]);
+    TEST_ASSERT_EQUAL_UINT32(2, pt_remote_drain(&remote));
+    pt_sched_run(&sched);
+
+    TEST_ASSERT_EQUAL_UINT(2, rt[0].consumed);
+    TEST_ASSERT_EQUAL_UINT(2, rt[1].consumed);
+    TEST_ASSERT_TRUE(pt_sched_idle(&sched));
+    pt_remote_close(&remote);
+}
+
+/* Test: Wait returns at once if a wake is pending, and times out otherwise */
+void test_remote_wait(void) {
+    struct remote_task rt[1];
+    start(rt, 1, 1);
+
+    pt_remote_wait(&remote, 0);
+    TEST_ASSERT_TRUE(pt_remote_empty(&remote));
+
+    post(&rt[0]);
+    pt_remote_wait(&remote, -1);
+    TEST_ASSERT_EQUAL_UINT32(1, pt_remote_drain(&remote));
+    pt_remote_close(&remote);
+}
+
+/* Producers in other threads */
+#define PRODUCERS 4
+#define POSTS 20000
+
+static void *producer_main(void *arg) {
+    struct remote_task *rt = arg;
+    int i;
+    for (i = 0; i < POSTS; i++) {
+        post(rt);
+    }
+    return NULL;
+}
+
+/* Test: Wakes from several threads are never lost */
+void test_remote_wake_from_threads(void) {
+    struct remote_task rt[PRODUCERS];
+    pthread_t threads[PRODUCERS];
+    int timeouts = 0;
+    int done = 0;
+    int i;
+    start(rt, PRODUCERS, POSTS);
+
+    for (i = 0; i < PRODUCERS; i++) {
+        pthread_create(&threads[i], NULL, producer_main, &rt[i]);
+    }
+    while (done < PRODUCERS && timeouts < 10) {
+        if (pt_remote_drain(&remote) > 0) {
+            timeouts = 0;
+        }
+        pt_sched_run(&sched);
+        if (pt_sched_idle(&sched)) {
+            /* Only a lost wakeup makes the waits time out repeatedly */
+            pt_remote_wait(&remote, 100);
+            if (pt_remote_empty(&remote)) {
+                timeouts++;
+            }
+        }
+        for (done = 0, i = 0; i < PRODUCERS; i++) {
+            done += rt[i].task.state == PT_TASK_IDLE;
+        }
+    }
+    for (i = 0; i < PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    TEST_ASSERT_EQUAL_INT(PRODUCERS, done);
+    for (i = 0; i < PRODUCERS; i++) {
+        TEST_ASSERT_EQUAL_UINT(POSTS, rt[i].consumed);
+    }
+    pt_remote_close(&remote);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_remote_wake_and_drain);
+    RUN_TEST(test_remote_wakes_are_coalesced);
+    RUN_TEST(test_remote_node_reused_after_drain);
+    RUN_TEST(test_remote_wait);
+    RUN_TEST(test_remote_wake_from_threads);
+    return UNITY_END();
+}
@@ -0,0 +1,222 @@
+#include "unity.h"
+#include "pt-rwlock.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static struct pt_rwlock rw;
+
+struct rw_task {
+    struct pt_task task;
+    int id;
+    int runs;
+    int held;
+};
+
+/* Order in which tasks got the lock: id, negative for writers */
+static int order[16], order_len;
+
+/* Thread that holds the lock for reading across one yield */
+static PT_THREAD(thread_reader(struct pt_task *t)) {
+    struct rw_task *rt = (struct rw_task *)t;
+    rt->runs++;
+    PT_BEGIN(&t->pt);
+    PT_RWLOCK_READ(t, &rw);
+    TEST_ASSERT_NULL(pt_rwlock_writer(&rw));
+    rt->held = 1;
+    order[order_len++] = rt->id;
+    PT_YIELD(&t->pt);
+    rt->held = 0;
+    PT_RWLOCK_READ_UNLOCK(t, &rw);
+    PT_END(&t->pt);
+}
+
+/* Thread that holds the lock for writing across one yield */
+static PT_THREAD(thread_writer(struct pt_task *t)) {
+    struct rw_task *rt = (struct rw_task *)t;
+    rt->runs++;
+    PT_BEGIN(&t->pt);
+    PT_RWLOCK_WRITE(t, &rw);
+    TEST_ASSERT_EQUAL_PTR(t, pt_rwlock_writer(&rw));
+    TEST_ASSERT_EQUAL_UINT32(0, pt_rwlock_readers(&rw));
+    rt->held = 1;
+    order[order_len++] = -rt->id;
+    PT_YIELD(&t->pt);
+    rt->held = 0;
+    PT_RWLOCK_WRITE_UNLOCK(t, &rw);
+    PT_END(&t->pt);
+}
+
+static void spawn(struct pt_sched *s, struct rw_task *rt, int id, pt_task_fn fn) {
+    *rt = (struct rw_task){0};
+    rt->id = id;
+    pt_sched_spawn(s, &rt->task, fn);
+}
+
+static void run_all(struct pt_sched *s) {
+    int passes = 0;
+    while (!pt_sched_idle(s) && passes++ < 100) {
+        pt_sched_run(s);
+    }
+}
+
+static void reset(struct pt_sched *s) {
+    pt_sched_init(s);
+    PT_RWLOCK_INIT(&rw);
+    order_len = 0;
+}
+
+/* Test: PT_RWLOCK_INIT leaves the lock free */
+void test_rwlock_init(void) {
+    PT_RWLOCK_INIT(&rw);
+    TEST_ASSERT_EQUAL_UINT32(0, pt_rwlock_readers(&rw));
+    TEST_ASSERT_NULL(pt_rwlock_writer(&rw));
+    TEST_ASSERT_EQUAL_UINT32(0, rw.readq.count);
+    TEST_ASSERT_EQUAL_UINT32(0, rw.writeq.count);
+}
+
+/* Test: Readers hold the lock together */
+void test_rwlock_readers_share(void) {
+    struct pt_sched s;
+    struct rw_task r[3];
+    int i;
+    reset(&s);
+    for (i = 0; i < 3; i++) {
+        spawn(&s, &r[i], i + 1, thread_reader);
+    }
+
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_UINT32(3, pt_rwlock_readers(&rw));
+    for (i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_INT(1, r[i].held);
+    }
+    run_all(&s);
+    TEST_ASSERT_EQUAL_UINT32(0, pt_rwlock_readers(&rw));
+}
+
+/* Test: A writer excludes readers, which are admitted together when it unlocks */
+void test_rwlock_writer_admits_readers(void) {
+    struct pt_sched s;
+    struct rw_task w, r[3];
+    int i;
+    reset(&s);
+    spawn(&s, &w, 1, thread_writer);
+    for (i = 0; i < 3; i++) {
+        spawn(&s, &r[i], i + 1, thread_reader);
+    }
+
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_PTR(&w.task, pt_rwlock_writer(&rw));
+    TEST_ASSERT_EQUAL_UINT32(3, rw.readq.count);
+    for (i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_UINT8(PT_TASK_BLOCKED, r[i].task.state);
+    }
+
+    pt_sched_run(&s);
+    TEST_ASSERT_NULL(pt_rwlock_writer(&rw));
+    TEST_ASSERT_EQUAL_UINT32(3, pt_rwlock_readers(&rw));
+    TEST_ASSERT_EQUAL_UINT32(3, pt_sched_run(&s));
+    for (i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_INT(1, r[i].held);
+        TEST_ASSERT_EQUAL_INT(2, r[i].runs);
+    }
+    run_all(&s);
+    TEST_ASSERT_EQUAL_UINT32(0, pt_rwlock_readers(&rw));
+}
+
+/* Test: The last reader hands the lock to a waiting writer, and later readers queue behind it */
+void test_rwlock_writer_preference(void) {
+    struct pt_sched s;
+    struct rw_task r1, w, r2;
+    reset(&s);
+    spawn(&s, &r1, 1, thread_reader);
+    spawn(&s, &w, 1, thread_writer);
+    spawn(&s, &r2, 2, thread_reader);
+
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_UINT32(1, pt_rwlock_readers(&rw));
+    TEST_ASSERT_EQUAL_UINT32(1, rw.writeq.count);
+    TEST_ASSERT_EQUAL_UINT32(1, rw.readq.count);
+    TEST_ASSERT_EQUAL_INT(0, r2.held);
+
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_PTR(&w.task, pt_rwlock_writer(&rw));
+
+    run_all(&s);
+    TEST_ASSERT_EQUAL_INT(3, order_len);
+    TEST_ASSERT_EQUAL_INT(1, order[0]);
+    TEST_ASSERT_EQUAL_INT(-1, order[1]);
+    TEST_ASSERT_EQUAL_INT(2, order[2]);
+}
+
+/* Test: A writer with no readers waiting hands the lock to the next writer in FIFO order */
+void test_rwlock_writers_fifo(void) {
+    struct pt_sched s;
+    struct rw_task w[3];
+    int i;
+    reset(&s);
+    for (i = 0; i < 3; i++) {
+        spawn(&s, &w[i], i + 1, thread_writer);
+    }
+
+    run_all(&s);
+    TEST_ASSERT_EQUAL_INT(3, order_len);
+    TEST_ASSERT_EQUAL_INT(2, w[0].runs);
+    for (i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_INT(-(i + 1), order[i]);
+    }
+    TEST_ASSERT_EQUAL_INT(3, w[2].runs);
+    TEST_ASSERT_NULL(pt_rwlock_writer(&rw));
+}
+
+/* Test: Readers and writers alternate in phases; a writer admits every waiting reader */
+void test_rwlock_phases(void) {
+    struct pt_sched s;
+    struct rw_task w[2], r[4];
+    static const int expected[] = { -1, 1, 2, 3, -2, 4 };
+    int i;
+    reset(&s);
+    spawn(&s, &w[0], 1, thread_writer);
+    spawn(&s, &r[0], 1, thread_reader);
+    spawn(&s, &r[1], 2, thread_reader);
+    spawn(&s, &w[1], 2, thread_writer);
+    spawn(&s, &r[2], 3, thread_reader);
+
+    pt_sched_run(&s);
+    spawn(&s, &r[3], 4, thread_reader);
+    run_all(&s);
+
+    TEST_ASSERT_EQUAL_INT(6, order_len);
+    for (i = 0; i < 6; i++) {
+        TEST_ASSERT_EQUAL_INT(expected[i], order[i]);
+    }
+}
+
+/* Test: tryread and trywrite only take a lock that is available */
+void test_rwlock_try(void) {
+    struct pt_task a, b;
+    PT_RWLOCK_INIT(&rw);
+    TEST_ASSERT_TRUE(pt_rwlock_tryread(&rw));
+    TEST_ASSERT_TRUE(pt_rwlock_tryread(&rw));
+    TEST_ASSERT_FALSE(pt_rwlock_trywrite(&rw, &a));
+    pt_rwlock_read_unlock(&rw);
+    pt_rwlock_read_unlock(&rw);
+    TEST_ASSERT_TRUE(pt_rwlock_trywrite(&rw, &a));
+    TEST_ASSERT_FALSE(pt_rwlock_trywrite(&rw, &b));
+    TEST_ASSERT_FALSE(pt_rwlock_tryread(&rw));
+    pt_rwlock_write_unlock(&rw);
+    TEST_ASSERT_NULL(pt_rwlock_writer(&rw));
+    TEST_ASSERT_TRUE(pt_rwlock_tryread(&rw));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_rwlock_init);
+    RUN_TEST(test_rwlock_readers_share);
+    RUN_TEST(test_rwlock_writer_admits_readers);
+    RUN_TEST(test_rwlock_writer_preference);
+    RUN_TEST(test_rwlock_writers_fifo);
+    RUN_TEST(test_rwlock_phases);
+    RUN_TEST(test_rwlock_try);
+    return UNITY_END();
+}
@@ -0,0 +1,693 @@
+#include <string.h>
+
+#include "unity.h"
+#include "pt-sched.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+struct counter_task {
+    struct pt_task task;
+    int flag;
+    int runs;
+    int steps;
+};
+
+/* Thread that waits for its flag, then ends */
+static PT_THREAD(thread_waits_for_flag(struct pt_task *t)) {
+    struct counter_task *c = (struct counter_task *)t;
+    c->runs++;
+    PT_BEGIN(&t->pt);
+    PT_WAIT_UNTIL(&t->pt, c->flag);
+    c->steps++;
+    PT_END(&t->pt);
+}
+
+/* Thread that yields a few times, then ends */
+static PT_THREAD(thread_yields_three_times(struct pt_task *t)) {
+    struct counter_task *c = (struct counter_task *)t;
+    c->runs++;
+    PT_BEGIN(&t->pt);
+    PT_YIELD(&t->pt);
+    PT_YIELD(&t->pt);
+    PT_YIELD(&t->pt);
+    c->steps++;
+    PT_END(&t->pt);
+}
+
+/* Thread that wakes itself before waiting */
+static PT_THREAD(thread_wakes_itself(struct pt_task *t)) {
+    struct counter_task *c = (struct counter_task *)t;
+    c->runs++;
+    PT_BEGIN(&t->pt);
+    c->flag = 1;
+    pt_task_wake(t);
+    PT_WAIT_UNTIL(&t->pt, 0);
+    PT_END(&t->pt);
+}
+
+/* Test: Spawned task is runnable and runs once per pass */
+void test_spawn_makes_task_runnable(void) {
+    struct pt_sched s;
+    struct counter_task c = {0};
+    pt_sched_init(&s);
+    TEST_ASSERT_TRUE(pt_sched_idle(&s));
+
+    pt_sched_spawn(&s, &c.task, thread_yields_three_times);
+    TEST_ASSERT_FALSE(pt_sched_idle(&s));
+    TEST_ASSERT_EQUAL_UINT32(1, pt_sched_run(&s));
+    TEST_ASSERT_EQUAL_INT(1, c.runs);
+}
+
+/* Test: Yielded task stays runnable until it ends */
+void test_yielded_task_runs_until_ended(void) {
+    struct pt_sched s;
+    struct counter_task c = {0};
+    pt_sched_init(&s);
+    pt_sched_spawn(&s, &c.task, thread_yields_three_times);
+
+    while (!pt_sched_idle(&s) && c.runs < 10) {
+        pt_sched_run(&s);
+    }
+
+    TEST_ASSERT_EQUAL_INT(4, c.runs);
+    TEST_ASSERT_EQUAL_INT(1, c.steps);
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_IDLE, c.task.state);
+}
+
+/* Test: Waiting task is parked and not polled */
+void test_waiting_task_is_parked(void) {
+    struct pt_sched s;
+    struct counter_task c = {0};
+    int i;
+    pt_sched_init(&s);
+    pt_sched_spawn(&s, &c.task, thread_waits_for_flag);
+
+    for (i = 0; i < 5; i++) {
+        pt_sched_run(&s);
+    }
+
+    TEST_ASSERT_EQUAL_INT(1, c.runs);
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_PARKED, c.task.state);
+    TEST_ASSERT_TRUE(pt_sched_idle(&s));
+}
+
+/* Test: Wake makes a parked task run again */
+void test_wake_resumes_parked_task(void) {
+    struct pt_sched s;
+    struct counter_task c = {0};
+    pt_sched_init(&s);
+    pt_sched_spawn(&s, &c.task, thread_waits_for_flag);
+    pt_sched_run(&s);
+
+    c.flag = 1;
+    pt_task_wake(&c.task);
+    TEST_ASSERT_EQUAL_UINT32(1, pt_sched_run(&s));
+
+    TEST_ASSERT_EQUAL_INT(2, c.runs);
+    TEST_ASSERT_EQUAL_INT(1, c.steps);
+    TEST_ASSERT_TRUE(pt_sched_idle(&s));
+}
+
+/* Test: Spurious wake re-evaluates the condition and parks again */
+void test_spurious_wake_parks_again(void) {
+    struct pt_sched s;
+    struct counter_task c = {0};
+    pt_sched_init(&s);
+    pt_sched_spawn(&s, &c.task, thread_waits_for_flag);
+    pt_sched_run(&s);
+
+    pt_task_wake(&c.task);
+    pt_sched_run(&s);
+
+    TEST_ASSERT_EQUAL_INT(2, c.runs);
+    TEST_ASSERT_EQUAL_INT(0, c.steps);
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_PARKED, c.task.state);
+}
+
+/* Test: Waking a runnable task twice does not queue it twice */
+void test_double_wake_queues_once(void) {
+    struct pt_sched s;
+    struct counter_task c = {0};
+    pt_sched_init(&s);
+    pt_sched_spawn(&s, &c.task, thread_waits_for_flag);
+    pt_sched_run(&s);
+
+    pt_task_wake(&c.task);
+    pt_task_wake(&c.task);
+    TEST_ASSERT_EQUAL_UINT32(1, pt_sched_run(&s));
+}
+
+/* Test: Wake while running is not lost */
+void test_wake_while_running_is_not_lost(void) {
+    struct pt_sched s;
+    struct counter_task c = {0};
+    pt_sched_init(&s);
+    pt_sched_spawn(&s, &c.task, thread_wakes_itself);
+    pt_sched_run(&s);
+
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_READY, c.task.state);
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_INT(2, c.runs);
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_PARKED, c.task.state);
+}
+
+/* Test: Only the woken task of many is run */
+void test_only_woken_tasks_run(void) {
+    struct pt_sched s;
+    struct counter_task c[8];
+    int i;
+    pt_sched_init(&s);
+    for (i = 0; i < 8; i++) {
+        c[i] = (struct counter_task){0};
+        pt_sched_spawn(&s, &c[i].task, thread_waits_for_flag);
+    }
+    TEST_ASSERT_EQUAL_UINT32(8, pt_sched_run(&s));
+
+    c[3].flag = 1;
+    pt_task_wake(&c[3].task);
+    TEST_ASSERT_EQUAL_UINT32(1, pt_sched_run(&s));
+
+    for (i = 0; i < 8; i++) {
+        TEST_ASSERT_EQUAL_INT(i == 3 ? 2 : 1, c[i].runs);
+    }
+}
+
+/* Test: Tasks run in FIFO order */
+static int order[4], order_len;
+static PT_THREAD(thread_records_order(struct pt_task *t)) {
+    struct counter_task *c = (struct counter_task *)t;
+    PT_BEGIN(&t->pt);
+    order[order_len++] = c->flag;
+    PT_END(&t->pt);
+}
+
+void test_tasks_run_in_fifo_order(void) {
+    struct pt_sched s;
+    struct counter_task c[4];
+    int i;
+    pt_sched_init(&s);
+    order_len = 0;
+    for (i = 0; i < 4; i++) {
+        c[i] = (struct counter_task){0};
+        c[i].flag = i;
+        pt_sched_spawn(&s, &c[i].task, thread_records_order);
+    }
+    pt_sched_run(&s);
+
+    TEST_ASSERT_EQUAL_INT(4, order_len);
+    for (i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_INT(i, order[i]);
+    }
+}
+
+/* Thread that blocks on a wait queue, then counts a step */
+static struct pt_waitq waitq;
+static PT_THREAD(thread_blocks_on_waitq(struct pt_task *t)) {
+    struct counter_task *c = (struct counter_task *)t;
+    c->runs++;
+    PT_BEGIN(&t->pt);
+    pt_waitq_push(&waitq, t);
+    PT_BLOCK(t);
+    c->steps++;
+    PT_END(&t->pt);
+}
+
+/* Test: Wait queue wakes one task at a time in FIFO order */
+void test_waitq_wake_one(void) {
+    struct pt_sched s;
+    struct counter_task c[3];
+    int i;
+    pt_sched_init(&s);
+    pt_waitq_init(&waitq);
+    for (i = 0; i < 3; i++) {
+        c[i] = (struct counter_task){0};
+        pt_sched_spawn(&s, &c[i].task, thread_blocks_on_waitq);
+    }
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_UINT32(3, waitq.count);
+
+    TEST_ASSERT_EQUAL_PTR(&c[0].task, pt_waitq_wake_one(&waitq));
+    TEST_ASSERT_EQUAL_UINT32(1, pt_sched_run(&s));
+    TEST_ASSERT_EQUAL_INT(1, c[0].steps);
+    TEST_ASSERT_EQUAL_INT(0, c[1].steps);
+    TEST_ASSERT_EQUAL_UINT32(2, waitq.count);
+}
+
+/* Test: Wait queue wakes all tasks with one splice */
+void test_waitq_wake_all(void) {
+    struct pt_sched s;
+    struct counter_task c[4];
+    int i;
+    pt_sched_init(&s);
+    pt_waitq_init(&waitq);
+    for (i = 0; i < 4; i++) {
+        c[i] = (struct counter_task){0};
+        pt_sched_spawn(&s, &c[i].task, thread_blocks_on_waitq);
+    }
+    pt_sched_run(&s);
+
+    TEST_ASSERT_EQUAL_UINT32(4, pt_waitq_wake_all(&waitq));
+    TEST_ASSERT_EQUAL_UINT32(0, waitq.count);
+    TEST_ASSERT_NULL(pt_waitq_wake_one(&waitq));
+    TEST_ASSERT_EQUAL_UINT32(4, pt_sched_run(&s));
+    for (i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_INT(1, c[i].steps);
+        TEST_ASSERT_EQUAL_UINT8(PT_TASK_IDLE, c[i].task.state);
+    }
+}
+
+/* Thread that records its flag each time it runs, yielding a few times */
+static int prio_order[64], prio_order_len;
+static PT_THREAD(thread_records_runs(struct pt_task *t)) {
+    struct counter_task *c = (struct counter_task *)t;
+    prio_order[prio_order_len++] = c->flag;
+    PT_BEGIN(&t->pt);
+    while (++c->steps < 3) {
+        PT_YIELD(&t->pt);
+    }
+    PT_END(&t->pt);
+}
+
+/* Test: Higher-priority tasks run first, FIFO within a level */
+void test_priority_order(void) {
+    static const unsigned prios[6] = { 5, 1, 5, 0, 1, PT_SCHED_LEVELS - 1 };
+    static const int expected[] = { 3, 3, 3, 1, 4, 1, 4, 1, 4, 0, 2, 0, 2, 0, 2, 5, 5, 5 };
+    struct pt_sched s;
+    struct counter_task c[6];
+    int i;
+    pt_sched_init(&s);
+    prio_order_len = 0;
+    for (i = 0; i < 6; i++) {
+        c[i] = (struct counter_task){0};
+        c[i].flag = i;
+        pt_sched_spawn_prio(&s, &c[i].task, thread_records_runs, prios[i]);
+    }
+    while (!pt_sched_idle(&s)) {
+        pt_sched_run_one(&s);
+    }
+
+    TEST_ASSERT_EQUAL_INT(18, prio_order_len);
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected, prio_order, 18);
+}
+
+/* Test: A new priority takes effect when the task yields */
+void test_set_priority(void) {
+    struct pt_sched s;
+    struct counter_task c[2];
+    int i;
+    pt_sched_init(&s);
+    prio_order_len = 0;
+    for (i = 0; i < 2; i++) {
+        c[i] = (struct counter_task){0};
+        c[i].flag = i;
+        pt_sched_spawn_prio(&s, &c[i].task, thread_records_runs, 3);
+    }
+    pt_task_set_prio(&c[1].task, 2);
+    pt_sched_run_one(&s);
+    pt_sched_run_one(&s);
+    pt_sched_run_one(&s);
+
+    TEST_ASSERT_EQUAL_INT(3, prio_order_len);
+    TEST_ASSERT_EQUAL_INT(0, prio_order[0]);
+    TEST_ASSERT_EQUAL_INT(1, prio_order[1]);
+    TEST_ASSERT_EQUAL_INT(1, prio_order[2]);
+}
+
+/* Thread that yields forever */
+static PT_THREAD(thread_spins(struct pt_task *t)) {
+    struct counter_task *c = (struct counter_task *)t;
+    c->runs++;
+    PT_BEGIN(&t->pt);
+    for (;;) {
+        PT_YIELD(&t->pt);
+    }
+    PT_END(&t->pt);
+}
+
+/* Test: Strict priorities starve lower levels until aging is enabled */
+void test_aging_prevents_starvation(void) {
+    struct pt_sched s;
+    struct counter_task busy = {0}, low = {0};
+    int i;
+    pt_sched_init(&s);
+    pt_sched_spawn_prio(&s, &busy.task, thread_spins, 0);
+    pt_sched_spawn_prio(&s, &low.task, thread_spins, 4);
+
+    for (i = 0; i < 100; i++) {
+        pt_sched_run_one(&s);
+    }
+    TEST_ASSERT_EQUAL_INT(100, busy.runs);
+    TEST_ASSERT_EQUAL_INT(0, low.runs);
+
+    /* One promotion every 10 runs: level 4 reaches level 0 in 40 runs */
+    pt_sched_set_aging(&s, 10);
+    for (i = 0; i < 41; i++) {
+        pt_sched_run_one(&s);
+    }
+    TEST_ASSERT_EQUAL_INT(1, low.runs);
+    TEST_ASSERT_EQUAL_INT(140, busy.runs);
+
+    /* It is back at its own priority after it ran */
+    for (i = 0; i < 39; i++) {
+        pt_sched_run_one(&s);
+    }
+    TEST_ASSERT_EQUAL_INT(1, low.runs);
+}
+
+/* Test: Waiters of different priorities are woken into their own levels */
+void test_waitq_wake_all_mixed(void) {
+    static const unsigned prios[4] = { 7, 2, 7, 2 };
+    static const int expected[] = { 1, 3, 0, 2 };
+    struct pt_sched s;
+    struct counter_task c[4];
+    int i;
+    pt_sched_init(&s);
+    pt_waitq_init(&waitq);
+    for (i = 0; i < 4; i++) {
+        c[i] = (struct counter_task){0};
+        pt_sched_spawn_prio(&s, &c[i].task, thread_blocks_on_waitq, prios[i]);
+    }
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_UINT8(1, waitq.mixed);
+
+    TEST_ASSERT_EQUAL_UINT32(4, pt_waitq_wake_all(&waitq));
+    for (i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_INT(0, c[expected[i]].steps);
+        pt_sched_run_one(&s);
+        TEST_ASSERT_EQUAL_INT(1, c[expected[i]].steps);
+    }
+    TEST_ASSERT_TRUE(pt_sched_idle(&s));
+}
+
+/* Thread that declares the deadline in its flag, blocks, then records */
+static PT_THREAD(thread_yields_deadline(struct pt_task *t)) {
+    struct counter_task *c = (struct counter_task *)t;
+    PT_BEGIN(&t->pt);
+    PT_YIELD_DEADLINE(t, (uint32_t)c->flag);
+    pt_waitq_push(&waitq, t);
+    PT_BLOCK(t);
+    prio_order[prio_order_len++] = c->flag;
+    PT_END(&t->pt);
+}
+
+/* Test: Tasks with deadlines run earliest first, before any priority */
+void test_deadline_order(void) {
+    static const int deadlines[5] = { 30, 10, 50, 20, 40 };
+    struct pt_sched s;
+    struct counter_task c[5], urgent = {0};
+    int i;
+    pt_sched_init(&s);
+    pt_waitq_init(&waitq);
+    prio_order_len = 0;
+    for (i = 0; i < 5; i++) {
+        c[i] = (struct counter_task){0};
+        c[i].flag = deadlines[i];
+        pt_sched_spawn(&s, &c[i].task, thread_yields_deadline);
+    }
+    while (waitq.count < 5) {
+        pt_sched_run_one(&s);
+    }
+    TEST_ASSERT_TRUE(pt_sched_idle(&s));
+
+    TEST_ASSERT_EQUAL_UINT32(5, pt_waitq_wake_all(&waitq));
+    urgent.flag = 99;
+    pt_sched_spawn_prio(&s, &urgent.task, thread_records_runs, 0);
+    for (i = 0; i < 5; i++) {
+        pt_sched_run_one(&s);
+    }
+
+    for (i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL_INT(10 * (i + 1), prio_order[i]);
+    }
+    TEST_ASSERT_EQUAL_INT(0, urgent.steps);
+    TEST_ASSERT_EQUAL_UINT32(0, pt_sched_misses(&s));
+}
+
+/* Test: The deadline heap stays ordered through many inserts and removals */
+void test_deadline_heap(void) {
+    enum { TASKS = 200 };
+    static struct pt_task tasks[TASKS];
+    struct pt_task *removed[TASKS / 2];
+    struct pt_sched s;
+    struct pt_task *t;
+    uint32_t seed = 12345, last = 0;
+    int i;
+    pt_sched_init(&s);
+    /* Deadlines wrap around */
+    s.wheel.now = 0xfffff000u;
+    for (i = 0; i < TASKS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        tasks[i].sched = &s;
+        tasks[i].edf = 0;
+        pt_task_next_deadline(&tasks[i], s.wheel.now + (seed >> 16) % 10000);
+        pt_sched_enqueue(&s, &tasks[i]);
+    }
+    for (i = 0; i < TASKS / 2; i++) {
+        t = pt_sched_edf_remove(&s);
+        TEST_ASSERT_TRUE(i == 0 || (int32_t)(t->deadline - last) >= 0);
+        last = t->deadline;
+        removed[i] = t;
+    }
+    for (i = 0; i < TASKS / 2; i++) {
+        removed[i]->deadline += 20000;
+        pt_sched_enqueue(&s, removed[i]);
+    }
+    for (i = 0; i < TASKS; i++) {
+        t = pt_sched_edf_remove(&s);
+        TEST_ASSERT_TRUE((int32_t)(t->deadline - last) >= 0);
+        last = t->deadline;
+    }
+    TEST_ASSERT_NULL(s.edf);
+}
+
+/* Periodic thread that does one job per period */
+static PT_THREAD(thread_periodic(struct pt_task *t)) {
+    struct counter_task *c = (struct counter_task *)t;
+    PT_BEGIN(&t->pt);
+    for (;;) {
+        c->runs++;
+        PT_WAIT_PERIOD(t, (uint32_t)c->flag);
+    }
+    PT_END(&t->pt);
+}
+
+/* Test: A periodic task runs once per period and late jobs are counted */
+void test_periodic_misses(void) {
+    struct pt_sched s;
+    struct counter_task c = {0};
+    int i;
+    pt_sched_init(&s);
+    c.flag = 10;
+    pt_sched_spawn(&s, &c.task, thread_periodic);
+
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_INT(1, c.runs);
+    TEST_ASSERT_TRUE(pt_sched_idle(&s));
+    for (i = 0; i < 100; i++) {
+        pt_sched_advance(&s, 1);
+        pt_sched_run(&s);
+    }
+    TEST_ASSERT_EQUAL_INT(11, c.runs);
+    TEST_ASSERT_EQUAL_UINT32(0, pt_sched_misses(&s));
+
+    /* Released at 110 and due at 120, but only run at 125 */
+    pt_sched_advance(&s, 25);
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_INT(12, c.runs);
+    TEST_ASSERT_EQUAL_UINT32(1, pt_sched_misses(&s));
+    /* The job released at 120 is due at 130 and runs at once */
+    TEST_ASSERT_FALSE(pt_sched_idle(&s));
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_INT(13, c.runs);
+    TEST_ASSERT_EQUAL_UINT32(1, pt_sched_misses(&s));
+    TEST_ASSERT_TRUE(pt_sched_idle(&s));
+}
+
+/* Thread that records its flag each time it runs, forever */
+static PT_THREAD(thread_records_forever(struct pt_task *t)) {
+    struct counter_task *c = (struct counter_task *)t;
+    prio_order[prio_order_len++] = c->flag;
+    PT_BEGIN(&t->pt);
+    for (;;) {
+        PT_YIELD(&t->pt);
+    }
+    PT_END(&t->pt);
+}
+
+/* Test: Clearing the deadline returns the task to its priority */
+void test_clear_deadline(void) {
+    static const int expected[] = { 0, 1, 1, 1, 0, 1 };
+    struct pt_sched s;
+    struct counter_task c[2];
+    int i;
+    pt_sched_init(&s);
+    prio_order_len = 0;
+    for (i = 0; i < 2; i++) {
+        c[i] = (struct counter_task){0};
+        c[i].flag = i;
+        pt_sched_spawn_prio(&s, &c[i].task, thread_records_forever, 1);
+    }
+    /* Takes effect when the task yields */
+    pt_task_next_deadline(&c[1].task, 5);
+    for (i = 0; i < 3; i++) {
+        pt_sched_run_one(&s);
+    }
+    /* Leaves the heap after its next run */
+    pt_task_clear_deadline(&c[1].task);
+    for (i = 0; i < 3; i++) {
+        pt_sched_run_one(&s);
+    }
+
+    TEST_ASSERT_EQUAL_INT(6, prio_order_len);
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected, prio_order, 6);
+}
+
+static struct counter_task children[4];
+static struct pt_latch latch;
+
+/* Thread that spawns the children and waits for them */
+static PT_THREAD(thread_spawns_all(struct pt_task *t)) {
+    struct counter_task *c = (struct counter_task *)t;
+    c->runs++;
+    PT_BEGIN(&t->pt);
+    PT_SPAWN_ALL(t, &latch, children, 4, thread_yields_three_times);
+    c->steps++;
+    PT_END(&t->pt);
+}
+
+/* Thread that waits for the latch */
+static PT_THREAD(thread_waits_for_latch(struct pt_task *t)) {
+    struct counter_task *c = (struct counter_task *)t;
+    c->runs++;
+    PT_BEGIN(&t->pt);
+    PT_LATCH_WAIT(t, &latch);
+    c->steps++;
+    PT_END(&t->pt);
+}
+
+/* Test: PT_SPAWN_ALL runs the children and wakes the parent once when all have ended */
+void test_spawn_all(void) {
+    struct pt_sched s;
+    struct counter_task parent = {0};
+    int i, passes = 0;
+    pt_sched_init(&s);
+    memset(children, 0, sizeof(children));
+    pt_sched_spawn_prio(&s, &parent.task, thread_spawns_all, 3);
+
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_UINT32(4, latch.count);
+    TEST_ASSERT_EQUAL_UINT8(PT_TASK_BLOCKED, parent.task.state);
+    for (i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_UINT8(3, children[i].task.prio);
+    }
+
+    while (!pt_sched_idle(&s) && passes++ < 20) {
+        pt_sched_run(&s);
+    }
+    TEST_ASSERT_EQUAL_INT(1, parent.steps);
+    TEST_ASSERT_EQUAL_INT(2, parent.runs);
+    TEST_ASSERT_EQUAL_UINT32(0, latch.count);
+    for (i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_INT(1, children[i].steps);
+        TEST_ASSERT_EQUAL_INT(4, children[i].runs);
+    }
+}
+
+/* Test: A latch wakes its waiters when counted down to zero, and an open latch does not block */
+void test_latch_count_down(void) {
+    struct pt_sched s;
+    struct counter_task c[2];
+    int i;
+    pt_sched_init(&s);
+    pt_latch_init(&latch, 2);
+    for (i = 0; i < 2; i++) {
+        c[i] = (struct counter_task){0};
+        pt_sched_spawn(&s, &c[i].task, thread_waits_for_latch);
+    }
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_UINT32(2, latch.waiters.count);
+
+    pt_latch_count_down(&latch);
+    TEST_ASSERT_TRUE(pt_sched_idle(&s));
+    pt_latch_count_down(&latch);
+    TEST_ASSERT_EQUAL_UINT32(2, pt_sched_run(&s));
+    TEST_ASSERT_EQUAL_INT(1, c[0].steps);
+    TEST_ASSERT_EQUAL_INT(1, c[1].steps);
+
+    pt_latch_count_down(&latch);
+    TEST_ASSERT_EQUAL_UINT32(0, latch.count);
+    c[0] = (struct counter_task){0};
+    pt_sched_spawn(&s, &c[0].task, thread_waits_for_latch);
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_INT(1, c[0].steps);
+}
+
+static struct pt_barrier barrier;
+
+/* Thread that passes the barrier twice, recording its flag as id each round */
+static PT_THREAD(thread_barrier_rounds(struct pt_task *t)) {
+    struct counter_task *c = (struct counter_task *)t;
+    c->runs++;
+    PT_BEGIN(&t->pt);
+    for (c->steps = 0; c->steps < 2; c->steps++) {
+        prio_order[prio_order_len++] = c->flag;
+        PT_BARRIER_WAIT(t, &barrier);
+    }
+    PT_END(&t->pt);
+}
+
+/* Test: A barrier holds every task until all have arrived, round after round */
+void test_barrier(void) {
+    static const int expected[] = { 0, 1, 2, 2, 0, 1 };
+    struct pt_sched s;
+    struct counter_task c[3];
+    int i, passes = 0;
+    pt_sched_init(&s);
+    pt_barrier_init(&barrier, 3);
+    prio_order_len = 0;
+    for (i = 0; i < 3; i++) {
+        c[i] = (struct counter_task){0};
+        c[i].flag = i;
+        pt_sched_spawn(&s, &c[i].task, thread_barrier_rounds);
+    }
+
+    /* The last to arrive wakes the others and arrives for the next round */
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_UINT32(1, barrier.waiters.count);
+    TEST_ASSERT_EQUAL_UINT32(1, barrier.arrived);
+
+    while (!pt_sched_idle(&s) && passes++ < 20) {
+        pt_sched_run(&s);
+    }
+    TEST_ASSERT_EQUAL_INT(6, prio_order_len);
+    TEST_ASSERT_EQUAL_INT_ARRAY(expected, prio_order, 6);
+    TEST_ASSERT_EQUAL_UINT32(0, barrier.waiters.count);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_spawn_makes_task_runnable);
+    RUN_TEST(test_yielded_task_runs_until_ended);
+    RUN_TEST(test_waiting_task_is_parked);
+    RUN_TEST(test_wake_resumes_parked_task);
+    RUN_TEST(test_spurious_wake_parks_again);
+    RUN_TEST(test_double_wake_queues_once);
+    RUN_TEST(test_wake_while_running_is_not_lost);
+    RUN_TEST(test_only_woken_tasks_run);
+    RUN_TEST(test_tasks_run_in_fifo_order);
+    RUN_TEST(test_waitq_wake_one);
+    RUN_TEST(test_waitq_wake_all);
+    RUN_TEST(test_priority_order);
+    RUN_TEST(test_set_priority);
+    RUN_TEST(test_aging_prevents_starvation);
+    RUN_TEST(test_waitq_wake_all_mixed);
+    RUN_TEST(test_deadline_order);
+    RUN_TEST(test_deadline_heap);
+    RUN_TEST(test_periodic_misses);
+    RUN_TEST(test_clear_deadline);
+    RUN_TEST(test_spawn_all);
+    RUN_TEST(test_latch_count_down);
+    RUN_TEST(test_barrier);
+    return UNITY_END();
+}
@@ -0,0 +1,179 @@
+#include <stdint.h>
+
+/* A clock that only moves when the test says so */
+static uint64_t now_ns;
+#define PT_STATS_NOW() (now_ns)
+
+#include "unity.h"
+#include "pt-sched.h"
+
+#include <string.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static int ready;
+
+static PT_THREAD(worker(struct pt *pt)) {
+    PT_BEGIN(pt);
+    now_ns += 100;
+    PT_YIELD(pt);
+    now_ns += 50;
+    PT_WAIT_UNTIL(pt, ready);
+    now_ns += 300;
+    PT_YIELD(pt);
+    PT_END(pt);
+}
+
+static PT_THREAD(idle(struct pt *pt)) {
+    PT_BEGIN(pt);
+    now_ns += 10;
+    PT_YIELD(pt);
+    PT_END(pt);
+}
+
+static PT_THREAD(parent(struct pt *pt, struct pt *child)) {
+    PT_BEGIN(pt);
+    PT_SPAWN(pt, child, idle(child));
+    PT_EXIT(pt);
+    PT_END(pt);
+}
+
+/* Test: Counters follow what the protothread returns */
+void test_counters(void) {
+    struct pt pt;
+    PT_INIT(&pt);
+    ready = 0;
+
+    TEST_ASSERT_EQUAL(PT_YIELDED, worker(&pt));
+    TEST_ASSERT_EQUAL(PT_WAITING, worker(&pt));
+    TEST_ASSERT_EQUAL(PT_WAITING, worker(&pt));
+    ready = 1;
+    TEST_ASSERT_EQUAL(PT_YIELDED, worker(&pt));
+    TEST_ASSERT_EQUAL(PT_ENDED, worker(&pt));
+
+    TEST_ASSERT_EQUAL_STRING("worker", pt.stats.name);
+    TEST_ASSERT_EQUAL_UINT64(5, pt.stats.resumes);
+    TEST_ASSERT_EQUAL_UINT64(2, pt.stats.yields);
+    TEST_ASSERT_EQUAL_UINT64(2, pt.stats.waits);
+}
+
+/* Test: Time is summed over resumes and the longest resume is kept */
+void test_time(void) {
+    struct pt pt;
+    PT_INIT(&pt);
+    ready = 1;
+
+    while (PT_SCHEDULE(worker(&pt))) {
+    }
+    TEST_ASSERT_EQUAL_UINT64(450, pt.stats.ns);
+    TEST_ASSERT_EQUAL_UINT64(350, pt.stats.max_ns);
+}
+
+/* Test: Ending keeps the statistics and PT_INIT() clears them */
+void test_init_clears(void) {
+    struct pt pt;
+    PT_INIT(&pt);
+
+    TEST_ASSERT_EQUAL(PT_YIELDED, idle(&pt));
+    TEST_ASSERT_EQUAL(PT_ENDED, idle(&pt));
+    TEST_ASSERT_EQUAL(PT_YIELDED, idle(&pt));
+    TEST_ASSERT_EQUAL_UINT64(3, pt.stats.resumes);
+    TEST_ASSERT_EQUAL_UINT64(20, pt.stats.ns);
+
+    PT_INIT(&pt);
+    TEST_ASSERT_EQUAL_UINT64(0, pt.stats.resumes);
+    TEST_ASSERT_EQUAL_UINT64(0, pt.stats.ns);
+    TEST_ASSERT_NULL(pt.stats.name);
+}
+
+/* Test: A parent's time includes its child's */
+void test_child_time(void) {
+    struct pt pt, child;
+    PT_INIT(&pt);
+
+    TEST_ASSERT_EQUAL(PT_WAITING, parent(&pt, &child));
+    TEST_ASSERT_EQUAL(PT_EXITED, parent(&pt, &child));
+    TEST_ASSERT_EQUAL_UINT64(2, child.stats.resumes);
+    TEST_ASSERT_EQUAL_UINT64(10, child.stats.ns);
+    TEST_ASSERT_EQUAL_UINT64(2, pt.stats.resumes);
+    TEST_ASSERT_EQUAL_UINT64(1, pt.stats.waits);
+    TEST_ASSERT_EQUAL_UINT64(10, pt.stats.ns);
+}
+
+static struct pt_sched sched;
+static struct pt_waitq waitq;
+
+static PT_THREAD(blocker(struct pt_task *t)) {
+    PT_BEGIN(&t->pt);
+    pt_waitq_push(&waitq, t);
+    PT_BLOCK(t);
+    PT_END(&t->pt);
+}
+
+/* Test: Blocking on a wait queue counts as a wait */
+void test_block(void) {
+    struct pt_task task;
+    pt_sched_init(&sched);
+    pt_waitq_init(&waitq);
+    pt_sched_spawn(&sched, &task, blocker);
+
+    pt_sched_run(&sched);
+    pt_waitq_wake_all(&waitq);
+    pt_sched_run(&sched);
+    TEST_ASSERT_EQUAL_STRING("blocker", task.pt.stats.name);
+    TEST_ASSERT_EQUAL_UINT64(2, task.pt.stats.resumes);
+    TEST_ASSERT_EQUAL_UINT64(1, task.pt.stats.waits);
+}
+
+/* Test: The top-N dump is sorted by time */
+void test_dump(void) {
+    struct pt a, b, c;
+    struct pt_stats *stats[] = { PT_STATS_OF(&a), PT_STATS_OF(&b), PT_STATS_OF(&c) };
+    char out[512];
+    size_t len;
+    FILE *f;
+
+    PT_INIT(&a);
+    PT_INIT(&b);
+    PT_INIT(&c);
+    ready = 1;
+    idle(&a);
+    while (PT_SCHEDULE(worker(&b))) {
+    }
+    TEST_ASSERT_EQUAL_size_t(2, pt_stats_top(stats, 3, 2));
+    TEST_ASSERT_EQUAL_PTR(&b.stats, stats[0]);
+    TEST_ASSERT_EQUAL_PTR(&a.stats, stats[1]);
+    TEST_ASSERT_EQUAL_PTR(&c.stats, stats[2]);
+
+    f = tmpfile();
+    TEST_ASSERT_NOT_NULL(f);
+    pt_stats_print_json(f, stats, 3, 1);
+    rewind(f);
+    len = fread(out, 1, sizeof(out) - 1, f);
+    out[len] = '\0';
+    fclose(f);
+    TEST_ASSERT_EQUAL_STRING("[\n  {\"name\": \"worker\", \"resumes\": 3, \"yields\": 2, "
+                             "\"waits\": 0, \"ns\": 450, \"max_ns\": 350}\n]\n", out);
+
+    f = tmpfile();
+    TEST_ASSERT_NOT_NULL(f);
+    pt_stats_print(f, stats, 3, 3);
+    rewind(f);
+    len = fread(out, 1, sizeof(out) - 1, f);
+    out[len] = '\0';
+    fclose(f);
+    TEST_ASSERT_NOT_NULL(strstr(out, "worker"));
+    TEST_ASSERT_TRUE(strstr(out, "worker") < strstr(out, "idle"));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_counters);
+    RUN_TEST(test_time);
+    RUN_TEST(test_init_clears);
+    RUN_TEST(test_child_time);
+    RUN_TEST(test_block);
+    RUN_TEST(test_dump);
+    return UNITY_END();
+}
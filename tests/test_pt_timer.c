@@ -0,0 +1,262 @@
+#include "unity.h"
+#include "pt-sched.h"
+
+#include <stdlib.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static struct pt_timer_wheel wheel;
+
+#define NUM_TIMERS 64
+static struct pt_timer timers[NUM_TIMERS];
+static uint32_t fired_at[NUM_TIMERS];
+static int fired_count;
+
+static void record_expiry(struct pt_timer *t) {
+    fired_at[t - timers] = wheel.now;
+    fired_count++;
+}
+
+static void reset_wheel(uint32_t now) {
+    int i;
+    pt_timer_wheel_init(&wheel, record_expiry);
+    wheel.now = now;
+    for (i = 0; i < NUM_TIMERS; i++) {
+        pt_timer_init(&timers[i]);
+        fired_at[i] = 0;
+    }
+    fired_count = 0;
+}
+
+/* Test: Timer fires exactly when its deadline is reached */
+void test_timer_fires_at_deadline(void) {
+    reset_wheel(0);
+    pt_timer_add(&wheel, &timers[0], 5);
+    TEST_ASSERT_TRUE(pt_timer_pending(&timers[0]));
+
+    pt_timer_wheel_advance(&wheel, 4);
+    TEST_ASSERT_EQUAL_INT(0, fired_count);
+    TEST_ASSERT_FALSE(pt_timer_expired(&wheel, &timers[0]));
+
+    pt_timer_wheel_advance(&wheel, 1);
+    TEST_ASSERT_EQUAL_INT(1, fired_count);
+    TEST_ASSERT_EQUAL_UINT32(5, fired_at[0]);
+    TEST_ASSERT_FALSE(pt_timer_pending(&timers[0]));
+    TEST_ASSERT_TRUE(pt_timer_expired(&wheel, &timers[0]));
+}
+
+/* Test: Zero ticks is treated as one tick */
+void test_timer_zero_ticks_fires_next_tick(void) {
+    reset_wheel(0);
+    pt_timer_add(&wheel, &timers[0], 0);
+    pt_timer_wheel_advance(&wheel, 1);
+    TEST_ASSERT_EQUAL_INT(1, fired_count);
+}
+
+/* Test: Cancelled timer does not fire */
+void test_timer_cancel(void) {
+    reset_wheel(0);
+    pt_timer_add(&wheel, &timers[0], 3);
+    pt_timer_add(&wheel, &timers[1], 3);
+    pt_timer_cancel(&timers[0]);
+    TEST_ASSERT_FALSE(pt_timer_pending(&timers[0]));
+
+    pt_timer_wheel_advance(&wheel, 10);
+    TEST_ASSERT_EQUAL_INT(1, fired_count);
+    TEST_ASSERT_EQUAL_UINT32(0, fired_at[0]);
+    TEST_ASSERT_EQUAL_UINT32(3, fired_at[1]);
+
+    /* Cancelling again is harmless */
+    pt_timer_cancel(&timers[0]);
+    pt_timer_cancel(&timers[1]);
+}
+
+/* Test: Adding a pending timer restarts it */
+void test_timer_restart(void) {
+    reset_wheel(0);
+    pt_timer_add(&wheel, &timers[0], 3);
+    pt_timer_wheel_advance(&wheel, 2);
+    pt_timer_add(&wheel, &timers[0], 3);
+    pt_timer_wheel_advance(&wheel, 2);
+    TEST_ASSERT_EQUAL_INT(0, fired_count);
+    pt_timer_wheel_advance(&wheel, 1);
+    TEST_ASSERT_EQUAL_UINT32(5, fired_at[0]);
+}
+
+/* Test: Timers in higher levels are cascaded and fire on time */
+void test_timer_cascades_through_levels(void) {
+    static const uint32_t delays[] = {
+        63, 64, 65, 4095, 4096, 4097, 100000, 262144, 300007
+    };
+    int i, n = (int)(sizeof(delays) / sizeof(delays[0]));
+
+    reset_wheel(17);
+    for (i = 0; i < n; i++) {
+        pt_timer_add(&wheel, &timers[i], delays[i]);
+    }
+    pt_timer_wheel_advance(&wheel, 300007);
+
+    TEST_ASSERT_EQUAL_INT(n, fired_count);
+    for (i = 0; i < n; i++) {
+        TEST_ASSERT_EQUAL_UINT32(17 + delays[i], fired_at[i]);
+    }
+}
+
+/* Test: Timers fire on time across the 32-bit wrap of the counter */
+void test_timer_wraps_around(void) {
+    reset_wheel(0xFFFFFFF0u);
+    pt_timer_add(&wheel, &timers[0], 0x20);
+    pt_timer_add(&wheel, &timers[1], 0x1000);
+    pt_timer_wheel_advance(&wheel, 0x1000);
+
+    TEST_ASSERT_EQUAL_INT(2, fired_count);
+    TEST_ASSERT_EQUAL_UINT32(0x10u, fired_at[0]);
+    TEST_ASSERT_EQUAL_UINT32(0xFF0u, fired_at[1]);
+}
+
+/* Test: Random timers match a brute-force reference */
+void test_timer_random_deadlines(void) {
+    uint32_t expected[NUM_TIMERS];
+    uint32_t max = 0;
+    int i;
+
+    reset_wheel(123456);
+    srand(42);
+    for (i = 0; i < NUM_TIMERS; i++) {
+        uint32_t ticks = 1 + (uint32_t)rand() % 20000;
+        expected[i] = wheel.now + ticks;
+        if (ticks > max) {
+            max = ticks;
+        }
+        pt_timer_add(&wheel, &timers[i], ticks);
+        /* Stagger the start times */
+        pt_timer_wheel_advance(&wheel, (uint32_t)rand() % 50);
+    }
+    pt_timer_wheel_advance(&wheel, max + 1);
+
+    TEST_ASSERT_EQUAL_INT(NUM_TIMERS, fired_count);
+    for (i = 0; i < NUM_TIMERS; i++) {
+        TEST_ASSERT_EQUAL_UINT32(expected[i], fired_at[i]);
+    }
+}
+
+/* Scheduled protothreads using timeouts */
+struct timed_task {
+    struct pt_task task;
+    int flag;
+    int runs;
+    int done;
+    int timed_out;
+};
+
+static PT_THREAD(thread_sleeps(struct pt_task *t)) {
+    struct timed_task *tt = (struct timed_task *)t;
+    tt->runs++;
+    PT_BEGIN(&t->pt);
+    PT_SLEEP(t, 10);
+    tt->done = 1;
+    PT_END(&t->pt);
+}
+
+static PT_THREAD(thread_waits_with_timeout(struct pt_task *t)) {
+    struct timed_task *tt = (struct timed_task *)t;
+    tt->runs++;
+    PT_BEGIN(&t->pt);
+    PT_WAIT_UNTIL_TIMEOUT(t, tt->flag, 10);
+    tt->timed_out = PT_TIMEDOUT(t);
+    tt->done = 1;
+    PT_END(&t->pt);
+}
+
+/* Test: PT_SLEEP parks the task until its deadline */
+void test_pt_sleep(void) {
+    struct pt_sched s;
+    struct timed_task tt = {0};
+    int i;
+    pt_sched_init(&s);
+    pt_sched_spawn(&s, &tt.task, thread_sleeps);
+
+    for (i = 0; i < 9; i++) {
+        pt_sched_run(&s);
+        pt_sched_advance(&s, 1);
+    }
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_INT(0, tt.done);
+    TEST_ASSERT_EQUAL_INT(1, tt.runs);
+
+    pt_sched_advance(&s, 1);
+    pt_sched_run(&s);
+    TEST_ASSERT_EQUAL_INT(1, tt.done);
+    TEST_ASSERT_EQUAL_INT(2, tt.runs);
+}
+
+/* Test: PT_WAIT_UNTIL_TIMEOUT continues when the condition is true */
+void test_wait_until_timeout_condition(void) {
+    struct pt_sched s;
+    struct timed_task tt = {0};
+    pt_sched_init(&s);
+    pt_sched_spawn(&s, &tt.task, thread_waits_with_timeout);
+    pt_sched_run(&s);
+    pt_sched_advance(&s, 5);
+
+    tt.flag = 1;
+    pt_task_wake(&tt.task);
+    pt_sched_run(&s);
+
+    TEST_ASSERT_EQUAL_INT(1, tt.done);
+    TEST_ASSERT_EQUAL_INT(0, tt.timed_out);
+    TEST_ASSERT_FALSE(pt_timer_pending(&tt.task.timer));
+}
+
+/* Test: PT_WAIT_UNTIL_TIMEOUT continues when the timeout expires */
+void test_wait_until_timeout_expires(void) {
+    struct pt_sched s;
+    struct timed_task tt = {0};
+    pt_sched_init(&s);
+    pt_sched_spawn(&s, &tt.task, thread_waits_with_timeout);
+    pt_sched_run(&s);
+
+    pt_sched_advance(&s, 10);
+    pt_sched_run(&s);
+
+    TEST_ASSERT_EQUAL_INT(1, tt.done);
+    TEST_ASSERT_EQUAL_INT(1, tt.timed_out);
+    TEST_ASSERT_EQUAL_INT(2, tt.runs);
+}
+
+/* Test: Finished task does not leave a pending timer behind */
+static PT_THREAD(thread_exits_with_timer(struct pt_task *t)) {
+    PT_BEGIN(&t->pt);
+    pt_timer_add(&t->sched->wheel, &t->timer, 5);
+    PT_EXIT(&t->pt);
+    PT_END(&t->pt);
+}
+
+void test_finished_task_cancels_timer(void) {
+    struct pt_sched s;
+    struct timed_task tt = {0};
+    pt_sched_init(&s);
+    pt_sched_spawn(&s, &tt.task, thread_exits_with_timer);
+    pt_sched_run(&s);
+
+    TEST_ASSERT_FALSE(pt_timer_pending(&tt.task.timer));
+    pt_sched_advance(&s, 10);
+    TEST_ASSERT_TRUE(pt_sched_idle(&s));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_timer_fires_at_deadline);
+    RUN_TEST(test_timer_zero_ticks_fires_next_tick);
+    RUN_TEST(test_timer_cancel);
+    RUN_TEST(test_timer_restart);
+    RUN_TEST(test_timer_cascades_through_levels);
+    RUN_TEST(test_timer_wraps_around);
+    RUN_TEST(test_timer_random_deadlines);
+    RUN_TEST(test_pt_sleep);
+    RUN_TEST(test_wait_until_timeout_condition);
+    RUN_TEST(test_wait_until_timeout_expires);
+    RUN_TEST(test_finished_task_cancels_timer);
+    return UNITY_END();
+}
@@ -0,0 +1,179 @@
+#include "unity.h"
+#include "pt.h"
+
+#include <string.h>
+
+PT_TRACE_DEFINE;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static struct pt_trace trace;
+static struct pt_trace_event events[16];
+static int ready;
+
+static PT_THREAD(worker(struct pt *pt)) {
+    PT_BEGIN(pt);
+    PT_YIELD(pt);
+    PT_WAIT_UNTIL(pt, ready);
+    PT_END(pt);
+}
+
+static PT_THREAD(quick(struct pt *pt)) {
+    PT_BEGIN(pt);
+    PT_END(pt);
+}
+
+static PT_THREAD(parent(struct pt *pt, struct pt *child)) {
+    PT_BEGIN(pt);
+    PT_SPAWN(pt, child, worker(child));
+    PT_EXIT(pt);
+    PT_END(pt);
+}
+
+static void check_event(uint32_t i, const void *pt, const char *name, int ret) {
+    const struct pt_trace_event *e = pt_trace_event(&trace, i);
+    TEST_ASSERT_EQUAL_PTR(pt, e->pt);
+    TEST_ASSERT_EQUAL_STRING(name, e->name);
+    TEST_ASSERT_EQUAL_INT(ret, e->ret);
+    if (ret == PT_TRACE_RESUME) {
+        TEST_ASSERT_EQUAL_UINT32(0, e->line);
+    } else {
+        TEST_ASSERT_TRUE(e->line > 0);
+    }
+}
+
+/* Test: Every resume and return is recorded in order */
+void test_events(void) {
+    struct pt pt;
+    uint32_t i;
+    pt_trace_init(&trace, events, 16, 0);
+    pt_trace_attach(&trace);
+    PT_INIT(&pt);
+    ready = 0;
+
+    TEST_ASSERT_EQUAL(PT_YIELDED, worker(&pt));
+    TEST_ASSERT_EQUAL(PT_WAITING, worker(&pt));
+    ready = 1;
+    TEST_ASSERT_EQUAL(PT_ENDED, worker(&pt));
+    pt_trace_attach(NULL);
+
+    TEST_ASSERT_EQUAL_UINT32(6, pt_trace_count(&trace));
+    check_event(0, &pt, "worker", PT_TRACE_RESUME);
+    check_event(1, &pt, "worker", PT_YIELDED);
+    check_event(2, &pt, "worker", PT_TRACE_RESUME);
+    check_event(3, &pt, "worker", PT_WAITING);
+    check_event(4, &pt, "worker", PT_TRACE_RESUME);
+    check_event(5, &pt, "worker", PT_ENDED);
+    TEST_ASSERT_TRUE(pt_trace_event(&trace, 1)->line < pt_trace_event(&trace, 3)->line);
+    for (i = 1; i < 6; i++) {
+        TEST_ASSERT_TRUE(pt_trace_event(&trace, i)->ticks >= pt_trace_event(&trace, i - 1)->ticks);
+    }
+}
+
+/* Test: Nothing is recorded without a trace buffer */
+void test_detached(void) {
+    struct pt pt;
+    pt_trace_init(&trace, events, 16, 0);
+    PT_INIT(&pt);
+
+    worker(&pt);
+    TEST_ASSERT_EQUAL_UINT32(0, pt_trace_count(&trace));
+}
+
+/* Test: Child protothreads are nested in their parent */
+void test_nested(void) {
+    struct pt pt, child;
+    pt_trace_init(&trace, events, 16, 0);
+    pt_trace_attach(&trace);
+    PT_INIT(&pt);
+    ready = 1;
+
+    TEST_ASSERT_EQUAL(PT_WAITING, parent(&pt, &child));
+    TEST_ASSERT_EQUAL(PT_EXITED, parent(&pt, &child));
+    pt_trace_attach(NULL);
+
+    TEST_ASSERT_EQUAL_UINT32(8, pt_trace_count(&trace));
+    check_event(0, &pt, "parent", PT_TRACE_RESUME);
+    check_event(1, &child, "worker", PT_TRACE_RESUME);
+    check_event(2, &child, "worker", PT_YIELDED);
+    check_event(3, &pt, "parent", PT_WAITING);
+    check_event(4, &pt, "parent", PT_TRACE_RESUME);
+    check_event(5, &child, "worker", PT_TRACE_RESUME);
+    check_event(6, &child, "worker", PT_ENDED);
+    check_event(7, &pt, "parent", PT_EXITED);
+}
+
+/* Test: A full ring keeps the newest events */
+void test_wraparound(void) {
+    struct pt pt;
+    int i;
+    pt_trace_init(&trace, events, 16, 0);
+    pt_trace_attach(&trace);
+    PT_INIT(&pt);
+    ready = 1;
+
+    for (i = 0; i < 9; i++) {
+        worker(&pt);
+    }
+    pt_trace_attach(NULL);
+
+    /* 18 events, of which the first two were overwritten */
+    TEST_ASSERT_EQUAL_UINT32(16, pt_trace_count(&trace));
+    check_event(0, &pt, "worker", PT_TRACE_RESUME);
+    check_event(1, &pt, "worker", PT_ENDED);
+    check_event(15, &pt, "worker", PT_YIELDED);
+}
+
+/* Test: The trace is written as Chrome trace events */
+void test_json(void) {
+    struct pt_trace *traces[] = { &trace };
+    struct pt pt, child;
+    char out[4096];
+    const char *p;
+    int written = 0;
+    size_t len;
+    FILE *f;
+    pt_trace_init(&trace, events, 8, 7);
+    pt_trace_attach(&trace);
+    PT_INIT(&pt);
+    ready = 1;
+
+    /* 10 events: the first resumes of the parent and the child are lost */
+    parent(&pt, &child);
+    parent(&pt, &child);
+    quick(&pt);
+    pt_trace_attach(NULL);
+
+    f = tmpfile();
+    TEST_ASSERT_NOT_NULL(f);
+    pt_trace_write_json(f, traces, 1);
+    rewind(f);
+    len = fread(out, 1, sizeof(out) - 1, f);
+    out[len] = '\0';
+    fclose(f);
+
+    TEST_ASSERT_EQUAL_INT(0, strncmp(out, "{\"traceEvents\": [", 17));
+    TEST_ASSERT_NOT_NULL(strstr(out, "\"ph\": \"B\""));
+    TEST_ASSERT_NOT_NULL(strstr(out, "\"tid\": 7"));
+    TEST_ASSERT_NOT_NULL(strstr(out, "\"ret\": \"PT_EXITED\""));
+    TEST_ASSERT_NOT_NULL(strstr(out, "\"name\": \"quick\""));
+    /* The returns whose resumes were lost are skipped */
+    TEST_ASSERT_NULL(strstr(out, "PT_YIELDED"));
+    TEST_ASSERT_NULL(strstr(out, "PT_WAITING"));
+    for (p = out; (p = strstr(p, "\"ph\"")) != NULL; p++) {
+        written++;
+    }
+    TEST_ASSERT_EQUAL_INT(6, written);
+    TEST_ASSERT_EQUAL_STRING("\n]}\n", out + len - 4);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_events);
+    RUN_TEST(test_detached);
+    RUN_TEST(test_nested);
+    RUN_TEST(test_wraparound);
+    RUN_TEST(test_json);
+    return UNITY_END();
+}
@@ -0,0 +1,249 @@
+#include "unity.h"
+#include "pt-uring.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/socket.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static struct pt_sched sched;
+static struct pt_uring uring;
+
+struct io_task {
+    struct pt_task task;
+    struct pt_io_handle h;
+    char buf[16];
+    const char *data;
+    size_t len;
+    ssize_t res;
+    int err;
+    int runs;
+    int done;
+};
+
+static void run(void) {
+    pt_sched_run(&sched);
+    pt_uring_poll(&uring, 0);
+}
+
+static void start(uint32_t entries) {
+    pt_sched_init(&sched);
+    TEST_ASSERT_EQUAL_INT(0, pt_uring_init(&uring, &sched, entries));
+    if (entries > 0 && !pt_uring_available(&uring)) {
+        pt_uring_close(&uring);
+        TEST_IGNORE_MESSAGE("io_uring is not available");
+    }
+}
+
+static PT_THREAD(thread_reads(struct pt_task *t)) {
+    struct io_task *it = (struct io_task *)t;
+    it->runs++;
+    PT_BEGIN(&t->pt);
+    PT_IO_READ(t, &uring, &it->h, it->buf, sizeof(it->buf), it->res);
+    it->err = it->res < 0 ? errno : 0;
+    it->done = 1;
+    PT_END(&t->pt);
+}
+
+static PT_THREAD(thread_writes(struct pt_task *t)) {
+    struct io_task *it = (struct io_task *)t;
+    it->runs++;
+    PT_BEGIN(&t->pt);
+    PT_IO_WRITE(t, &uring, &it->h, it->data, it->len, it->res);
+    it->done = 1;
+    PT_END(&t->pt);
+}
+
+static void spawn(struct io_task *it, int fd, pt_task_fn fn) {
+    memset(it, 0, sizeof(*it));
+    TEST_ASSERT_EQUAL_INT(0, pt_uring_add(&uring, &it->h, fd));
+    pt_sched_spawn(&sched, &it->task, fn);
+}
+
+/* A read blocks until data arrives and returns what is there */
+static void check_read_blocks(uint32_t entries) {
+    struct io_task it;
+    int fds[2];
+
+    start(entries);
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    pt_io_nonblock(fds[0]);
+    spawn(&it, fds[0], thread_reads);
+
+    run();
+    run();
+    TEST_ASSERT_EQUAL_INT(0, it.done);
+    TEST_ASSERT_EQUAL_INT(1, it.runs);
+    TEST_ASSERT_TRUE(pt_sched_idle(&sched));
+
+    TEST_ASSERT_EQUAL_INT(5, write(fds[1], "hello", 5));
+    pt_uring_poll(&uring, 1000);
+    run();
+    TEST_ASSERT_EQUAL_INT(1, it.done);
+    TEST_ASSERT_EQUAL_INT(5, it.res);
+    TEST_ASSERT_EQUAL_MEMORY("hello", it.buf, 5);
+
+    pt_uring_del(&uring, &it.h);
+    close(fds[0]);
+    close(fds[1]);
+    pt_uring_close(&uring);
+}
+
+/* Reads and writes work on regular files at the current position */
+static void check_file(uint32_t entries) {
+    struct io_task it;
+    FILE *f = tmpfile();
+    int fd = fileno(f);
+
+    start(entries);
+    spawn(&it, fd, thread_writes);
+    it.data = "protothreads";
+    it.len = 12;
+    while (!it.done) {
+        run();
+    }
+    TEST_ASSERT_EQUAL_INT(12, it.res);
+    pt_uring_del(&uring, &it.h);
+
+    TEST_ASSERT_EQUAL_INT(4, (int)lseek(fd, 4, SEEK_SET));
+    spawn(&it, fd, thread_reads);
+    while (!it.done) {
+        run();
+    }
+    TEST_ASSERT_EQUAL_INT(8, it.res);
+    TEST_ASSERT_EQUAL_MEMORY("othreads", it.buf, 8);
+
+    /* The end of file */
+    spawn(&it, fd, thread_reads);
+    while (!it.done) {
+        run();
+    }
+    TEST_ASSERT_EQUAL_INT(0, it.res);
+
+    pt_uring_del(&uring, &it.h);
+    fclose(f);
+    pt_uring_close(&uring);
+}
+
+/* Errors are returned as -1 with errno set */
+static void check_error(uint32_t entries) {
+    struct io_task it;
+    int fds[2];
+
+    start(entries);
+    TEST_ASSERT_EQUAL_INT(0, pipe(fds));
+    pt_io_nonblock(fds[1]);
+    /* Reading from the write end of a pipe fails */
+    spawn(&it, fds[1], thread_reads);
+    while (!it.done) {
+        run();
+    }
+    TEST_ASSERT_EQUAL_INT(-1, it.res);
+    TEST_ASSERT_EQUAL_INT(EBADF, it.err);
+
+    pt_uring_del(&uring, &it.h);
+    close(fds[0]);
+    close(fds[1]);
+    pt_uring_close(&uring);
+}
+
+/* More requests than submission queue entries are all completed */
+#define MANY 40
+
+static void check_many(uint32_t entries) {
+    static struct io_task it[MANY];
+    int fds[MANY][2];
+    int i, done, rounds = 0;
+
+    start(entries);
+    for (i = 0; i < MANY; i++) {
+        TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds[i]));
+        pt_io_nonblock(fds[i][0]);
+        spawn(&it[i], fds[i][0], thread_reads);
+    }
+    run();
+    for (i = 0; i < MANY; i++) {
+        TEST_ASSERT_EQUAL_INT(1, write(fds[i][1], "x", 1));
+    }
+    do {
+        pt_uring_poll(&uring, 100);
+        pt_sched_run(&sched);
+        for (done = 0, i = 0; i < MANY; i++) {
+            done += it[i].done;
+        }
+    } while (done < MANY && ++rounds < 1000);
+
+    TEST_ASSERT_EQUAL_INT(MANY, done);
+    for (i = 0; i < MANY; i++) {
+        TEST_ASSERT_EQUAL_INT(1, it[i].res);
+        pt_uring_del(&uring, &it[i].h);
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+    pt_uring_close(&uring);
+}
+
+/* A request fails if the submission queue stays full */
+static void check_sq_stuck(void) {
+    static struct io_task it[9];
+    int fds[9][2];
+    int i, ring_fd;
+
+    start(8);
+    for (i = 0; i < 9; i++) {
+        TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds[i]));
+    }
+    /* Fill the submission queue without submitting it */
+    for (i = 0; i < 8; i++) {
+        spawn(&it[i], fds[i][0], thread_reads);
+    }
+    pt_sched_run(&sched);
+    TEST_ASSERT_EQUAL_UINT32(8, uring.to_submit);
+
+    /* io_uring_enter() fails on a file that is not a ring */
+    ring_fd = uring.ring_fd;
+    uring.ring_fd = open("/dev/null", O_RDONLY);
+    TEST_ASSERT_TRUE(uring.ring_fd >= 0);
+    spawn(&it[8], fds[8][0], thread_reads);
+    pt_sched_run(&sched);
+    TEST_ASSERT_EQUAL_INT(1, it[8].done);
+    TEST_ASSERT_EQUAL_INT(-1, it[8].res);
+    TEST_ASSERT_NOT_EQUAL(0, it[8].err);
+    close(uring.ring_fd);
+    uring.ring_fd = ring_fd;
+
+    for (i = 0; i < 9; i++) {
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+    pt_uring_close(&uring);
+}
+
+/* Test: io_uring engine */
+void test_uring_read_blocks(void) { check_read_blocks(8); }
+void test_uring_file(void) { check_file(8); }
+void test_uring_error(void) { check_error(8); }
+void test_uring_many_requests(void) { check_many(8); }
+void test_uring_sq_stuck(void) { check_sq_stuck(); }
+
+/* Test: epoll fallback */
+void test_fallback_read_blocks(void) { check_read_blocks(0); }
+void test_fallback_file(void) { check_file(0); }
+void test_fallback_error(void) { check_error(0); }
+void test_fallback_many_requests(void) { check_many(0); }
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_uring_read_blocks);
+    RUN_TEST(test_uring_file);
+    RUN_TEST(test_uring_error);
+    RUN_TEST(test_uring_many_requests);
+    RUN_TEST(test_uring_sq_stuck);
+    RUN_TEST(test_fallback_read_blocks);
+    RUN_TEST(test_fallback_file);
+    RUN_TEST(test_fallback_error);
+    RUN_TEST(test_fallback_many_requests);
+    return UNITY_END();
+}